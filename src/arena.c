@@ -0,0 +1,234 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+
+
+
+
+/**
+ * Capacity of the first block, if no capacity was requested
+ */
+#ifndef GL_ARENA_DEFAULT_CAPACITY
+#define GL_ARENA_DEFAULT_CAPACITY 65536
+#endif
+
+/**
+ * Alignment of all allocations which are not strings
+ */
+#define GL_ARENA_ALIGNMENT (sizeof(max_align_t))
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Contiguous chunk of memory, allocations are carved off the front
+ */
+struct gl_arena_block {
+	struct gl_arena_block* next;
+
+	size_t capacity;
+	size_t used;
+
+	max_align_t data[];
+};
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * The arena itself lives in front of its first block, so an arena created
+ * large enough for a catalog costs exactly one call to the system allocator
+ */
+struct gl_arena {
+	struct gl_arena_block* current;
+	size_t blocks;
+
+	struct gl_arena_block first;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Pointer to `length' bytes inside `block' or 0 if it is full
+ */
+static void* allocate_in_block(	struct gl_arena_block* block,
+				size_t length,
+				size_t alignment
+		) {
+	size_t offset = (block->used + alignment - 1) & ~(alignment - 1);
+
+	if (offset + length > block->capacity) {
+		return 0;
+	}
+	block->used = offset + length;
+	return (uint8_t*)block->data + offset;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Bump allocation, moves on to the next block (reusing blocks kept by
+ * gl_reset_arena) or requests a new one from the system allocator
+ */
+static void* allocate(struct gl_arena* arena, size_t length, size_t alignment) {
+
+	for (;;) {
+		void* memory = allocate_in_block(arena->current, length, alignment);
+		if (memory) {
+			return memory;
+		}
+		if (!arena->current->next) {
+			break;
+		}
+		arena->current = arena->current->next;
+	}
+
+
+	/* Grow geometrically, but always fit the requested length
+	 */
+	size_t capacity = 2 * arena->current->capacity;
+	if (capacity < length + alignment) {
+		capacity = length + alignment;
+	}
+
+	struct gl_arena_block* block = malloc(sizeof(struct gl_arena_block) + capacity);
+	block->next = 0;
+	block->capacity = capacity;
+	block->used = 0;
+
+	arena->current->next = block;
+	arena->current = block;
+	arena->blocks += 1;
+
+	return allocate_in_block(block, length, alignment);
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_arena* gl_create_arena(size_t capacity) {
+	if (!capacity) {
+		capacity = GL_ARENA_DEFAULT_CAPACITY;
+	}
+
+	struct gl_arena* arena = malloc(sizeof(struct gl_arena) + capacity);
+	arena->current = &arena->first;
+	arena->blocks = 1;
+
+	arena->first.next = 0;
+	arena->first.capacity = capacity;
+	arena->first.used = 0;
+
+	return arena;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_reset_arena(struct gl_arena* arena) {
+	struct gl_arena_block* block = &arena->first;
+
+	for (; block; block = block->next) {
+		block->used = 0;
+	}
+	arena->current = &arena->first;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_arena(struct gl_arena* arena) {
+	struct gl_arena_block* block = arena->first.next;
+
+	while (block) {
+		struct gl_arena_block* next = block->next;
+		free(block);
+		block = next;
+	}
+	free(arena);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void* gl_arena_allocate(struct gl_arena* arena, size_t length) {
+	return allocate(arena, length, GL_ARENA_ALIGNMENT);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t* gl_arena_allocate_string(struct gl_arena* arena, size_t length) {
+	uint8_t* string = allocate(arena, length + 1, 1);
+
+	string[length] = 0;
+	return string;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t* gl_arena_copy(struct gl_arena* arena, uint8_t const* data, size_t length) {
+	uint8_t* copy = gl_arena_allocate_string(arena, length);
+
+	memcpy(copy, data, length);
+	return copy;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_arena_blocks(struct gl_arena* arena) {
+	return arena->blocks;
+}
+
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_ARENA
+#define GLTOOLKIT_ARENA
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+
+
+
+
+/**
+ * Allocates `length' bytes from the arena, aligned for any type
+ *
+ * @warning Memory must not be freed individually, it is released by
+ *     gl_reset_arena or gl_free_arena
+ */
+void* gl_arena_allocate(struct gl_arena* arena, size_t length);
+
+/**
+ * Allocates room for a string of `length' bytes plus 0-terminator, packed
+ * next to the previously allocated string
+ *
+ * @return Buffer with `length' + 1 bytes, the last one already set to 0
+ */
+uint8_t* gl_arena_allocate_string(struct gl_arena* arena, size_t length);
+
+/**
+ * Copies `length' bytes of `data' into the arena and appends a 0-terminator
+ *
+ * @return Copy of `data'
+ */
+uint8_t* gl_arena_copy(struct gl_arena* arena, uint8_t const* data, size_t length);
+
+/**
+ * @return Number of blocks requested from the system allocator
+ */
+size_t gl_get_arena_blocks(struct gl_arena* arena);
+
+
+
+
+
+#endif
+
@@ -0,0 +1,435 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "error.h"
+
+
+
+
+
+/**
+ * File name suffixes of cache entries
+ */
+#define GL_CACHE_BODY_SUFFIX ".body"
+#define GL_CACHE_META_SUFFIX ".meta"
+
+/**
+ * Meta file header lines
+ */
+#define GL_CACHE_ETAG "ETag: "
+#define GL_CACHE_LAST_MODIFIED "Last-Modified: "
+
+
+
+
+
+/**
+ * [OPAQUE API]
+ */
+struct gl_cache {
+	uint8_t* directory;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * New body is written into a temporary file next to the cache entry, which
+ * replaces the entry on commit
+ */
+struct gl_cache_writer {
+	struct gl_cache* cache;
+	uint8_t* url;
+
+	FILE* file;
+	uint8_t* temporary_path;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return 64 bit FNV-1a hash of `url'
+ */
+static uint64_t hash_url(uint8_t const* url) {
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (; *url; ++url) {
+		hash ^= *url;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Path of the cache file of `url' with `suffix', has to be freed by
+ *     the caller
+ */
+static uint8_t* cache_path(	struct gl_cache* cache,
+				uint8_t const* url,
+				uint8_t const* suffix
+		) {
+	size_t length = strlen(cache->directory) + 1 + 16 + strlen(suffix) + 1;
+	uint8_t* path = malloc(length);
+
+	snprintf(path, length, "%s/%016llx%s",
+		cache->directory, (unsigned long long)hash_url(url), suffix
+	);
+	return path;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Reads one line without its line break
+ *
+ * @return Line which has to be freed by the caller or 0 at the end of file
+ */
+static uint8_t* read_line(FILE* file) {
+	char* line = 0;
+	size_t capacity = 0;
+	ssize_t length = getline(&line, &capacity, file);
+
+	if (length < 0) {
+		free(line);
+		return 0;
+	}
+	if (length && '\n' == line[length - 1]) {
+		line[length - 1] = 0;
+	}
+	return line;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Reads the meta file of `url'. The URL is stored in the first line, so hash
+ * collisions are detected
+ *
+ * @return true iff the meta file belongs to `url'
+ */
+static bool read_meta(	struct gl_cache* cache,
+			uint8_t const* url,
+			uint8_t** etag,
+			uint8_t** last_modified
+		) {
+	*etag = 0;
+	*last_modified = 0;
+
+	uint8_t* path = cache_path(cache, url, GL_CACHE_META_SUFFIX);
+	FILE* meta = fopen(path, "rb");
+	free(path);
+
+	if (!meta) {
+		return false;
+	}
+
+	uint8_t* line = read_line(meta);
+	bool matches = line && !strcmp(line, url);
+	free(line);
+
+	while (matches && (line = read_line(meta))) {
+		size_t etag_length = strlen(GL_CACHE_ETAG);
+		size_t last_modified_length = strlen(GL_CACHE_LAST_MODIFIED);
+
+		if (!strncmp(line, GL_CACHE_ETAG, etag_length)) {
+			free(*etag);
+			*etag = strdup(&line[etag_length]);
+		} else if (!strncmp(line, GL_CACHE_LAST_MODIFIED, last_modified_length)) {
+			free(*last_modified);
+			*last_modified = strdup(&line[last_modified_length]);
+		}
+		free(line);
+	}
+	fclose(meta);
+
+	if (!matches) {
+		free(*etag);
+		free(*last_modified);
+		*etag = 0;
+		*last_modified = 0;
+	}
+	return matches;
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_cache* gl_create_cache(uint8_t const* directory) {
+	if (mkdir(directory, 0777) && EEXIST != errno) {
+		gl_set_error("Cannot create cache directory %s", directory);
+		return 0;
+	}
+
+	struct stat status;
+	if (stat(directory, &status) || !S_ISDIR(status.st_mode)) {
+		gl_set_error("Cache %s is not a directory", directory);
+		return 0;
+	}
+
+	struct gl_cache* cache = malloc(sizeof(struct gl_cache));
+	cache->directory = strdup(directory);
+	return cache;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_get_cache_validators(	struct gl_cache* cache,
+				uint8_t const* url,
+				uint8_t** etag,
+				uint8_t** last_modified
+		) {
+	if (!read_meta(cache, url, etag, last_modified)) {
+		return false;
+	}
+
+
+	/* Validators are useless without the body they validate
+	 */
+	uint8_t* path = cache_path(cache, url, GL_CACHE_BODY_SUFFIX);
+	bool cached = (*etag || *last_modified) && !access(path, R_OK);
+	free(path);
+
+	if (!cached) {
+		free(*etag);
+		free(*last_modified);
+		*etag = 0;
+		*last_modified = 0;
+	}
+	return cached;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+FILE* gl_open_cache_body(	struct gl_cache* cache,
+				uint8_t const* url,
+				size_t* length
+		) {
+	uint8_t* etag = 0;
+	uint8_t* last_modified = 0;
+	bool matches = read_meta(cache, url, &etag, &last_modified);
+
+	free(etag);
+	free(last_modified);
+
+	if (!matches) {
+		return 0;
+	}
+
+	uint8_t* path = cache_path(cache, url, GL_CACHE_BODY_SUFFIX);
+	FILE* body = fopen(path, "rb");
+	free(path);
+
+	struct stat status;
+	if (!body || fstat(fileno(body), &status)) {
+		if (body) {
+			fclose(body);
+		}
+		return 0;
+	}
+
+	*length = status.st_size;
+	return body;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_cache_writer* gl_create_cache_writer(
+			struct gl_cache* cache, uint8_t const* url
+		) {
+	uint8_t* temporary_path = cache_path(cache, url, GL_CACHE_BODY_SUFFIX ".XXXXXX");
+	int descriptor = mkstemp(temporary_path);
+
+	if (descriptor < 0) {
+		gl_set_error("Cannot create cache file %s", temporary_path);
+		free(temporary_path);
+		return 0;
+	}
+
+	FILE* file = fdopen(descriptor, "wb");
+	if (!file) {
+		gl_set_error("Cannot write cache file %s", temporary_path);
+		close(descriptor);
+		unlink(temporary_path);
+		free(temporary_path);
+		return 0;
+	}
+
+	struct gl_cache_writer* writer = malloc(sizeof(struct gl_cache_writer));
+	writer->cache = cache;
+	writer->url = strdup(url);
+	writer->file = file;
+	writer->temporary_path = temporary_path;
+	return writer;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_write_cache_writer(	struct gl_cache_writer* writer,
+				uint8_t const* data, size_t length
+		) {
+	return length == fwrite(data, 1, length, writer->file);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_commit_cache_writer(	struct gl_cache_writer* writer,
+				uint8_t const* etag,
+				uint8_t const* last_modified
+		) {
+	if (!(etag || last_modified)) {
+		goto exit_failure;
+	}
+
+	FILE* file = writer->file;
+	writer->file = 0;
+
+	if (fclose(file)) {
+		goto exit_failure;
+	}
+
+
+	/* Write meta data next to the new body
+	 */
+	uint8_t* meta_path = cache_path(writer->cache, writer->url, GL_CACHE_META_SUFFIX);
+	uint8_t* body_path = cache_path(writer->cache, writer->url, GL_CACHE_BODY_SUFFIX);
+	uint8_t* temporary_meta_path = cache_path(writer->cache, writer->url, GL_CACHE_META_SUFFIX ".XXXXXX");
+
+	int descriptor = mkstemp(temporary_meta_path);
+	FILE* meta = descriptor < 0 ? 0 : fdopen(descriptor, "wb");
+	bool written = meta;
+
+	if (descriptor >= 0 && !meta) {
+		close(descriptor);
+	}
+
+	if (meta) {
+		fprintf(meta, "%s\n", writer->url);
+		if (etag) {
+			fprintf(meta, "%s%s\n", GL_CACHE_ETAG, etag);
+		}
+		if (last_modified) {
+			fprintf(meta, "%s%s\n", GL_CACHE_LAST_MODIFIED, last_modified);
+		}
+		bool failed = ferror(meta);
+		written = !fclose(meta) && !failed;
+	}
+
+
+	/* Remove old meta data first, so a body is never revalidated with
+	 * validators of another body
+	 */
+	if (written) {
+		unlink(meta_path);
+		written = !rename(writer->temporary_path, body_path)
+			&& !rename(temporary_meta_path, meta_path)
+		;
+	}
+	if (!written) {
+		gl_set_error("Cannot store %s in cache", writer->url);
+		unlink(temporary_meta_path);
+	}
+
+	free(meta_path);
+	free(body_path);
+	free(temporary_meta_path);
+
+	if (!written) {
+		goto exit_failure;
+	}
+
+	free(writer->url);
+	free(writer->temporary_path);
+	free(writer);
+	return true;
+
+
+	/* Discard temporary body
+	 */
+exit_failure:
+	gl_abort_cache_writer(writer);
+	return false;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_abort_cache_writer(struct gl_cache_writer* writer) {
+	if (writer->file) {
+		fclose(writer->file);
+	}
+	unlink(writer->temporary_path);
+
+	free(writer->url);
+	free(writer->temporary_path);
+	free(writer);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_cache(struct gl_cache* cache) {
+	free(cache->directory);
+	free(cache);
+}
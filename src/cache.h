@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_CACHE
+#define GLTOOLKIT_CACHE
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Opaque structures
+ */
+struct gl_cache;
+struct gl_cache_writer;
+
+
+
+
+
+/**
+ * Opens a persistent response cache inside `directory', which is created if
+ * it does not exist yet. Every URL is stored as body and meta file named
+ * after the URL's hash
+ *
+ * @return Cache or 0 iff the directory is not usable
+ */
+struct gl_cache* gl_create_cache(uint8_t const* directory);
+
+/**
+ * Looks up the validators of the cached response of `url'. Both values have
+ * to be freed by the caller
+ *
+ * @param etag ETag of the cached response or 0
+ * @param last_modified Last-Modified date of the cached response or 0
+ *
+ * @return true iff a response of `url' is cached
+ */
+bool gl_get_cache_validators(	struct gl_cache* cache,
+				uint8_t const* url,
+				uint8_t** etag,
+				uint8_t** last_modified
+);
+
+/**
+ * Opens the cached body of `url' for reading
+ *
+ * @param length Length of the body in bytes
+ *
+ * @return Body positioned at its first byte or 0 iff nothing is cached
+ */
+FILE* gl_open_cache_body(	struct gl_cache* cache,
+				uint8_t const* url,
+				size_t* length
+);
+
+/**
+ * Starts storing a new response of `url'. The previously cached response
+ * stays valid until the writer is committed
+ *
+ * @return Writer or 0 on failure
+ */
+struct gl_cache_writer* gl_create_cache_writer(
+	struct gl_cache* cache, uint8_t const* url
+);
+
+/**
+ * Appends `length' bytes to the new body
+ *
+ * @return false on I/O errors
+ */
+bool gl_write_cache_writer(	struct gl_cache_writer* writer,
+				uint8_t const* data, size_t length
+);
+
+/**
+ * Replaces the cached response with the written body and frees the writer.
+ * Responses without validators are not kept, since they cannot be
+ * revalidated
+ *
+ * @param etag ETag header of the response (optional)
+ * @param last_modified Last-Modified header of the response (optional)
+ *
+ * @return true iff the response was stored
+ */
+bool gl_commit_cache_writer(	struct gl_cache_writer* writer,
+				uint8_t const* etag,
+				uint8_t const* last_modified
+);
+
+/**
+ * Discards the written body and frees the writer
+ */
+void gl_abort_cache_writer(struct gl_cache_writer* writer);
+
+/**
+ * Frees all resources allocated by struct, cached responses are kept on disk
+ */
+void gl_free_cache(struct gl_cache* cache);
+
+
+
+
+
+#endif
@@ -0,0 +1,740 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "codegen.h"
+#include "error.h"
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Keywords of C++, language codes like `or' cannot be used as namespace
+ */
+static char const* const cpp_keywords[] = {
+	"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand",
+	"bitor", "bool", "break", "case", "catch", "char", "char16_t",
+	"char32_t", "char8_t", "class", "co_await", "co_return", "co_yield",
+	"compl", "concept", "const", "const_cast", "consteval", "constexpr",
+	"constinit", "continue", "decltype", "default", "delete", "do",
+	"double", "dynamic_cast", "else", "enum", "explicit", "export",
+	"extern", "false", "float", "for", "friend", "goto", "if", "inline",
+	"int", "long", "mutable", "namespace", "new", "noexcept", "not",
+	"not_eq", "nullptr", "operator", "or", "or_eq", "private",
+	"protected", "public", "register", "reinterpret_cast", "requires",
+	"return", "short", "signed", "sizeof", "static", "static_assert",
+	"static_cast", "struct", "switch", "template", "this", "thread_local",
+	"throw", "true", "try", "typedef", "typeid", "typename", "union",
+	"unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while",
+	"xor", "xor_eq"
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * One string of the catalog
+ */
+struct codegen_string {
+	uint8_t const* master_string;
+	uint8_t const* logical_string;
+	uint8_t const* translation;
+
+	/* Upper case identifier derived from the LogicalString, 0 iff it is
+	 * empty
+	 */
+	uint8_t* id;
+
+	/* Position inside the catalog, keeps the first of duplicates
+	 */
+	size_t index;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Tables of the generated sources
+ */
+struct codegen_catalog {
+	uint8_t* project;
+	uint8_t* project_upper;
+	uint8_t* language;
+
+	/* Strings with id ordered by id
+	 */
+	struct codegen_string* ids;
+	size_t ids_count;
+
+	/* Translated strings ordered by master string
+	 */
+	struct codegen_string* translated;
+	size_t translated_count;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Orders strings by id, ties are broken by LogicalString and catalog position
+ */
+static int compare_ids(void const* a, void const* b) {
+	struct codegen_string const* string_a = a;
+	struct codegen_string const* string_b = b;
+	int order = strcmp(string_a->id, string_b->id);
+
+	if (order) {
+		return order;
+	}
+	order = strcmp(string_a->logical_string, string_b->logical_string);
+
+	if (order) {
+		return order;
+	}
+	return (string_a->index > string_b->index) - (string_a->index < string_b->index);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Orders strings by master string, ties are broken by catalog position
+ */
+static int compare_master_strings(void const* a, void const* b) {
+	struct codegen_string const* string_a = a;
+	struct codegen_string const* string_b = b;
+	int order = strcmp(string_a->master_string, string_b->master_string);
+
+	if (order) {
+		return order;
+	}
+	return (string_a->index > string_b->index) - (string_a->index < string_b->index);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return `name' as upper case identifier suffix, e.g. `menu.start' as
+ *     `MENU_START'. Has to be freed by the caller
+ */
+static uint8_t* upper_identifier(uint8_t const* name) {
+	uint8_t* identifier = strdup(name);
+
+	uint8_t* c = identifier; for (; *c; ++c) {
+		*c = isalnum(*c) && *c < 0x80 ? toupper(*c) : '_';
+	}
+	return identifier;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Name of the namespace of `identifier', which has to be freed by the
+ *     caller
+ */
+static uint8_t* namespace_identifier(uint8_t const* identifier) {
+	size_t length = strlen(identifier);
+	uint8_t* name = malloc(length + 2);
+	memcpy(name, identifier, length + 1);
+
+	size_t i = 0; for (; i < sizeof(cpp_keywords) / sizeof(cpp_keywords[0]); ++i) {
+		if (!strcmp(cpp_keywords[i], identifier)) {
+			name[length] = '_';
+			name[length + 1] = 0;
+			break;
+		}
+	}
+	return name;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Adds every string of `translations' with LogicalString to `ids'
+ *
+ * @return Number of strings in `ids'
+ */
+static size_t add_ids(	struct codegen_string* ids,
+			size_t count,
+			struct gl_translations* translations
+		) {
+	size_t i = 0; for (; i < gl_get_translations_count(translations); ++i) {
+		struct gl_translation* translation = gl_get_translation(translations, i);
+
+		if (!gl_get_translation_logical_string_length(translation)) {
+			continue;
+		}
+		struct codegen_string string = {
+			.master_string = gl_get_translation_master_string(translation),
+			.logical_string = gl_get_translation_logical_string(translation),
+			.translation = gl_get_translation_string(translation),
+			.id = upper_identifier(gl_get_translation_logical_string(translation)),
+			.index = i
+		};
+
+		if (!gl_get_translation_string_length(translation)) {
+			string.translation = string.master_string;
+		}
+		ids[count++] = string;
+	}
+	return count;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Sorts `ids' and keeps only the first string of every id, which is the one
+ * with the least LogicalString. Different LogicalStrings mapping to the same
+ * id, like `menu.start' and `menu_start', are counted in `collisions' and
+ * the first of them is described by gl_set_error (optional)
+ *
+ * @return Number of unique ids
+ */
+static size_t unique_ids(	struct codegen_string* ids,
+				size_t count,
+				uint8_t const* project_upper,
+				size_t* collisions
+		) {
+	qsort(ids, count, sizeof(struct codegen_string), compare_ids);
+
+	size_t unique = 0;
+	size_t i = 0; for (; i < count; ++i) {
+		if (!unique || strcmp(ids[unique - 1].id, ids[i].id)) {
+			ids[unique++] = ids[i];
+			continue;
+		}
+
+		if (collisions && strcmp(ids[i - 1].logical_string, ids[i].logical_string)) {
+			if (!(*collisions)++) {
+				gl_set_error("LogicalStrings `%s' and `%s' both map to %s_%s, only the former is generated",
+					ids[unique - 1].logical_string, ids[i].logical_string,
+					project_upper, ids[i].id
+				);
+			}
+		}
+		free(ids[i].id);
+	}
+	return unique;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Collects the tables of `translations'. Strings with duplicate id or
+ * duplicate master string are kept only once
+ */
+static struct codegen_catalog* create_catalog(	uint8_t const* project,
+						uint8_t const* language,
+						struct gl_translations* translations
+		) {
+	size_t count = gl_get_translations_count(translations);
+	struct codegen_catalog* catalog = malloc(sizeof(struct codegen_catalog));
+
+	catalog->project = gl_get_codegen_identifier(project);
+	catalog->project_upper = upper_identifier(catalog->project);
+	catalog->language = gl_get_codegen_identifier(language);
+	catalog->ids = malloc((count + 1) * sizeof(struct codegen_string));
+	catalog->ids_count = add_ids(catalog->ids, 0, translations);
+	catalog->translated = malloc((count + 1) * sizeof(struct codegen_string));
+	catalog->translated_count = 0;
+
+	size_t i = 0; for (; i < count; ++i) {
+		struct gl_translation* translation = gl_get_translation(translations, i);
+		struct codegen_string string = {
+			.master_string = gl_get_translation_master_string(translation),
+			.logical_string = gl_get_translation_logical_string(translation),
+			.translation = gl_get_translation_string(translation),
+			.id = 0,
+			.index = i
+		};
+
+		if (gl_get_translation_string_length(translation) && gl_get_translation_master_string_length(translation)) {
+			catalog->translated[catalog->translated_count++] = string;
+		}
+	}
+
+
+	/* Sort and drop duplicates, collisions are reported by the ids header
+	 */
+	catalog->ids_count = unique_ids(catalog->ids, catalog->ids_count, catalog->project_upper, 0);
+	qsort(catalog->translated, catalog->translated_count, sizeof(struct codegen_string), compare_master_strings);
+
+	size_t unique = 0;
+	for (i = 0; i < catalog->translated_count; ++i) {
+		if (!unique || strcmp(catalog->translated[unique - 1].master_string, catalog->translated[i].master_string)) {
+			catalog->translated[unique++] = catalog->translated[i];
+		}
+	}
+	catalog->translated_count = unique;
+
+	return catalog;
+}
+
+
+
+/**
+ * [PRIVATE]
+ */
+static void free_catalog(struct codegen_catalog* catalog) {
+	size_t i = 0; for (; i < catalog->ids_count; ++i) {
+		free(catalog->ids[i].id);
+	}
+	free(catalog->ids);
+	free(catalog->translated);
+	free(catalog->language);
+	free(catalog->project_upper);
+	free(catalog->project);
+	free(catalog);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes `string' as C string literal. Bytes which are not printable ASCII
+ * are written as octal escapes, so the sources do not depend on the
+ * compiler's source character set, `?' is escaped to prevent trigraphs
+ */
+static void write_literal(FILE* stream, uint8_t const* string) {
+	fputc('"', stream);
+
+	for (; *string; ++string) {
+		switch (*string) {
+			case '"':	fputs("\\\"", stream); break;
+			case '\\':	fputs("\\\\", stream); break;
+			case '?':	fputs("\\?", stream); break;
+			case '\n':	fputs("\\n", stream); break;
+			case '\r':	fputs("\\r", stream); break;
+			case '\t':	fputs("\\t", stream); break;
+
+			default:
+				if (*string < 0x20 || *string >= 0x7f) {
+					fprintf(stream, "\\%03o", *string);
+				} else {
+					fputc(*string, stream);
+				}
+		}
+	}
+	fputc('"', stream);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes the comment opening every generated file
+ */
+static void write_notice(FILE* stream, struct codegen_catalog* catalog) {
+	fprintf(stream,
+		"/* Generated by " GLTOOLKIT_NAME " from the translations of %s/%s, do\n"
+		" * not edit\n"
+		" */\n",
+		catalog->project, catalog->language
+	);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes the include of the ids header shared by all languages
+ */
+static void write_ids_include(FILE* stream, struct codegen_catalog* catalog) {
+	fprintf(stream, "#include \"%s_ids.h\"\n", catalog->project);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes the initializers of the translation of every id and of the
+ * translated strings, both terminated by an empty entry. C sources index
+ * the strings by id using designated initializers, C++ headers list pairs of
+ * id and translation ordered by id since ids are ordered like their names
+ */
+static void write_tables(	FILE* stream,
+				struct codegen_catalog* catalog,
+				bool designated,
+				uint8_t const* strings,
+				uint8_t const* translations
+		) {
+	if (designated) {
+		fprintf(stream, "%s[%s_STRING_COUNT + 1] = {\n", strings, catalog->project_upper);
+	} else {
+		fprintf(stream, "%s[%lu + 1] = {\n", strings, (unsigned long)catalog->ids_count);
+	}
+
+	size_t i = 0; for (; i < catalog->ids_count; ++i) {
+		fprintf(stream, designated ? "\t[%s_%s] = " : "\t{%s_%s, ", catalog->project_upper, catalog->ids[i].id);
+		write_literal(stream, catalog->ids[i].translation);
+		fprintf(stream, designated ? ",\n" : "},\n");
+	}
+	fprintf(stream, designated ? "\t[%s_STRING_COUNT] = 0\n};\n\n" : "\t{%s_STRING_COUNT, 0}\n};\n\n", catalog->project_upper);
+
+	fprintf(stream, "%s[%lu + 1] = {\n", translations, (unsigned long)catalog->translated_count);
+
+	for (i = 0; i < catalog->translated_count; ++i) {
+		fprintf(stream, "\t{");
+		write_literal(stream, catalog->translated[i].master_string);
+		fprintf(stream, ", ");
+		write_literal(stream, catalog->translated[i].translation);
+		fprintf(stream, "},\n");
+	}
+	fprintf(stream, "\t{0, 0}\n};\n");
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t* gl_get_codegen_identifier(uint8_t const* name) {
+	size_t length = strlen(name);
+	uint8_t* identifier = malloc(length + 2);
+	uint8_t* c = identifier;
+
+	if (!length || isdigit(*name)) {
+		*c++ = '_';
+	}
+	for (; *name; ++name) {
+		*c++ = isalnum(*name) && *name < 0x80 ? tolower(*name) : '_';
+	}
+	*c = 0;
+	return identifier;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_write_ids_header(	FILE* header,
+				uint8_t const* project,
+				struct gl_translations* const* catalogs,
+				size_t count,
+				size_t* collisions
+		) {
+	uint8_t* project_identifier = gl_get_codegen_identifier(project);
+	uint8_t* project_upper = upper_identifier(project_identifier);
+
+	size_t strings = 0;
+	size_t i = 0; for (; i < count; ++i) {
+		if (catalogs[i]) {
+			strings += gl_get_translations_count(catalogs[i]);
+		}
+	}
+
+	struct codegen_string* ids = malloc((strings + 1) * sizeof(struct codegen_string));
+	size_t ids_count = 0;
+
+	for (i = 0; i < count; ++i) {
+		if (catalogs[i]) {
+			ids_count = add_ids(ids, ids_count, catalogs[i]);
+		}
+	}
+	*collisions = 0;
+	ids_count = unique_ids(ids, ids_count, project_upper, collisions);
+
+
+	/* Ids are numbered in byte order of their names, which every language
+	 * relies on
+	 */
+	fprintf(header,
+		"/* Generated by " GLTOOLKIT_NAME " from the LogicalStrings of all languages of\n"
+		" * %s, do not edit\n"
+		" */\n"
+		"#ifndef %s_IDS_H\n"
+		"#define %s_IDS_H\n"
+		"\n"
+		"enum %s_string_id {\n",
+		project_identifier, project_upper, project_upper, project_identifier
+	);
+
+	for (i = 0; i < ids_count; ++i) {
+		fprintf(header, "\t%s_%s,\n", project_upper, ids[i].id);
+		free(ids[i].id);
+	}
+	fprintf(header,
+		"\t%s_STRING_COUNT\n"
+		"};\n"
+		"\n"
+		"#endif\n",
+		project_upper
+	);
+
+	free(ids);
+	free(project_upper);
+	free(project_identifier);
+	return !ferror(header);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_write_c_header(	FILE* header,
+			uint8_t const* project,
+			uint8_t const* language,
+			struct gl_translations* translations
+		) {
+	struct codegen_catalog* catalog = create_catalog(project, language, translations);
+	uint8_t* language_upper = upper_identifier(catalog->language);
+
+	write_notice(header, catalog);
+	fprintf(header,
+		"#ifndef %s_%s_H\n"
+		"#define %s_%s_H\n"
+		"\n"
+		"#ifdef __cplusplus\n"
+		"extern \"C\" {\n"
+		"#endif\n"
+		"\n",
+		catalog->project_upper, language_upper,
+		catalog->project_upper, language_upper
+	);
+	write_ids_include(header, catalog);
+
+	fprintf(header,
+		"\n"
+		"/* @return Translation of `id', its master string iff untranslated, 0 iff\n"
+		" *     the language does not contain `id'\n"
+		" */\n"
+		"char const* %s_%s_get(enum %s_string_id id);\n"
+		"\n"
+		"/* @return Translation of `master_string' or `master_string' itself iff\n"
+		" *     untranslated\n"
+		" */\n"
+		"char const* %s_%s_gettext(char const* master_string);\n"
+		"\n"
+		"#ifdef __cplusplus\n"
+		"}\n"
+		"#endif\n"
+		"\n"
+		"#endif\n",
+		catalog->project, catalog->language, catalog->project,
+		catalog->project, catalog->language
+	);
+
+	free(language_upper);
+	free_catalog(catalog);
+	return !ferror(header);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_write_c_source(	FILE* source,
+			uint8_t const* header_name,
+			uint8_t const* project,
+			uint8_t const* language,
+			struct gl_translations* translations
+		) {
+	struct codegen_catalog* catalog = create_catalog(project, language, translations);
+
+	write_notice(source, catalog);
+	fprintf(source,
+		"#include <stdlib.h>\n"
+		"#include <string.h>\n"
+		"\n"
+		"#include \"%s\"\n"
+		"\n"
+		"\n"
+		"\n"
+		"struct translation {\n"
+		"\tchar const* master_string;\n"
+		"\tchar const* translation;\n"
+		"};\n"
+		"\n",
+		header_name
+	);
+	write_tables(source, catalog, true, "static char const* const strings", "static struct translation const translations");
+
+	fprintf(source,
+		"\n"
+		"\n"
+		"\n"
+		"static int compare_translations(void const* master_string, void const* translation) {\n"
+		"\treturn strcmp(master_string, ((struct translation const*)translation)->master_string);\n"
+		"}\n"
+		"\n"
+		"char const* %s_%s_get(enum %s_string_id id) {\n"
+		"\treturn (unsigned)id < %s_STRING_COUNT ? strings[id] : 0;\n"
+		"}\n"
+		"\n"
+		"char const* %s_%s_gettext(char const* master_string) {\n"
+		"\tstruct translation const* translation = bsearch(\n"
+		"\t\tmaster_string, translations, %lu, sizeof(struct translation),\n"
+		"\t\tcompare_translations\n"
+		"\t);\n"
+		"\treturn translation ? translation->translation : master_string;\n"
+		"}\n",
+		catalog->project, catalog->language, catalog->project,
+		catalog->project_upper,
+		catalog->project, catalog->language,
+		(unsigned long)catalog->translated_count
+	);
+
+	free_catalog(catalog);
+	return !ferror(source);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_write_cpp_header(	FILE* header,
+				uint8_t const* project,
+				uint8_t const* language,
+				struct gl_translations* translations
+		) {
+	struct codegen_catalog* catalog = create_catalog(project, language, translations);
+	uint8_t* language_upper = upper_identifier(catalog->language);
+	uint8_t* project_namespace = namespace_identifier(catalog->project);
+	uint8_t* language_namespace = namespace_identifier(catalog->language);
+
+	write_notice(header, catalog);
+	fprintf(header,
+		"#ifndef %s_%s_HPP\n"
+		"#define %s_%s_HPP\n"
+		"\n"
+		"#include <cstddef>\n"
+		"\n",
+		catalog->project_upper, language_upper,
+		catalog->project_upper, language_upper
+	);
+	write_ids_include(header, catalog);
+
+	fprintf(header,
+		"\n"
+		"namespace %s {\n"
+		"namespace %s {\n"
+		"\n"
+		"struct string {\n"
+		"\t%s_string_id id;\n"
+		"\tchar const* translation;\n"
+		"};\n"
+		"\n"
+		"struct translation {\n"
+		"\tchar const* master_string;\n"
+		"\tchar const* translation;\n"
+		"};\n"
+		"\n",
+		project_namespace, language_namespace, catalog->project
+	);
+	write_tables(header, catalog, false, "constexpr string strings", "constexpr translation translations");
+
+	fprintf(header,
+		"\n"
+		"constexpr int compare(char const* a, char const* b) {\n"
+		"\tfor (; *a && *a == *b; ++a, ++b) {\n"
+		"\t}\n"
+		"\treturn static_cast<unsigned char>(*a) - static_cast<unsigned char>(*b);\n"
+		"}\n"
+		"\n"
+		"/* @return Translation of `id', its master string iff untranslated,\n"
+		" *     nullptr iff the language does not contain `id'\n"
+		" */\n"
+		"constexpr char const* get(%s_string_id id) {\n"
+		"\tstd::size_t low = 0;\n"
+		"\tstd::size_t high = %lu;\n"
+		"\n"
+		"\twhile (low < high) {\n"
+		"\t\tstd::size_t middle = low + (high - low) / 2;\n"
+		"\n"
+		"\t\tif (strings[middle].id == id) {\n"
+		"\t\t\treturn strings[middle].translation;\n"
+		"\t\t} else if (strings[middle].id < id) {\n"
+		"\t\t\tlow = middle + 1;\n"
+		"\t\t} else {\n"
+		"\t\t\thigh = middle;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn nullptr;\n"
+		"}\n"
+		"\n"
+		"/* @return Translation of `master_string' or `master_string' itself iff\n"
+		" *     untranslated\n"
+		" */\n"
+		"constexpr char const* gettext(char const* master_string) {\n"
+		"\tstd::size_t low = 0;\n"
+		"\tstd::size_t high = %lu;\n"
+		"\n"
+		"\twhile (low < high) {\n"
+		"\t\tstd::size_t middle = low + (high - low) / 2;\n"
+		"\t\tint order = compare(translations[middle].master_string, master_string);\n"
+		"\n"
+		"\t\tif (!order) {\n"
+		"\t\t\treturn translations[middle].translation;\n"
+		"\t\t} else if (order < 0) {\n"
+		"\t\t\tlow = middle + 1;\n"
+		"\t\t} else {\n"
+		"\t\t\thigh = middle;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn master_string;\n"
+		"}\n"
+		"\n"
+		"}\n"
+		"}\n"
+		"\n"
+		"#endif\n",
+		catalog->project, (unsigned long)catalog->ids_count,
+		(unsigned long)catalog->translated_count
+	);
+
+	free(language_namespace);
+	free(project_namespace);
+	free(language_upper);
+	free_catalog(catalog);
+	return !ferror(header);
+}
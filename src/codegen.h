@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_CODEGEN
+#define GLTOOLKIT_CODEGEN
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+
+
+
+
+/**
+ * Generated sources of `project', e.g. for project `demo' and language `de'
+ *
+ *   enum demo_string_id {             One identifier per LogicalString of
+ *       DEMO_MENU_START, ...          any language in byte order, written
+ *       DEMO_STRING_COUNT             once to demo_ids.h by
+ *   };                                gl_write_ids_header
+ *
+ *   char const* demo_de_get(enum demo_string_id id);
+ *   char const* demo_de_gettext(char const* master_string);
+ *
+ * gl_write_c_header declares both functions, gl_write_c_source defines them
+ * on top of static const tables and gl_write_cpp_header defines them as
+ * constexpr functions in namespace demo::de, so translations of constant
+ * keys resolve at compile time. Strings without translation resolve to their
+ * master string, like gettext does, ids missing from a language resolve to a
+ * null pointer. All headers of a language include the ids header, which has
+ * to be written from the catalogs of all languages whenever one of them
+ * changes
+ */
+
+/**
+ * Writes <project>_ids.h, the enum of the string ids of all languages.
+ * LogicalStrings which map to the same identifier, e.g. `menu.start' and
+ * `menu_start', get a single id, which the least of them keeps in every
+ * language
+ *
+ * @param catalogs Catalogs of all `count' languages, missing catalogs are 0
+ * @param collisions Receives the number of LogicalStrings without id, the
+ *     first of them is described by gl_get_error
+ * @return false on I/O errors
+ */
+bool gl_write_ids_header(	FILE* header,
+				uint8_t const* project,
+				struct gl_translations* const* catalogs,
+				size_t count,
+				size_t* collisions
+);
+
+/**
+ * Writes the C header declaring the lookup functions
+ *
+ * @return false on I/O errors
+ */
+bool gl_write_c_header(	FILE* header,
+			uint8_t const* project,
+			uint8_t const* language,
+			struct gl_translations* translations
+);
+
+/**
+ * Writes the C source defining the lookup functions of the header named
+ * `header_name'
+ *
+ * @return false on I/O errors
+ */
+bool gl_write_c_source(	FILE* source,
+			uint8_t const* header_name,
+			uint8_t const* project,
+			uint8_t const* language,
+			struct gl_translations* translations
+);
+
+/**
+ * Writes the C++14 header, which depends on the ids header only
+ *
+ * @return false on I/O errors
+ */
+bool gl_write_cpp_header(	FILE* header,
+				uint8_t const* project,
+				uint8_t const* language,
+				struct gl_translations* translations
+);
+
+/**
+ * Converts `name' into a lower case C identifier, e.g. `pt-BR' into `pt_br'
+ *
+ * @return Identifier, has to be freed by the caller
+ */
+uint8_t* gl_get_codegen_identifier(uint8_t const* name);
+
+
+
+
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "error.h"
+#include "gltoolkit.h"
+
+
+
+
+
+/**
+ * Longest message kept, longer ones are truncated
+ */
+#define GL_ERROR_LENGTH 512
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Last message of every thread, so concurrent calls do not overwrite each
+ * other's failures
+ */
+static __thread uint8_t gl_error[GL_ERROR_LENGTH];
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_set_error(char const* format, ...) {
+	va_list arguments;
+
+	va_start(arguments, format);
+	vsnprintf(gl_error, sizeof(gl_error), format, arguments);
+	va_end(arguments);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_get_error() {
+	return gl_error;
+}
@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_ERROR
+#define GLTOOLKIT_ERROR
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+
+
+
+
+
+/**
+ * Maximum number of bytes of a response quoted by error messages, messages
+ * are truncated anyway and responses may be large
+ */
+#define GL_ERROR_EXCERPT_LENGTH 256
+
+/**
+ * Describes why the current call failed. The message replaces the previous
+ * one of the calling thread and is returned by gl_get_error
+ */
+void gl_set_error(char const* format, ...) __attribute__((format(printf, 1, 2)));
+
+
+
+
+
+#endif
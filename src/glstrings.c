@@ -0,0 +1,477 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <stdlib.h>
+#include <entities.h>
+
+#include "glstrings.h"
+
+
+
+
+
+/**
+ * Longest element name which has to be recognized
+ */
+#define GL_GLSTRINGS_NAME_LENGTH 32
+
+/**
+ * Nesting levels of the GLStrings schema
+ *
+ *   <GLStrings>              GL_GLSTRINGS_DEPTH_ROOT
+ *     <GLString>             GL_GLSTRINGS_DEPTH_ENTRY
+ *       <MasterString>       GL_GLSTRINGS_DEPTH_FIELD
+ */
+#define GL_GLSTRINGS_DEPTH_ROOT 1
+#define GL_GLSTRINGS_DEPTH_ENTRY 2
+#define GL_GLSTRINGS_DEPTH_FIELD 3
+
+
+
+/**
+ * Element names of all fields, ordered like enum gl_glstrings_field
+ */
+static uint8_t const* gl_glstrings_field_names[GL_GLSTRINGS_FIELDS] = {
+	"MasterString",
+	"LogicalString",
+	"ContextInfo",
+	"Translation"
+};
+
+
+
+/**
+ * Content of fields which are missing or self-closing in in-place mode
+ */
+static uint8_t gl_glstrings_empty[1] = {0};
+
+
+
+/**
+ * Lexer states
+ */
+enum gl_glstrings_state {
+	GL_GLSTRINGS_TEXT,		/* Character data between tags */
+	GL_GLSTRINGS_TAG,		/* Directly after `<' */
+	GL_GLSTRINGS_OPEN_NAME,		/* Name of an opening tag */
+	GL_GLSTRINGS_OPEN_REST,		/* Attributes of an opening tag */
+	GL_GLSTRINGS_OPEN_QUOTED,	/* Quoted attribute value */
+	GL_GLSTRINGS_CLOSE_NAME,	/* Name of a closing tag */
+	GL_GLSTRINGS_SKIP,		/* <?...?> and <!...> */
+	GL_GLSTRINGS_COMMENT		/* <!--...--> */
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Growable field buffer, reused for every entry. In in-place mode `data'
+ * points into the document instead
+ */
+struct gl_glstrings_buffer {
+	uint8_t* data;
+	size_t length;
+	size_t capacity;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ */
+struct gl_glstrings_parser {
+	gl_glstrings_callback callback;
+	void* context;
+	bool in_place;
+
+	enum gl_glstrings_state state;
+	bool failed;
+
+	/* Current element nesting and the field being read (or -1)
+	 */
+	size_t depth;
+	bool in_entry;
+	int field;
+	bool document_done;
+
+	/* Name of the tag being lexed
+	 */
+	uint8_t name[GL_GLSTRINGS_NAME_LENGTH + 1];
+	size_t name_length;
+
+	/* Last characters inside the tag, used to detect `/>', `?>' and `-->'
+	 */
+	uint8_t previous[2];
+	uint8_t quote;
+
+	struct gl_glstrings_buffer fields[GL_GLSTRINGS_FIELDS];
+	size_t count;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Appends character data to a field buffer
+ */
+static void append_field(	struct gl_glstrings_buffer* buffer,
+				uint8_t const* data, size_t length
+		) {
+	size_t required = buffer->length + length + 1;
+
+	if (required > buffer->capacity) {
+		size_t capacity = 2 * buffer->capacity;
+		if (capacity < required) {
+			capacity = required;
+		}
+		buffer->data = realloc(buffer->data, capacity);
+		buffer->capacity = capacity;
+	}
+
+	memcpy(&buffer->data[buffer->length], data, length);
+	buffer->length += length;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Appends character data to a field inside the document. Usually a field
+ * consists of exactly one run of text, which is referenced as is. Further
+ * runs (separated by comments) are moved next to the previous ones, which is
+ * safe since they always follow the field's current end
+ */
+static void append_field_in_place(	struct gl_glstrings_buffer* buffer,
+					uint8_t* data, size_t length
+		) {
+	if (!buffer->data) {
+		buffer->data = data;
+	} else if (&buffer->data[buffer->length] != data) {
+		memmove(&buffer->data[buffer->length], data, length);
+	}
+	buffer->length += length;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Terminates and decodes all fields and reports the entry
+ */
+static bool emit_entry(struct gl_glstrings_parser* parser) {
+	uint8_t* fields[GL_GLSTRINGS_FIELDS];
+	size_t lengths[GL_GLSTRINGS_FIELDS];
+
+	size_t i = 0; for (; i < GL_GLSTRINGS_FIELDS; ++i) {
+		struct gl_glstrings_buffer* buffer = &parser->fields[i];
+
+		/* Terminating in place overwrites the `<' of the field's closing
+		 * tag, which has already been consumed
+		 */
+		if (parser->in_place) {
+			if (!buffer->data) {
+				buffer->data = gl_glstrings_empty;
+			}
+		} else {
+			append_field(buffer, "", 0);
+		}
+		buffer->data[buffer->length] = 0;
+
+		fields[i] = buffer->data;
+		lengths[i] = buffer->length
+			? decode_html_entities_utf8(buffer->data, 0)
+			: 0
+		;
+	}
+
+	parser->count += 1;
+	return parser->callback(fields, lengths, parser->context);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Index of the field named like the current tag or -1
+ */
+static int field_index(struct gl_glstrings_parser* parser) {
+	parser->name[parser->name_length] = 0;
+
+	int i = 0; for (; i < GL_GLSTRINGS_FIELDS; ++i) {
+		if (!strcmp(parser->name, gl_glstrings_field_names[i])) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * An opening tag was completed
+ */
+static void open_element(struct gl_glstrings_parser* parser, bool empty) {
+	parser->depth += 1;
+
+	if (GL_GLSTRINGS_DEPTH_ENTRY == parser->depth) {
+		parser->name[parser->name_length] = 0;
+		parser->in_entry = !strcmp(parser->name, "GLString");
+
+		if (parser->in_entry) {
+			size_t i = 0; for (; i < GL_GLSTRINGS_FIELDS; ++i) {
+				parser->fields[i].length = 0;
+
+				if (parser->in_place) {
+					parser->fields[i].data = 0;
+				}
+			}
+		}
+	} else if (GL_GLSTRINGS_DEPTH_FIELD == parser->depth && parser->in_entry) {
+		parser->field = field_index(parser);
+	}
+
+	if (empty) {
+		parser->depth -= 1;
+		parser->field = -1;
+	}
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * A closing tag was completed
+ *
+ * @return false iff the document is malformed or the callback aborted
+ */
+static bool close_element(struct gl_glstrings_parser* parser) {
+	if (!parser->depth) {
+		return false;
+	}
+
+	if (GL_GLSTRINGS_DEPTH_FIELD == parser->depth) {
+		parser->field = -1;
+	} else if (GL_GLSTRINGS_DEPTH_ENTRY == parser->depth && parser->in_entry) {
+		parser->in_entry = false;
+		if (!emit_entry(parser)) {
+			return false;
+		}
+	}
+
+	parser->depth -= 1;
+	if (!parser->depth) {
+		parser->document_done = true;
+	}
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Remembers the last two characters of a tag
+ */
+static void shift_previous(struct gl_glstrings_parser* parser, uint8_t c) {
+	parser->previous[0] = parser->previous[1];
+	parser->previous[1] = c;
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_glstrings_parser* gl_create_glstrings_parser(
+			gl_glstrings_callback callback, void* context, bool in_place
+		) {
+	struct gl_glstrings_parser* parser = calloc(1, sizeof(struct gl_glstrings_parser));
+	parser->callback = callback;
+	parser->context = context;
+	parser->in_place = in_place;
+	parser->state = GL_GLSTRINGS_TEXT;
+	parser->field = -1;
+
+	return parser;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_feed_glstrings_parser(	struct gl_glstrings_parser* parser,
+				uint8_t* data, size_t length
+		) {
+	uint8_t* end = data + length;
+
+	while (!parser->failed && data < end) {
+		uint8_t c = *data;
+
+		switch (parser->state) {
+
+		/* Copy character data in bulk up to the next tag
+		 */
+		case GL_GLSTRINGS_TEXT: {
+			uint8_t* tag = memchr(data, '<', end - data);
+			uint8_t* text_end = tag ? tag : end;
+
+			if (parser->field >= 0 && parser->in_place) {
+				append_field_in_place(&parser->fields[parser->field], data, text_end - data);
+			} else if (parser->field >= 0) {
+				append_field(&parser->fields[parser->field], data, text_end - data);
+			}
+			data = text_end;
+
+			if (tag) {
+				parser->state = GL_GLSTRINGS_TAG;
+				++data;
+			}
+			continue;
+		}
+
+		case GL_GLSTRINGS_TAG:
+			parser->name_length = 0;
+			parser->previous[0] = parser->previous[1] = 0;
+
+			if ('/' == c) {
+				parser->state = GL_GLSTRINGS_CLOSE_NAME;
+			} else if ('?' == c || '!' == c) {
+				parser->state = GL_GLSTRINGS_SKIP;
+				shift_previous(parser, c);
+			} else {
+				parser->state = GL_GLSTRINGS_OPEN_NAME;
+				continue;
+			}
+			break;
+
+		case GL_GLSTRINGS_OPEN_NAME:
+		case GL_GLSTRINGS_CLOSE_NAME:
+			if ('>' == c || '/' == c || ' ' == c || '\t' == c || '\r' == c || '\n' == c) {
+				if (GL_GLSTRINGS_CLOSE_NAME == parser->state) {
+					if ('>' == c) {
+						parser->state = GL_GLSTRINGS_TEXT;
+						parser->failed = !close_element(parser);
+					}
+					break;
+				}
+				parser->state = GL_GLSTRINGS_OPEN_REST;
+				continue;
+			}
+			if (parser->name_length < GL_GLSTRINGS_NAME_LENGTH) {
+				parser->name[parser->name_length++] = c;
+			}
+			break;
+
+		case GL_GLSTRINGS_OPEN_REST:
+			if ('"' == c || '\'' == c) {
+				parser->quote = c;
+				parser->state = GL_GLSTRINGS_OPEN_QUOTED;
+			} else if ('>' == c) {
+				parser->state = GL_GLSTRINGS_TEXT;
+				open_element(parser, '/' == parser->previous[1]);
+			}
+			shift_previous(parser, c);
+			break;
+
+		case GL_GLSTRINGS_OPEN_QUOTED:
+			if (parser->quote == c) {
+				parser->state = GL_GLSTRINGS_OPEN_REST;
+			}
+			break;
+
+		/* <!-- switches to comment mode, everything else ends with `>'
+		 */
+		case GL_GLSTRINGS_SKIP:
+			if ('-' == c && '-' == parser->previous[1] && '!' == parser->previous[0]) {
+				parser->state = GL_GLSTRINGS_COMMENT;
+				parser->previous[0] = parser->previous[1] = 0;
+			} else if ('>' == c) {
+				parser->state = GL_GLSTRINGS_TEXT;
+			} else {
+				shift_previous(parser, c);
+			}
+			break;
+
+		case GL_GLSTRINGS_COMMENT:
+			if ('>' == c && '-' == parser->previous[0] && '-' == parser->previous[1]) {
+				parser->state = GL_GLSTRINGS_TEXT;
+			}
+			shift_previous(parser, c);
+			break;
+		}
+
+		++data;
+	}
+
+	return !parser->failed;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_finish_glstrings_parser(struct gl_glstrings_parser* parser) {
+	return !parser->failed
+		&& parser->document_done
+		&& GL_GLSTRINGS_TEXT == parser->state
+	;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_glstrings_parser_count(struct gl_glstrings_parser* parser) {
+	return parser->count;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_glstrings_parser(struct gl_glstrings_parser* parser) {
+	if (!parser->in_place) {
+		size_t i = 0; for (; i < GL_GLSTRINGS_FIELDS; ++i) {
+			free(parser->fields[i].data);
+		}
+	}
+	free(parser);
+}
+
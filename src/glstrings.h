@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_GLSTRINGS
+#define GLTOOLKIT_GLSTRINGS
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Opaque structures
+ */
+struct gl_glstrings_parser;
+
+
+
+/**
+ * Fields of a <GLString> element
+ */
+enum gl_glstrings_field {
+	GL_GLSTRINGS_MASTER_STRING = 0,
+	GL_GLSTRINGS_LOGICAL_STRING,
+	GL_GLSTRINGS_CONTEXT_INFO,
+	GL_GLSTRINGS_TRANSLATION,
+
+	GL_GLSTRINGS_FIELDS
+};
+
+
+
+/**
+ * Invoked for every complete <GLString> element. `fields' contains
+ * GL_GLSTRINGS_FIELDS 0-terminated and entity decoded strings, which are only
+ * valid during the callback unless the parser works in place
+ *
+ * @return false iff parsing should be aborted
+ */
+typedef bool (*gl_glstrings_callback)(
+	uint8_t* const* fields, size_t const* lengths, void* context
+);
+
+
+
+
+
+/**
+ * Creates an incremental parser for GLStrings documents. The document can be
+ * fed in arbitrary chunks and every <GLString> is reported as soon as its
+ * closing tag was seen, so memory usage only depends on the largest entry
+ *
+ * @param in_place If true, all chunks have to be consecutive parts of one
+ *     writable buffer which outlives the parser. Fields are then terminated
+ *     and decoded inside that buffer and reported without being copied, they
+ *     stay valid as long as the buffer
+ */
+struct gl_glstrings_parser* gl_create_glstrings_parser(
+	gl_glstrings_callback callback, void* context, bool in_place
+);
+
+/**
+ * Parses the next chunk of the document
+ *
+ * @return false iff the document is malformed or the callback aborted
+ */
+bool gl_feed_glstrings_parser(	struct gl_glstrings_parser* parser,
+				uint8_t* data, size_t length
+);
+
+/**
+ * @return true iff the complete document was fed without errors
+ */
+bool gl_finish_glstrings_parser(struct gl_glstrings_parser* parser);
+
+/**
+ * @return Number of <GLString> elements reported so far
+ */
+size_t gl_get_glstrings_parser_count(struct gl_glstrings_parser* parser);
+
+/**
+ * Frees all resources allocated by the parser
+ */
+void gl_free_glstrings_parser(struct gl_glstrings_parser* parser);
+
+
+
+
+
+#endif
+
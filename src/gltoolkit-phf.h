@@ -0,0 +1,292 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_PHF
+#define GLTOOLKIT_PHF
+
+
+
+
+
+/**
+ * Runtime of compiled catalogs as written by `gltoolkit --phf'. This header
+ * does not depend on the rest of gltoolkit and may be copied into
+ * applications: a catalog is memory mapped and every key is resolved by
+ * probing exactly one slot of a minimal perfect hash table, without any
+ * allocation
+ *
+ *   struct gl_phf catalog;
+ *
+ *   if (gl_phf_open(&catalog, "de.phf")) {
+ *       char const* translation = gl_phf_get(&catalog, "Please wait...");
+ *       ...
+ *       gl_phf_close(&catalog);
+ *   }
+ *
+ * Layout, in native byte order and therefore only readable on the kind of
+ * platform it was written on:
+ *
+ *  1. struct gl_phf_header
+ *  2. one displacement per bucket, there are as many buckets as keys
+ *  3. one struct gl_phf_slot per key
+ *  4. the string pool containing all 0-terminated keys and translations
+ *
+ * A key is hashed with seed 0 to find its bucket. A negative displacement
+ * `d' places the bucket's only key directly into slot -d - 1, otherwise the
+ * key is hashed again with seed `d' to find its slot. Keys which are not part
+ * of the catalog are rejected by comparing them with the slot's key
+ */
+
+
+
+/**
+ * Includes
+ */
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+
+
+/**
+ * Identifies compiled catalogs and their format version
+ */
+#define GL_PHF_MAGIC "GLPHF001"
+
+/**
+ * Written in native byte order, so catalogs of a different byte order are
+ * detected
+ */
+#define GL_PHF_BYTE_ORDER 0x01020304
+
+
+
+/**
+ * Beginning of every catalog, all offsets are relative to the beginning of
+ * the catalog
+ */
+struct gl_phf_header {
+	uint8_t magic[8];
+	uint32_t byte_order;
+	uint32_t count;
+
+	uint32_t displacements_offset;
+	uint32_t slots_offset;
+	uint32_t strings_offset;
+	uint32_t length;
+};
+
+/**
+ * Location of one key and its translation inside the string pool
+ */
+struct gl_phf_slot {
+	uint32_t key_offset;
+	uint32_t key_length;
+	uint32_t translation_offset;
+	uint32_t translation_length;
+};
+
+/**
+ * Opened catalog, all members are views into `data'
+ */
+struct gl_phf {
+	char const* data;
+	size_t length;
+
+	/* Iff true `data' is a mapping owned by the catalog
+	 */
+	bool mapped;
+
+	uint32_t count;
+	int32_t const* displacements;
+	struct gl_phf_slot const* slots;
+};
+
+
+
+
+
+/**
+ * Hash of `key' used both for buckets (seed 0) and slots (seed of the
+ * bucket's displacement)
+ */
+static inline uint32_t gl_phf_hash(uint32_t seed, char const* key, size_t length) {
+	uint64_t hash = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+
+	size_t i = 0; for (; i < length; ++i) {
+		hash ^= (uint8_t)key[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	/* FNV-1a alone mixes the last bytes poorly, which matters for keys
+	 * differing only in a trailing number
+	 */
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return (uint32_t)hash;
+}
+
+
+
+/**
+ * Uses `length' bytes at `data' as catalog, e.g. a catalog embedded into the
+ * executable. `data' has to be aligned to 4 bytes and stay valid until the
+ * catalog is closed
+ *
+ * @return false iff `data' is no catalog of this kind of platform
+ */
+static inline bool gl_phf_map(struct gl_phf* phf, void const* data, size_t length) {
+	struct gl_phf_header const* header = (struct gl_phf_header const*)data;
+	memset(phf, 0, sizeof(struct gl_phf));
+
+	if (	length < sizeof(struct gl_phf_header)
+	||	memcmp(header->magic, GL_PHF_MAGIC, sizeof(header->magic))
+	||	GL_PHF_BYTE_ORDER != header->byte_order
+	||	length != header->length) {
+		return false;
+	}
+
+	/* Tables have to fit in front of the string pool, which is checked
+	 * lazily by every lookup
+	 */
+	uint64_t count = header->count;
+	if (	header->displacements_offset + count * sizeof(int32_t) > header->slots_offset
+	||	header->slots_offset + count * sizeof(struct gl_phf_slot) > header->strings_offset
+	||	header->strings_offset > length
+	||	(header->displacements_offset | header->slots_offset) % sizeof(uint32_t)) {
+		return false;
+	}
+
+	phf->data = (char const*)data;
+	phf->length = length;
+	phf->count = header->count;
+	phf->displacements = (int32_t const*)&phf->data[header->displacements_offset];
+	phf->slots = (struct gl_phf_slot const*)&phf->data[header->slots_offset];
+	return true;
+}
+
+
+
+/**
+ * Maps the catalog at `path'
+ *
+ * @return false iff the file cannot be mapped or is no catalog
+ */
+static inline bool gl_phf_open(struct gl_phf* phf, char const* path) {
+	memset(phf, 0, sizeof(struct gl_phf));
+
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0) {
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(descriptor, &status) || status.st_size < (off_t)sizeof(struct gl_phf_header)) {
+		close(descriptor);
+		return false;
+	}
+
+	size_t length = status.st_size;
+	void* map = mmap(0, length, PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+
+	if (MAP_FAILED == map) {
+		return false;
+	}
+	if (!gl_phf_map(phf, map, length)) {
+		munmap(map, length);
+		return false;
+	}
+	phf->mapped = true;
+	return true;
+}
+
+
+
+/**
+ * Unmaps the catalog iff it has been opened by gl_phf_open
+ */
+static inline void gl_phf_close(struct gl_phf* phf) {
+	if (phf->mapped) {
+		munmap((void*)phf->data, phf->length);
+	}
+	memset(phf, 0, sizeof(struct gl_phf));
+}
+
+
+
+/**
+ * @return 0-terminated translation of `key' or 0 iff the catalog does not
+ *     contain `key'
+ */
+static inline char const* gl_phf_lookup(	struct gl_phf const* phf,
+						char const* key, size_t length
+		) {
+	if (!phf->count) {
+		return 0;
+	}
+	int32_t displacement = phf->displacements[gl_phf_hash(0, key, length) % phf->count];
+	uint32_t n = displacement < 0
+		? (uint32_t)(-(int64_t)displacement - 1)
+		: gl_phf_hash((uint32_t)displacement, key, length) % phf->count
+	;
+	if (n >= phf->count) {
+		return 0;
+	}
+
+	/* Corrupt slots must neither point outside the catalog nor at strings
+	 * without terminator, which callers would read past the catalog
+	 */
+	struct gl_phf_slot const* slot = &phf->slots[n];
+	if (	length != slot->key_length
+	||	(uint64_t)slot->key_offset + length >= phf->length
+	||	(uint64_t)slot->translation_offset + slot->translation_length >= phf->length
+	||	phf->data[slot->key_offset + length]
+	||	phf->data[slot->translation_offset + slot->translation_length]
+	||	memcmp(&phf->data[slot->key_offset], key, length)) {
+		return 0;
+	}
+	return &phf->data[slot->translation_offset];
+}
+
+
+
+/**
+ * @return 0-terminated translation of the 0-terminated `key' or 0 iff the
+ *     catalog does not contain `key'
+ */
+static inline char const* gl_phf_get(struct gl_phf const* phf, char const* key) {
+	return gl_phf_lookup(phf, key, strlen(key));
+}
+
+
+
+
+
+#endif
@@ -30,12 +30,21 @@
 /**
  * Includes
  */
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 /**
  * Opaque structures
  */
+struct gl_arena;
+struct gl_async;
+struct gl_async_request;
+struct gl_session;
+struct gl_snapshot;
+struct gl_string_pool;
+struct gl_trace;
 struct gl_language;
 struct gl_languages;
 struct gl_translation;
@@ -43,12 +52,394 @@ struct gl_translations;
 
 
 
+/**
+ * Invoked by gl_fetch_translations as soon as the translations of `language'
+ * are available. `translations' is 0 iff fetching failed, gl_get_error
+ * describes why during the callback. Otherwise the callback takes ownership
+ * and has to call gl_free_translations
+ */
+typedef void (*gl_translations_callback)(
+	struct gl_language* language,
+	struct gl_translations* translations,
+	void* context
+);
+
+
+
+/**
+ * Events of a socket of an asynchronous context
+ */
+enum gl_async_events {
+	GL_ASYNC_IN = 1,
+	GL_ASYNC_OUT = 2,
+	GL_ASYNC_ERROR = 4,
+	GL_ASYNC_REMOVE = 8
+};
+
+/**
+ * Passed to gl_async_perform instead of a file descriptor after the timeout
+ * requested by the timer callback expired
+ */
+#define GL_ASYNC_TIMEOUT -1
+
+
+
+/**
+ * Invoked when the event loop has to start watching `fd' for `events'
+ * (GL_ASYNC_IN and/or GL_ASYNC_OUT), changes them or stops watching `fd'
+ * (GL_ASYNC_REMOVE)
+ */
+typedef void (*gl_async_socket_callback)(int fd, int events, void* context);
+
+/**
+ * Invoked when the single timer of an asynchronous context has to be
+ * (re)armed. The event loop has to call gl_async_perform with
+ * GL_ASYNC_TIMEOUT after `timeout' milliseconds, -1 disarms the timer
+ * @warning gl_async_perform must not be called from within this callback
+ */
+typedef void (*gl_async_timer_callback)(long timeout, void* context);
+
+/**
+ * Invoked by gl_async_perform as soon as the languages requested by
+ * gl_async_get_languages are available. `languages' is 0 iff the request
+ * failed or was cancelled, otherwise the callback takes ownership
+ */
+typedef void (*gl_async_languages_callback)(
+	struct gl_languages* languages,
+	void* context
+);
+
+/**
+ * Invoked by gl_async_perform as soon as the translations requested by
+ * gl_async_get_translations are available. `translations' is 0 iff the
+ * request failed or was cancelled, otherwise the callback takes ownership
+ */
+typedef void (*gl_async_translations_callback)(
+	struct gl_translations* translations,
+	void* context
+);
+
+
+
+/**
+ * Callbacks of gl_stream_translations
+ */
+struct gl_stream_callbacks {
+
+	/* Invoked as soon as data of `language' arrives. The return value is
+	 * passed as `stream' to the other callbacks of this language
+	 */
+	void* (*begin)(struct gl_language* language, void* context);
+
+	/* Invoked for every translation as soon as it was parsed.
+	 * `translation' is only valid during the callback. Return false to
+	 * abort the language
+	 */
+	bool (*translation)(struct gl_translation* translation, void* stream);
+
+	/* Invoked after the last translation of `language', `success' is
+	 * false iff downloading or parsing failed, gl_get_error describes
+	 * why during the callback
+	 */
+	void (*end)(struct gl_language* language, bool success, void* stream);
+};
+
+
+
+
+
+/**
+ * Initializes cURL and everything else shared by all sessions. Has to be
+ * called before any other function, calls may be nested and come from any
+ * thread
+ *
+ * @return false iff initialization failed, gl_cleanup must not be called
+ *     then
+ */
+bool gl_init();
+
+/**
+ * Balances one successful gl_init. The last one releases the global
+ * resources again
+ *
+ * @warning All sessions have to be freed before
+ */
+void gl_cleanup();
+
+/**
+ * Functions report failures through their return value only. The reason is
+ * kept per thread, so concurrent calls do not overwrite each other's
+ * messages
+ *
+ * @return Description of the last failure on the calling thread, empty iff
+ *     no call failed yet. Valid until the next call on the same thread
+ */
+uint8_t const* gl_get_error();
+
+
+
+/**
+ * An arena serves all allocations of a catalog from one or a few large
+ * blocks, so building and freeing a catalog does not depend on the number
+ * of strings
+ *
+ * @param capacity Size of the first block in bytes, 0 for a default size
+ *
+ * @return New arena
+ */
+struct gl_arena* gl_create_arena(size_t capacity);
+
+/**
+ * Releases everything allocated from the arena at once, but keeps its blocks
+ * for reuse
+ *
+ * @warning Invalidates all catalogs built inside the arena
+ */
+void gl_reset_arena(struct gl_arena* arena);
+
+/**
+ * Frees the arena and everything allocated from it
+ */
+void gl_free_arena(struct gl_arena* arena);
+
+
+
+/**
+ * A string pool stores every distinct string once. Attached to a session,
+ * all copied catalogs of a project share master strings, logical strings and
+ * context info, which are the same in every language
+ *
+ * @return New, empty pool
+ */
+struct gl_string_pool* gl_create_string_pool();
+
+/**
+ * @return Number of distinct strings stored
+ */
+size_t gl_get_string_pool_count(struct gl_string_pool* pool);
+
+/**
+ * @return Number of bytes stored, including 0-terminators
+ */
+size_t gl_get_string_pool_bytes(struct gl_string_pool* pool);
+
+/**
+ * @return Number of bytes which did not have to be stored because an equal
+ *     string already was, including 0-terminators
+ */
+size_t gl_get_string_pool_saved_bytes(struct gl_string_pool* pool);
+
+/**
+ * Frees all strings
+ *
+ * @warning Invalidates all catalogs built using the pool
+ */
+void gl_free_string_pool(struct gl_string_pool* pool);
+
+
+
+/**
+ * A trace records how long every phase of a sync took, i.e. DNS lookup,
+ * connect, TLS handshake, time to first byte and transfer of every request
+ * as well as parsing and building of every catalog
+ * @return New, empty trace
+ */
+struct gl_trace* gl_create_trace();
+
+/**
+ * Writes all spans in Chrome's trace event format, which can be loaded by
+ * chrome://tracing or Perfetto
+ * @return false iff writing failed
+ */
+bool gl_write_trace(struct gl_trace* trace, FILE* stream);
+
+/**
+ * Prints count, total, mean and maximum duration of every phase
+ */
+void gl_print_trace_stats(struct gl_trace* trace, FILE* stream);
+
+/**
+ * Frees all spans
+ */
+void gl_free_trace(struct gl_trace* trace);
+
+
+
+/**
+ * A session owns long lived cURL handles. DNS results, connections and TLS
+ * sessions are kept alive and shared between all requests made through the
+ * same session
+ *
+ * A session may be used by several threads at once. Each transfer takes an
+ * easy handle of the session's pool, so transfers of different threads run
+ * concurrently, and so do the transfers of a single batch fetch. Only batch
+ * fetches of different threads take turns on the session's multi handle.
+ * Options have to be set before the session is shared
+ *
+ * @return New session or 0 on failure
+ */
+struct gl_session* gl_create_session();
+
+/**
+ * If enabled, catalogs built by the session do not copy their strings.
+ * Instead they take ownership of the downloaded document and reference their
+ * fields inside it, which are decoded and 0-terminated in place
+ */
+void gl_set_session_zero_copy(struct gl_session* session, bool zero_copy);
+
+/**
+ * @return true iff catalogs are built as views into the downloaded document
+ */
+bool gl_get_session_zero_copy(struct gl_session* session);
+
+/**
+ * Keeps every response together with its ETag and Last-Modified header inside
+ * `directory'. Later requests of the same URL are sent conditionally and a
+ * 304 Not Modified answer is served from the cache
+ *
+ * @param directory Cache directory, created if missing. 0 disables caching
+ *
+ * @return false iff the directory cannot be used, caching is disabled then
+ */
+bool gl_set_session_cache(struct gl_session* session, uint8_t const* directory);
+
+/**
+ * Records the phases of every request and every catalog built by the session
+ * into `trace'
+ * @param trace Trace owned by the caller, 0 disables tracing
+ */
+void gl_set_session_trace(struct gl_session* session, struct gl_trace* trace);
+
+/**
+ * Shares the source strings of all copied catalogs built by the session
+ * through `pool', 0 gives every catalog its own copies (default). Zero copy
+ * catalogs keep referencing their documents
+ *
+ * @warning The pool has to outlive all catalogs built while it is attached
+ */
+void gl_set_session_string_pool(struct gl_session* session, struct gl_string_pool* pool);
+
+/**
+ * @return Number of requests performed by the session
+ */
+size_t gl_get_session_requests(struct gl_session* session);
+
+/**
+ * @return Number of responses the server rejected with 429 Too Many Requests
+ *     or 503 Service Unavailable, every one of them was retried unless the
+ *     download ran out of attempts
+ */
+size_t gl_get_session_throttled(struct gl_session* session);
+
+/**
+ * @return Number of concurrent downloads the server currently tolerates, as
+ *     learned from throttled responses (0 before the first concurrent
+ *     download)
+ */
+size_t gl_get_session_concurrency(struct gl_session* session);
+
+/**
+ * @return Number of new connections the session had to establish
+ */
+size_t gl_get_session_connects(struct gl_session* session);
+
+/**
+ * @return Number of responses served from the cache after the server
+ *     confirmed them to be unchanged
+ */
+size_t gl_get_session_revalidated(struct gl_session* session);
+
+/**
+ * @return Number of body bytes the session received from the network,
+ *     compressed bodies are counted before decoding
+ */
+size_t gl_get_session_wire_bytes(struct gl_session* session);
+
+/**
+ * @return Number of body bytes the session received after decoding
+ */
+size_t gl_get_session_decoded_bytes(struct gl_session* session);
+
+/**
+ * @return Seconds spent on transfers, from sending a request until the last
+ *     body byte arrived, summed over all requests of the session
+ */
+double gl_get_session_transfer_seconds(struct gl_session* session);
+
+/**
+ * Closes all connections and frees all resources allocated by the session
+ */
+void gl_free_session(struct gl_session* session);
+
+
+
+/**
+ * Creates a context for non-blocking requests, which is driven by the
+ * caller's event loop in the style of curl_multi_socket_action. Requests use
+ * the connections of `session' and many of them progress on one thread
+ * @param socket_callback Reports file descriptors the loop has to watch
+ * @param timer_callback Reports when the loop has to call gl_async_perform
+ *     even if no file descriptor became ready
+ * @return New context or 0 on failure
+ */
+struct gl_async* gl_create_async(	struct gl_session* session,
+					gl_async_socket_callback socket_callback,
+					gl_async_timer_callback timer_callback,
+					void* context
+);
+
+/**
+ * Lets transfers progress after `fd' became ready for `events' or, if `fd'
+ * is GL_ASYNC_TIMEOUT, after the timer expired. Completion callbacks of
+ * finished requests are invoked from within this function and may start new
+ * requests
+ * @return false iff cURL failed
+ */
+bool gl_async_perform(struct gl_async* async, int fd, int events);
+
+/**
+ * @return Milliseconds until gl_async_perform should be called with
+ *     GL_ASYNC_TIMEOUT, -1 if there is no timeout. An alternative to the
+ *     timer callback for loops which poll
+ */
+long gl_get_async_timeout(struct gl_async* async);
+
+/**
+ * @return Number of requests which did not complete yet
+ */
+size_t gl_get_async_running(struct gl_async* async);
+
+/**
+ * Aborts a request which did not complete yet, its completion callback is
+ * invoked immediately with 0
+ */
+void gl_cancel_async_request(struct gl_async_request* request);
+
+/**
+ * Cancels all requests still running and frees the context
+ * @warning Has to be called before freeing the session
+ */
+void gl_free_async(struct gl_async* async);
+
 
 
 /**
  * @return All languages used by `project'
  */
-struct gl_languages* gl_get_languages(uint8_t const* project);
+struct gl_languages* gl_get_languages(struct gl_session* session, uint8_t const* project);
+
+/**
+ * Like gl_get_languages, but returns immediately. `callback' is invoked
+ * exactly once from within gl_async_perform or gl_cancel_async_request
+ * @return Request, valid until its callback is invoked, or 0 iff the request
+ *     could not be started. `callback' is not invoked then
+ */
+struct gl_async_request* gl_async_get_languages(
+			struct gl_async* async,
+			uint8_t const* project,
+			gl_async_languages_callback callback,
+			void* context
+);
 
 /**
  * @return Number of languages in project
@@ -70,6 +461,25 @@ uint8_t const* gl_get_language_name(struct gl_language* language);
  */
 uint8_t const* gl_get_language_code(struct gl_language* language);
 
+/**
+ * Sets how long fetching the n-th language is expected to take, e.g. as
+ * measured by an earlier run. Fetching all languages starts the most
+ * expensive ones first, languages without cost follow in list order
+ */
+void gl_set_language_cost(struct gl_languages* languages, size_t n, double cost);
+
+/**
+ * @return Decoded size of the n-th language's translations as received by
+ *     the last fetch of all languages, 0 iff it was not fetched
+ */
+size_t gl_get_language_bytes(struct gl_languages* languages, size_t n);
+
+/**
+ * @return Seconds the last fetch of all languages spent downloading and
+ *     parsing the n-th language, 0 iff it was not fetched
+ */
+double gl_get_language_seconds(struct gl_languages* languages, size_t n);
+
 /**
  * Frees all resources allocated by the structure
  */
@@ -83,7 +493,101 @@ void gl_free_languages(struct gl_languages* languages);
  *
  * @return All translations of of `project' in `language'
  */
-struct gl_translations* gl_get_translations(uint8_t const* project, uint8_t const* language);
+struct gl_translations* gl_get_translations(
+			struct gl_session* session,
+			uint8_t const* project,
+			uint8_t const* language
+);
+
+/**
+ * Like gl_get_translations, but builds the catalog inside `arena', so one
+ * arena can be reused for many languages without going back to the system
+ * allocator. The catalog still has to be freed with gl_free_translations,
+ * which releases its lookup indices, before the arena is reset or freed
+ *
+ * @param arena Arena owned by the caller
+ */
+struct gl_translations* gl_get_translations_in_arena(
+			struct gl_session* session,
+			uint8_t const* project,
+			uint8_t const* language,
+			struct gl_arena* arena
+);
+
+/**
+ * Like gl_get_translations, but returns immediately. `callback' is invoked
+ * exactly once from within gl_async_perform or gl_cancel_async_request
+ * @return Request, valid until its callback is invoked, or 0 iff the request
+ *     could not be started. `callback' is not invoked then
+ */
+struct gl_async_request* gl_async_get_translations(
+			struct gl_async* async,
+			uint8_t const* project,
+			uint8_t const* language,
+			gl_async_translations_callback callback,
+			void* context
+);
+
+/**
+ * Fetches the translations of all `languages' concurrently, keeping at most
+ * `jobs' downloads in flight. `callback' is invoked once per language in
+ * order of completion
+ *
+ * @param project GetLocalization.com project name
+ * @param languages Languages of interest
+ * @param jobs Maximum number of parallel downloads
+ *
+ * @return false iff the downloads could not be set up
+ */
+bool gl_fetch_translations(	struct gl_session* session,
+				uint8_t const* project,
+				struct gl_languages* languages,
+				size_t jobs,
+				gl_translations_callback callback,
+				void* context
+);
+
+/**
+ * Like gl_fetch_translations, but as a pipeline of three stages connected by
+ * bounded queues: the calling thread only downloads, `parsers' threads build
+ * the catalogs and `writers' threads invoke `callback'. Downloads wait while
+ * all parsers are busy and parsers wait while all writers are busy, so the
+ * number of documents and catalogs in memory depends on the number of
+ * threads instead of the number of languages
+ *
+ * @param parsers Number of threads building catalogs, at least 1
+ * @param writers Number of threads invoking `callback', at least 1
+ *
+ * @warning `callback' is invoked concurrently iff `writers' is above 1
+ * @return false iff the downloads could not be set up
+ */
+bool gl_fetch_translations_pipelined(	struct gl_session* session,
+					uint8_t const* project,
+					struct gl_languages* languages,
+					size_t jobs,
+					size_t parsers, size_t writers,
+					gl_translations_callback callback,
+					void* context
+);
+
+/**
+ * Streams the translations of all `languages' without building them in
+ * memory. Every translation is parsed and reported while its language is
+ * still downloading, so memory usage does not depend on the project's size
+ *
+ * @param project GetLocalization.com project name
+ * @param languages Languages of interest
+ * @param jobs Maximum number of parallel downloads
+ *
+ * @return false iff the downloads could not be set up
+ */
+bool gl_stream_translations(	struct gl_session* session,
+				uint8_t const* project,
+				struct gl_languages* languages,
+				size_t jobs,
+				struct gl_stream_callbacks const* callbacks,
+				void* context
+);
 
 /**
  * @return Number of translations
@@ -95,6 +599,28 @@ size_t gl_get_translations_count(struct gl_translations* translations);
  */
 struct gl_translation* gl_get_translation(struct gl_translations* translations, size_t n);
 
+/**
+ * Finds a translation by its master string (msgid). An index over all master
+ * strings is built on first use, so every lookup takes constant expected
+ * time. Lookups may come from several threads at once
+ * @return First translation with `master_string' or 0 if there is none
+ */
+struct gl_translation* gl_find_translation_by_master(
+			struct gl_translations* translations,
+			uint8_t const* master_string
+);
+
+/**
+ * Finds a translation by its logical string, like
+ * gl_find_translation_by_master
+ * @return First translation with `logical_string' or 0 if there is none or
+ *     `logical_string' is empty
+ */
+struct gl_translation* gl_find_translation_by_logical(
+			struct gl_translations* translations,
+			uint8_t const* logical_string
+);
+
 /**
  * @return 0-terminated master string of translation
  */
@@ -116,12 +642,76 @@ uint8_t const* gl_get_translation_context_info(struct gl_translation* translatio
 uint8_t const* gl_get_translation_string(struct gl_translation* translation);
 
 /**
- * Frees all resources allocated by struct
+ * @return Length of master string in bytes (without 0-terminator)
+ */
+size_t gl_get_translation_master_string_length(struct gl_translation* translation);
+
+/**
+ * @return Length of logical string in bytes (without 0-terminator)
+ */
+size_t gl_get_translation_logical_string_length(struct gl_translation* translation);
+
+/**
+ * @return Length of context info in bytes (without 0-terminator)
+ */
+size_t gl_get_translation_context_info_length(struct gl_translation* translation);
+
+/**
+ * @return Length of translated string in bytes (without 0-terminator)
+ */
+size_t gl_get_translation_string_length(struct gl_translation* translation);
+
+/**
+ * Frees all resources allocated by struct and has to be called for every
+ * catalog. The lookup indices and the document of zero copy catalogs are
+ * released at once, the rest of catalogs built by
+ * gl_get_translations_in_arena is released together with their arena
  */
 void gl_free_translations(struct gl_translations* translations);
 
 
 
+/**
+ * Writes all languages and one catalog per language into a binary snapshot
+ * at `path'. `translations' must contain gl_get_languages_count entries, a
+ * catalog may be 0 if it is missing. The previous snapshot is replaced
+ * atomically
+ *
+ * @return true iff the snapshot was written
+ */
+bool gl_save_snapshot(	uint8_t const* path,
+			struct gl_languages* languages,
+			struct gl_translations* const* translations
+);
+
+/**
+ * Maps a snapshot written by gl_save_snapshot into memory. Records and
+ * strings are read directly from the mapping without being copied or
+ * relocated. Every record is checked to reference 0-terminated strings
+ * inside the snapshot before it is opened
+ *
+ * @return Snapshot or 0 if the file is missing, truncated, corrupted or was
+ *     written on an incompatible platform
+ */
+struct gl_snapshot* gl_open_snapshot(uint8_t const* path);
+
+/**
+ * @return Languages of the snapshot, owned by the snapshot
+ */
+struct gl_languages* gl_get_snapshot_languages(struct gl_snapshot* snapshot);
+
+/**
+ * @return Catalog of the `n'th language, owned by the snapshot
+ */
+struct gl_translations* gl_get_snapshot_translations(struct gl_snapshot* snapshot, size_t n);
+
+/**
+ * Unmaps the snapshot, invalidating all of its languages and catalogs
+ */
+void gl_close_snapshot(struct gl_snapshot* snapshot);
+
+
+
 
 
 #endif
@@ -20,12 +20,90 @@
  *
  *  3. This notice may not be removed or altered from any source distribution.
  */
+#include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <curl/curl.h>
 
+#include "cache.h"
+#include "error.h"
+#include "gltoolkit.h"
 #include "http.h"
+#include "intern.h"
+#include "trace.h"
+
+
+
+
+
+/**
+ * Minimal capacity of a response buffer, unless the server announced a
+ * smaller Content-Length
+ */
+#ifndef GL_HTTP_MINIMAL_BUFFER_LENGTH
+#define GL_HTTP_MINIMAL_BUFFER_LENGTH 4096
+#endif
+
+/**
+ * Maximal capacity reserved for an announced Content-Length, since the server
+ * controls it. Longer responses grow the buffer as their data arrives
+ */
+#ifndef GL_HTTP_MAXIMAL_RESERVED_LENGTH
+#define GL_HTTP_MAXIMAL_RESERVED_LENGTH (64 * 1024 * 1024)
+#endif
+
+/**
+ * Content codings offered to the server, the empty string offers every coding
+ * cURL can decode (gzip and deflate with zlib)
+ */
+#ifndef GL_HTTP_ACCEPT_ENCODING
+#define GL_HTTP_ACCEPT_ENCODING ""
+#endif
+
+/**
+ * Size of chunks a cached body is passed to a sink in
+ */
+#define GL_HTTP_CACHE_CHUNK_LENGTH 16384
+
+/**
+ * Number of attempts of a download the server throttles (429 Too Many
+ * Requests or 503 Service Unavailable) before it fails
+ */
+#ifndef GL_HTTP_MAX_ATTEMPTS
+#define GL_HTTP_MAX_ATTEMPTS 6
+#endif
+
+/**
+ * Delay in microseconds before retrying a throttled download without
+ * Retry-After header, doubled with every further attempt
+ */
+#ifndef GL_HTTP_BACKOFF
+#define GL_HTTP_BACKOFF 100000
+#endif
+
+/**
+ * Upper bound of every retry delay in microseconds, including delays
+ * requested by the server
+ */
+#ifndef GL_HTTP_MAX_BACKOFF
+#define GL_HTTP_MAX_BACKOFF 30000000
+#endif
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Number of gl_init calls not yet balanced by gl_cleanup
+ */
+static pthread_mutex_t gl_init_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t gl_init_count = 0;
 
 
 
@@ -39,12 +117,213 @@ struct gl_http_response {
 
 	size_t response_length;
 	size_t buffer_length;
+
+	/* Transfer filling the buffer, used to look up the Content-Length
+	 */
+	CURL* curl;
+
+	/* Streaming consumer replacing the buffer (optional)
+	 */
+	gl_download_sink sink;
+	void* sink_context;
+	size_t n;
+
+	/* Revalidation of a cached response (optional)
+	 */
+	struct gl_cache* cache;
+	uint8_t const* url;
+	struct curl_slist* validators;
+	struct gl_cache_writer* cache_writer;
+	uint8_t* etag;
+	uint8_t* last_modified;
+
+	/* Delay requested by a throttling server in seconds, -1 if none
+	 */
+	long retry_after;
+
+	/* Body has a Content-Encoding, its Content-Length is the compressed
+	 * length and no hint for the decoded length
+	 */
+	bool encoded;
+
+	/* Statistics
+	 */
+	size_t chunks;
+	size_t reallocations;
+	size_t copied_bytes;
+	size_t wire_bytes;
+	double transfer_seconds;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * Long lived cURL handles of a session. Every easy handle is attached to
+ * `share', so DNS results, open connections and TLS sessions are reused by
+ * all requests of the session
+ */
+struct gl_session {
+	CURLSH* share;
+	CURLM* multi;
+
+	/* `lock' guards the handle pool, the window, the jitter and the
+	 * statistics, `transfers' the multi handle for a whole
+	 * gl_download_all and `share_locks' every kind of data in `share'
+	 */
+	pthread_mutex_t lock;
+	pthread_mutex_t transfers;
+	pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+	/* Easy handles available for downloads
+	 */
+	CURL** idle;
+	size_t idle_count;
+	size_t handles_count;
+
+	/* Build catalogs as views into the response (optional)
+	 */
+	bool zero_copy;
+
+	/* Persistent response cache (optional)
+	 */
+	struct gl_cache* cache;
+
+	/* Phase timings (optional)
+	 */
+	struct gl_trace* trace;
+
+	/* Shared source strings of all catalogs (optional)
+	 */
+	struct gl_string_pool* strings;
+
+	/* Concurrent transfers the server currently tolerates, grown
+	 * additively while downloads succeed and halved whenever the server
+	 * throttles a transfer started after the last decrease (0 until the
+	 * first concurrent download)
+	 */
+	double window;
+	uint64_t decreased;
+
+	/* State of the retry delay jitter
+	 */
+	uint64_t random;
+
+	/* Statistics
+	 */
+	size_t requests;
+	size_t throttled;
+	size_t connects;
+	size_t revalidated;
+	size_t wire_bytes;
+	size_t decoded_bytes;
+	double transfer_seconds;
+};
+
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * One download driven by an event loop. Requests of an async context form a
+ * doubly linked list, so they can be cancelled in any order
+ */
+struct gl_async_request {
+	struct gl_async* async;
+	CURL* curl;
+	struct gl_http_response* response;
+	uint8_t* url;
+
+	gl_async_download_callback callback;
+	void* context;
+
+	struct gl_async_request* previous;
+	struct gl_async_request* next;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * Multi handle of a session driven by the caller's event loop using
+ * curl_multi_socket_action
+ */
+struct gl_async {
+	struct gl_session* session;
+	CURLM* multi;
+
+	gl_async_socket_callback socket_callback;
+	gl_async_timer_callback timer_callback;
+	void* context;
+
+	struct gl_async_request* requests;
+	size_t running;
 };
 
 
 
 
 
+/**
+ * [PRIVATE]
+ *
+ * Grows the buffer to hold at least `required_length' bytes. The capacity is
+ * at least doubled so n bytes arriving in arbitrary chunks cause O(log n)
+ * reallocations. As long as the buffer is empty a known Content-Length is
+ * reserved at once, up to GL_HTTP_MAXIMAL_RESERVED_LENGTH. Encoded bodies are
+ * not reserved, since cURL decodes them and their Content-Length only counts
+ * the compressed bytes
+ *
+ * @return false iff the buffer could not be grown, it is kept unchanged then
+ */
+static bool reserve_response(	struct gl_http_response* response,
+				size_t required_length
+		) {
+	if (required_length <= response->buffer_length) {
+		return true;
+	}
+
+	size_t buffer_length = 2 * response->buffer_length;
+	if (buffer_length < GL_HTTP_MINIMAL_BUFFER_LENGTH) {
+		buffer_length = GL_HTTP_MINIMAL_BUFFER_LENGTH;
+	}
+
+	if (!response->response_length && !response->encoded && response->curl) {
+		curl_off_t content_length = -1;
+		curl_easy_getinfo(response->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+
+		if (content_length > 0) {
+			buffer_length = content_length < GL_HTTP_MAXIMAL_RESERVED_LENGTH
+				? (size_t)content_length
+				: GL_HTTP_MAXIMAL_RESERVED_LENGTH
+			;
+		}
+	}
+
+	if (buffer_length < required_length) {
+		buffer_length = required_length;
+	}
+
+	uint8_t* data = realloc(response->data, buffer_length);
+	if (!data) {
+		gl_set_error("Cannot allocate %lu bytes for response", (unsigned long)buffer_length);
+		return false;
+	}
+
+	if (response->response_length) {
+		response->reallocations += 1;
+		response->copied_bytes += response->response_length;
+	}
+	response->data = data;
+	response->buffer_length = buffer_length;
+	return true;
+}
+
+
+
 /**
  * [PRIVATE]
  *
@@ -54,17 +333,49 @@ static size_t write_response(void* src, size_t size, size_t nmemb, void* dest) {
 	struct gl_http_response* response = dest;
 	size_t required_length = response->response_length + size * nmemb;
 
-	/* Reallocate buffer iff necessary
+	long status = 0;
+	curl_easy_getinfo(response->curl, CURLINFO_RESPONSE_CODE, &status);
+
+	/* Bodies of error responses (e.g. rate limit notices) are neither
+	 * cached nor passed on, the download fails or is retried instead
+	 */
+	if (status < 200 || status >= 300) {
+		return size * nmemb;
+	}
+
+	/* Store successful responses in the cache while they arrive
+	 */
+	if (response->cache && !response->chunks && 200 == status) {
+		response->cache_writer = gl_create_cache_writer(response->cache, response->url);
+	}
+	if (response->cache_writer && !gl_write_cache_writer(response->cache_writer, src, size * nmemb)) {
+		gl_abort_cache_writer(response->cache_writer);
+		response->cache_writer = 0;
+	}
+
+	/* Pass data to sink instead of buffering it
+	 */
+	if (response->sink) {
+		response->response_length += size * nmemb;
+		response->chunks += 1;
+
+		if (!response->sink(response->n, src, size * nmemb, response->sink_context)) {
+			return 0;
+		}
+		return size * nmemb;
+	}
+
+	/* Reallocate buffer iff necessary, failing the transfer if impossible
 	 */
-	if (required_length > response->buffer_length) {
-		response->data = realloc(response->data, required_length);
-		response->buffer_length = required_length;
+	if (!reserve_response(response, required_length)) {
+		return 0;
 	}
 
 	/* Copy data
 	 */
 	memcpy(&response->data[response->response_length], src, size * nmemb);
 	response->response_length += size * nmemb;
+	response->chunks += 1;
 
 	return size * nmemb;
 }
@@ -74,76 +385,1546 @@ static size_t write_response(void* src, size_t size, size_t nmemb, void* dest) {
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * Stores the trimmed value of header `name' in `value'
+ *
+ * @return true iff `line' contains header `name'
+ */
+static bool read_header_value(	uint8_t** value,
+				uint8_t const* name,
+				uint8_t const* line, size_t length
+		) {
+	size_t name_length = strlen(name);
+
+	if (length < name_length || strncasecmp(line, name, name_length)) {
+		return false;
+	}
+
+	uint8_t const* begin = &line[name_length];
+	uint8_t const* end = &line[length];
+
+	while (begin < end && (' ' == *begin || '\t' == *begin)) {
+		++begin;
+	}
+	while (end > begin && (' ' == end[-1] || '\t' == end[-1] || '\r' == end[-1] || '\n' == end[-1])) {
+		--end;
+	}
+
+	free(*value);
+	*value = strndup(begin, end - begin);
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Delay in seconds requested by Retry-After header `value', which is
+ *     either a number of seconds or a HTTP date
+ */
+static long parse_retry_after(uint8_t const* value) {
+	if (!*value || strspn(value, "0123456789") == strlen(value)) {
+		return strtol(value, 0, 10);
+	}
+
+	time_t date = curl_getdate(value, 0);
+	time_t now = time(0);
+
+	if (date < 0) {
+		return -1;
+	}
+	return date > now ? date - now : 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * cURL header function callback, remembers the validators and requested
+ * retry delay of the response
  */
-struct gl_http_response* gl_download(uint8_t const* url) {
+static size_t read_header(char* src, size_t size, size_t nmemb, void* dest) {
+	struct gl_http_response* response = dest;
+	size_t length = size * nmemb;
+	uint8_t* retry_after = 0;
+	uint8_t* encoding = 0;
 
-	/* Initialize cURL
+	/* Every status line starts a new header block, e.g. after redirects
 	 */
-	CURL* curl = curl_easy_init();
+	if (length >= 5 && !strncasecmp(src, "HTTP/", 5)) {
+		free(response->etag);
+		free(response->last_modified);
+		response->etag = 0;
+		response->last_modified = 0;
+		response->retry_after = -1;
+		response->encoded = false;
 
-	if (!curl) {
-		fprintf(stderr, "curl_init() failed\n");
-		return 0;
+	} else if (read_header_value(&retry_after, "Retry-After:", src, length)) {
+		response->retry_after = parse_retry_after(retry_after);
+		free(retry_after);
+
+	} else if (read_header_value(&encoding, "Content-Encoding:", src, length)) {
+		response->encoded = *encoding && strcasecmp(encoding, "identity");
+		free(encoding);
+
+	} else if (!read_header_value(&response->etag, "ETag:", src, length)) {
+		read_header_value(&response->last_modified, "Last-Modified:", src, length);
+	}
+	return length;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Appends header `name' with `value' to `headers'
+ */
+static struct curl_slist* append_header(	struct curl_slist* headers,
+						uint8_t const* name,
+						uint8_t const* value
+		) {
+	size_t length = strlen(name) + 2 + strlen(value) + 1;
+	uint8_t* header = malloc(length);
+
+	snprintf(header, length, "%s: %s", name, value);
+	headers = curl_slist_append(headers, header);
+
+	free(header);
+	return headers;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Replaces the (empty) body of a 304 response with the cached body, which is
+ * either buffered or passed to the response's sink
+ *
+ * @return true iff the cached body could be read
+ */
+static bool restore_response(struct gl_http_response* response) {
+	size_t length = 0;
+	FILE* body = gl_open_cache_body(response->cache, response->url, &length);
+
+	if (!body) {
+		gl_set_error("Cached response of %s vanished", response->url);
+		return false;
 	}
+	bool success = true;
 
 
-	/* Prepare response
+	/* Buffer whole body at once
 	 */
-	struct gl_http_response* response = malloc(sizeof(struct gl_http_response));
-	response->response_length = 0;
-	response->buffer_length = 1;
-	response->data = malloc(response->buffer_length * sizeof(uint8_t));
+	if (!response->sink) {
+		success = reserve_response(response, length);
+
+		if (success) {
+			response->response_length = fread(response->data, 1, length, body);
+			response->chunks += 1;
+			success = length == response->response_length;
+		}
+
+
+	/* Feed sink in chunks, like a network transfer would
+	 */
+	} else {
+		uint8_t chunk[GL_HTTP_CACHE_CHUNK_LENGTH];
+		size_t read = 0;
+
+		while (success && (read = fread(chunk, 1, sizeof(chunk), body))) {
+			response->response_length += read;
+			response->chunks += 1;
+			success = response->sink(response->n, chunk, read, response->sink_context);
+		}
+		success = success && !ferror(body);
+	}
+
+	fclose(body);
+	return success;
+}
+
 
 
-	/* Configure cURL
+/**
+ * [PRIVATE]
+ *
+ * @return Empty response buffer
+ */
+static struct gl_http_response* create_response() {
+	struct gl_http_response* response = calloc(1, sizeof(struct gl_http_response));
+
+	/* Empty bodies still come as 0-terminated buffer, which does not count
+	 * as capacity
 	 */
+	response->data = calloc(1, sizeof(uint8_t));
+	response->retry_after = -1;
+	return response;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Prepares `curl' for downloading `url' into `response' while sharing
+ * connections, DNS and TLS sessions with all other handles of `session'
+ */
+static void configure_download(	struct gl_session* session,
+				CURL* curl,
+				uint8_t const* url,
+				struct gl_http_response* response
+		) {
+	curl_easy_reset(curl);
+	curl_easy_setopt(curl, CURLOPT_SHARE, session->share);
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 	curl_easy_setopt(curl, CURLOPT_URL, url);
+
+	/* cURL decodes compressed bodies as they arrive, so the write function
+	 * only ever sees decoded chunks
+	 */
+	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, GL_HTTP_ACCEPT_ENCODING);
 	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_response);
 	curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, read_header);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, response);
 
+	response->curl = curl;
 
-	/* Download contents
-	 */
-	CURLcode code = curl_easy_perform(curl);
-	curl_easy_cleanup(curl);
-
-	if (CURLE_OK != code) {
-		fprintf(stderr, "curl_easy_perform() failed %s\n", curl_easy_strerror(code));
-		gl_free_response(response);
-		return 0;
+	if (!session->cache) {
+		return;
 	}
 
 
-	/* Return response :-)
+	/* Ask the server to confirm the cached response instead of sending
+	 * it again
 	 */
-	return response;
+	uint8_t* etag = 0;
+	uint8_t* last_modified = 0;
+
+	if (gl_get_cache_validators(session->cache, url, &etag, &last_modified)) {
+		if (etag) {
+			response->validators = append_header(response->validators, "If-None-Match", etag);
+		}
+		if (last_modified) {
+			response->validators = append_header(response->validators, "If-Modified-Since", last_modified);
+		}
+		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, response->validators);
+	}
+	free(etag);
+	free(last_modified);
+
+	response->cache = session->cache;
+	response->url = url;
 }
 
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * Records the phases of the transfer on `curl', which just finished. cURL
+ * reports every phase as time since the transfer started, so the phases are
+ * consecutive slices of the whole download
  */
-uint8_t* gl_get_response_data(struct gl_http_response* response) {
-	return response->data;
+static void trace_download(struct gl_session* session, CURL* curl) {
+	CURLINFO const infos[] = {
+		CURLINFO_NAMELOOKUP_TIME_T,
+		CURLINFO_CONNECT_TIME_T,
+		CURLINFO_APPCONNECT_TIME_T,
+		CURLINFO_PRETRANSFER_TIME_T,
+		CURLINFO_STARTTRANSFER_TIME_T,
+		CURLINFO_TOTAL_TIME_T
+	};
+	uint8_t const* names[] = {"dns", "connect", "tls", "request", "ttfb", "transfer"};
+
+	char* url = 0;
+	curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+
+	curl_off_t total = 0;
+	curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+	uint64_t end = gl_trace_now();
+	uint64_t start = end - total;
+	gl_add_trace_span(session->trace, "download", url, 0, start, end);
+
+
+	/* Phases not needed by this transfer (e.g. DNS and connect on a reused
+	 * connection) are empty and not recorded
+	 */
+	curl_off_t previous = 0;
+
+	size_t i = 0; for (; i < sizeof(infos) / sizeof(infos[0]); ++i) {
+		curl_off_t offset = 0;
+		curl_easy_getinfo(curl, infos[i], &offset);
+
+		if (offset > previous) {
+			gl_add_trace_span(session->trace, names[i], url, 0,
+				start + previous, start + offset
+			);
+			previous = offset;
+		}
+	}
 }
 
 
 
 /**
- * @return Response data length
+ * [PRIVATE]
+ *
+ * Updates the session's and `response''s statistics after a transfer on
+ * `curl' finished
  */
-size_t gl_get_response_length(struct gl_http_response* response) {
-	return response->response_length;
+static void count_download(	struct gl_session* session,
+				CURL* curl,
+				struct gl_http_response* response
+		) {
+	long connects = 0;
+	curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+	/* Body bytes as received, i.e. before decoding
+	 */
+	curl_off_t wire_bytes = 0;
+	curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+	response->wire_bytes = wire_bytes;
+
+	curl_off_t transfer_time = 0;
+	curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &transfer_time);
+	response->transfer_seconds = transfer_time / 1e6;
+
+	pthread_mutex_lock(&session->lock);
+	session->requests += 1;
+	session->connects += connects;
+	session->wire_bytes += response->wire_bytes;
+	session->decoded_bytes += response->response_length;
+	session->transfer_seconds += transfer_time / 1e6;
+	pthread_mutex_unlock(&session->lock);
+
+	if (session->trace) {
+		trace_download(session, curl);
+	}
 }
 
 
 
 /**
- * Frees all resources allocated by struct
+ * [PRIVATE]
+ *
+ * Detaches `response' from `curl' after its transfer finished. Successful
+ * responses are committed to the cache and 304 responses are replaced by
+ * their cached body
+ *
+ * @param transferred true iff cURL completed the transfer
+ *
+ * @return true iff `response' holds a usable body, i.e. the transfer
+ *     completed with a 2xx status or was revalidated
  */
-void gl_free_response(struct gl_http_response* response) {
+static bool complete_download(	struct gl_session* session,
+				CURL* curl,
+				struct gl_http_response* response,
+				bool transferred
+		) {
+	long status = 0;
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+	response->curl = 0;
+
+	if (response->cache_writer) {
+		if (transferred && 200 == status) {
+			gl_commit_cache_writer(response->cache_writer, response->etag, response->last_modified);
+		} else {
+			gl_abort_cache_writer(response->cache_writer);
+		}
+		response->cache_writer = 0;
+	}
+
+	if (transferred && 304 == status && response->cache) {
+		pthread_mutex_lock(&session->lock);
+		session->revalidated += 1;
+		pthread_mutex_unlock(&session->lock);
+		return restore_response(response);
+	}
+
+	if (transferred && (status < 200 || status >= 300)) {
+		char* url = 0;
+		curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+
+		gl_set_error("Downloading %s failed with status %li", url, status);
+		return false;
+	}
+	return transferred;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Counts the transfer on `curl' as throttled iff the server rejected it
+ * because of its load
+ *
+ * @return true iff the transfer should be retried later
+ */
+static bool is_throttled(	struct gl_session* session,
+				CURL* curl,
+				bool transferred
+		) {
+	long status = 0;
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+	bool throttled = transferred && (429 == status || 503 == status);
+
+	pthread_mutex_lock(&session->lock);
+	session->throttled += throttled;
+	pthread_mutex_unlock(&session->lock);
+	return throttled;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Adapts the number of concurrent transfers of `session' (AIMD) to the
+ * outcome of a transfer started at `started'. All transfers in flight
+ * while the server is overloaded are likely throttled, so only the first
+ * of them halves the window
+ */
+static void adapt_concurrency(	struct gl_session* session,
+				bool throttled,
+				uint64_t started,
+				size_t jobs
+		) {
+	pthread_mutex_lock(&session->lock);
+
+	if (!throttled) {
+		session->window += 1.0 / session->window;
+	} else if (started >= session->decreased) {
+		session->window /= 2.0;
+		session->decreased = gl_trace_now();
+	}
+
+	if (session->window < 1.0) {
+		session->window = 1.0;
+	}
+	if (session->window > jobs) {
+		session->window = jobs;
+	}
+	pthread_mutex_unlock(&session->lock);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Microseconds to wait before the `attempt''th retry of a throttled
+ *     download. The server's Retry-After is honoured, otherwise the delay
+ *     grows exponentially. Jitter keeps throttled transfers from returning
+ *     at the same instant
+ */
+static uint64_t retry_delay(	struct gl_session* session,
+				struct gl_http_response* response,
+				size_t attempt
+		) {
+	pthread_mutex_lock(&session->lock);
+	session->random ^= session->random << 13;
+	session->random ^= session->random >> 7;
+	session->random ^= session->random << 17;
+	uint64_t random = session->random;
+	pthread_mutex_unlock(&session->lock);
+
+	/* Delays are clamped before jitter is derived from them, so neither
+	 * the shift nor the subtraction can overflow
+	 */
+	uint64_t delay = GL_HTTP_MAX_BACKOFF;
+	uint64_t jitter_divisor = 2;
+
+	if (response->retry_after >= 0) {
+		if (response->retry_after < GL_HTTP_MAX_BACKOFF / 1000000) {
+			delay = response->retry_after * 1000000ull;
+		}
+		jitter_divisor = 4;
+	} else if (attempt < 32 && ((uint64_t)GL_HTTP_BACKOFF << (attempt ? attempt - 1 : 0)) < GL_HTTP_MAX_BACKOFF) {
+		delay = (uint64_t)GL_HTTP_BACKOFF << (attempt ? attempt - 1 : 0);
+	}
+	uint64_t jitter = delay / jitter_divisor;
+
+	return jitter
+		? delay - jitter + random % (jitter + 1)
+		: delay
+	;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Blocks for `delay' microseconds
+ */
+static void pause_download(uint64_t delay) {
+	struct timespec duration = {
+		.tv_sec = delay / 1000000,
+		.tv_nsec = (delay % 1000000) * 1000
+	};
+
+	while (nanosleep(&duration, &duration) && EINTR == errno);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Serializes access to the kind of data `data' inside the session's share,
+ * whose handles may transfer on different threads
+ */
+static void lock_share(	__attribute__((unused)) CURL* curl,
+			curl_lock_data data,
+			__attribute__((unused)) curl_lock_access access,
+			void* context
+		) {
+	struct gl_session* session = context;
+	pthread_mutex_lock(&session->share_locks[data]);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Counterpart of lock_share
+ */
+static void unlock_share(__attribute__((unused)) CURL* curl, curl_lock_data data, void* context) {
+	struct gl_session* session = context;
+	pthread_mutex_unlock(&session->share_locks[data]);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Idle easy handle of `session''s pool or a new one, 0 on failure
+ */
+static CURL* acquire_handle(struct gl_session* session) {
+	CURL* curl = 0;
+	pthread_mutex_lock(&session->lock);
+
+	if (session->idle_count) {
+		curl = session->idle[--session->idle_count];
+		goto exit;
+	}
+
+	curl = curl_easy_init();
+	if (!curl) {
+		gl_set_error("curl_easy_init() failed");
+		goto exit;
+	}
+
+	session->idle = realloc(session->idle, (session->handles_count + 1) * sizeof(CURL*));
+	session->handles_count += 1;
+
+exit:
+	pthread_mutex_unlock(&session->lock);
+	return curl;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Returns `curl' into `session''s pool, keeping its connections alive
+ */
+static void release_handle(struct gl_session* session, CURL* curl) {
+	pthread_mutex_lock(&session->lock);
+	session->idle[session->idle_count++] = curl;
+	pthread_mutex_unlock(&session->lock);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Schedules the n-th url of `urls' on a pooled easy handle inside the
+ * session's multi handle
+ *
+ * @return true iff the transfer was added
+ */
+static bool add_download(	struct gl_session* session,
+				uint8_t const* const* urls, size_t n,
+				CURL** handles,
+				struct gl_http_response** responses,
+				gl_download_sink sink, void* sink_context
+		) {
+	CURL* curl = acquire_handle(session);
+
+	if (!curl) {
+		return false;
+	}
+
+	responses[n] = create_response();
+	responses[n]->sink = sink;
+	responses[n]->sink_context = sink_context;
+	responses[n]->n = n;
+	configure_download(session, curl, urls[n], responses[n]);
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*)n);
+
+	CURLMcode code = curl_multi_add_handle(session->multi, curl);
+	if (CURLM_OK != code) {
+		gl_set_error("curl_multi_add_handle() failed %s", curl_multi_strerror(code));
+		release_handle(session, curl);
+		gl_free_response(responses[n]);
+		responses[n] = 0;
+		return false;
+	}
+
+	handles[n] = curl;
+	return true;
+}
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Forwards cURL's interest in `socket' to the caller's event loop
+ */
+static int async_socket(	__attribute__((unused)) CURL* curl,
+				curl_socket_t socket, int what, void* context,
+				__attribute__((unused)) void* socket_context
+		) {
+	struct gl_async* async = context;
+	int events = 0;
+
+	if (CURL_POLL_REMOVE == what) {
+		events = GL_ASYNC_REMOVE;
+	} else {
+		events |= (CURL_POLL_IN & what) ? GL_ASYNC_IN : 0;
+		events |= (CURL_POLL_OUT & what) ? GL_ASYNC_OUT : 0;
+	}
+
+	async->socket_callback(socket, events, async->context);
+	return 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Forwards cURL's timeout to the caller's event loop
+ */
+static int async_timer(__attribute__((unused)) CURLM* multi, long timeout, void* context) {
+	struct gl_async* async = context;
+
+	async->timer_callback(timeout, async->context);
+	return 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Detaches `request' from its transfer and hands the response (0 iff
+ * `transferred' is false or the response is unusable) to the callback
+ */
+static void finish_async_request(struct gl_async_request* request, bool transferred) {
+	struct gl_async* async = request->async;
+	struct gl_http_response* response = request->response;
+
+	transferred = complete_download(async->session, request->curl, response, transferred);
+
+	curl_multi_remove_handle(async->multi, request->curl);
+	release_handle(async->session, request->curl);
+	async->running -= 1;
+
+
+	/* Unlink before the callback, which might start new requests
+	 */
+	if (request->previous) {
+		request->previous->next = request->next;
+	} else {
+		async->requests = request->next;
+	}
+	if (request->next) {
+		request->next->previous = request->previous;
+	}
+
+	if (!transferred) {
+		gl_free_response(response);
+		response = 0;
+	}
+	request->callback(response, request->context);
+
+	free(request->url);
+	free(request);
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_init() {
+	bool initialized = true;
+	pthread_mutex_lock(&gl_init_lock);
+
+	if (!gl_init_count) {
+		CURLcode code = curl_global_init(CURL_GLOBAL_ALL);
+
+		if (CURLE_OK != code) {
+			gl_set_error("curl_global_init() failed %s", curl_easy_strerror(code));
+			initialized = false;
+		}
+	}
+	gl_init_count += initialized;
+
+	pthread_mutex_unlock(&gl_init_lock);
+	return initialized;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_cleanup() {
+	pthread_mutex_lock(&gl_init_lock);
+
+	if (gl_init_count && !--gl_init_count) {
+		curl_global_cleanup();
+	}
+	pthread_mutex_unlock(&gl_init_lock);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_session* gl_create_session() {
+
+	/* cURL initializes itself implicitly otherwise, which is not thread
+	 * safe
+	 */
+	pthread_mutex_lock(&gl_init_lock);
+	bool initialized = gl_init_count;
+	pthread_mutex_unlock(&gl_init_lock);
+
+	if (!initialized) {
+		gl_set_error("gl_init() has to be called before creating a session");
+		return 0;
+	}
+
+	struct gl_session* session = calloc(1, sizeof(struct gl_session));
+	pthread_mutex_init(&session->lock, 0);
+	pthread_mutex_init(&session->transfers, 0);
+
+	size_t i = 0; for (; i < CURL_LOCK_DATA_LAST; ++i) {
+		pthread_mutex_init(&session->share_locks[i], 0);
+	}
+
+
+	/* Share DNS cache, connection pool and TLS sessions between all
+	 * handles of the session
+	 */
+	session->share = curl_share_init();
+	if (!session->share) {
+		gl_set_error("curl_share_init() failed");
+		goto exit_failure;
+	}
+	curl_share_setopt(session->share, CURLSHOPT_LOCKFUNC, lock_share);
+	curl_share_setopt(session->share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+	curl_share_setopt(session->share, CURLSHOPT_USERDATA, session);
+	curl_share_setopt(session->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(session->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+	curl_share_setopt(session->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	session->random = (gl_trace_now() ^ (uintptr_t)session) | 1;
+
+
+	/* Long lived handle for concurrent downloads, easy handles are pooled
+	 * on demand
+	 */
+	session->multi = curl_multi_init();
+	if (!session->multi) {
+		gl_set_error("curl_multi_init() failed");
+		goto exit_failure;
+	}
+	return session;
+
+
+	/* Free partially initialized session
+	 */
+exit_failure:
+	gl_free_session(session);
+	return 0;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_set_session_zero_copy(struct gl_session* session, bool zero_copy) {
+	session->zero_copy = zero_copy;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_get_session_zero_copy(struct gl_session* session) {
+	return session->zero_copy;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_set_session_cache(struct gl_session* session, uint8_t const* directory) {
+	if (session->cache) {
+		gl_free_cache(session->cache);
+		session->cache = 0;
+	}
+	if (!directory) {
+		return true;
+	}
+
+	session->cache = gl_create_cache(directory);
+	return session->cache;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_set_session_trace(struct gl_session* session, struct gl_trace* trace) {
+	session->trace = trace;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_trace* gl_get_session_trace(struct gl_session* session) {
+	return session->trace;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_set_session_string_pool(struct gl_session* session, struct gl_string_pool* pool) {
+	session->strings = pool;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_string_pool* gl_get_session_string_pool(struct gl_session* session) {
+	return session->strings;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_session_requests(struct gl_session* session) {
+	pthread_mutex_lock(&session->lock);
+	size_t requests = session->requests;
+	pthread_mutex_unlock(&session->lock);
+	return requests;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_session_throttled(struct gl_session* session) {
+	pthread_mutex_lock(&session->lock);
+	size_t throttled = session->throttled;
+	pthread_mutex_unlock(&session->lock);
+	return throttled;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_session_concurrency(struct gl_session* session) {
+	pthread_mutex_lock(&session->lock);
+	size_t concurrency = session->window;
+	pthread_mutex_unlock(&session->lock);
+	return concurrency;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_session_connects(struct gl_session* session) {
+	pthread_mutex_lock(&session->lock);
+	size_t connects = session->connects;
+	pthread_mutex_unlock(&session->lock);
+	return connects;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_session_revalidated(struct gl_session* session) {
+	pthread_mutex_lock(&session->lock);
+	size_t revalidated = session->revalidated;
+	pthread_mutex_unlock(&session->lock);
+	return revalidated;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_session_wire_bytes(struct gl_session* session) {
+	pthread_mutex_lock(&session->lock);
+	size_t wire_bytes = session->wire_bytes;
+	pthread_mutex_unlock(&session->lock);
+	return wire_bytes;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_session_decoded_bytes(struct gl_session* session) {
+	pthread_mutex_lock(&session->lock);
+	size_t decoded_bytes = session->decoded_bytes;
+	pthread_mutex_unlock(&session->lock);
+	return decoded_bytes;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+double gl_get_session_transfer_seconds(struct gl_session* session) {
+	pthread_mutex_lock(&session->lock);
+	double transfer_seconds = session->transfer_seconds;
+	pthread_mutex_unlock(&session->lock);
+	return transfer_seconds;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_session(struct gl_session* session) {
+	size_t i = 0; for (; i < session->idle_count; ++i) {
+		curl_easy_cleanup(session->idle[i]);
+	}
+	free(session->idle);
+
+	if (session->multi) {
+		curl_multi_cleanup(session->multi);
+	}
+
+	/* Share has to be released after all handles using it
+	 */
+	if (session->share) {
+		curl_share_cleanup(session->share);
+	}
+	if (session->cache) {
+		gl_free_cache(session->cache);
+	}
+
+	for (i = 0; i < CURL_LOCK_DATA_LAST; ++i) {
+		pthread_mutex_destroy(&session->share_locks[i]);
+	}
+	pthread_mutex_destroy(&session->transfers);
+	pthread_mutex_destroy(&session->lock);
+	free(session);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t* gl_escape(uint8_t const* string) {
+	return curl_easy_escape(0, string, 0);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_http_response* gl_download(struct gl_session* session, uint8_t const* url) {
+	struct gl_http_response* response = 0;
+	CURLcode code = CURLE_OK;
+
+	/* A pooled handle of its own lets every thread download at once
+	 */
+	CURL* curl = acquire_handle(session);
+	if (!curl) {
+		return 0;
+	}
+
+	size_t attempt = 1; for (;; ++attempt) {
+
+		/* Prepare response and configure the handle
+		 */
+		response = create_response();
+		configure_download(session, curl, url, response);
+
+
+		/* Download contents
+		 */
+		code = curl_easy_perform(curl);
+		count_download(session, curl, response);
+
+		bool throttled = is_throttled(session, curl, CURLE_OK == code);
+
+		if (!throttled || GL_HTTP_MAX_ATTEMPTS == attempt) {
+			break;
+		}
+
+
+		/* Wait until the server accepts requests again
+		 */
+		uint64_t delay = retry_delay(session, response, attempt);
+
+		gl_free_response(response);
+		pause_download(delay);
+	}
+
+	if (CURLE_OK != code) {
+		gl_set_error("Downloading %s failed %s", url, curl_easy_strerror(code));
+	}
+	bool transferred = complete_download(session, curl, response, CURLE_OK == code);
+	release_handle(session, curl);
+
+	if (!transferred) {
+		gl_free_response(response);
+		return 0;
+	}
+
+
+	/* Return response :-)
+	 */
+	return response;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_download_all(	struct gl_session* session,
+			uint8_t const* const* urls, size_t count, size_t jobs,
+			size_t const* order,
+			gl_download_sink sink,
+			gl_download_callback callback, void* context
+		) {
+
+	if (!jobs) {
+		jobs = 1;
+	}
+
+	/* Concurrent calls take turns on the session's multi handle
+	 */
+	pthread_mutex_lock(&session->transfers);
+	CURLM* multi = session->multi;
+	curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)jobs);
+
+	/* Start at full concurrency, the window learned by earlier downloads
+	 * of the session is kept
+	 */
+	pthread_mutex_lock(&session->lock);
+	if (!session->window || session->window > jobs) {
+		session->window = jobs;
+	}
+	pthread_mutex_unlock(&session->lock);
+
+	CURL** handles = calloc(count + 1, sizeof(CURL*));
+	struct gl_http_response** responses = calloc(count + 1, sizeof(struct gl_http_response*));
+	size_t* attempts = calloc(count + 1, sizeof(size_t));
+	uint64_t* started = calloc(count + 1, sizeof(uint64_t));
+	uint64_t* retry_at = calloc(count + 1, sizeof(uint64_t));
+	bool* finished = calloc(count + 1, sizeof(bool));
+	size_t scheduled = 0;
+	size_t in_flight = 0;
+	size_t waiting = 0;
+	bool success = true;
+
+
+	/* Keep as many transfers in flight as the server tolerates and hand
+	 * every finished response to the callback immediately, so processing
+	 * of one language overlaps with the downloads of the others
+	 */
+	while (scheduled < count || in_flight || waiting) {
+		uint64_t now = gl_trace_now();
+		uint64_t wake = 0;
+
+
+		/* Throttled downloads are retried first once their delay passed
+		 */
+		size_t i = 0; for (; success && waiting && i < count; ++i) {
+			if (!retry_at[i]) {
+				continue;
+			}
+			if (retry_at[i] > now || in_flight >= (size_t)session->window) {
+				wake = !wake || retry_at[i] < wake ? retry_at[i] : wake;
+				continue;
+			}
+			if (!add_download(session, urls, i, handles, responses, sink, context)) {
+				success = false;
+				break;
+			}
+			retry_at[i] = 0;
+			attempts[i] += 1;
+			started[i] = now;
+			--waiting;
+			++in_flight;
+		}
+
+		while (success && scheduled < count && in_flight < (size_t)session->window) {
+			size_t n = order ? order[scheduled] : scheduled;
+
+			if (!add_download(session, urls, n, handles, responses, sink, context)) {
+				success = false;
+				break;
+			}
+			attempts[n] = 1;
+			started[n] = now;
+			++scheduled;
+			++in_flight;
+		}
+
+
+		/* Nothing to transfer until the next retry is due
+		 */
+		if (!in_flight) {
+			if (!success || !wake) {
+				break;
+			}
+			pause_download(wake - now);
+			continue;
+		}
+
+		int running = 0;
+		CURLMcode code = curl_multi_perform(multi, &running);
+
+		if (CURLM_OK != code) {
+			gl_set_error("curl_multi_perform() failed %s", curl_multi_strerror(code));
+			success = false;
+			break;
+		}
+
+
+		/* Dispatch finished transfers
+		 */
+		int pending = 0;
+		CURLMsg* message = 0;
+
+		while ((message = curl_multi_info_read(multi, &pending))) {
+			if (CURLMSG_DONE != message->msg) {
+				continue;
+			}
+
+			CURL* curl = message->easy_handle;
+			CURLcode result = message->data.result;
+			void* private = 0;
+			curl_easy_getinfo(curl, CURLINFO_PRIVATE, &private);
+
+			size_t n = (size_t)private;
+			struct gl_http_response* response = responses[n];
+			handles[n] = 0;
+			responses[n] = 0;
+
+			count_download(session, curl, response);
+			bool throttled = is_throttled(session, curl, CURLE_OK == result);
+			adapt_concurrency(session, throttled, started[n], jobs);
+
+
+			/* Retry throttled downloads after a delay, instead of
+			 * failing them
+			 */
+			if (throttled && attempts[n] < GL_HTTP_MAX_ATTEMPTS) {
+				retry_at[n] = gl_trace_now() + retry_delay(session, response, attempts[n]);
+				++waiting;
+
+				curl_multi_remove_handle(multi, curl);
+				release_handle(session, curl);
+				gl_free_response(response);
+				--in_flight;
+				continue;
+			}
+
+			if (CURLE_OK != result) {
+				gl_set_error("Downloading %s failed %s", urls[n], curl_easy_strerror(result));
+			}
+			bool transferred = complete_download(session, curl, response, CURLE_OK == result);
+			curl_multi_remove_handle(multi, curl);
+			release_handle(session, curl);
+			--in_flight;
+
+			if (!transferred) {
+				gl_free_response(response);
+				response = 0;
+			}
+			finished[n] = true;
+			callback(n, response, context);
+		}
+
+
+		/* Wake up for the next due retry at the latest
+		 */
+		if (in_flight) {
+			long timeout = 1000;
+
+			if (wake) {
+				uint64_t due = (wake > now ? wake - now : 0) / 1000;
+				timeout = due < (uint64_t)timeout ? (long)due : timeout;
+			}
+			curl_multi_wait(multi, 0, 0, timeout, 0);
+		}
+	}
+
+
+	/* Abort transfers still in flight (only after failures)
+	 */
+	size_t i = 0; for (; i < count; ++i) {
+		if (handles[i]) {
+			curl_multi_remove_handle(multi, handles[i]);
+			release_handle(session, handles[i]);
+		}
+		if (responses[i]) {
+			gl_free_response(responses[i]);
+		}
+	}
+	pthread_mutex_unlock(&session->transfers);
+
+
+	/* Every download still gets its callback, which may set errors of its
+	 * own, so the cause of the failure is kept
+	 */
+	if (!success) {
+		uint8_t* failure = strdup(gl_get_error());
+
+		for (i = 0; i < count; ++i) {
+			if (!finished[i]) {
+				gl_set_error("Downloading %s aborted: %s", urls[i], failure);
+				callback(i, 0, context);
+			}
+		}
+		free(failure);
+	}
+
+	free(handles);
+	free(responses);
+	free(attempts);
+	free(started);
+	free(retry_at);
+	free(finished);
+	return success;
+}
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_async* gl_create_async(	struct gl_session* session,
+					gl_async_socket_callback socket_callback,
+					gl_async_timer_callback timer_callback,
+					void* context
+		) {
+	CURLM* multi = curl_multi_init();
+	if (!multi) {
+		gl_set_error("curl_multi_init() failed");
+		return 0;
+	}
+
+	struct gl_async* async = calloc(1, sizeof(struct gl_async));
+	async->session = session;
+	async->multi = multi;
+	async->socket_callback = socket_callback;
+	async->timer_callback = timer_callback;
+	async->context = context;
+
+	curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, async_socket);
+	curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, async);
+	curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, async_timer);
+	curl_multi_setopt(multi, CURLMOPT_TIMERDATA, async);
+	return async;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_session* gl_get_async_session(struct gl_async* async) {
+	return async->session;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_async_request* gl_async_download(	struct gl_async* async,
+						uint8_t const* url,
+						gl_async_download_callback callback,
+						void* context
+		) {
+	CURL* curl = acquire_handle(async->session);
+	if (!curl) {
+		return 0;
+	}
+
+	struct gl_async_request* request = calloc(1, sizeof(struct gl_async_request));
+	request->async = async;
+	request->curl = curl;
+	request->response = create_response();
+	request->url = (uint8_t*)strdup(url);
+	request->callback = callback;
+	request->context = context;
+
+	configure_download(async->session, curl, request->url, request->response);
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, request);
+
+	CURLMcode code = curl_multi_add_handle(async->multi, curl);
+	if (CURLM_OK != code) {
+		gl_set_error("curl_multi_add_handle() failed %s", curl_multi_strerror(code));
+		release_handle(async->session, curl);
+		gl_free_response(request->response);
+		free(request->url);
+		free(request);
+		return 0;
+	}
+
+
+	/* Link request, so it can be cancelled
+	 */
+	request->next = async->requests;
+	if (async->requests) {
+		async->requests->previous = request;
+	}
+	async->requests = request;
+	async->running += 1;
+
+	return request;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_async_perform(struct gl_async* async, int fd, int events) {
+	int mask = 0;
+	mask |= (GL_ASYNC_IN & events) ? CURL_CSELECT_IN : 0;
+	mask |= (GL_ASYNC_OUT & events) ? CURL_CSELECT_OUT : 0;
+	mask |= (GL_ASYNC_ERROR & events) ? CURL_CSELECT_ERR : 0;
+
+	int running = 0;
+	CURLMcode code = curl_multi_socket_action(async->multi,
+		GL_ASYNC_TIMEOUT == fd ? CURL_SOCKET_TIMEOUT : fd,
+		mask, &running
+	);
+
+	if (CURLM_OK != code) {
+		gl_set_error("curl_multi_socket_action() failed %s", curl_multi_strerror(code));
+		return false;
+	}
+
+
+	/* Dispatch finished transfers
+	 */
+	int pending = 0;
+	CURLMsg* message = 0;
+
+	while ((message = curl_multi_info_read(async->multi, &pending))) {
+		if (CURLMSG_DONE != message->msg) {
+			continue;
+		}
+
+		CURLcode result = message->data.result;
+		struct gl_async_request* request = 0;
+		curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &request);
+
+		if (CURLE_OK != result) {
+			gl_set_error("Downloading %s failed %s", request->url, curl_easy_strerror(result));
+		}
+		count_download(async->session, request->curl, request->response);
+		finish_async_request(request, CURLE_OK == result);
+	}
+	return true;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+long gl_get_async_timeout(struct gl_async* async) {
+	long timeout = -1;
+	curl_multi_timeout(async->multi, &timeout);
+	return timeout;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_async_running(struct gl_async* async) {
+	return async->running;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_cancel_async_request(struct gl_async_request* request) {
+	gl_set_error("Downloading %s was cancelled", request->url);
+	finish_async_request(request, false);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_async(struct gl_async* async) {
+	while (async->requests) {
+		gl_cancel_async_request(async->requests);
+	}
+
+	curl_multi_cleanup(async->multi);
+	free(async);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t* gl_get_response_data(struct gl_http_response* response) {
+	return response->data;
+}
+
+
+
+/**
+ * @return Response data length
+ */
+size_t gl_get_response_length(struct gl_http_response* response) {
+	return response->response_length;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t* gl_release_response_data(struct gl_http_response* response) {
+	uint8_t* data = response->data;
+
+	response->data = 0;
+	response->response_length = 0;
+	response->buffer_length = 0;
+	return data;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_response_chunks(struct gl_http_response* response) {
+	return response->chunks;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_response_reallocations(struct gl_http_response* response) {
+	return response->reallocations;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_response_copied_bytes(struct gl_http_response* response) {
+	return response->copied_bytes;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_response_wire_bytes(struct gl_http_response* response) {
+	return response->wire_bytes;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+double gl_get_response_transfer_seconds(struct gl_http_response* response) {
+	return response->transfer_seconds;
+}
+
+
+
+/**
+ * Frees all resources allocated by struct
+ */
+void gl_free_response(struct gl_http_response* response) {
+	if (response->cache_writer) {
+		gl_abort_cache_writer(response->cache_writer);
+	}
+	curl_slist_free_all(response->validators);
+
+	free(response->etag);
+	free(response->last_modified);
 	free(response->data);
 	free(response);
 }
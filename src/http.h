@@ -30,21 +30,106 @@
 /**
  * Includes
  */
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 /**
  * Opaque structures
  */
+struct gl_async;
+struct gl_async_request;
 struct gl_http_response;
+struct gl_session;
 
 
 
+/**
+ * Invoked by gl_download_all for every chunk of the n-th download as it
+ * arrives. The chunk is only valid during the callback
+ *
+ * @return false iff the download should be aborted
+ */
+typedef bool (*gl_download_sink)(
+	size_t n, uint8_t const* data, size_t length, void* context
+);
 
+/**
+ * Invoked by gl_download_all exactly once per download, as soon as the n-th
+ * download finished or after the transfers were aborted. `response' is 0 iff
+ * the download failed, otherwise the callback takes ownership of it
+ */
+typedef void (*gl_download_callback)(
+	size_t n, struct gl_http_response* response, void* context
+);
 
 /**
- * Downloads the contents of an url into a dynamic buffer
+ * Invoked by gl_async_perform as soon as an asynchronous download finished.
+ * `response' is 0 iff the download failed or was cancelled, otherwise the
+ * callback takes ownership of it
+ */
+typedef void (*gl_async_download_callback)(
+	struct gl_http_response* response, void* context
+);
+
+
+
+
+
+/**
+ * URL-encodes `string'
+ *
+ * @return Escaped string, has to be freed using curl_free
  */
-struct gl_http_response* gl_download(uint8_t const* url);
+uint8_t* gl_escape(uint8_t const* string);
+
+/**
+ * Downloads the contents of an url into a dynamic buffer, reusing the
+ * session's connections. Throttled requests are retried after the delay
+ * requested by the server, or with exponential backoff
+ *
+ * @return Response or 0 iff the download failed or the status was not 2xx
+ */
+struct gl_http_response* gl_download(struct gl_session* session, uint8_t const* url);
+
+/**
+ * Downloads the contents of all `urls' concurrently, keeping at most `jobs'
+ * transfers in flight at any time. Whenever the server throttles a transfer
+ * the number of transfers in flight is halved and the download retried
+ * later, it grows back by one transfer per window of successful downloads
+ *
+ * @param order Indices of `urls' in the order their transfers are started,
+ *     0 for the order of `urls' itself
+ * @param sink If set, data is streamed into the sink instead of being
+ *     buffered and responses passed to `callback' will be empty
+ *
+ * @return false iff the transfers could not be set up or were aborted, every
+ *     unfinished download is passed to `callback' as failed then
+ */
+bool gl_download_all(	struct gl_session* session,
+			uint8_t const* const* urls, size_t count, size_t jobs,
+			size_t const* order,
+			gl_download_sink sink,
+			gl_download_callback callback, void* context
+);
+
+/**
+ * Starts downloading `url' without blocking. The transfer progresses while
+ * the caller's event loop drives `async' through gl_async_perform
+ *
+ * @return Request or 0 iff the transfer could not be set up, `callback' is
+ *     not invoked then
+ */
+struct gl_async_request* gl_async_download(	struct gl_async* async,
+						uint8_t const* url,
+						gl_async_download_callback callback,
+						void* context
+);
+
+/**
+ * @return Session whose connections are used by `async'
+ */
+struct gl_session* gl_get_async_session(struct gl_async* async);
 
 /**
  * @return Response data
@@ -56,6 +141,42 @@ uint8_t* gl_get_response_data(struct gl_http_response* response);
  */
 size_t gl_get_response_length(struct gl_http_response* response);
 
+/**
+ * Transfers ownership of the response data to the caller, who has to free it.
+ * The response is left empty
+ *
+ * @return Response data
+ */
+uint8_t* gl_release_response_data(struct gl_http_response* response);
+
+/**
+ * @return Number of chunks delivered by cURL
+ */
+size_t gl_get_response_chunks(struct gl_http_response* response);
+
+/**
+ * @return Number of times the buffer had to be moved to grow. Responses
+ *     with a Content-Length are reserved at once unless they are compressed,
+ *     since the Content-Length of those counts the compressed bytes
+ */
+size_t gl_get_response_reallocations(struct gl_http_response* response);
+
+/**
+ * @return Number of bytes which had to be copied while growing the buffer
+ */
+size_t gl_get_response_copied_bytes(struct gl_http_response* response);
+
+/**
+ * @return Number of body bytes received from the network, which is less than
+ *     the response length iff the body was transferred compressed
+ */
+size_t gl_get_response_wire_bytes(struct gl_http_response* response);
+
+/**
+ * @return Seconds from sending the request until the last body byte arrived
+ */
+double gl_get_response_transfer_seconds(struct gl_http_response* response);
+
 /**
  * Frees all resources allocated by struct
  */
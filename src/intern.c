@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "gltoolkit.h"
+#include "intern.h"
+
+
+
+
+
+/**
+ * Number of slots of a new pool, has to be a power of two
+ */
+#define GL_INTERN_INITIAL_SLOTS 1024
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Slot of the pool's hash table, `string' is 0 iff the slot is empty
+ */
+struct gl_string_slot {
+	uint8_t const* string;
+	size_t length;
+	uint32_t hash;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * Open addressing hash table with linear probing over all strings, which are
+ * stored back to back inside `arena'. The table is kept at most half full.
+ * `lock' serializes catalogs built on different threads
+ */
+struct gl_string_pool {
+	pthread_mutex_t lock;
+	struct gl_arena* arena;
+
+	struct gl_string_slot* slots;
+	size_t mask;
+	size_t count;
+
+	/* Statistics
+	 */
+	size_t bytes;
+	size_t saved_bytes;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return FNV-1a hash of `length' bytes of `data'
+ */
+static uint32_t hash_data(uint8_t const* data, size_t length) {
+	uint32_t hash = 2166136261u;
+
+	size_t i = 0; for (; i < length; ++i) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	return hash;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Empty slot or slot holding `length' bytes of `data'
+ */
+static struct gl_string_slot* find_slot(	struct gl_string_slot* slots,
+						size_t mask,
+						uint8_t const* data,
+						size_t length,
+						uint32_t hash
+		) {
+	size_t i = hash & mask;
+
+	for (;; i = (i + 1) & mask) {
+		struct gl_string_slot* slot = &slots[i];
+
+		if (!slot->string || (hash == slot->hash
+				&& length == slot->length
+				&& !memcmp(data, slot->string, length))) {
+			return slot;
+		}
+	}
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Doubles the number of slots, strings keep their addresses
+ */
+static void grow_pool(struct gl_string_pool* pool) {
+	size_t mask = 2 * pool->mask + 1;
+	struct gl_string_slot* slots = calloc(mask + 1, sizeof(struct gl_string_slot));
+
+	size_t i = 0; for (; i <= pool->mask; ++i) {
+		struct gl_string_slot* slot = &pool->slots[i];
+
+		if (slot->string) {
+			*find_slot(slots, mask, slot->string, slot->length, slot->hash) = *slot;
+		}
+	}
+
+	free(pool->slots);
+	pool->slots = slots;
+	pool->mask = mask;
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_string_pool* gl_create_string_pool() {
+	struct gl_string_pool* pool = calloc(1, sizeof(struct gl_string_pool));
+
+	pthread_mutex_init(&pool->lock, 0);
+	pool->arena = gl_create_arena(0);
+	pool->slots = calloc(GL_INTERN_INITIAL_SLOTS, sizeof(struct gl_string_slot));
+	pool->mask = GL_INTERN_INITIAL_SLOTS - 1;
+	return pool;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_intern_string(	struct gl_string_pool* pool,
+					uint8_t const* data,
+					size_t length
+		) {
+	uint32_t hash = hash_data(data, length);
+
+	pthread_mutex_lock(&pool->lock);
+	struct gl_string_slot* slot = find_slot(pool->slots, pool->mask, data, length, hash);
+
+	if (slot->string) {
+		pool->saved_bytes += length + 1;
+
+		uint8_t const* string = slot->string;
+		pthread_mutex_unlock(&pool->lock);
+		return string;
+	}
+
+
+	/* New string, the table is grown before it gets more than half full
+	 */
+	slot->string = gl_arena_copy(pool->arena, data, length);
+	slot->length = length;
+	slot->hash = hash;
+	pool->count += 1;
+	pool->bytes += length + 1;
+
+	uint8_t const* string = slot->string;
+	if (2 * pool->count > pool->mask) {
+		grow_pool(pool);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return string;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_string_pool_count(struct gl_string_pool* pool) {
+	return pool->count;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_string_pool_bytes(struct gl_string_pool* pool) {
+	return pool->bytes;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_string_pool_saved_bytes(struct gl_string_pool* pool) {
+	return pool->saved_bytes;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_string_pool(struct gl_string_pool* pool) {
+	pthread_mutex_destroy(&pool->lock);
+	gl_free_arena(pool->arena);
+	free(pool->slots);
+	free(pool);
+}
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_INTERN
+#define GLTOOLKIT_INTERN
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+
+
+
+
+/**
+ * Stores `length' bytes of `data' plus 0-terminator in the pool, unless an
+ * equal string is already stored
+ *
+ * @return String inside the pool, valid until the pool is freed
+ */
+uint8_t const* gl_intern_string(	struct gl_string_pool* pool,
+					uint8_t const* data,
+					size_t length
+);
+
+/**
+ * @return String pool attached to the session or 0
+ */
+struct gl_string_pool* gl_get_session_string_pool(struct gl_session* session);
+
+
+
+
+
+#endif
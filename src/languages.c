@@ -26,8 +26,13 @@
 #include <curl/curl.h>
 #include <xml.h>
 
+#include "arena.h"
+#include "error.h"
 #include "gltoolkit.h"
 #include "http.h"
+#include "languages.h"
+#include "tokenizer.h"
+#include "trace.h"
 
 
 
@@ -56,6 +61,24 @@
 struct gl_language {
 	uint8_t* name;
 	uint8_t* iana;
+
+	/* If set, the string fields hold the distance of every string from the
+	 * language itself instead of its address (see snapshots)
+	 */
+	bool relative;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * Expected cost of fetching one language and what its last fetch measured
+ */
+struct gl_language_schedule {
+	double cost;
+	size_t bytes;
+	double seconds;
 };
 
 
@@ -63,11 +86,30 @@ struct gl_language {
 /**
  * [OPAQUE API]
  *
- * 0-terminated array with all languages provided by project
+ * Array with all languages provided by project. The structure, all languages
+ * and their strings live inside `arena'
  */
 struct gl_languages {
-	struct gl_language** languages;
+	struct gl_language* languages;
 	size_t languages_count;
+
+	/* One entry per language, allocated on first use (optional)
+	 */
+	struct gl_language_schedule* schedule;
+
+	struct gl_arena* arena;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Position of a language in the fetch order
+ */
+struct gl_language_rank {
+	double cost;
+	size_t n;
 };
 
 
@@ -75,92 +117,170 @@ struct gl_languages {
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * @return Schedule entries of all languages, allocated on first use
  */
-struct gl_languages* gl_get_languages(uint8_t const* project) {
-	struct gl_http_response* response = 0;
-	struct xml_document* document = 0;
-	struct gl_languages* languages = 0;
+static struct gl_language_schedule* get_schedule(struct gl_languages* languages) {
+	if (!languages->schedule) {
+		size_t length = (languages->languages_count + 1) * sizeof(struct gl_language_schedule);
 
+		languages->schedule = gl_arena_allocate(languages->arena, length);
+		memset(languages->schedule, 0, length);
+	}
+	return languages->schedule;
+}
 
-	/* Initialize cURL
-	 */
-	CURL* curl = curl_easy_init();
-	if (!curl) {
-		fprintf(stderr, "Initializing cURL failed\n");
-		goto exit_failure;
+
+
+/**
+ * [PRIVATE]
+ *
+ * Orders ranks by descending cost, equal costs keep list order
+ */
+static int compare_ranks(void const* a, void const* b) {
+	struct gl_language_rank const* x = a;
+	struct gl_language_rank const* y = b;
+
+	if (x->cost != y->cost) {
+		return x->cost > y->cost ? -1 : 1;
 	}
+	return x->n < y->n ? -1 : x->n > y->n;
+}
 
 
-	/* Create URL
-	 */
-	uint8_t* project_escaped = curl_easy_escape(curl, project, 0);
+
+/**
+ * [PRIVATE]
+ *
+ * @return Address of `string', a field of `language'
+ */
+static uint8_t const* resolve_string(	struct gl_language const* language,
+					uint8_t const* string
+		) {
+	return language->relative
+		? (uint8_t const*)language + (intptr_t)string
+		: string
+	;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Dynamically allocated REST API URL of `project''s languages
+ */
+static uint8_t* languages_url(uint8_t const* project) {
+	uint8_t* project_escaped = gl_escape(project);
 
 	size_t url_length = strlen(GET_LOCALIZATION_LANGUAGES_PATTERN) + strlen(project_escaped) + 1;
-	uint8_t* url = alloca(url_length * sizeof(uint8_t));
+	uint8_t* url = malloc(url_length * sizeof(uint8_t));
 	snprintf(url, url_length - 1, GET_LOCALIZATION_LANGUAGES_PATTERN, project_escaped);
 	url[url_length - 1] = 0;
 
 	curl_free(project_escaped);
-	curl_easy_cleanup(curl);
+	return url;
+}
 
 
-	/* Download content
-	 */
-	response = gl_download(url);
-	if (!response) {
-		fprintf(stderr, "Failed downloading %s\n", url);
-		goto exit_failure;
-	}
+
+/**
+ * [PRIVATE]
+ *
+ * Builds the language list from a languages response. `response' is freed
+ * in any case
+ *
+ * @param trace Receives the parse phase, may be 0
+ * @param url Used for error reporting and tracing only
+ */
+static struct gl_languages* parse_languages(
+			struct gl_http_response* response,
+			struct gl_trace* trace,
+			uint8_t const* url
+		) {
+	struct xml_document* document = 0;
+	struct gl_token* tokens = 0;
+	struct gl_languages* languages = 0;
 
 
-	/* Parse contents
+	/* Locate all fields with the tokenizer, documents of any other shape
+	 * are parsed by xml.c
 	 */
-	document = xml_parse_document(
-		gl_get_response_data(response),
-		gl_get_response_length(response)
+	uint64_t parse_start = gl_trace_now();
+	uint8_t* data = gl_get_response_data(response);
+	size_t length = gl_get_response_length(response);
+
+	size_t count = 0;
+	struct xml_node* xml_languages = 0;
+	tokens = gl_tokenize(
+		GL_TOKENIZER_LANGUAGES, gl_get_tokenizer_kernel(),
+		data, length, &count
 	);
 
-	if (!document) {
-		size_t length = gl_get_response_length(response);
-		uint8_t* buffer = alloca(length + 1);
-		memcpy(buffer, gl_get_response_data(response), length);
-		buffer[length] = 0;
+	if (!tokens) {
+		document = xml_parse_document(data, length);
 
-		fprintf(stderr, "Failed parsing response from %s: %s\n", url, buffer);
-		goto exit_failure;
+		if (!document) {
+			gl_set_error("Failed parsing response from %s: %.*s", url,
+				(int)(length < GL_ERROR_EXCERPT_LENGTH ? length : GL_ERROR_EXCERPT_LENGTH), data
+			);
+			goto exit_failure;
+		}
+
+		xml_languages = xml_document_root(document);
+		count = xml_node_children(xml_languages);
 	}
 
 
-	/* Build language list
+	/* Build language list inside an arena large enough for the whole list
 	 */
-	struct xml_node* xml_languages = xml_document_root(document);
-	
-	languages = malloc(sizeof(struct gl_languages));
-	languages->languages_count = xml_node_children(xml_languages);
-	languages->languages = calloc(languages->languages_count + 1, sizeof(struct gl_language*));
+	struct gl_arena* arena = gl_create_arena(64
+		+ sizeof(struct gl_languages)
+		+ count * sizeof(struct gl_language)
+		+ length
+	);
+
+	languages = gl_arena_allocate(arena, sizeof(struct gl_languages));
+	languages->languages_count = count;
+	languages->languages = gl_arena_allocate(arena, (count + 1) * sizeof(struct gl_language));
+	languages->schedule = 0;
+	languages->arena = arena;
 
-	size_t i = 0; for (; i < languages->languages_count; ++i) {
-		struct gl_language* language = malloc(sizeof(struct gl_language));
+	size_t i = 0; for (; tokens && i < count; ++i) {
+		struct gl_language* language = &languages->languages[i];
+		struct gl_token const* fields = &tokens[i * GL_TOKENIZER_FIELDS];
+
+		language->name = gl_arena_copy(arena, fields[0].data, fields[0].length);
+		language->iana = gl_arena_copy(arena, fields[1].data, fields[1].length);
+		language->relative = false;
+	}
+
+	for (; document && i < count; ++i) {
+		struct gl_language* language = &languages->languages[i];
 
 		struct xml_node* xml_language = xml_node_child(xml_languages, i);
 		struct xml_string* xml_language_name = xml_node_content(xml_node_child(xml_language, 0));
 		struct xml_string* xml_language_iana = xml_node_content(xml_node_child(xml_language, 1));
 
-		language->name = calloc(xml_string_length(xml_language_name) + 1, sizeof(uint8_t));
-		language->iana = calloc(xml_string_length(xml_language_iana) + 1, sizeof(uint8_t));
+		language->name = gl_arena_allocate_string(arena, xml_string_length(xml_language_name));
+		language->iana = gl_arena_allocate_string(arena, xml_string_length(xml_language_iana));
 
 		xml_string_copy(xml_language_name, language->name, xml_string_length(xml_language_name));
 		xml_string_copy(xml_language_iana, language->iana, xml_string_length(xml_language_iana));
-
-		languages->languages[i] = language;
+		language->relative = false;
 	}
 
 
 	/* Free temporary data and return compiled list
 	 */
-	xml_document_free(document, false);
+	free(tokens);
+	if (document) {
+		xml_document_free(document, false);
+	}
 	gl_free_response(response);
+
+	gl_add_trace_span(trace, "parse", url, 0, parse_start, gl_trace_now());
 	return languages;
 
 
@@ -170,9 +290,8 @@ exit_failure:
 	if (document) {
 		xml_document_free(document, false);
 	}
-	if (response) {
-		gl_free_response(response);
-	}
+	gl_free_response(response);
+
 	if (languages) {
 		gl_free_languages(languages);
 	}
@@ -181,6 +300,146 @@ exit_failure:
 
 
 
+/**
+ * [PRIVATE]
+ *
+ * Request of gl_async_get_languages
+ */
+struct async_languages {
+	gl_async_languages_callback callback;
+	void* context;
+
+	struct gl_trace* trace;
+	uint8_t* url;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Builds the language list as soon as its download finished
+ */
+static void async_languages_downloaded(struct gl_http_response* response, void* context) {
+	struct async_languages* request = context;
+	struct gl_languages* languages = 0;
+
+	if (response) {
+		languages = parse_languages(response, request->trace, request->url);
+	}
+
+	request->callback(languages, request->context);
+	free(request->url);
+	free(request);
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_language_record_size() {
+	return sizeof(struct gl_language);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_set_relative_language(	struct gl_language* record,
+				int64_t name_offset,
+				int64_t code_offset
+		) {
+	memset(record, 0, sizeof(struct gl_language));
+
+	record->name = (uint8_t*)(intptr_t)name_offset;
+	record->iana = (uint8_t*)(intptr_t)code_offset;
+	record->relative = true;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_get_relative_language(	struct gl_language const* record,
+				int64_t* name_offset,
+				int64_t* code_offset
+		) {
+	*name_offset = (intptr_t)record->name;
+	*code_offset = (intptr_t)record->iana;
+	return record->relative;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_languages* gl_create_languages_view(struct gl_language* records, size_t count) {
+	struct gl_arena* arena = gl_create_arena(64 + sizeof(struct gl_languages));
+	struct gl_languages* languages = gl_arena_allocate(arena, sizeof(struct gl_languages));
+
+	languages->languages = records;
+	languages->languages_count = count;
+	languages->schedule = 0;
+	languages->arena = arena;
+	return languages;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_languages* gl_get_languages(struct gl_session* session, uint8_t const* project) {
+	uint8_t* url = languages_url(project);
+	struct gl_languages* languages = 0;
+	struct gl_http_response* response = gl_download(session, url);
+
+	if (response) {
+		languages = parse_languages(response, gl_get_session_trace(session), url);
+	}
+
+	free(url);
+	return languages;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_async_request* gl_async_get_languages(
+			struct gl_async* async,
+			uint8_t const* project,
+			gl_async_languages_callback callback,
+			void* context
+		) {
+	struct gl_session* session = gl_get_async_session(async);
+
+	struct async_languages* request = malloc(sizeof(struct async_languages));
+	request->callback = callback;
+	request->context = context;
+	request->trace = gl_get_session_trace(session);
+	request->url = languages_url(project);
+
+	struct gl_async_request* download = gl_async_download(
+		async, request->url, async_languages_downloaded, request
+	);
+
+	if (!download) {
+		free(request->url);
+		free(request);
+	}
+	return download;
+}
+
+
+
 /**
  * [PUBLIC API]
  */
@@ -198,7 +457,7 @@ struct gl_language* gl_get_language(struct gl_languages* languages, size_t n) {
 		return 0;
 	}
 
-	return languages->languages[n];
+	return &languages->languages[n];
 }
 
 
@@ -207,7 +466,7 @@ struct gl_language* gl_get_language(struct gl_languages* languages, size_t n) {
  * [PUBLIC API]
  */
 uint8_t const* gl_get_language_name(struct gl_language* language) {
-	return language->name;
+	return resolve_string(language, language->name);
 }
 
 
@@ -216,7 +475,7 @@ uint8_t const* gl_get_language_name(struct gl_language* language) {
  * [PUBLIC API]
  */
 uint8_t const* gl_get_language_code(struct gl_language* language) {
-	return language->iana;
+	return resolve_string(language, language->iana);
 }
 
 
@@ -224,15 +483,83 @@ uint8_t const* gl_get_language_code(struct gl_language* language) {
 /**
  * [PUBLIC API]
  */
-void gl_free_languages(struct gl_languages* languages) {
-	size_t i = 0; for (; i < languages->languages_count; ++i) {
-		struct gl_language* language = languages->languages[i];
-		free(language->name);
-		free(language->iana);
-		free(language);
+void gl_set_language_cost(struct gl_languages* languages, size_t n, double cost) {
+	if (n < languages->languages_count) {
+		get_schedule(languages)[n].cost = cost;
+	}
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_language_bytes(struct gl_languages* languages, size_t n) {
+	return languages->schedule && n < languages->languages_count
+		? languages->schedule[n].bytes
+		: 0
+	;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+double gl_get_language_seconds(struct gl_languages* languages, size_t n) {
+	return languages->schedule && n < languages->languages_count
+		? languages->schedule[n].seconds
+		: 0
+	;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t* gl_schedule_languages(struct gl_languages* languages) {
+	struct gl_language_schedule* schedule = get_schedule(languages);
+	size_t count = languages->languages_count;
+	struct gl_language_rank* ranks = malloc((count + 1) * sizeof(struct gl_language_rank));
+
+	size_t i = 0; for (; i < count; ++i) {
+		ranks[i].cost = schedule[i].cost;
+		ranks[i].n = i;
+
+		schedule[i].bytes = 0;
+		schedule[i].seconds = 0;
+	}
+	qsort(ranks, count, sizeof(struct gl_language_rank), compare_ranks);
+
+	size_t* order = malloc((count + 1) * sizeof(size_t));
+	for (i = 0; i < count; ++i) {
+		order[i] = ranks[i].n;
 	}
+	free(ranks);
+	return order;
+}
+
+
 
-	free(languages->languages);
-	free(languages);
+/**
+ * [PUBLIC API]
+ */
+void gl_set_language_measurement(	struct gl_languages* languages,
+					size_t n,
+					size_t bytes,
+					double seconds
+		) {
+	languages->schedule[n].bytes = bytes;
+	languages->schedule[n].seconds = seconds;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_languages(struct gl_languages* languages) {
+	gl_free_arena(languages->arena);
 }
 
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_LANGUAGES
+#define GLTOOLKIT_LANGUAGES
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+
+
+
+
+/**
+ * @return Size of a language record in bytes
+ */
+size_t gl_get_language_record_size();
+
+/**
+ * Stores a language in relative form inside `record'. Its strings are not
+ * referenced by address but by their distance from the record, so records
+ * and strings can be mapped from a file at any address
+ *
+ * @param record Room for gl_get_language_record_size() bytes
+ * @param name_offset Distance of the language's name from `record'
+ * @param code_offset Distance of the language's iana code from `record'
+ */
+void gl_set_relative_language(	struct gl_language* record,
+				int64_t name_offset,
+				int64_t code_offset
+);
+
+/**
+ * Reads a record written by gl_set_relative_language, e.g. to check it
+ * before use
+ *
+ * @return false iff `record' is not in relative form
+ */
+bool gl_get_relative_language(	struct gl_language const* record,
+				int64_t* name_offset,
+				int64_t* code_offset
+);
+
+/**
+ * Wraps `count' consecutive language records as language list without
+ * copying them. The records have to outlive the list
+ */
+struct gl_languages* gl_create_languages_view(struct gl_language* records, size_t count);
+
+/**
+ * Orders `languages' for fetching: the most expensive ones first (longest
+ * processing time first), so the last language to finish does not start
+ * late. Languages without cost follow in list order. Prepares recording
+ * the measurements of the fetch, too
+ *
+ * @return Indices of all languages in fetch order, have to be freed
+ */
+size_t* gl_schedule_languages(struct gl_languages* languages);
+
+/**
+ * Records that fetching the n-th language received `bytes' and took
+ * `seconds'. Different languages may be recorded concurrently
+ *
+ * @warning gl_schedule_languages has to be called before
+ */
+void gl_set_language_measurement(	struct gl_languages* languages,
+					size_t n,
+					size_t bytes,
+					double seconds
+);
+
+
+
+
+
+#endif
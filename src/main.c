@@ -20,14 +20,59 @@
  *
  *  3. This notice may not be removed or altered from any source distribution.
  */
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <entities.h>
 #include <xml.h>
+#include "codegen.h"
 #include "gltoolkit.h"
+#include "mo.h"
+#include "output.h"
+#include "phf.h"
+#include "po.h"
+#include "trace.h"
+
+
+
+
+
+/**
+ * Number of parallel downloads if not specified on the command line
+ */
+#ifndef GLTOOLKIT_DEFAULT_JOBS
+#define GLTOOLKIT_DEFAULT_JOBS 4
+#endif
+
+
+
+
+
+/**
+ * Beginning of the header field which changes on every run
+ */
+#define GLTOOLKIT_REVISION_DATE "PO-Revision-Date: "
+
+/**
+ * File next to LINGUAS keeping size and duration of every language of the
+ * last sync
+ */
+#define GLTOOLKIT_SCHEDULE_FILE ".gltoolkit-schedule"
+
+
+
+
+
+/**
+ * Set by SIGINT and SIGTERM, ends --watch after the current sync
+ */
+static volatile sig_atomic_t stopping = 0;
 
 
 
@@ -55,6 +100,27 @@ static FILE* open_in_directory(
 
 
 
+/**
+ * Replaces an output file iff its contents changed, so unchanged files keep
+ * their modification time and do not trigger rebuilds
+ *
+ * @return false iff the file could not be written
+ */
+static bool close_output(struct gl_output* output) {
+	uint8_t* path = strdup(gl_get_output_path(output));
+	enum gl_output_result result = gl_close_output(output);
+
+	if (GL_OUTPUT_UNCHANGED == result) {
+		fprintf(stdout, "%s is up to date\n", path);
+	} else if (GL_OUTPUT_FAILED == result) {
+		fprintf(stderr, "%s\n", gl_get_error());
+	}
+	free(path);
+	return GL_OUTPUT_FAILED != result;
+}
+
+
+
 /**
  * Prints all IANA language codes into a file, needed by `gettext'
  *
@@ -65,18 +131,75 @@ static void print_linguas(
 			uint8_t const* directory, uint8_t const* file
 		) {
 
-	FILE* linguas = open_in_directory(directory, file, "wb");
+	struct gl_output* output = gl_open_output(directory, file);
 
-	if (!linguas) {
-		fprintf(stderr, "Cannot open %s in %s\n", file, directory);
+	if (!output) {
+		fprintf(stderr, "%s\n", gl_get_error());
 		exit(EXIT_FAILURE);
 	}
+	FILE* linguas = gl_get_output_stream(output);
 
 	size_t i = 0; for (; i < gl_get_languages_count(languages); ++i) {
 		struct gl_language* language = gl_get_language(languages, i);
 		fprintf(linguas, "%s ", gl_get_language_code(language));
 	}
-	fclose(linguas);
+
+	if (!close_output(output)) {
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+/**
+ * Expects every language to take as long as it did during the last sync,
+ * so the slowest languages are fetched first. Each line of the schedule
+ * file reads `<iana-code> <bytes> <seconds>'
+ */
+static void read_schedule(struct gl_languages* languages, uint8_t const* directory) {
+	FILE* schedule = open_in_directory(directory, GLTOOLKIT_SCHEDULE_FILE, "rb");
+	if (!schedule) {
+		return;
+	}
+
+	uint8_t code[64];
+	unsigned long bytes = 0;
+	double seconds = 0;
+
+	while (3 == fscanf(schedule, "%63s %lu %lf", code, &bytes, &seconds)) {
+		size_t i = 0; for (; i < gl_get_languages_count(languages); ++i) {
+			if (!strcmp(code, gl_get_language_code(gl_get_language(languages, i)))) {
+				gl_set_language_cost(languages, i, seconds);
+			}
+		}
+	}
+	fclose(schedule);
+}
+
+
+
+/**
+ * Stores size and duration of every language fetched by this sync for the
+ * next one
+ */
+static void write_schedule(struct gl_languages* languages, uint8_t const* directory) {
+	struct gl_output* output = gl_open_output(directory, GLTOOLKIT_SCHEDULE_FILE);
+	if (!output) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		return;
+	}
+	FILE* schedule = gl_get_output_stream(output);
+
+	size_t i = 0; for (; i < gl_get_languages_count(languages); ++i) {
+		if (gl_get_language_bytes(languages, i)) {
+			fprintf(schedule, "%s %lu %.6f\n",
+				gl_get_language_code(gl_get_language(languages, i)),
+				(unsigned long)gl_get_language_bytes(languages, i),
+				gl_get_language_seconds(languages, i)
+			);
+		}
+	}
+	close_output(output);
 }
 
 
@@ -144,11 +267,108 @@ static uint8_t* configuration_value(
 
 
 /**
- * Prints all translations of a language into a po-file
+ * Prints one field of the header entry
+ *
+ * @param quoted Print as po string literal instead of plain header line
+ */
+static void print_header_field(	FILE* stream, bool quoted,
+				char const* format, ...
+		) {
+	va_list arguments;
+
+	if (quoted) {
+		fprintf(stream, "\"");
+	}
+	va_start(arguments, format);
+	vfprintf(stream, format, arguments);
+	va_end(arguments);
+
+	fprintf(stream, quoted ? "\\n\"\n" : "\n");
+}
+
+
+
+/**
+ * Prints the fields of the header entry, i.e. the translation of the empty
+ * msgid
+ *
+ * @param quoted Print as po string literals instead of plain header lines
  */
-static void print_po(	uint8_t const* project,
+static void print_header_fields(	FILE* stream, bool quoted,
+					uint8_t const* project,
+					struct gl_language* language,
+					struct xml_node* configuration
+		) {
+
+	/* Extrat configuration values (will be empty strings, if missing)
+	 */
+	uint8_t* report_msgid_bugs_to = configuration_value(configuration, "Report-Msgid-Bugs-To");
+	uint8_t* language_team = configuration_value(configuration, "Language-Team");
+	uint8_t* plural_forms = configuration_value(configuration, "Plural-Forms");
+
+
+	/* Write header fields
+	 *
+	 * @warning Currently there is no way to get information about
+	 *     `Last-Translator' and `POT-Creation-Date' from
+	 *     GetLocalization.com
+	 *
+	 *     Moreover the version in `Project-Id-Version' does not depend on
+	 *     GetLocalization.com so it can not be extracted from there
+	 */
+	print_header_field(stream, quoted, "Project-Id-Version: %s", project);
+	if (report_msgid_bugs_to) {
+		print_header_field(stream, quoted, "Report-Msgid-Bugs-To: %s", report_msgid_bugs_to);
+	}
+//	print_header_field(stream, quoted, "POT-Creation-Date: 2011-03-29 22:06+0200");
+
+	/* Languages are written by several threads at once
+	 */
+	time_t now = time(0);
+	struct tm lt;
+	localtime_r(&now, &lt);
+
+	print_header_field(stream, quoted, GLTOOLKIT_REVISION_DATE "%04d-%02d-%02d %02d:%02d %s",
+		1900 + lt.tm_year,
+		1 + lt.tm_mon,
+		lt.tm_mday,
+		lt.tm_hour,
+		lt.tm_min,
+		lt.tm_zone
+	);
+
+//	print_header_field(stream, quoted, "Last-Translator: Nikita M. Makarov <5253450@gmail.com>");
+	if (language_team) {
+		print_header_field(stream, quoted, "Language-Team: %s", language_team);
+	}
+	print_header_field(stream, quoted, "MIME-Version: 1.0");
+	print_header_field(stream, quoted, "Content-Type: text/plain; charset=UTF-8");
+	print_header_field(stream, quoted, "Content-Transfer-Encoding: 8bit");
+	print_header_field(stream, quoted, "Language: %s", gl_get_language_code(language));
+	print_header_field(stream, quoted, "X-Generator: %s", GLTOOLKIT_NAME);
+	if (plural_forms) {
+		print_header_field(stream, quoted, "Plural-Forms: %s", plural_forms);
+	}
+
+
+	/* Free allocated resources
+	 */
+	if (report_msgid_bugs_to)	free(report_msgid_bugs_to);
+	if (language_team)		free(language_team);
+	if (plural_forms)		free(plural_forms);
+}
+
+
+
+/**
+ * Opens the po file of a language and writes its header. The file is only
+ * generated in memory, since its revision date is the only line which
+ * changes on every run
+ *
+ * @return Opened po file or 0 on failure
+ */
+static struct gl_output* open_po(	uint8_t const* project,
 			struct gl_language* language,
-			struct gl_translations* translations,
 			struct xml_node* configuration,
 			uint8_t const* directory
 		) {
@@ -157,9 +377,6 @@ static void print_po(	uint8_t const* project,
 	 */
 	uint8_t* license = configuration_value(configuration, "License");
 	uint8_t* original_author = configuration_value(configuration, "Original-Translator");
-	uint8_t* report_msgid_bugs_to = configuration_value(configuration, "Report-Msgid-Bugs-To");
-	uint8_t* language_team = configuration_value(configuration, "Language-Team");
-	uint8_t* plural_forms = configuration_value(configuration, "Plural-Forms");
 
 
 	/* Open po file
@@ -171,21 +388,19 @@ static void print_po(	uint8_t const* project,
 	snprintf(po_name, po_name_length, "%s.po", language_iana);
 	po_name[po_name_length - 1] = 0;
 
-	FILE* po = open_in_directory(directory, po_name, "wb");
-	if (!po) {
-		fprintf(stderr, "Cannot open %s\n", po_name);
+	struct gl_output* output = gl_open_output(directory, po_name);
+	if (!output) {
+		fprintf(stderr, "%s\n", gl_get_error());
 		goto exit;
 	}
+	FILE* po = gl_get_output_stream(output);
+
+	/* Keep revision date of an otherwise unchanged po file
+	 */
+	gl_set_output_volatile_line(output, "\"" GLTOOLKIT_REVISION_DATE);
 
 
 	/* Write po header
-	 *
-	 * @warning Currently there is no way to get information about
-	 *     `Last-Translator' and `POT-Creation-Date' from
-	 *     GetLocalization.com
-	 *
-	 *     Moreover the version in `Project-Id-Version' does not depend on
-	 *     GetLocalization.com so it can not be extracted from there
 	 */
 	fprintf(po, "# This file was auto generated by %s. DO NOT EDIT\n", GLTOOLKIT_NAME);
 	fprintf(po, "#\n");
@@ -200,59 +415,753 @@ static void print_po(	uint8_t const* project,
 
 	fprintf(po, "msgid \"\"\n");
 	fprintf(po, "msgstr \"\"\n");
-	fprintf(po, "\"Project-Id-Version: %s\\n\"\n", project);
-	if (report_msgid_bugs_to) {
-		fprintf(po, "\"Report-Msgid-Bugs-To: %s\\n\"\n", report_msgid_bugs_to);
+	print_header_fields(po, true, project, language, configuration);
+	fprintf(po, "\n");
+
+
+	/* Free allocated resources
+	 */
+exit:
+	if (license)			free(license);
+	if (original_author)		free(original_author);
+
+	return output;
+}
+
+
+
+/**
+ * Writes the binary mo catalog of a language directly, so no msgfmt run is
+ * necessary
+ *
+ * @return false iff the catalog could not be written
+ */
+static bool write_mo(	uint8_t const* project,
+			struct gl_language* language,
+			struct gl_translations* translations,
+			struct xml_node* configuration,
+			uint8_t const* directory
+		) {
+
+	/* Header entry
+	 */
+	char* header = 0;
+	size_t header_length = 0;
+	FILE* stream = open_memstream(&header, &header_length);
+
+	if (!stream) {
+		return false;
 	}
-//	fprintf(po, "\"POT-Creation-Date: 2011-03-29 22:06+0200\\n\"\n");
+	print_header_fields(stream, false, project, language, configuration);
+	fclose(stream);
 
-	time_t now = time(0);
-	struct tm* lt = localtime(&now);
-
-	fprintf(po, "\"PO-Revision-Date: %04d-%02d-%02d %02d:%02d %s\\n\"\n",
-		1900 + lt->tm_year,
-		1 + lt->tm_mon,
-		lt->tm_mday,
-		lt->tm_hour,
-		lt->tm_min,
-		lt->tm_zone
+
+	/* Open mo file
+	 */
+	uint8_t const* language_iana = gl_get_language_code(language);
+	size_t mo_name_length = strlen(language_iana) + strlen(".mo") + 1;
+	uint8_t* mo_name = alloca(mo_name_length * sizeof(uint8_t));
+
+	snprintf(mo_name, mo_name_length, "%s.mo", language_iana);
+	mo_name[mo_name_length - 1] = 0;
+
+	struct gl_output* output = gl_open_output(directory, mo_name);
+	if (!output) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		free(header);
+		return false;
+	}
+
+
+	/* The revision date is a line of the header entry's translation
+	 */
+	gl_set_output_volatile_line(output, GLTOOLKIT_REVISION_DATE);
+
+	bool written = gl_write_mo(gl_get_output_stream(output), header, translations);
+	free(header);
+
+	if (!written) {
+		fprintf(stderr, "Cannot write %s\n", mo_name);
+		gl_discard_output(output);
+		return false;
+	}
+	return close_output(output);
+}
+
+
+
+/**
+ * Writes the compiled catalog of a language, which is looked up by the
+ * runtime in gltoolkit-phf.h without parsing
+ *
+ * @return false iff the catalog could not be written
+ */
+static bool write_phf(	struct gl_language* language,
+			struct gl_translations* translations,
+			enum gl_phf_key key,
+			uint8_t const* directory
+		) {
+	uint8_t const* language_iana = gl_get_language_code(language);
+	size_t phf_name_length = strlen(language_iana) + strlen(".phf") + 1;
+	uint8_t* phf_name = alloca(phf_name_length * sizeof(uint8_t));
+
+	snprintf(phf_name, phf_name_length, "%s.phf", language_iana);
+	phf_name[phf_name_length - 1] = 0;
+
+	struct gl_output* output = gl_open_output(directory, phf_name);
+	if (!output) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		return false;
+	}
+
+	if (!gl_write_phf(gl_get_output_stream(output), key, translations)) {
+		fprintf(stderr, "Cannot write %s: %s\n", phf_name, gl_get_error());
+		gl_discard_output(output);
+		return false;
+	}
+	return close_output(output);
+}
+
+
+
+/**
+ * Writes the C source and header as well as the C++ header of a language,
+ * so translations can be compiled into an application. Files are only
+ * replaced iff their contents changed, which keeps them from triggering
+ * rebuilds
+ *
+ * @return false iff a file could not be written
+ */
+static bool write_sources(	uint8_t const* project,
+				struct gl_language* language,
+				struct gl_translations* translations,
+				uint8_t const* directory
+		) {
+	uint8_t const* language_iana = gl_get_language_code(language);
+	uint8_t* project_identifier = gl_get_codegen_identifier(project);
+	uint8_t* language_identifier = gl_get_codegen_identifier(language_iana);
+
+	uint8_t const* extensions[] = {".h", ".c", ".hpp"};
+	bool success = true;
+
+	size_t i = 0; for (; i < sizeof(extensions) / sizeof(extensions[0]); ++i) {
+		size_t name_length = strlen(project_identifier) + strlen(language_identifier) + strlen(extensions[i]) + 2;
+		uint8_t* name = alloca(name_length * sizeof(uint8_t));
+		uint8_t* header_name = alloca(name_length * sizeof(uint8_t));
+
+		snprintf(name, name_length, "%s_%s%s", project_identifier, language_identifier, extensions[i]);
+		snprintf(header_name, name_length, "%s_%s.h", project_identifier, language_identifier);
+
+		struct gl_output* output = gl_open_output(directory, name);
+		if (!output) {
+			fprintf(stderr, "%s\n", gl_get_error());
+			success = false;
+			continue;
+		}
+
+		FILE* stream = gl_get_output_stream(output);
+		bool written = 0 == i
+			? gl_write_c_header(stream, project, language_iana, translations)
+			: 1 == i
+			? gl_write_c_source(stream, header_name, project, language_iana, translations)
+			: gl_write_cpp_header(stream, project, language_iana, translations)
+		;
+
+		if (!written) {
+			fprintf(stderr, "Cannot write %s\n", name);
+			gl_discard_output(output);
+			success = false;
+			continue;
+		}
+		success = close_output(output) && success;
+	}
+
+	free(language_identifier);
+	free(project_identifier);
+	return success;
+}
+
+
+
+/**
+ * Writes <project>_ids.h, the enum of the LogicalStrings of all languages
+ * included by every language's sources
+ *
+ * @return false iff the header could not be written
+ */
+static bool write_ids(	uint8_t const* project,
+			struct gl_languages* languages,
+			struct gl_translations** catalogs,
+			uint8_t const* directory
+		) {
+	uint8_t* project_identifier = gl_get_codegen_identifier(project);
+	size_t name_length = strlen(project_identifier) + strlen("_ids.h") + 1;
+	uint8_t* name = alloca(name_length * sizeof(uint8_t));
+
+	snprintf(name, name_length, "%s_ids.h", project_identifier);
+	free(project_identifier);
+
+	struct gl_output* output = gl_open_output(directory, name);
+	if (!output) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		return false;
+	}
+
+	size_t collisions = 0;
+	if (!gl_write_ids_header(gl_get_output_stream(output), project, catalogs, gl_get_languages_count(languages), &collisions)) {
+		fprintf(stderr, "Cannot write %s\n", name);
+		gl_discard_output(output);
+		return false;
+	}
+
+	if (collisions) {
+		fprintf(stderr, "Warning: %lu LogicalStrings of %s have no id of their own: %s\n",
+			(unsigned long)collisions, project, gl_get_error()
+		);
+	}
+	return close_output(output);
+}
+
+
+
+/**
+ * State of the translation callbacks
+ */
+struct fetch_state {
+	uint8_t const* project;
+	uint8_t const* working_directory;
+
+	/* Write binary mo catalogs instead of po files
+	 */
+	bool mo;
+
+	/* Write compiled catalogs with keys `phf_key' instead of po files
+	 */
+	bool phf;
+	enum gl_phf_key phf_key;
+
+	/* Write C and C++ sources instead of po files
+	 */
+	bool codegen;
+
+	/* Threads building catalogs respectively writing files, so callbacks
+	 * run concurrently
+	 */
+	size_t parsers;
+	size_t writers;
+
+	/* Receives the time spent writing every language (optional)
+	 */
+	struct gl_trace* trace;
+
+	/* Languages which could not be fetched or written during the current
+	 * sync, updated atomically by the writer threads
+	 */
+	size_t failures;
+
+	/* Keeps the catalog of every language of `languages' for the snapshot,
+	 * the ids header or the next sync instead of freeing it (optional)
+	 */
+	struct gl_languages* languages;
+	struct gl_translations** catalogs;
+	struct gl_string_pool* pool;
+
+	/* Catalogs of the previous sync, languages whose translations did not
+	 * change are not written again (optional)
+	 */
+	struct gl_languages* previous_languages;
+	struct gl_translations** previous_catalogs;
+	struct gl_string_pool* previous_pool;
+};
+
+
+
+/**
+ * Po file being generated, translations are serialized by a buffered writer
+ * after the header
+ */
+struct po_file {
+	struct gl_output* output;
+	struct gl_po_writer* writer;
+
+	/* Sync the po file is written for
+	 */
+	struct fetch_state* state;
+};
+
+
+
+/**
+ * Opens the po file of `language' using its translation configuration
+ * (optional)
+ */
+static struct po_file* open_language_po(struct fetch_state* state, struct gl_language* language) {
+
+	/* Open translation configuration
+	 */
+	struct xml_document* configuration = open_configuration(
+		language, state->working_directory
 	);
+	struct xml_node* config = configuration
+		? xml_document_root(configuration) : 0
+	;
 
-//	fprintf(po, "\"Last-Translator: Nikita M. Makarov <5253450@gmail.com>\\n\"\n");
-	if (language_team) {
-		fprintf(po, "\"Language-Team: %s\\n\"\n", language_team);
+	/* Write po header
+	 */
+	struct gl_output* output = open_po(	state->project, language, config,
+						state->working_directory
+	);
+
+	if (configuration) {
+		xml_document_free(configuration, true);
 	}
-	fprintf(po, "\"MIME-Version: 1.0\\n\"\n");
-	fprintf(po, "\"Content-Type: text/plain; charset=UTF-8\\n\"\n");
-	fprintf(po, "\"Content-Transfer-Encoding: 8bit\\n\"\n");
-	fprintf(po, "\"Language: %s\\n\"\n", language_iana);
-	fprintf(po, "\"X-Generator: %s\\n\"\n", GLTOOLKIT_NAME);
-	if (plural_forms) {
-		fprintf(po, "\"Plural-Forms: %s\\n\"\n", plural_forms);
+	if (!output) {
+		return 0;
 	}
-	fprintf(po, "\n");
+
+	struct po_file* po = malloc(sizeof(struct po_file));
+	po->output = output;
+	po->writer = gl_create_po_writer(gl_get_output_stream(output));
+	po->state = state;
+	return po;
+}
+
+
+
+/**
+ * Completes the po file, which is kept unchanged if `success' is false
+ *
+ * @return false iff the po file could not be written
+ */
+static bool close_language_po(struct po_file* po, bool success) {
+	success = gl_free_po_writer(po->writer) && success;
+
+	if (success) {
+		success = close_output(po->output);
+	} else {
+		gl_discard_output(po->output);
+	}
+
+	free(po);
+	return success;
+}
+
 
 
-	/* Write translations
+/**
+ * Writes the mo catalog of `language' using its translation configuration
+ * (optional)
+ */
+static bool write_language_mo(	struct fetch_state* state,
+				struct gl_language* language,
+				struct gl_translations* translations
+		) {
+
+	/* Open translation configuration
 	 */
-	size_t j = 0; for (; j < gl_get_translations_count(translations); ++j) {
-		struct gl_translation* translation = gl_get_translation(translations, j);
+	struct xml_document* configuration = open_configuration(
+		language, state->working_directory
+	);
+	struct xml_node* config = configuration
+		? xml_document_root(configuration) : 0
+	;
+
+	/* Write catalog
+	 */
+	bool written = write_mo(	state->project, language, translations,
+					config, state->working_directory
+	);
 
-		fprintf(po, "# %s\n", gl_get_translation_context_info(translation));
-		fprintf(po, "msgid \"%s\"\n", gl_get_translation_master_string(translation));
-		fprintf(po, "msgstr \"%s\"\n", gl_get_translation_string(translation));
-		fprintf(po, "\n");
+	if (configuration) {
+		xml_document_free(configuration, true);
 	}
+	return written;
+}
 
 
-	/* Free allocated resources
+
+/**
+ * Frees the translations of `language' after they have been written, unless
+ * they are kept for the snapshot, the ids header or the next sync
+ */
+static void release_translations(	struct fetch_state* state,
+					struct gl_language* language,
+					struct gl_translations* translations
+		) {
+	if (state->catalogs) {
+		size_t i = 0; for (; i < gl_get_languages_count(state->languages); ++i) {
+			if (language == gl_get_language(state->languages, i)) {
+				state->catalogs[i] = translations;
+				return;
+			}
+		}
+	}
+	gl_free_translations(translations);
+}
+
+
+
+/**
+ * @return true iff both catalogs contain the same translations in the same
+ *     order
+ */
+static bool same_translations(struct gl_translations* a, struct gl_translations* b) {
+	if (gl_get_translations_count(a) != gl_get_translations_count(b)) {
+		return false;
+	}
+
+	size_t i = 0; for (; i < gl_get_translations_count(a); ++i) {
+		struct gl_translation* x = gl_get_translation(a, i);
+		struct gl_translation* y = gl_get_translation(b, i);
+
+		if (	strcmp(gl_get_translation_master_string(x), gl_get_translation_master_string(y))
+		||	strcmp(gl_get_translation_logical_string(x), gl_get_translation_logical_string(y))
+		||	strcmp(gl_get_translation_context_info(x), gl_get_translation_context_info(y))
+		||	strcmp(gl_get_translation_string(x), gl_get_translation_string(y))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+/**
+ * @return true iff the previous sync fetched the same translations of
+ *     `language'
+ */
+static bool unchanged_translations(	struct fetch_state* state,
+					struct gl_language* language,
+					struct gl_translations* translations
+		) {
+	if (!state->previous_catalogs) {
+		return false;
+	}
+	uint8_t const* language_code = gl_get_language_code(language);
+
+	size_t i = 0; for (; i < gl_get_languages_count(state->previous_languages); ++i) {
+		struct gl_language* previous = gl_get_language(state->previous_languages, i);
+
+		if (!strcmp(language_code, gl_get_language_code(previous))) {
+			return state->previous_catalogs[i]
+				&& same_translations(state->previous_catalogs[i], translations)
+			;
+		}
+	}
+	return false;
+}
+
+
+
+/**
+ * Frees all kept catalogs of `languages', the list itself and the pool
+ * holding the catalogs' source strings
+ */
+static void free_catalogs(	struct gl_languages* languages,
+				struct gl_translations** catalogs,
+				struct gl_string_pool* pool
+		) {
+	size_t i = 0; for (; catalogs && i < gl_get_languages_count(languages); ++i) {
+		if (catalogs[i]) {
+			gl_free_translations(catalogs[i]);
+		}
+	}
+	free(catalogs);
+	gl_free_languages(languages);
+
+	if (pool) {
+		gl_free_string_pool(pool);
+	}
+}
+
+
+
+/**
+ * Records that a language is missing from the output of the current sync
+ */
+static void fail_language(struct fetch_state* state) {
+	__sync_fetch_and_add(&state->failures, 1);
+}
+
+
+
+/**
+ * Writes the po file, catalog or sources of `language' as soon as its translations
+ * are available
+ */
+static void translations_fetched(
+			struct gl_language* language,
+			struct gl_translations* translations,
+			void* context
+		) {
+	struct fetch_state* state = context;
+	uint8_t const* language_code = gl_get_language_code(language);
+
+	if (!translations) {
+		fprintf(stderr, "Failed fetching %s/%s: %s\n", state->project, language_code, gl_get_error());
+		fail_language(state);
+		return;
+	}
+	fprintf(stdout, "Fetched %s/%s\n", state->project, language_code);
+	uint64_t start = gl_trace_now();
+
+	if (unchanged_translations(state, language, translations)) {
+		fprintf(stdout, "Translations of %s/%s did not change\n", state->project, language_code);
+		release_translations(state, language, translations);
+		return;
+	}
+
+	if (state->mo) {
+		if (!write_language_mo(state, language, translations)) {
+			fail_language(state);
+		}
+		release_translations(state, language, translations);
+
+		gl_add_trace_span(state->trace, "mo", 0, language_code, start, gl_trace_now());
+		return;
+	}
+
+	if (state->phf) {
+		if (!write_phf(language, translations, state->phf_key, state->working_directory)) {
+			fail_language(state);
+		}
+		release_translations(state, language, translations);
+
+		gl_add_trace_span(state->trace, "phf", 0, language_code, start, gl_trace_now());
+		return;
+	}
+
+	if (state->codegen) {
+		if (!write_sources(state->project, language, translations, state->working_directory)) {
+			fail_language(state);
+		}
+		release_translations(state, language, translations);
+
+		gl_add_trace_span(state->trace, "codegen", 0, language_code, start, gl_trace_now());
+		return;
+	}
+
+	struct po_file* po = open_language_po(state, language);
+	if (po) {
+		size_t j = 0; for (; j < gl_get_translations_count(translations); ++j) {
+			gl_write_po_translation(po->writer, gl_get_translation(translations, j));
+		}
+	}
+	if (!po || !close_language_po(po, true)) {
+		fail_language(state);
+	}
+	release_translations(state, language, translations);
+
+	gl_add_trace_span(state->trace, "po", 0, language_code, start, gl_trace_now());
+}
+
+
+
+/**
+ * Opens the po file of `language' when streaming starts
+ */
+static void* stream_begin(struct gl_language* language, void* context) {
+	struct po_file* po = open_language_po(context, language);
+
+	if (!po) {
+		fail_language(context);
+	}
+	return po;
+}
+
+
+
+/**
+ * Writes every translation as soon as it was parsed
+ */
+static bool stream_translation(struct gl_translation* translation, void* stream) {
+	struct po_file* po = stream;
+
+	if (po) {
+		gl_write_po_translation(po->writer, translation);
+	}
+	return po;
+}
+
+
+
+/**
+ * Closes the po file of `language', which is kept unchanged if streaming
+ * failed. A po file which could not be opened was already recorded as
+ * failure
+ */
+static void stream_end(struct gl_language* language, bool success, void* stream) {
+	struct po_file* po = stream;
+
+	if (po) {
+		struct fetch_state* state = po->state;
+		success = close_language_po(po, success);
+
+		if (!success) {
+			fail_language(state);
+		}
+	}
+	if (success) {
+		fprintf(stdout, "Streamed %s\n", gl_get_language_code(language));
+	} else {
+		fprintf(stderr, "Failed streaming %s: %s\n", gl_get_language_code(language), gl_get_error());
+	}
+}
+
+
+
+/**
+ * Fetches the languages of the project and all their translations and writes
+ * LINGUAS as well as every po file, catalog or source. Catalogs are kept in
+ * `state' for the next sync iff `keep' is set
+ *
+ * @return true iff all languages were fetched and written
+ */
+static bool sync_project(	struct gl_session* session,
+				struct fetch_state* state,
+				size_t jobs, bool stream, bool keep,
+				uint8_t const* snapshot
+		) {
+
+	/* 1. Fetch all available languages and write them to LINGUAS
 	 */
-exit:
-	if (license)			free(license);
-	if (original_author)		free(original_author);
-	if (report_msgid_bugs_to)	free(report_msgid_bugs_to);
-	if (language_team)		free(language_team);
-	if (plural_forms)		free(plural_forms);
+	uint64_t start = gl_trace_now();
+	struct gl_languages* languages = gl_get_languages(session, state->project);
+
+	if (!languages) {
+		fprintf(stderr, "Cannot fetch languages of %s: %s\n", state->project, gl_get_error());
+		return false;
+	}
+
+	uint64_t linguas_start = gl_trace_now();
+	print_linguas(languages, state->working_directory, "LINGUAS");
+	gl_add_trace_span(state->trace, "linguas", 0, 0, linguas_start, gl_trace_now());
+
+
+	/* 2. For every language fetch all translations and write the po file,
+	 * starting with the languages which took longest last time
+	 */
+	read_schedule(languages, state->working_directory);
+
+	size_t count = gl_get_languages_count(languages);
+	state->failures = 0;
+	state->languages = languages;
+	state->catalogs = snapshot || keep || state->codegen
+		? calloc(count + 1, sizeof(struct gl_translations*))
+		: 0
+	;
+
+	/* Kept catalogs of all languages share their source strings
+	 */
+	state->pool = state->catalogs ? gl_create_string_pool() : 0;
+	gl_set_session_string_pool(session, state->pool);
+	fprintf(stdout, "Fetching %lu languages of %s using %lu parallel downloads, %lu parsers and %lu writers\n",
+		(unsigned long)count, state->project, (unsigned long)jobs,
+		(unsigned long)state->parsers, (unsigned long)state->writers
+	);
+
+	struct gl_stream_callbacks callbacks = {
+		.begin = stream_begin,
+		.translation = stream_translation,
+		.end = stream_end
+	};
+
+	bool success = stream
+		? gl_stream_translations(session, state->project, languages, jobs, &callbacks, state)
+		: gl_fetch_translations_pipelined(session, state->project, languages, jobs, state->parsers, state->writers, translations_fetched, state)
+	;
+
+	if (!success) {
+		fprintf(stderr, "Cannot fetch translations of %s: %s\n", state->project, gl_get_error());
+	}
+	if (state->failures) {
+		fprintf(stderr, "%lu of %lu languages of %s could not be fetched or written\n",
+			(unsigned long)state->failures, (unsigned long)count, state->project
+		);
+		success = false;
+	}
+	write_schedule(languages, state->working_directory);
+
+
+	/* The ids header needs the catalogs of all languages, it is kept
+	 * unchanged iff languages are missing
+	 */
+	if (state->codegen && success) {
+		uint64_t ids_start = gl_trace_now();
+		success = write_ids(state->project, languages, state->catalogs, state->working_directory);
+		gl_add_trace_span(state->trace, "codegen", 0, 0, ids_start, gl_trace_now());
+	}
+
+
+	/* Catalogs of languages which failed are missing from the snapshot
+	 */
+	if (snapshot) {
+		uint64_t snapshot_start = gl_trace_now();
+
+		if (!gl_save_snapshot(snapshot, languages, state->catalogs)) {
+			fprintf(stderr, "%s\n", gl_get_error());
+			success = false;
+		}
+		gl_add_trace_span(state->trace, "snapshot", 0, 0, snapshot_start, gl_trace_now());
+	}
+
+
+	/* Catalogs of this sync replace the previous ones
+	 */
+	gl_set_session_string_pool(session, 0);
+
+	if (state->previous_languages) {
+		free_catalogs(state->previous_languages, state->previous_catalogs, state->previous_pool);
+		state->previous_languages = 0;
+		state->previous_catalogs = 0;
+		state->previous_pool = 0;
+	}
+
+	if (keep) {
+		state->previous_languages = languages;
+		state->previous_catalogs = state->catalogs;
+		state->previous_pool = state->pool;
+	} else {
+		free_catalogs(languages, state->catalogs, state->pool);
+	}
+	state->languages = 0;
+	state->catalogs = 0;
+	state->pool = 0;
+
+	gl_add_trace_span(state->trace, "sync", 0, state->project, start, gl_trace_now());
+	return success;
+}
+
+
+
+/**
+ * Ends --watch once the current sync completed
+ */
+static void stop_watching(__attribute__((unused)) int number) {
+	stopping = 1;
+}
+
+
+
+/**
+ * Sleeps `interval' seconds unless a signal requests to stop earlier
+ */
+static void wait_interval(unsigned long interval) {
+	struct timespec duration = {
+		.tv_sec = interval,
+		.tv_nsec = 0
+	};
+
+	while (!stopping && nanosleep(&duration, &duration) && EINTR == errno);
+}
+
+
+
+/**
+ * Prints usage information
+ */
+static void print_usage() {
+	fprintf(stderr, "Usage: gltoolkit [--jobs <n>] [--parsers <n>] [--writers <n>] [--stream | --mo | --phf <master|logical> | --codegen] [--zero-copy] [--cache <directory>] [--trace <file>] [--stats] [--snapshot <file>] [--watch <seconds>] <project> <working-directory>\n");
 }
 
 
@@ -266,6 +1175,37 @@ exit:
  * Downloads translations from GetLocalization.com and converts them into
  * gettext sources
  *
+ * @param --jobs Maximum number of parallel downloads (optional)
+ * @param --parsers Number of threads building catalogs while downloads
+ *     continue, defaults to the number of processors (optional)
+ * @param --writers Number of threads writing po files or catalogs,
+ *     defaults to the number of processors (optional)
+ * @param --stream Write translations while downloading instead of building
+ *     catalogs in memory (optional)
+ * @param --mo Write binary mo catalogs instead of po files, cannot be
+ *     combined with --stream (optional)
+ * @param --phf Write compiled catalogs keyed by master or logical string
+ *     instead of po files, which are read by the runtime in gltoolkit-phf.h.
+ *     Cannot be combined with --stream or --mo (optional)
+ * @param --codegen Write <project>_<language>.c and .h with static const
+ *     tables and a .hpp with constexpr lookups, as well as <project>_ids.h
+ *     with an enum of the LogicalStrings of all languages, instead of po
+ *     files. Cannot be combined with
+ *     --stream, --mo or --phf (optional)
+ * @param --zero-copy Build catalogs as views into the downloaded documents
+ *     instead of copying every string (optional)
+ * @param --cache Directory keeping responses between runs, unchanged
+ *     resources are only revalidated (optional)
+ * @param --trace Writes the duration of every phase of every request and
+ *     language to a file in Chrome's trace event format (optional)
+ * @param --stats Prints a summary of all phases after the run (optional)
+ * @param --snapshot Additionally writes all languages and catalogs into a
+ *     binary snapshot which can be memory mapped by gl_open_snapshot, cannot
+ *     be combined with --stream (optional)
+ * @param --watch Keeps running and syncs again every n seconds, reusing
+ *     the session's connections. Catalogs are kept in memory, so languages
+ *     whose translations did not change are not written again. Cannot be
+ *     combined with --stream, ends on SIGINT or SIGTERM (optional)
  * @param argv[1] GetLocalization.com project name
  * @param argv[2] Working directory
  *
@@ -275,64 +1215,171 @@ exit:
  *
  *  0. Validate arguments
  *  1. Fetch all available languages and write them to LINGUAS
- *  2. All translations and write po translation file
+ *  2. Concurrently fetch all translations, build the catalogs and write po
+ *     translation files in a pipeline, so downloading, parsing and writing
+ *     of different languages overlap. Languages which took longest during
+ *     the last run (as recorded in .gltoolkit-schedule) are started first
+ *  3. Repeat 1. and 2. until stopped iff watching
  */
 int main(int argc, char** argv) {
 
 	/* 0. Validate arguments
 	 */
-	if (3 != argc) {
-		fprintf(stderr, "Usage: gltoolkit <project> <working-directory>\n");
+	size_t jobs = GLTOOLKIT_DEFAULT_JOBS;
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t parsers = processors > 0 ? processors : 1;
+	size_t writers = parsers;
+	bool stream = false;
+	bool mo = false;
+	bool phf = false;
+	bool codegen = false;
+	enum gl_phf_key phf_key = GL_PHF_MASTER_STRING;
+	bool zero_copy = false;
+	uint8_t const* cache = 0;
+	uint8_t const* trace_file = 0;
+	bool stats = false;
+	uint8_t const* snapshot = 0;
+	unsigned long watch = 0;
+	int argument = 1;
+
+	for (; argument < argc && !strncmp(argv[argument], "--", 2); ++argument) {
+		if (!strcmp(argv[argument], "--jobs") && argument + 1 < argc) {
+			jobs = strtoul(argv[++argument], 0, 10);
+		} else if (!strcmp(argv[argument], "--parsers") && argument + 1 < argc) {
+			parsers = strtoul(argv[++argument], 0, 10);
+		} else if (!strcmp(argv[argument], "--writers") && argument + 1 < argc) {
+			writers = strtoul(argv[++argument], 0, 10);
+		} else if (!strcmp(argv[argument], "--stream")) {
+			stream = true;
+		} else if (!strcmp(argv[argument], "--mo")) {
+			mo = true;
+		} else if (!strcmp(argv[argument], "--phf") && argument + 1 < argc) {
+			uint8_t const* key = argv[++argument];
+			phf = true;
+
+			if (!strcmp(key, "master")) {
+				phf_key = GL_PHF_MASTER_STRING;
+			} else if (!strcmp(key, "logical")) {
+				phf_key = GL_PHF_LOGICAL_STRING;
+			} else {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[argument], "--codegen")) {
+			codegen = true;
+		} else if (!strcmp(argv[argument], "--zero-copy")) {
+			zero_copy = true;
+		} else if (!strcmp(argv[argument], "--cache") && argument + 1 < argc) {
+			cache = argv[++argument];
+		} else if (!strcmp(argv[argument], "--trace") && argument + 1 < argc) {
+			trace_file = argv[++argument];
+		} else if (!strcmp(argv[argument], "--stats")) {
+			stats = true;
+		} else if (!strcmp(argv[argument], "--snapshot") && argument + 1 < argc) {
+			snapshot = argv[++argument];
+		} else if (!strcmp(argv[argument], "--watch") && argument + 1 < argc) {
+			watch = strtoul(argv[++argument], 0, 10);
+
+			if (!watch) {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+		} else {
+			print_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (2 != argc - argument || !jobs || !parsers || !writers || (stream && (mo || phf || codegen || snapshot || watch)) || mo + phf + codegen > 1) {
+		print_usage();
 		return EXIT_FAILURE;
 	}
-	uint8_t const* project = argv[1];
-	uint8_t const* working_directory = argv[2];
+	uint8_t const* project = argv[argument];
+	uint8_t const* working_directory = argv[argument + 1];
 
 
-	/* 1. Fetch all available languages and write them to LINGUAS
+	/* All requests of all syncs share the same session
 	 */
-	struct gl_languages* languages = gl_get_languages(project);
-	print_linguas(languages, working_directory, "LINGUAS");
+	if (!gl_init()) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		return EXIT_FAILURE;
+	}
 
+	struct gl_session* session = gl_create_session();
+	if (!session) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		gl_cleanup();
+		return EXIT_FAILURE;
+	}
+	gl_set_session_zero_copy(session, zero_copy);
 
-	/* 2. For every language do
-	 */
-	size_t i = 0; for (; i < gl_get_languages_count(languages); ++i) {
-		struct gl_language* language = gl_get_language(languages, i);
-		uint8_t const* language_code = gl_get_language_code(language);
-		fprintf(stdout, "Fetching %s/%s\n", project, language_code);
-		
-		/* 2.a Fetch all translations
-		 */
-		struct gl_translations* translations = gl_get_translations(
-			project, language_code
-		);
+	if (cache && !gl_set_session_cache(session, cache)) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		gl_free_session(session);
+		gl_cleanup();
+		return EXIT_FAILURE;
+	}
 
-		/* 2.b Open translation configuration
-		 */
-		struct xml_document* configuration = open_configuration(
-			language, working_directory
-		);
-		struct xml_node* config = configuration
-			? xml_document_root(configuration) : 0
-		;
+	struct gl_trace* trace = trace_file || stats ? gl_create_trace() : 0;
+	gl_set_session_trace(session, trace);
 
-		/* 2.c Write po file
-		 */
-		print_po(project, language, translations, config, working_directory);
+	struct fetch_state state = {
+		.project = project,
+		.working_directory = working_directory,
+		.mo = mo,
+		.phf = phf,
+		.phf_key = phf_key,
+		.codegen = codegen,
+		.parsers = parsers,
+		.writers = writers,
+		.trace = trace
+	};
+
+
+	/* 1. and 2. Sync once, 3. or until stopped
+	 */
+	if (watch) {
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = stop_watching;
+		sigaction(SIGINT, &action, 0);
+		sigaction(SIGTERM, &action, 0);
+	}
+	bool success = sync_project(session, &state, jobs, stream, watch, snapshot);
 
-		/* Free resources
-		 */
-		if (configuration) {
-			xml_document_free(configuration, true);
+	if (watch) {
+		for (wait_interval(watch); !stopping; wait_interval(watch)) {
+			success = sync_project(session, &state, jobs, stream, true, snapshot);
+		}
+
+		if (state.previous_languages) {
+			free_catalogs(state.previous_languages, state.previous_catalogs, state.previous_pool);
 		}
-		gl_free_translations(translations);
 	}
 
 
-	/* Free resources and exit
+	/* Free resources and report where the time went
 	 */
-	gl_free_languages(languages);
-	return EXIT_SUCCESS;
+	gl_free_session(session);
+	gl_cleanup();
+
+	if (trace) {
+		if (trace_file) {
+			FILE* trace_stream = fopen(trace_file, "wb");
+			bool written = trace_stream && gl_write_trace(trace, trace_stream);
+
+			if (trace_stream && fclose(trace_stream)) {
+				written = false;
+			}
+			if (!written) {
+				fprintf(stderr, "Cannot write trace to %s\n", trace_file);
+				success = false;
+			}
+		}
+		if (stats) {
+			gl_print_trace_stats(trace, stdout);
+		}
+		gl_free_trace(trace);
+	}
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
-
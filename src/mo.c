@@ -0,0 +1,299 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <stdlib.h>
+
+#include "mo.h"
+
+
+
+
+
+/**
+ * Magic number of .mo files, written in native byte order
+ */
+#define GL_MO_MAGIC 0x950412de
+
+/**
+ * Size of the header of revision 0 catalogs, which have no system dependent
+ * strings
+ */
+#define GL_MO_HEADER_LENGTH (7 * sizeof(uint32_t))
+
+/**
+ * Bits of the hashpjw word
+ */
+#define GL_MO_HASH_WORD_BITS 32
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * One message of the catalog
+ */
+struct mo_message {
+	uint8_t const* original;
+	size_t original_length;
+
+	uint8_t const* translation;
+	size_t translation_length;
+
+	/* Position inside the catalog, keeps sorting stable
+	 */
+	size_t index;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Orders messages like msgfmt, ties are broken by catalog position
+ */
+static int compare_messages(void const* a, void const* b) {
+	struct mo_message const* message_a = a;
+	struct mo_message const* message_b = b;
+	int order = strcmp(message_a->original, message_b->original);
+
+	if (order) {
+		return order;
+	}
+	return (message_a->index > message_b->index) - (message_a->index < message_b->index);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff `candidate' is prime, `candidate' has to be odd
+ */
+static bool is_prime(uint32_t candidate) {
+	uint32_t divisor = 3;
+	uint64_t square = divisor * divisor;
+
+	while (square < candidate && candidate % divisor) {
+		++divisor;
+		square += 4 * divisor;
+		++divisor;
+	}
+	return candidate % divisor;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Smallest odd prime not less than `seed'
+ */
+static uint32_t next_prime(uint32_t seed) {
+	seed |= 1;
+
+	while (!is_prime(seed)) {
+		seed += 2;
+	}
+	return seed;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes `count' native 32 bit integers
+ */
+static bool write_words(FILE* mo, uint32_t const* words, size_t count) {
+	return count == fwrite(words, sizeof(uint32_t), count, mo);
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint32_t gl_mo_hash(uint8_t const* string) {
+	uint32_t hash = 0;
+
+	for (; *string; ++string) {
+		hash <<= 4;
+		hash += *string;
+
+		uint32_t high = hash & (~(uint32_t)0 << (GL_MO_HASH_WORD_BITS - 4));
+		if (high) {
+			hash ^= high >> (GL_MO_HASH_WORD_BITS - 8);
+			hash ^= high;
+		}
+	}
+	return hash;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint32_t gl_mo_hash_size(uint32_t count) {
+	uint32_t size = next_prime((count * 4) / 3);
+
+	/* Probing needs at least three slots
+	 */
+	return size <= 2 ? 3 : size;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_write_mo(	FILE* mo,
+			uint8_t const* header,
+			struct gl_translations* translations
+		) {
+	size_t translations_count = gl_get_translations_count(translations);
+	struct mo_message* messages = malloc((translations_count + 1) * sizeof(struct mo_message));
+	size_t count = 0;
+
+
+	/* Header entry has the empty msgid and is therefore always first
+	 */
+	if (header) {
+		messages[count++] = (struct mo_message){
+			.original = "",
+			.original_length = 0,
+			.translation = header,
+			.translation_length = strlen(header),
+			.index = 0
+		};
+	}
+
+	size_t i = 0; for (; i < translations_count; ++i) {
+		struct gl_translation* translation = gl_get_translation(translations, i);
+
+		if (	!gl_get_translation_master_string_length(translation)
+		||	!gl_get_translation_string_length(translation)) {
+			continue;
+		}
+		messages[count++] = (struct mo_message){
+			.original = gl_get_translation_master_string(translation),
+			.original_length = gl_get_translation_master_string_length(translation),
+			.translation = gl_get_translation_string(translation),
+			.translation_length = gl_get_translation_string_length(translation),
+			.index = i + 1
+		};
+	}
+
+
+	/* Sort by msgid and drop duplicates
+	 */
+	qsort(messages, count, sizeof(struct mo_message), compare_messages);
+
+	size_t unique = 0;
+	for (i = 0; i < count; ++i) {
+		if (!unique || strcmp(messages[unique - 1].original, messages[i].original)) {
+			messages[unique++] = messages[i];
+		}
+	}
+	count = unique;
+
+
+	/* Tables follow the header directly, strings follow the hash table
+	 */
+	uint32_t hash_size = gl_mo_hash_size(count);
+	uint32_t original_offset = GL_MO_HEADER_LENGTH;
+	uint32_t translation_offset = original_offset + 2 * sizeof(uint32_t) * count;
+	uint32_t hash_offset = translation_offset + 2 * sizeof(uint32_t) * count;
+	uint32_t string_offset = hash_offset + sizeof(uint32_t) * hash_size;
+
+	uint32_t header_words[] = {
+		GL_MO_MAGIC, 0, count,
+		original_offset, translation_offset,
+		hash_size, hash_offset
+	};
+	bool success = write_words(mo, header_words, sizeof(header_words) / sizeof(uint32_t));
+
+
+	/* Length and offset of every string, originals first
+	 */
+	uint32_t* table = malloc(2 * sizeof(uint32_t) * (count + 1));
+	uint32_t offset = string_offset;
+
+	for (i = 0; i < count; ++i) {
+		table[2 * i] = messages[i].original_length;
+		table[2 * i + 1] = offset;
+		offset += messages[i].original_length + 1;
+	}
+	success = success && write_words(mo, table, 2 * count);
+
+	for (i = 0; i < count; ++i) {
+		table[2 * i] = messages[i].translation_length;
+		table[2 * i + 1] = offset;
+		offset += messages[i].translation_length + 1;
+	}
+	success = success && write_words(mo, table, 2 * count);
+	free(table);
+
+
+	/* Open addressing with double hashing, slots store index + 1
+	 */
+	uint32_t* hash_table = calloc(hash_size, sizeof(uint32_t));
+
+	for (i = 0; i < count; ++i) {
+		uint32_t hash = gl_mo_hash(messages[i].original);
+		uint32_t slot = hash % hash_size;
+
+		if (hash_table[slot]) {
+			uint32_t increment = 1 + (hash % (hash_size - 2));
+
+			do {
+				if (slot >= hash_size - increment) {
+					slot -= hash_size - increment;
+				} else {
+					slot += increment;
+				}
+			} while (hash_table[slot]);
+		}
+		hash_table[slot] = i + 1;
+	}
+	success = success && write_words(mo, hash_table, hash_size);
+	free(hash_table);
+
+
+	/* 0-terminated strings
+	 */
+	for (i = 0; success && i < count; ++i) {
+		success = 1 == fwrite(messages[i].original, messages[i].original_length + 1, 1, mo);
+	}
+	for (i = 0; success && i < count; ++i) {
+		success = 1 == fwrite(messages[i].translation, messages[i].translation_length + 1, 1, mo);
+	}
+
+	free(messages);
+	return success;
+}
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_MO
+#define GLTOOLKIT_MO
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+
+
+
+
+/**
+ * Writes a binary GNU .mo catalog, laid out exactly like `msgfmt' does:
+ * strings sorted by msgid followed by the hash table used by gettext for
+ * O(1) lookups. Untranslated strings are skipped and of duplicate msgids
+ * only the first one is kept
+ *
+ * @param header Contents of the header entry, i.e. the translation of the
+ *     empty msgid (optional)
+ *
+ * @return false on I/O errors
+ *
+ * @see http://www.gnu.org/software/gettext/manual/html_node/MO-Files.html
+ */
+bool gl_write_mo(	FILE* mo,
+			uint8_t const* header,
+			struct gl_translations* translations
+);
+
+/**
+ * @return Hash of `string' as computed by gettext (hashpjw)
+ */
+uint32_t gl_mo_hash(uint8_t const* string);
+
+/**
+ * @return Size of the hash table msgfmt uses for `count' strings
+ */
+uint32_t gl_mo_hash_size(uint32_t count);
+
+
+
+
+
+#endif
@@ -0,0 +1,348 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "output.h"
+
+
+
+
+
+/**
+ * [OPAQUE API]
+ */
+struct gl_output {
+	uint8_t* path;
+
+	/* New contents
+	 */
+	FILE* stream;
+	char* data;
+	size_t length;
+
+	/* Line ignored during comparison (optional)
+	 */
+	uint8_t const* volatile_prefix;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Maximal number of names tried for a temporary file
+ */
+#define GL_OUTPUT_TEMPORARY_ATTEMPTS 100
+
+/**
+ * [PRIVATE]
+ *
+ * Distinguishes temporary files of the process
+ */
+static size_t gl_output_temporary_counter = 0;
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Locates the line starting with `prefix'
+ *
+ * @param begin Offset of the line
+ * @param end Offset behind the line's line break
+ *
+ * @return true iff such a line exists
+ */
+static bool find_line(	uint8_t const* data, size_t length,
+			uint8_t const* prefix,
+			size_t* begin, size_t* end
+		) {
+	size_t prefix_length = strlen(prefix);
+	size_t offset = 0;
+
+	while (offset + prefix_length <= length) {
+		uint8_t const* line_end = memchr(&data[offset], '\n', length - offset);
+		size_t next = line_end ? (size_t)(line_end - data + 1) : length;
+
+		if (!memcmp(&data[offset], prefix, prefix_length)) {
+			*begin = offset;
+			*end = next;
+			return true;
+		}
+		offset = next;
+	}
+	return false;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff both contents are equal, apart from the volatile line
+ */
+static bool equal_contents(	uint8_t const* a, size_t a_length,
+				uint8_t const* b, size_t b_length,
+				uint8_t const* volatile_prefix
+		) {
+	size_t a_begin = 0, a_end = 0;
+	size_t b_begin = 0, b_end = 0;
+
+	if (	!volatile_prefix
+	||	!find_line(a, a_length, volatile_prefix, &a_begin, &a_end)
+	||	!find_line(b, b_length, volatile_prefix, &b_begin, &b_end)) {
+		return a_length == b_length && !memcmp(a, b, a_length);
+	}
+
+	return a_begin == b_begin
+		&& a_length - a_end == b_length - b_end
+		&& !memcmp(a, b, a_begin)
+		&& !memcmp(&a[a_end], &b[b_end], a_length - a_end)
+	;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Contents of the file at `path' or 0 iff it cannot be read
+ */
+static uint8_t* read_file(uint8_t const* path, size_t* length) {
+	FILE* file = fopen(path, "rb");
+	struct stat status;
+
+	if (!file) {
+		return 0;
+	}
+	if (fstat(fileno(file), &status)) {
+		fclose(file);
+		return 0;
+	}
+
+	*length = status.st_size;
+	uint8_t* data = malloc(*length + 1);
+	bool complete = *length == fread(data, 1, *length, file);
+	fclose(file);
+
+	if (!complete) {
+		free(data);
+		return 0;
+	}
+	return data;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes the new contents into a temporary file next to the target and
+ * renames it over the target, so readers never see a partial file
+ *
+ * @return true iff the file was replaced
+ */
+static bool replace_file(struct gl_output* output) {
+	uint8_t* temporary_path = 0;
+	int descriptor = gl_create_temporary_file(output->path, &temporary_path);
+
+	if (descriptor < 0) {
+		return false;
+	}
+
+	FILE* file = fdopen(descriptor, "wb");
+	if (!file) {
+		gl_set_error("Cannot write %s", output->path);
+		close(descriptor);
+		unlink(temporary_path);
+		free(temporary_path);
+		return false;
+	}
+
+	bool written = output->length == fwrite(output->data, 1, output->length, file);
+	written = !fclose(file) && written;
+
+	if (written && rename(temporary_path, output->path)) {
+		written = false;
+	}
+	if (!written) {
+		gl_set_error("Cannot write %s", output->path);
+		unlink(temporary_path);
+	}
+
+	free(temporary_path);
+	return written;
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+int gl_create_temporary_file(uint8_t const* path, uint8_t** temporary_path) {
+
+	/* Process id and counter have at most 3 decimal digits per byte
+	 */
+	size_t temporary_length = strlen(path) + 2 * (strlen(".") + 3 * sizeof(unsigned long)) + 1;
+	*temporary_path = malloc(temporary_length);
+
+	size_t attempt = 0; for (; attempt < GL_OUTPUT_TEMPORARY_ATTEMPTS; ++attempt) {
+		snprintf(*temporary_path, temporary_length, "%s.%lu.%lu", path,
+			(unsigned long)getpid(),
+			(unsigned long)__sync_fetch_and_add(&gl_output_temporary_counter, 1)
+		);
+
+		/* Unlike mkstemp's private files, the process's file mode creation
+		 * mask decides the permissions like for any other new file
+		 */
+		int descriptor = open(*temporary_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+
+		if (descriptor >= 0) {
+			return descriptor;
+		} else if (EEXIST != errno) {
+			break;
+		}
+	}
+
+	gl_set_error("Cannot create temporary file for %s", path);
+	free(*temporary_path);
+	*temporary_path = 0;
+	return -1;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_output* gl_open_output(uint8_t const* directory, uint8_t const* file) {
+	struct gl_output* output = calloc(1, sizeof(struct gl_output));
+
+	size_t path_length = strlen(directory) + strlen("/") + strlen(file) + 1;
+	output->path = malloc(path_length);
+	snprintf(output->path, path_length, "%s/%s", directory, file);
+
+	output->stream = open_memstream(&output->data, &output->length);
+	if (!output->stream) {
+		gl_set_error("Cannot generate %s", output->path);
+		free(output->path);
+		free(output);
+		return 0;
+	}
+	return output;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+FILE* gl_get_output_stream(struct gl_output* output) {
+	return output->stream;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_get_output_path(struct gl_output* output) {
+	return output->path;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_set_output_volatile_line(struct gl_output* output, uint8_t const* prefix) {
+	output->volatile_prefix = prefix;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+enum gl_output_result gl_close_output(struct gl_output* output) {
+	enum gl_output_result result = GL_OUTPUT_FAILED;
+
+	FILE* stream = output->stream;
+	output->stream = 0;
+
+	if (fclose(stream)) {
+		gl_set_error("Cannot generate %s", output->path);
+		goto exit;
+	}
+
+
+	/* Keep existing file iff it already has the same contents
+	 */
+	size_t existing_length = 0;
+	uint8_t* existing = read_file(output->path, &existing_length);
+	bool unchanged = existing && equal_contents(
+		output->data, output->length,
+		existing, existing_length,
+		output->volatile_prefix
+	);
+	free(existing);
+
+	if (unchanged) {
+		result = GL_OUTPUT_UNCHANGED;
+	} else if (replace_file(output)) {
+		result = GL_OUTPUT_WRITTEN;
+	}
+
+
+	/* Free allocated resources
+	 */
+exit:
+	gl_discard_output(output);
+	return result;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_discard_output(struct gl_output* output) {
+	if (output->stream) {
+		fclose(output->stream);
+	}
+	free(output->data);
+	free(output->path);
+	free(output);
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_OUTPUT
+#define GLTOOLKIT_OUTPUT
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Opaque structures
+ */
+struct gl_output;
+
+/**
+ * Outcome of closing an output file
+ */
+enum gl_output_result {
+	GL_OUTPUT_FAILED,
+	GL_OUTPUT_UNCHANGED,
+	GL_OUTPUT_WRITTEN
+};
+
+
+
+
+
+/**
+ * Creates a new file next to `path' for replacing it by rename. The file
+ * gets the permissions of any other new file of the process
+ *
+ * @param temporary_path Receives the path of the file, which has to be freed
+ *     by the caller
+ * @return Descriptor or -1 on failure
+ */
+int gl_create_temporary_file(uint8_t const* path, uint8_t** temporary_path);
+
+/**
+ * Starts generating `file' inside `directory'. Contents are collected in
+ * memory, the file itself is not touched before gl_close_output
+ *
+ * @return Output or 0 on failure
+ */
+struct gl_output* gl_open_output(uint8_t const* directory, uint8_t const* file);
+
+/**
+ * @return Stream receiving the new contents
+ */
+FILE* gl_get_output_stream(struct gl_output* output);
+
+/**
+ * @return Path of the generated file
+ */
+uint8_t const* gl_get_output_path(struct gl_output* output);
+
+/**
+ * Ignores the line starting with `prefix' when comparing new and existing
+ * contents, e.g. a time stamp. If nothing else changed, the existing file
+ * including its line is kept
+ *
+ * @param prefix Stays referenced until the output is closed
+ */
+void gl_set_output_volatile_line(struct gl_output* output, uint8_t const* prefix);
+
+/**
+ * Replaces the file atomically iff its contents changed and frees the output
+ */
+enum gl_output_result gl_close_output(struct gl_output* output);
+
+/**
+ * Frees the output without touching the file
+ */
+void gl_discard_output(struct gl_output* output);
+
+
+
+
+
+#endif
@@ -0,0 +1,328 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <stdlib.h>
+
+#include "error.h"
+#include "gltoolkit-phf.h"
+#include "phf.h"
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * One key of the catalog
+ */
+struct phf_message {
+	uint8_t const* key;
+	size_t key_length;
+
+	uint8_t const* translation;
+	size_t translation_length;
+
+	/* Position inside the catalog, keeps the first of duplicate keys
+	 */
+	size_t index;
+
+	/* Bucket of the key and number of keys sharing it
+	 */
+	uint32_t bucket;
+	uint32_t bucket_size;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Orders messages by key, ties are broken by catalog position
+ */
+static int compare_keys(void const* a, void const* b) {
+	struct phf_message const* message_a = a;
+	struct phf_message const* message_b = b;
+	size_t length = message_a->key_length < message_b->key_length
+		? message_a->key_length : message_b->key_length
+	;
+	int order = memcmp(message_a->key, message_b->key, length);
+
+	if (order) {
+		return order;
+	}
+	if (message_a->key_length != message_b->key_length) {
+		return (message_a->key_length > message_b->key_length) - (message_a->key_length < message_b->key_length);
+	}
+	return (message_a->index > message_b->index) - (message_a->index < message_b->index);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Orders messages by descending bucket size, so the largest buckets are
+ * placed while the table is still empty. Keys of a bucket stay adjacent
+ */
+static int compare_buckets(void const* a, void const* b) {
+	struct phf_message const* message_a = a;
+	struct phf_message const* message_b = b;
+
+	if (message_a->bucket_size != message_b->bucket_size) {
+		return (message_a->bucket_size < message_b->bucket_size) - (message_a->bucket_size > message_b->bucket_size);
+	}
+	return (message_a->bucket > message_b->bucket) - (message_a->bucket < message_b->bucket);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Hash of `message' using `seed'
+ */
+static uint32_t hash_message(uint32_t seed, struct phf_message const* message) {
+	return gl_phf_hash(seed, (char const*)message->key, message->key_length);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Searches the smallest displacement placing all `size' keys of a bucket
+ * into distinct free slots and occupies them
+ *
+ * @param occupants Index + 1 of the message in every slot, 0 iff free
+ * @param slots Scratch space of `size' slots
+ * @return Displacement or -1 iff there is none
+ */
+static int32_t displace_bucket(	struct phf_message const* messages, uint32_t first,
+				uint32_t size,
+				uint32_t* occupants, uint32_t count,
+				uint32_t* slots
+		) {
+	uint32_t displacement = 1;
+
+	for (; displacement < INT32_MAX; ++displacement) {
+		uint32_t i = 0; for (; i < size; ++i) {
+			slots[i] = hash_message(displacement, &messages[first + i]) % count;
+
+			if (occupants[slots[i]]) {
+				break;
+			}
+			uint32_t j = 0; for (; j < i && slots[j] != slots[i]; ++j) {
+				;
+			}
+			if (j < i) {
+				break;
+			}
+		}
+
+		if (i == size) {
+			for (i = 0; i < size; ++i) {
+				occupants[slots[i]] = first + i + 1;
+			}
+			return displacement;
+		}
+	}
+	return -1;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes `count' native 32 bit integers
+ */
+static bool write_words(FILE* phf, void const* words, size_t count) {
+	return count == fwrite(words, sizeof(uint32_t), count, phf);
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_write_phf(	FILE* phf,
+			enum gl_phf_key key,
+			struct gl_translations* translations
+		) {
+	size_t translations_count = gl_get_translations_count(translations);
+	struct phf_message* messages = malloc((translations_count + 1) * sizeof(struct phf_message));
+	int32_t* displacements = 0;
+	uint32_t* occupants = 0;
+	uint32_t* slots = 0;
+	bool success = false;
+	size_t count = 0;
+
+	size_t i = 0; for (; i < translations_count; ++i) {
+		struct gl_translation* translation = gl_get_translation(translations, i);
+		struct phf_message message = {
+			.key = GL_PHF_LOGICAL_STRING == key
+				? gl_get_translation_logical_string(translation)
+				: gl_get_translation_master_string(translation),
+			.key_length = GL_PHF_LOGICAL_STRING == key
+				? gl_get_translation_logical_string_length(translation)
+				: gl_get_translation_master_string_length(translation),
+			.translation = gl_get_translation_string(translation),
+			.translation_length = gl_get_translation_string_length(translation),
+			.index = i
+		};
+
+		if (message.key_length && message.translation_length) {
+			messages[count++] = message;
+		}
+	}
+
+
+	/* Sort by key and drop duplicates, which could never be placed
+	 */
+	qsort(messages, count, sizeof(struct phf_message), compare_keys);
+
+	size_t unique = 0;
+	for (i = 0; i < count; ++i) {
+		if (	!unique
+		||	messages[unique - 1].key_length != messages[i].key_length
+		||	memcmp(messages[unique - 1].key, messages[i].key, messages[i].key_length)) {
+			messages[unique++] = messages[i];
+		}
+	}
+	count = unique;
+
+
+	/* Strings are referenced by 32 bit offsets
+	 */
+	uint64_t strings_offset = sizeof(struct gl_phf_header)
+		+ count * (sizeof(int32_t) + sizeof(struct gl_phf_slot))
+	;
+	uint64_t length = strings_offset;
+
+	for (i = 0; i < count; ++i) {
+		length += messages[i].key_length + messages[i].translation_length + 2;
+	}
+	if (length > UINT32_MAX) {
+		gl_set_error("Catalog of %lu translations exceeds 4 GiB", (unsigned long)count);
+		goto exit;
+	}
+
+
+	/* Group keys by bucket, largest buckets first
+	 */
+	uint32_t* bucket_sizes = calloc(count + 1, sizeof(uint32_t));
+
+	for (i = 0; i < count; ++i) {
+		messages[i].bucket = hash_message(0, &messages[i]) % count;
+		bucket_sizes[messages[i].bucket] += 1;
+	}
+	for (i = 0; i < count; ++i) {
+		messages[i].bucket_size = bucket_sizes[messages[i].bucket];
+	}
+	free(bucket_sizes);
+
+	qsort(messages, count, sizeof(struct phf_message), compare_buckets);
+
+
+	/* Buckets of several keys are displaced into free slots, single keys
+	 * take the remaining slots directly
+	 */
+	displacements = calloc(count + 1, sizeof(int32_t));
+	occupants = calloc(count + 1, sizeof(uint32_t));
+	slots = malloc((count ? messages[0].bucket_size : 1) * sizeof(uint32_t));
+	uint32_t free_slot = 0;
+
+	for (i = 0; i < count; i += messages[i].bucket_size) {
+		uint32_t size = messages[i].bucket_size;
+
+		if (size > 1) {
+			int32_t displacement = displace_bucket(messages, i, size, occupants, count, slots);
+
+			if (displacement < 0) {
+				gl_set_error("Cannot place %lu keys of one bucket", (unsigned long)size);
+				goto exit;
+			}
+			displacements[messages[i].bucket] = displacement;
+			continue;
+		}
+
+		while (occupants[free_slot]) {
+			++free_slot;
+		}
+		occupants[free_slot] = i + 1;
+		displacements[messages[i].bucket] = -(int32_t)free_slot - 1;
+	}
+
+
+	/* Header and tables, strings are stored in slot order
+	 */
+	struct gl_phf_header header = {
+		.byte_order = GL_PHF_BYTE_ORDER,
+		.count = count,
+		.displacements_offset = sizeof(struct gl_phf_header),
+		.slots_offset = sizeof(struct gl_phf_header) + count * sizeof(int32_t),
+		.strings_offset = strings_offset,
+		.length = length
+	};
+	memcpy(header.magic, GL_PHF_MAGIC, sizeof(header.magic));
+
+	success = 1 == fwrite(&header, sizeof(header), 1, phf);
+	success = success && write_words(phf, displacements, count);
+
+	uint32_t offset = strings_offset;
+	for (i = 0; success && i < count; ++i) {
+		struct phf_message const* message = &messages[occupants[i] - 1];
+		struct gl_phf_slot slot = {
+			.key_offset = offset,
+			.key_length = message->key_length,
+			.translation_offset = offset + message->key_length + 1,
+			.translation_length = message->translation_length
+		};
+		offset += message->key_length + message->translation_length + 2;
+
+		success = 1 == fwrite(&slot, sizeof(slot), 1, phf);
+	}
+
+	for (i = 0; success && i < count; ++i) {
+		struct phf_message const* message = &messages[occupants[i] - 1];
+
+		success = 1 == fwrite(message->key, message->key_length + 1, 1, phf)
+			&& 1 == fwrite(message->translation, message->translation_length + 1, 1, phf)
+		;
+	}
+
+
+	/* Free allocated resources
+	 */
+exit:
+	if (slots)		free(slots);
+	if (occupants)		free(occupants);
+	if (displacements)	free(displacements);
+	free(messages);
+
+	return success;
+}
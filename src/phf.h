@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_PHF_WRITER
+#define GLTOOLKIT_PHF_WRITER
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+
+
+/**
+ * Field of a translation used as key of a compiled catalog
+ */
+enum gl_phf_key {
+	GL_PHF_MASTER_STRING,
+	GL_PHF_LOGICAL_STRING
+};
+
+
+
+
+
+/**
+ * Writes a compiled catalog, which is read by the header only runtime in
+ * gltoolkit-phf.h. Translations with an empty key or an empty translation
+ * are skipped and of duplicate keys only the first one is kept
+ *
+ * @return false on I/O errors or iff the catalog would exceed 4 GiB
+ */
+bool gl_write_phf(	FILE* phf,
+			enum gl_phf_key key,
+			struct gl_translations* translations
+);
+
+
+
+
+
+#endif
@@ -0,0 +1,453 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <stdlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_PO_X86
+#include <immintrin.h>
+#endif
+
+#include "po.h"
+
+
+
+
+
+/**
+ * Size of the output buffer, it grows only for entries larger than this
+ */
+#ifndef GL_PO_BUFFER_LENGTH
+#define GL_PO_BUFFER_LENGTH 65536
+#endif
+
+/**
+ * Room for the fixed parts of an entry
+ */
+#define GL_PO_ENTRY_OVERHEAD 32
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Escapes `length' bytes of `source' into `destination', which has to hold
+ * at least 2 * `length' bytes
+ *
+ * @return Number of bytes written
+ */
+typedef size_t (*gl_po_escape)(uint8_t* destination, uint8_t const* source, size_t length);
+
+
+
+/**
+ * [OPAQUE API]
+ */
+struct gl_po_writer {
+	FILE* stream;
+	gl_po_escape escape;
+
+	uint8_t* buffer;
+	size_t length;
+	size_t capacity;
+
+	size_t bytes;
+	bool failed;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Second character of the escape sequence of every byte, 0 for bytes which
+ * are copied verbatim
+ */
+static uint8_t const escape_table[256] = {
+	['"'] = '"',
+	['\\'] = '\\',
+	['\n'] = 'n',
+	['\t'] = 't'
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Scalar kernel, copies clean runs with memcpy
+ */
+static size_t escape_scalar(uint8_t* destination, uint8_t const* source, size_t length) {
+	uint8_t* out = destination;
+	size_t i = 0;
+
+	while (i < length) {
+		size_t run = i;
+		while (run < length && !escape_table[source[run]]) {
+			++run;
+		}
+
+		memcpy(out, &source[i], run - i);
+		out += run - i;
+		i = run;
+
+		if (i < length) {
+			out[0] = '\\';
+			out[1] = escape_table[source[i]];
+			out += 2;
+			i += 1;
+		}
+	}
+	return out - destination;
+}
+
+
+
+#ifdef GL_PO_X86
+/**
+ * [PRIVATE]
+ *
+ * SSE2 kernel, classifies 16 bytes at once and handles every special byte
+ * of a block in one pass. Since `destination' has room for twice the input,
+ * whole blocks can be stored even if only a prefix is kept: the block is
+ * stored once and the input following every escaped byte is stored again
+ * behind its escape sequence, without classifying it again
+ */
+__attribute__((target("sse2")))
+static size_t escape_sse2(uint8_t* destination, uint8_t const* source, size_t length) {
+	__m128i const quote = _mm_set1_epi8('"');
+	__m128i const backslash = _mm_set1_epi8('\\');
+	__m128i const newline = _mm_set1_epi8('\n');
+	__m128i const tab = _mm_set1_epi8('\t');
+
+	uint8_t* out = destination;
+	size_t i = 0;
+
+	while (i + 16 <= length) {
+		__m128i block = _mm_loadu_si128((__m128i const*)&source[i]);
+		__m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+			_mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, tab))
+		);
+		uint64_t mask = (unsigned)_mm_movemask_epi8(special);
+		size_t end = i + 16;
+
+		_mm_storeu_si128((__m128i*)out, block);
+
+		while (mask) {
+			size_t clean = __builtin_ctzll(mask);
+			out += clean;
+			i += clean;
+
+			out[0] = '\\';
+			out[1] = escape_table[source[i]];
+			out += 2;
+			i += 1;
+			mask >>= clean + 1;
+
+			if (i + 16 > length) {
+				return out - destination + escape_scalar(out, &source[i], length - i);
+			}
+			_mm_storeu_si128((__m128i*)out, _mm_loadu_si128((__m128i const*)&source[i]));
+		}
+
+		out += end - i;
+		i = end;
+	}
+	return out - destination + escape_scalar(out, &source[i], length - i);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * AVX2 kernel, like the SSE2 kernel but 32 bytes at once
+ */
+__attribute__((target("avx2")))
+static size_t escape_avx2(uint8_t* destination, uint8_t const* source, size_t length) {
+	__m256i const quote = _mm256_set1_epi8('"');
+	__m256i const backslash = _mm256_set1_epi8('\\');
+	__m256i const newline = _mm256_set1_epi8('\n');
+	__m256i const tab = _mm256_set1_epi8('\t');
+
+	uint8_t* out = destination;
+	size_t i = 0;
+
+	while (i + 32 <= length) {
+		__m256i block = _mm256_loadu_si256((__m256i const*)&source[i]);
+		__m256i special = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, newline), _mm256_cmpeq_epi8(block, tab))
+		);
+		uint64_t mask = (uint32_t)_mm256_movemask_epi8(special);
+		size_t end = i + 32;
+
+		_mm256_storeu_si256((__m256i*)out, block);
+
+		while (mask) {
+			size_t clean = __builtin_ctzll(mask);
+			out += clean;
+			i += clean;
+
+			out[0] = '\\';
+			out[1] = escape_table[source[i]];
+			out += 2;
+			i += 1;
+			mask >>= clean + 1;
+
+			if (i + 32 > length) {
+				return out - destination + escape_sse2(out, &source[i], length - i);
+			}
+			_mm256_storeu_si256((__m256i*)out, _mm256_loadu_si256((__m256i const*)&source[i]));
+		}
+
+		out += end - i;
+		i = end;
+	}
+	return out - destination + escape_sse2(out, &source[i], length - i);
+}
+#endif
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Implementation of `kernel' or 0 iff the CPU does not support it
+ */
+static gl_po_escape find_kernel(enum gl_po_kernel kernel) {
+	switch (kernel) {
+	case GL_PO_KERNEL_SCALAR:
+		return escape_scalar;
+
+#ifdef GL_PO_X86
+	case GL_PO_KERNEL_SSE2:
+		return __builtin_cpu_supports("sse2") ? escape_sse2 : 0;
+	case GL_PO_KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2") ? escape_avx2 : 0;
+#endif
+
+	default:
+		return 0;
+	}
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes the buffered entries to the stream
+ */
+static void flush_writer(struct gl_po_writer* writer) {
+	if (writer->length && writer->length != fwrite(writer->buffer, 1, writer->length, writer->stream)) {
+		writer->failed = true;
+	}
+	writer->length = 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Makes room for at least `length' more bytes
+ */
+static void reserve_writer(struct gl_po_writer* writer, size_t length) {
+	if (writer->length + length <= writer->capacity) {
+		return;
+	}
+	flush_writer(writer);
+
+	if (length > writer->capacity) {
+		writer->capacity = length;
+		writer->buffer = realloc(writer->buffer, writer->capacity);
+	}
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Appends `length' bytes verbatim, room has to be reserved
+ */
+static void append(struct gl_po_writer* writer, uint8_t const* data, size_t length) {
+	memcpy(&writer->buffer[writer->length], data, length);
+	writer->length += length;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Appends a comment, every line of `text' becomes a comment line
+ */
+static void append_comment(struct gl_po_writer* writer, uint8_t const* text, size_t length) {
+	append(writer, "# ", 2);
+
+	while (length) {
+		uint8_t const* line_end = memchr(text, '\n', length);
+		size_t line_length = line_end ? (size_t)(line_end - text) : length;
+
+		append(writer, text, line_length);
+		if (!line_end) {
+			break;
+		}
+
+		append(writer, "\n# ", 3);
+		text += line_length + 1;
+		length -= line_length + 1;
+	}
+	append(writer, "\n", 1);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Appends `keyword "string"' with `string' escaped
+ */
+static void append_string(	struct gl_po_writer* writer,
+				uint8_t const* keyword,
+				uint8_t const* string, size_t length
+		) {
+	append(writer, keyword, strlen(keyword));
+	append(writer, " \"", 2);
+	writer->length += writer->escape(&writer->buffer[writer->length], string, length);
+	append(writer, "\"\n", 2);
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_po_writer* gl_create_po_writer(FILE* stream) {
+	struct gl_po_writer* writer = calloc(1, sizeof(struct gl_po_writer));
+
+	writer->stream = stream;
+	writer->capacity = GL_PO_BUFFER_LENGTH;
+	writer->buffer = malloc(writer->capacity);
+
+	/* AVX2 gains little on entries of typical length and is slower than
+	 * SSE2 on some CPUs, it has to be selected explicitly
+	 */
+	enum gl_po_kernel kernel = GL_PO_KERNEL_DEFAULT;
+	while (!writer->escape) {
+		writer->escape = find_kernel(kernel--);
+	}
+	return writer;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_set_po_writer_kernel(struct gl_po_writer* writer, enum gl_po_kernel kernel) {
+	gl_po_escape escape = find_kernel(kernel);
+
+	if (!escape) {
+		return false;
+	}
+	writer->escape = escape;
+	return true;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_get_po_kernel_name(enum gl_po_kernel kernel) {
+	uint8_t const* names[] = {
+		[GL_PO_KERNEL_SCALAR] = "scalar",
+		[GL_PO_KERNEL_SSE2] = "sse2",
+		[GL_PO_KERNEL_AVX2] = "avx2"
+	};
+	return kernel < GL_PO_KERNELS ? names[kernel] : (uint8_t const*)"unknown";
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_write_po_translation(	struct gl_po_writer* writer,
+				struct gl_translation* translation
+		) {
+	size_t context_info_length = gl_get_translation_context_info_length(translation);
+	size_t master_string_length = gl_get_translation_master_string_length(translation);
+	size_t translation_length = gl_get_translation_string_length(translation);
+
+
+	/* Worst case: every comment line break and every string byte grows to
+	 * three respectively two bytes
+	 */
+	size_t length = 3 * context_info_length
+		+ 2 * master_string_length
+		+ 2 * translation_length
+		+ GL_PO_ENTRY_OVERHEAD
+	;
+	reserve_writer(writer, length);
+	size_t start = writer->length;
+
+	append_comment(writer, gl_get_translation_context_info(translation), context_info_length);
+	append_string(writer, "msgid", gl_get_translation_master_string(translation), master_string_length);
+	append_string(writer, "msgstr", gl_get_translation_string(translation), translation_length);
+	append(writer, "\n", 1);
+
+	writer->bytes += writer->length - start;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_po_writer_bytes(struct gl_po_writer* writer) {
+	return writer->bytes;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_free_po_writer(struct gl_po_writer* writer) {
+	flush_writer(writer);
+	bool success = !writer->failed;
+
+	free(writer->buffer);
+	free(writer);
+	return success;
+}
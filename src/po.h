@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_PO
+#define GLTOOLKIT_PO
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+/**
+ * Opaque structures
+ */
+struct gl_po_writer;
+
+/**
+ * Implementations of the escaping kernel
+ */
+enum gl_po_kernel {
+	GL_PO_KERNEL_SCALAR,
+	GL_PO_KERNEL_SSE2,
+	GL_PO_KERNEL_AVX2,
+	GL_PO_KERNELS
+};
+
+/**
+ * Kernel of new writers, wider kernels are not faster on every CPU
+ */
+#define GL_PO_KERNEL_DEFAULT GL_PO_KERNEL_SSE2
+
+
+
+
+
+/**
+ * Creates a writer serializing translations as po entries into a large
+ * buffer, which is written to `stream' in blocks. Uses GL_PO_KERNEL_DEFAULT
+ * or the next narrower kernel supported by the CPU
+ *
+ * @return New writer
+ */
+struct gl_po_writer* gl_create_po_writer(FILE* stream);
+
+/**
+ * Selects the escaping kernel, e.g. for benchmarks
+ *
+ * @return false iff the kernel is not supported by the CPU
+ */
+bool gl_set_po_writer_kernel(struct gl_po_writer* writer, enum gl_po_kernel kernel);
+
+/**
+ * @return Name of the kernel
+ */
+uint8_t const* gl_get_po_kernel_name(enum gl_po_kernel kernel);
+
+/**
+ * Appends one translation. Its context information becomes a comment, master
+ * string and translation become msgid and msgstr with `"', `\', newlines and
+ * tabs escaped
+ */
+void gl_write_po_translation(	struct gl_po_writer* writer,
+				struct gl_translation* translation
+);
+
+/**
+ * @return Number of bytes serialized so far
+ */
+size_t gl_get_po_writer_bytes(struct gl_po_writer* writer);
+
+/**
+ * Writes the buffer to the stream and frees the writer
+ *
+ * @return false on I/O errors
+ */
+bool gl_free_po_writer(struct gl_po_writer* writer);
+
+
+
+
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "queue.h"
+
+
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * Ring buffer of `capacity' items guarded by `lock'
+ */
+struct gl_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+
+	void** items;
+	size_t capacity;
+	size_t head;
+	size_t count;
+
+	bool closed;
+};
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_queue* gl_create_queue(size_t capacity) {
+	struct gl_queue* queue = calloc(1, sizeof(struct gl_queue));
+
+	pthread_mutex_init(&queue->lock, 0);
+	pthread_cond_init(&queue->not_empty, 0);
+	pthread_cond_init(&queue->not_full, 0);
+
+	queue->capacity = capacity ? capacity : 1;
+	queue->items = calloc(queue->capacity, sizeof(void*));
+	return queue;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_push_queue(struct gl_queue* queue, void* item) {
+	pthread_mutex_lock(&queue->lock);
+
+	while (!queue->closed && queue->count == queue->capacity) {
+		pthread_cond_wait(&queue->not_full, &queue->lock);
+	}
+
+	bool pushed = !queue->closed;
+	if (pushed) {
+		queue->items[(queue->head + queue->count) % queue->capacity] = item;
+		queue->count += 1;
+		pthread_cond_signal(&queue->not_empty);
+	}
+
+	pthread_mutex_unlock(&queue->lock);
+	return pushed;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void* gl_pop_queue(struct gl_queue* queue) {
+	pthread_mutex_lock(&queue->lock);
+
+	while (!queue->closed && !queue->count) {
+		pthread_cond_wait(&queue->not_empty, &queue->lock);
+	}
+
+	void* item = 0;
+	if (queue->count) {
+		item = queue->items[queue->head];
+		queue->head = (queue->head + 1) % queue->capacity;
+		queue->count -= 1;
+		pthread_cond_signal(&queue->not_full);
+	}
+
+	pthread_mutex_unlock(&queue->lock);
+	return item;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_close_queue(struct gl_queue* queue) {
+	pthread_mutex_lock(&queue->lock);
+
+	queue->closed = true;
+	pthread_cond_broadcast(&queue->not_empty);
+	pthread_cond_broadcast(&queue->not_full);
+
+	pthread_mutex_unlock(&queue->lock);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_queue(struct gl_queue* queue) {
+	pthread_cond_destroy(&queue->not_full);
+	pthread_cond_destroy(&queue->not_empty);
+	pthread_mutex_destroy(&queue->lock);
+
+	free(queue->items);
+	free(queue);
+}
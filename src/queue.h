@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_QUEUE
+#define GLTOOLKIT_QUEUE
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Opaque structures
+ */
+struct gl_queue;
+
+
+
+
+
+/**
+ * Creates a bounded queue connecting two stages of a pipeline. Producers
+ * block while it holds `capacity' items, which throttles a fast stage to
+ * the pace of the next one
+ *
+ * @return New, empty queue
+ */
+struct gl_queue* gl_create_queue(size_t capacity);
+
+/**
+ * Appends `item', which must not be 0, waiting for room if the queue is full
+ *
+ * @return false iff the queue has been closed, `item' was not appended then
+ */
+bool gl_push_queue(struct gl_queue* queue, void* item);
+
+/**
+ * Removes the oldest item, waiting for one if the queue is empty
+ *
+ * @return Item or 0 iff the queue has been closed and is empty
+ */
+void* gl_pop_queue(struct gl_queue* queue);
+
+/**
+ * Signals that no more items will be pushed, consumers drain the remaining
+ * items and then receive 0
+ */
+void gl_close_queue(struct gl_queue* queue);
+
+/**
+ * Frees the queue, which has to be empty and must not be used by any thread
+ */
+void gl_free_queue(struct gl_queue* queue);
+
+
+
+
+
+#endif
@@ -0,0 +1,595 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "error.h"
+#include "glstrings.h"
+#include "gltoolkit.h"
+#include "languages.h"
+#include "output.h"
+#include "translations.h"
+
+
+
+
+
+/**
+ * Identifies snapshot files and their format version
+ */
+#define GL_SNAPSHOT_MAGIC "GLSNAP01"
+
+/**
+ * Written in native byte order, so snapshots of a different byte order are
+ * detected
+ */
+#define GL_SNAPSHOT_BYTE_ORDER 0x01020304
+
+/**
+ * Alignment of all tables inside a snapshot
+ */
+#define GL_SNAPSHOT_ALIGNMENT 8
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Beginning of every snapshot. A snapshot consists of
+ *
+ *  1. this header
+ *  2. the language table, one entry per language
+ *  3. the language records
+ *  4. the translation records of every language, one after the other
+ *  5. the string pool containing all 0-terminated strings
+ *
+ * Records are stored in relative form, i.e. they reference their strings by
+ * distance instead of address, and are mapped without modification. The
+ * format uses native byte order and record layout, a snapshot can only be
+ * opened on the same kind of platform it was written on
+ */
+struct gl_snapshot_header {
+	uint8_t magic[8];
+	uint32_t byte_order;
+	uint32_t language_record_size;
+	uint32_t translation_record_size;
+	uint32_t reserved;
+
+	uint64_t length;
+	uint64_t languages_count;
+	uint64_t table_offset;
+	uint64_t languages_offset;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Location of one language's translation records
+ */
+struct gl_snapshot_entry {
+	uint64_t translations_offset;
+	uint64_t translations_count;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ */
+struct gl_snapshot {
+	void* map;
+	size_t length;
+
+	/* Views into the mapping, their structures live inside `arena'
+	 */
+	struct gl_languages* languages;
+	struct gl_translations** translations;
+	struct gl_arena* arena;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Number of translations of `translations' which may be 0
+ */
+static size_t count_translations(struct gl_translations* translations) {
+	return translations ? gl_get_translations_count(translations) : 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Length of every field of `translation' in order of
+ *     enum gl_glstrings_field
+ */
+static void field_lengths(struct gl_translation* translation, size_t* lengths) {
+	lengths[GL_GLSTRINGS_MASTER_STRING] = gl_get_translation_master_string_length(translation);
+	lengths[GL_GLSTRINGS_LOGICAL_STRING] = gl_get_translation_logical_string_length(translation);
+	lengths[GL_GLSTRINGS_CONTEXT_INFO] = gl_get_translation_context_info_length(translation);
+	lengths[GL_GLSTRINGS_TRANSLATION] = gl_get_translation_string_length(translation);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes every field of `translation' 0-terminated into the string pool
+ */
+static bool write_fields(FILE* file, struct gl_translation* translation) {
+	uint8_t const* fields[GL_GLSTRINGS_FIELDS] = {
+		[GL_GLSTRINGS_MASTER_STRING] = gl_get_translation_master_string(translation),
+		[GL_GLSTRINGS_LOGICAL_STRING] = gl_get_translation_logical_string(translation),
+		[GL_GLSTRINGS_CONTEXT_INFO] = gl_get_translation_context_info(translation),
+		[GL_GLSTRINGS_TRANSLATION] = gl_get_translation_string(translation)
+	};
+	size_t lengths[GL_GLSTRINGS_FIELDS];
+	field_lengths(translation, lengths);
+
+	size_t i = 0; for (; i < GL_GLSTRINGS_FIELDS; ++i) {
+		if (lengths[i] + 1 != fwrite(fields[i], 1, lengths[i] + 1, file)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes the snapshot to `file'. Records are written before the string pool,
+ * so the position of every string is computed in advance from the lengths
+ * of all strings written before it
+ */
+static bool write_snapshot(	FILE* file,
+				struct gl_languages* languages,
+				struct gl_translations* const* translations
+		) {
+	size_t count = gl_get_languages_count(languages);
+	size_t language_size = gl_get_language_record_size();
+	size_t translation_size = gl_get_translation_record_size();
+
+
+	/* Layout of tables and records
+	 */
+	struct gl_snapshot_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GL_SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.byte_order = GL_SNAPSHOT_BYTE_ORDER;
+	header.language_record_size = language_size;
+	header.translation_record_size = translation_size;
+	header.languages_count = count;
+	header.table_offset = sizeof(struct gl_snapshot_header);
+	header.languages_offset = header.table_offset + count * sizeof(struct gl_snapshot_entry);
+
+	uint64_t pool = header.languages_offset + count * language_size;
+	size_t i = 0; for (; i < count; ++i) {
+		pool += count_translations(translations[i]) * translation_size;
+	}
+
+	uint64_t length = pool;
+	for (i = 0; i < count; ++i) {
+		struct gl_language* language = gl_get_language(languages, i);
+		length += strlen(gl_get_language_name(language)) + 1;
+		length += strlen(gl_get_language_code(language)) + 1;
+
+		size_t j = 0; for (; j < count_translations(translations[i]); ++j) {
+			size_t lengths[GL_GLSTRINGS_FIELDS];
+			field_lengths(gl_get_translation(translations[i], j), lengths);
+
+			size_t k = 0; for (; k < GL_GLSTRINGS_FIELDS; ++k) {
+				length += lengths[k] + 1;
+			}
+		}
+	}
+	header.length = length;
+
+	if (1 != fwrite(&header, sizeof(header), 1, file)) {
+		return false;
+	}
+
+
+	/* Language table
+	 */
+	uint64_t records = header.languages_offset + count * language_size;
+	for (i = 0; i < count; ++i) {
+		struct gl_snapshot_entry entry = {
+			.translations_offset = records,
+			.translations_count = count_translations(translations[i])
+		};
+		if (1 != fwrite(&entry, sizeof(entry), 1, file)) {
+			return false;
+		}
+		records += entry.translations_count * translation_size;
+	}
+
+
+	/* Language records reference their strings at the beginning of the pool
+	 */
+	uint8_t* record = calloc(1, language_size > translation_size ? language_size : translation_size);
+	uint64_t position = header.languages_offset;
+	uint64_t string = pool;
+	bool written = true;
+
+	for (i = 0; written && i < count; ++i) {
+		struct gl_language* language = gl_get_language(languages, i);
+		uint64_t name = string;
+		uint64_t code = name + strlen(gl_get_language_name(language)) + 1;
+		string = code + strlen(gl_get_language_code(language)) + 1;
+
+		gl_set_relative_language((struct gl_language*)record,
+			(int64_t)(name - position), (int64_t)(code - position)
+		);
+		written = 1 == fwrite(record, language_size, 1, file);
+		position += language_size;
+	}
+
+
+	/* Translation records, followed by their strings in the same order
+	 */
+	for (i = 0; written && i < count; ++i) {
+		size_t j = 0; for (; written && j < count_translations(translations[i]); ++j) {
+			struct gl_translation* translation = gl_get_translation(translations[i], j);
+			size_t lengths[GL_GLSTRINGS_FIELDS];
+			int64_t offsets[GL_GLSTRINGS_FIELDS];
+			field_lengths(translation, lengths);
+
+			size_t k = 0; for (; k < GL_GLSTRINGS_FIELDS; ++k) {
+				offsets[k] = (int64_t)(string - position);
+				string += lengths[k] + 1;
+			}
+
+			gl_set_relative_translation((struct gl_translation*)record, translation, offsets);
+			written = 1 == fwrite(record, translation_size, 1, file);
+			position += translation_size;
+		}
+	}
+	free(record);
+
+	for (i = 0; written && i < count; ++i) {
+		struct gl_language* language = gl_get_language(languages, i);
+		uint8_t const* name = gl_get_language_name(language);
+		uint8_t const* code = gl_get_language_code(language);
+
+		written = strlen(name) + 1 == fwrite(name, 1, strlen(name) + 1, file)
+			&& strlen(code) + 1 == fwrite(code, 1, strlen(code) + 1, file)
+		;
+	}
+	for (i = 0; written && i < count; ++i) {
+		size_t j = 0; for (; written && j < count_translations(translations[i]); ++j) {
+			written = write_fields(file, gl_get_translation(translations[i], j));
+		}
+	}
+	return written;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff `count' records of `size' bytes starting at `offset' are
+ *     aligned and lie inside a snapshot of `length' bytes
+ */
+static bool in_bounds(uint64_t offset, uint64_t count, uint64_t size, uint64_t length) {
+	return !(offset % GL_SNAPSHOT_ALIGNMENT)
+		&& offset <= length
+		&& count <= (length - offset) / size
+	;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff the string `offset' bytes behind the record at `position'
+ *     starts inside the string pool and is 0-terminated inside the snapshot,
+ *     right after `string_length' bytes unless that is SIZE_MAX
+ */
+static bool string_in_bounds(	uint8_t const* map, uint64_t length, uint64_t pool,
+				uint64_t position, int64_t offset,
+				size_t string_length
+		) {
+	uint64_t string = position + (uint64_t)offset;
+
+	if (string < pool || string >= length) {
+		return false;
+	}
+	if (SIZE_MAX == string_length) {
+		return 0 != memchr(&map[string], 0, length - string);
+	}
+	return string_length < length - string && !map[string + string_length];
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff every record of the snapshot is in relative form and
+ *     references 0-terminated strings inside the string pool, which starts
+ *     behind the last record
+ */
+static bool check_records(	uint8_t const* map, uint64_t length,
+				struct gl_snapshot_header const* header
+		) {
+	struct gl_snapshot_entry const* table = (void const*)(map + header->table_offset);
+
+	uint64_t pool = header->languages_offset + header->languages_count * header->language_record_size;
+	size_t i = 0; for (; i < header->languages_count; ++i) {
+		uint64_t end = table[i].translations_offset + table[i].translations_count * header->translation_record_size;
+		pool = end > pool ? end : pool;
+	}
+
+	for (i = 0; i < header->languages_count; ++i) {
+		uint64_t position = header->languages_offset + i * header->language_record_size;
+		int64_t name = 0;
+		int64_t code = 0;
+
+		if (!gl_get_relative_language((void const*)(map + position), &name, &code)
+				|| !string_in_bounds(map, length, pool, position, name, SIZE_MAX)
+				|| !string_in_bounds(map, length, pool, position, code, SIZE_MAX)) {
+			return false;
+		}
+	}
+
+	for (i = 0; i < header->languages_count; ++i) {
+		size_t j = 0; for (; j < table[i].translations_count; ++j) {
+			uint64_t position = table[i].translations_offset + j * header->translation_record_size;
+			int64_t offsets[GL_GLSTRINGS_FIELDS];
+			size_t lengths[GL_GLSTRINGS_FIELDS];
+
+			if (!gl_get_relative_translation((void const*)(map + position), offsets, lengths)) {
+				return false;
+			}
+
+			size_t k = 0; for (; k < GL_GLSTRINGS_FIELDS; ++k) {
+				if (!string_in_bounds(map, length, pool, position, offsets[k], lengths[k])) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Header of the mapped snapshot or 0 if it is invalid
+ */
+static struct gl_snapshot_header const* check_snapshot(	void const* map,
+							size_t length,
+							uint8_t const* path
+		) {
+	struct gl_snapshot_header const* header = map;
+
+	if (length < sizeof(struct gl_snapshot_header)
+			|| memcmp(header->magic, GL_SNAPSHOT_MAGIC, sizeof(header->magic))) {
+		gl_set_error("%s is not a snapshot", path);
+		return 0;
+	}
+
+	if (GL_SNAPSHOT_BYTE_ORDER != header->byte_order
+			|| gl_get_language_record_size() != header->language_record_size
+			|| gl_get_translation_record_size() != header->translation_record_size) {
+		gl_set_error("Snapshot %s was written on an incompatible platform", path);
+		return 0;
+	}
+
+	if (length != header->length
+			|| !in_bounds(header->table_offset, header->languages_count, sizeof(struct gl_snapshot_entry), length)
+			|| !in_bounds(header->languages_offset, header->languages_count, header->language_record_size, length)) {
+		gl_set_error("Snapshot %s is truncated", path);
+		return 0;
+	}
+
+
+	/* Translation records of every language
+	 */
+	struct gl_snapshot_entry const* table = (void const*)((uint8_t const*)map + header->table_offset);
+
+	size_t i = 0; for (; i < header->languages_count; ++i) {
+		if (!in_bounds(table[i].translations_offset, table[i].translations_count, header->translation_record_size, length)) {
+			gl_set_error("Snapshot %s is truncated", path);
+			return 0;
+		}
+	}
+
+
+	/* Strings are read without further checks once the snapshot is open
+	 */
+	if (!check_records(map, length, header)) {
+		gl_set_error("Snapshot %s is corrupted", path);
+		return 0;
+	}
+	return header;
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_save_snapshot(	uint8_t const* path,
+			struct gl_languages* languages,
+			struct gl_translations* const* translations
+		) {
+
+	/* Snapshots are replaced atomically, processes which still map the
+	 * previous version keep reading consistent data
+	 */
+	uint8_t* temporary_path = 0;
+	int descriptor = gl_create_temporary_file(path, &temporary_path);
+
+	if (descriptor < 0) {
+		return false;
+	}
+
+	FILE* file = fdopen(descriptor, "wb");
+	if (!file) {
+		gl_set_error("Cannot write %s", path);
+		close(descriptor);
+		unlink(temporary_path);
+		free(temporary_path);
+		return false;
+	}
+
+	bool written = write_snapshot(file, languages, translations);
+	written = !fclose(file) && written;
+
+	if (written && rename(temporary_path, path)) {
+		written = false;
+	}
+	if (!written) {
+		gl_set_error("Cannot write %s", path);
+		unlink(temporary_path);
+	}
+
+	free(temporary_path);
+	return written;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_snapshot* gl_open_snapshot(uint8_t const* path) {
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0) {
+		gl_set_error("Cannot open %s", path);
+		return 0;
+	}
+
+	struct stat status;
+	if (fstat(descriptor, &status) || !status.st_size) {
+		gl_set_error("%s is not a snapshot", path);
+		close(descriptor);
+		return 0;
+	}
+
+
+	/* Pages are shared with every other process mapping the snapshot
+	 */
+	size_t length = status.st_size;
+	void* map = mmap(0, length, PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+
+	if (MAP_FAILED == map) {
+		gl_set_error("Cannot map %s", path);
+		return 0;
+	}
+
+	struct gl_snapshot_header const* header = check_snapshot(map, length, path);
+	if (!header) {
+		munmap(map, length);
+		return 0;
+	}
+
+
+	/* Only the list and catalog structures are allocated, records and
+	 * strings are used in place
+	 */
+	uint8_t const* base = map;
+	size_t count = header->languages_count;
+	struct gl_snapshot_entry const* table = (void const*)(base + header->table_offset);
+
+	struct gl_snapshot* snapshot = calloc(1, sizeof(struct gl_snapshot));
+	snapshot->map = map;
+	snapshot->length = length;
+	snapshot->arena = gl_create_arena(0);
+	snapshot->translations = gl_arena_allocate(snapshot->arena, (count + 1) * sizeof(struct gl_translations*));
+	snapshot->languages = gl_create_languages_view(
+		(struct gl_language*)(base + header->languages_offset), count
+	);
+
+	size_t i = 0; for (; i < count; ++i) {
+		snapshot->translations[i] = gl_create_translations_view(
+			snapshot->arena,
+			(struct gl_translation*)(base + table[i].translations_offset),
+			table[i].translations_count
+		);
+	}
+	return snapshot;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_languages* gl_get_snapshot_languages(struct gl_snapshot* snapshot) {
+	return snapshot->languages;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_translations* gl_get_snapshot_translations(struct gl_snapshot* snapshot, size_t n) {
+	if (n >= gl_get_languages_count(snapshot->languages)) {
+		return 0;
+	}
+
+	return snapshot->translations[n];
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_close_snapshot(struct gl_snapshot* snapshot) {
+	size_t i = 0; for (; i < gl_get_languages_count(snapshot->languages); ++i) {
+		gl_free_translations(snapshot->translations[i]);
+	}
+	gl_free_languages(snapshot->languages);
+	gl_free_arena(snapshot->arena);
+	munmap(snapshot->map, snapshot->length);
+	free(snapshot);
+}
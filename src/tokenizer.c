@@ -0,0 +1,647 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <stdlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_TOKENIZER_X86
+#include <immintrin.h>
+#endif
+
+#include "tokenizer.h"
+
+
+
+
+
+/**
+ * Entries the token array has room for initially, it doubles when full
+ */
+#ifndef GL_TOKENIZER_CAPACITY
+#define GL_TOKENIZER_CAPACITY 256
+#endif
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Finds the first occurrence of `first' or `second' between `data' and `end'
+ *
+ * @return Position of the byte found or `end'
+ */
+typedef uint8_t const* (*gl_tokenizer_scan)(	uint8_t const* data, uint8_t const* end,
+						uint8_t first, uint8_t second
+);
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Element name and its length
+ */
+struct gl_tokenizer_name {
+	uint8_t const* name;
+	size_t length;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Element names of a schema
+ */
+struct gl_tokenizer_names {
+	struct gl_tokenizer_name root;
+	struct gl_tokenizer_name entry;
+
+	/* Element in front of the entries which is skipped (optional)
+	 */
+	struct gl_tokenizer_name header;
+
+	struct gl_tokenizer_name fields[GL_TOKENIZER_FIELDS];
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Position inside the document
+ */
+struct gl_tokenizer_cursor {
+	uint8_t const* data;
+	uint8_t const* end;
+	gl_tokenizer_scan scan;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Names of all schemas, ordered like enum gl_tokenizer_schema
+ */
+#define GL_TOKENIZER_NAME(name) {name, sizeof(name) - 1}
+
+static struct gl_tokenizer_names const gl_tokenizer_schemas[] = {
+	[GL_TOKENIZER_GLSTRINGS] = {
+		.root = GL_TOKENIZER_NAME("GLStrings"),
+		.entry = GL_TOKENIZER_NAME("GLString"),
+		.header = GL_TOKENIZER_NAME("product"),
+		.fields = {
+			GL_TOKENIZER_NAME("MasterString"),
+			GL_TOKENIZER_NAME("LogicalString"),
+			GL_TOKENIZER_NAME("ContextInfo"),
+			GL_TOKENIZER_NAME("Translation")
+		}
+	},
+	[GL_TOKENIZER_LANGUAGES] = {
+		.root = GL_TOKENIZER_NAME("Languages"),
+		.entry = GL_TOKENIZER_NAME("Language"),
+		.fields = {
+			GL_TOKENIZER_NAME("Name"),
+			GL_TOKENIZER_NAME("IanaCode")
+		}
+	}
+};
+
+#undef GL_TOKENIZER_NAME
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Scalar kernel
+ */
+static uint8_t const* scan_scalar(	uint8_t const* data, uint8_t const* end,
+					uint8_t first, uint8_t second
+		) {
+	while (data < end && first != *data && second != *data) {
+		++data;
+	}
+	return data;
+}
+
+
+
+#ifdef GL_TOKENIZER_X86
+/**
+ * [PRIVATE]
+ *
+ * SSE2 kernel, compares 16 bytes at once
+ */
+__attribute__((target("sse2")))
+static uint8_t const* scan_sse2(	uint8_t const* data, uint8_t const* end,
+					uint8_t first, uint8_t second
+		) {
+	__m128i const a = _mm_set1_epi8(first);
+	__m128i const b = _mm_set1_epi8(second);
+
+	while (end - data >= 16) {
+		__m128i block = _mm_loadu_si128((__m128i const*)data);
+		unsigned mask = _mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(block, a), _mm_cmpeq_epi8(block, b))
+		);
+
+		if (mask) {
+			return data + __builtin_ctz(mask);
+		}
+		data += 16;
+	}
+	return scan_scalar(data, end, first, second);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * AVX2 kernel, like the SSE2 kernel but 32 bytes at once
+ */
+__attribute__((target("avx2")))
+static uint8_t const* scan_avx2(	uint8_t const* data, uint8_t const* end,
+					uint8_t first, uint8_t second
+		) {
+	__m256i const a = _mm256_set1_epi8(first);
+	__m256i const b = _mm256_set1_epi8(second);
+
+	while (end - data >= 32) {
+		__m256i block = _mm256_loadu_si256((__m256i const*)data);
+		unsigned mask = _mm256_movemask_epi8(
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, a), _mm256_cmpeq_epi8(block, b))
+		);
+
+		if (mask) {
+			return data + __builtin_ctz(mask);
+		}
+		data += 32;
+	}
+	return scan_sse2(data, end, first, second);
+}
+#endif
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Implementation of `kernel' or 0 iff the CPU does not support it
+ */
+static gl_tokenizer_scan find_kernel(enum gl_tokenizer_kernel kernel) {
+	switch (kernel) {
+	case GL_TOKENIZER_KERNEL_SCALAR:
+		return scan_scalar;
+
+#ifdef GL_TOKENIZER_X86
+	case GL_TOKENIZER_KERNEL_SSE2:
+		return __builtin_cpu_supports("sse2") ? scan_sse2 : 0;
+	case GL_TOKENIZER_KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2") ? scan_avx2 : 0;
+#endif
+
+	default:
+		return 0;
+	}
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff `c' is XML white space
+ */
+static bool is_space(uint8_t c) {
+	return ' ' == c || '\t' == c || '\r' == c || '\n' == c;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Skips white space between elements
+ */
+static void skip_space(struct gl_tokenizer_cursor* cursor) {
+	while (cursor->data < cursor->end && is_space(*cursor->data)) {
+		++cursor->data;
+	}
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff `name' of `length' bytes equals `expected'
+ */
+static bool is_name(	struct gl_tokenizer_name const* expected,
+			uint8_t const* name, size_t length
+		) {
+	return length == expected->length
+		&& !memcmp(expected->name, name, length)
+	;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff the cursor is at a closing tag
+ */
+static bool at_close_tag(struct gl_tokenizer_cursor* cursor) {
+	return cursor->end - cursor->data >= 2
+		&& '<' == cursor->data[0]
+		&& '/' == cursor->data[1]
+	;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Skips a byte order mark and processing instructions like <?xml ...?> in
+ * front of the root element
+ *
+ * @return false iff an instruction is not terminated
+ */
+static bool skip_prolog(struct gl_tokenizer_cursor* cursor) {
+	if (cursor->end - cursor->data >= 3 && !memcmp(cursor->data, "\xEF\xBB\xBF", 3)) {
+		cursor->data += 3;
+	}
+	skip_space(cursor);
+
+	while (cursor->end - cursor->data >= 2 && '<' == cursor->data[0] && '?' == cursor->data[1]) {
+		cursor->data = cursor->scan(cursor->data, cursor->end, '>', '>');
+
+		if (cursor->data == cursor->end) {
+			return false;
+		}
+		++cursor->data;
+		skip_space(cursor);
+	}
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Reads an opening tag. Double quoted attribute values may contain `>',
+ * single quoted ones are left to the fallback
+ *
+ * @param empty Set iff the tag is self-closing
+ * @return false iff the cursor is not at an opening tag
+ */
+static bool read_open_tag(	struct gl_tokenizer_cursor* cursor,
+				uint8_t const** name, size_t* name_length,
+				bool* empty
+		) {
+	uint8_t const* data = cursor->data;
+	uint8_t const* end = cursor->end;
+
+	if (data == end || '<' != *data) {
+		return false;
+	}
+	*name = ++data;
+
+	while (data < end && !is_space(*data) && '>' != *data && '/' != *data) {
+		++data;
+	}
+	*name_length = data - *name;
+
+	/* Rules out <!...>, <?...?> and closing tags
+	 */
+	if (!*name_length || '!' == **name || '?' == **name) {
+		return false;
+	}
+
+
+	/* Usually the name is directly followed by `>'
+	 */
+	uint8_t const* attributes = data;
+
+	while (data < end && '>' != *data) {
+		data = cursor->scan(data, end, '>', '"');
+
+		if (data < end && '"' == *data) {
+			data = cursor->scan(data + 1, end, '"', '"');
+			data += data < end;
+		}
+	}
+
+	if (data == end || memchr(attributes, '\'', data - attributes)) {
+		return false;
+	}
+
+	*empty = data > attributes && '/' == data[-1];
+	cursor->data = data + 1;
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Reads an opening tag named `name' without attributes
+ *
+ * @return false iff the cursor is not at such a tag, it is not moved then
+ */
+static bool read_plain_open_tag(	struct gl_tokenizer_cursor* cursor,
+					struct gl_tokenizer_name const* name
+		) {
+	if (	!name->length
+		|| (size_t)(cursor->end - cursor->data) < name->length + 2
+		|| '<' != cursor->data[0]
+		|| '>' != cursor->data[name->length + 1]
+		|| memcmp(&cursor->data[1], name->name, name->length)) {
+		return false;
+	}
+	cursor->data += name->length + 2;
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Reads a closing tag named `name'
+ *
+ * @return false iff the cursor is not at that closing tag
+ */
+static bool read_close_tag(	struct gl_tokenizer_cursor* cursor,
+				struct gl_tokenizer_name const* name
+		) {
+	if ((size_t)(cursor->end - cursor->data) < name->length + 3
+			|| !at_close_tag(cursor)
+			|| memcmp(&cursor->data[2], name->name, name->length)) {
+		return false;
+	}
+	cursor->data += 2 + name->length;
+	skip_space(cursor);
+
+	if (cursor->data == cursor->end || '>' != *cursor->data) {
+		return false;
+	}
+	++cursor->data;
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Reads character data up to the element's closing tag
+ *
+ * @return false iff the data is followed by anything but a closing tag,
+ *     e.g. a comment or CDATA section
+ */
+static bool read_text(struct gl_tokenizer_cursor* cursor, struct gl_token* token) {
+	uint8_t const* start = cursor->data;
+	uint8_t const* stop = cursor->scan(start, cursor->end, '<', '&');
+
+	token->escaped = stop < cursor->end && '&' == *stop;
+	if (token->escaped) {
+		stop = cursor->scan(stop, cursor->end, '<', '<');
+	}
+
+	token->data = start;
+	token->length = stop - start;
+	cursor->data = stop;
+
+	return at_close_tag(cursor);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Reads the fields of an entry up to and including its closing tag
+ *
+ * @return false iff the entry does not match the schema
+ */
+static bool read_entry(	struct gl_tokenizer_cursor* cursor,
+			struct gl_tokenizer_names const* names,
+			struct gl_token* tokens
+		) {
+	size_t expected = 0;
+
+	while (true) {
+		skip_space(cursor);
+
+		if (at_close_tag(cursor)) {
+			return read_close_tag(cursor, &names->entry);
+		}
+
+		/* Fields usually follow in schema order and without attributes
+		 */
+		struct gl_tokenizer_name const* next = &names->fields[expected];
+		size_t field = expected;
+		bool empty = false;
+
+		if (!read_plain_open_tag(cursor, next)) {
+			uint8_t const* name;
+			size_t name_length;
+
+			if (!read_open_tag(cursor, &name, &name_length, &empty)) {
+				return false;
+			}
+
+			field = 0;
+			while (field < GL_TOKENIZER_FIELDS && !is_name(&names->fields[field], name, name_length)) {
+				++field;
+			}
+
+			if (GL_TOKENIZER_FIELDS == field) {
+				return false;
+			}
+		}
+		expected = (field + 1) % GL_TOKENIZER_FIELDS;
+
+		if (!empty) {
+			if (!read_text(cursor, &tokens[field]) || !read_close_tag(cursor, &names->fields[field])) {
+				return false;
+			}
+		}
+	}
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_token* gl_tokenize(	enum gl_tokenizer_schema schema,
+				enum gl_tokenizer_kernel kernel,
+				uint8_t const* document, size_t length,
+				size_t* count
+		) {
+	struct gl_tokenizer_names const* names = &gl_tokenizer_schemas[schema];
+	struct gl_tokenizer_cursor cursor = {
+		.data = document,
+		.end = document + length,
+		.scan = find_kernel(kernel)
+	};
+
+	if (!cursor.scan) {
+		return 0;
+	}
+
+	size_t capacity = GL_TOKENIZER_CAPACITY;
+	size_t entries = 0;
+	struct gl_token* tokens = malloc(capacity * GL_TOKENIZER_FIELDS * sizeof(struct gl_token));
+
+	uint8_t const* name;
+	size_t name_length;
+	bool empty;
+
+
+	/* Root element
+	 */
+	if (!skip_prolog(&cursor)
+			|| !read_open_tag(&cursor, &name, &name_length, &empty)
+			|| !is_name(&names->root, name, name_length)) {
+		goto exit_failure;
+	}
+
+
+	/* Entries and the optional header element
+	 */
+	while (!empty) {
+		skip_space(&cursor);
+
+		if (at_close_tag(&cursor)) {
+			if (!read_close_tag(&cursor, &names->root)) {
+				goto exit_failure;
+			}
+			break;
+		}
+
+		bool entry_empty = false;
+		bool entry = read_plain_open_tag(&cursor, &names->entry);
+
+		if (!entry && !read_open_tag(&cursor, &name, &name_length, &entry_empty)) {
+			goto exit_failure;
+		}
+
+		if (entry || is_name(&names->entry, name, name_length)) {
+			if (entries == capacity) {
+				capacity *= 2;
+				tokens = realloc(tokens, capacity * GL_TOKENIZER_FIELDS * sizeof(struct gl_token));
+			}
+
+			/* Missing fields are empty
+			 */
+			struct gl_token* entry = &tokens[entries * GL_TOKENIZER_FIELDS];
+			size_t i = 0; for (; i < GL_TOKENIZER_FIELDS; ++i) {
+				entry[i] = (struct gl_token){.data = document, .length = 0, .escaped = false};
+			}
+
+			if (!entry_empty && !read_entry(&cursor, names, entry)) {
+				goto exit_failure;
+			}
+			++entries;
+
+		} else if (is_name(&names->header, name, name_length)) {
+			struct gl_token ignored;
+
+			if (!entry_empty && (!read_text(&cursor, &ignored) || !read_close_tag(&cursor, &names->header))) {
+				goto exit_failure;
+			}
+
+		} else {
+			goto exit_failure;
+		}
+	}
+
+
+	/* Nothing but white space may follow the root element
+	 */
+	skip_space(&cursor);
+	if (cursor.data != cursor.end) {
+		goto exit_failure;
+	}
+
+	*count = entries;
+	return tokens;
+
+
+	/* Document does not match the schema
+	 */
+exit_failure:
+	free(tokens);
+	return 0;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+enum gl_tokenizer_kernel gl_get_tokenizer_kernel() {
+	enum gl_tokenizer_kernel kernel = GL_TOKENIZER_KERNEL_DEFAULT;
+
+	while (!find_kernel(kernel)) {
+		--kernel;
+	}
+	return kernel;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_is_tokenizer_kernel_supported(enum gl_tokenizer_kernel kernel) {
+	return 0 != find_kernel(kernel);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_get_tokenizer_kernel_name(enum gl_tokenizer_kernel kernel) {
+	uint8_t const* names[] = {
+		[GL_TOKENIZER_KERNEL_SCALAR] = "scalar",
+		[GL_TOKENIZER_KERNEL_SSE2] = "sse2",
+		[GL_TOKENIZER_KERNEL_AVX2] = "avx2"
+	};
+	return kernel < GL_TOKENIZER_KERNELS ? names[kernel] : (uint8_t const*)"unknown";
+}
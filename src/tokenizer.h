@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_TOKENIZER
+#define GLTOOLKIT_TOKENIZER
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+
+
+/**
+ * Most fields of one entry, unused fields stay empty
+ */
+#define GL_TOKENIZER_FIELDS 4
+
+/**
+ * Document shapes understood by the tokenizer
+ *
+ *   <GLStrings><product/><GLString>             Fields are named like
+ *     <MasterString/><LogicalString/>           enum gl_glstrings_field
+ *     <ContextInfo/><Translation/>
+ *
+ *   <Languages><Language>                       Field 0 is the name, field 1
+ *     <Name/><IanaCode/>                        the iana code
+ */
+enum gl_tokenizer_schema {
+	GL_TOKENIZER_GLSTRINGS,
+	GL_TOKENIZER_LANGUAGES
+};
+
+/**
+ * Implementations of the byte scanning kernel
+ */
+enum gl_tokenizer_kernel {
+	GL_TOKENIZER_KERNEL_SCALAR,
+	GL_TOKENIZER_KERNEL_SSE2,
+	GL_TOKENIZER_KERNEL_AVX2,
+	GL_TOKENIZER_KERNELS
+};
+
+/**
+ * Kernel used by the parsers, per-tag work rather than byte scanning bounds
+ * throughput and AVX2 is slower than SSE2 on some CPUs
+ */
+#define GL_TOKENIZER_KERNEL_DEFAULT GL_TOKENIZER_KERNEL_SSE2
+
+
+
+/**
+ * Character data of one field inside the document. It is neither terminated
+ * nor entity decoded, `escaped' is set iff it contains a `&'
+ */
+struct gl_token {
+	uint8_t const* data;
+	size_t length;
+	bool escaped;
+};
+
+
+
+
+
+/**
+ * Locates all fields of a complete document in one pass without modifying
+ * it. Only the exact shape of `schema' is accepted: no comments, CDATA
+ * sections or unknown elements, so callers can fall back to a general XML
+ * parser for everything else
+ *
+ * @param count Receives the number of entries
+ * @return GL_TOKENIZER_FIELDS tokens per entry, which have to be freed, or 0
+ *     iff the document does not match `schema'
+ */
+struct gl_token* gl_tokenize(	enum gl_tokenizer_schema schema,
+				enum gl_tokenizer_kernel kernel,
+				uint8_t const* document, size_t length,
+				size_t* count
+);
+
+/**
+ * @return GL_TOKENIZER_KERNEL_DEFAULT or the next narrower kernel supported
+ *     by the CPU
+ */
+enum gl_tokenizer_kernel gl_get_tokenizer_kernel();
+
+/**
+ * @return true iff the CPU supports `kernel'
+ */
+bool gl_is_tokenizer_kernel_supported(enum gl_tokenizer_kernel kernel);
+
+/**
+ * @return Name of the kernel
+ */
+uint8_t const* gl_get_tokenizer_kernel_name(enum gl_tokenizer_kernel kernel);
+
+
+
+
+
+#endif
@@ -0,0 +1,311 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "trace.h"
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * One recorded phase
+ */
+struct gl_trace_span {
+	uint8_t const* name;
+	uint8_t* lane;
+	uint8_t* detail;
+
+	uint64_t start;
+	uint64_t duration;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ */
+struct gl_trace {
+
+	/* Spans may be added by several threads at once
+	 */
+	pthread_mutex_t lock;
+
+	struct gl_trace_span* spans;
+	size_t spans_count;
+	size_t spans_capacity;
+
+	/* Spans are reported relative to the trace's creation
+	 */
+	uint64_t origin;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Accumulated durations of one phase
+ */
+struct gl_trace_phase {
+	uint8_t const* name;
+	size_t count;
+	uint64_t total;
+	uint64_t max;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Copy of `string' or 0 if `string' is 0
+ */
+static uint8_t* copy_string(uint8_t const* string) {
+	return string ? (uint8_t*)strdup(string) : 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes `string' as JSON string literal
+ */
+static void write_json_string(FILE* stream, uint8_t const* string) {
+	fputc('"', stream);
+
+	for (; *string; ++string) {
+		if ('"' == *string || '\\' == *string) {
+			fprintf(stream, "\\%c", *string);
+		} else if (*string < 0x20) {
+			fprintf(stream, "\\u%04x", (unsigned)*string);
+		} else {
+			fputc(*string, stream);
+		}
+	}
+	fputc('"', stream);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Numbers lanes in order of their first span, 0 is the main track
+ *
+ * @param lanes Lanes seen so far, `lane' is appended if it is new
+ * @return Track of `lane'
+ */
+static size_t find_lane(uint8_t const** lanes, size_t* lanes_count, uint8_t const* lane) {
+	if (!lane) {
+		return 0;
+	}
+
+	size_t i = 0; for (; i < *lanes_count; ++i) {
+		if (!strcmp(lanes[i], lane)) {
+			return i + 1;
+		}
+	}
+
+	lanes[(*lanes_count)++] = lane;
+	return *lanes_count;
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint64_t gl_trace_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_add_trace_span(	struct gl_trace* trace,
+			uint8_t const* name,
+			uint8_t const* lane,
+			uint8_t const* detail,
+			uint64_t start, uint64_t end
+		) {
+	if (!trace) {
+		return;
+	}
+
+	uint8_t* lane_copy = copy_string(lane);
+	uint8_t* detail_copy = copy_string(detail);
+	pthread_mutex_lock(&trace->lock);
+
+	if (trace->spans_count == trace->spans_capacity) {
+		trace->spans_capacity = trace->spans_capacity ? 2 * trace->spans_capacity : 64;
+		trace->spans = realloc(trace->spans, trace->spans_capacity * sizeof(struct gl_trace_span));
+	}
+
+	struct gl_trace_span* span = &trace->spans[trace->spans_count++];
+	span->name = name;
+	span->lane = lane_copy;
+	span->detail = detail_copy;
+	span->start = start;
+	span->duration = end > start ? end - start : 0;
+
+	pthread_mutex_unlock(&trace->lock);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_trace* gl_create_trace() {
+	struct gl_trace* trace = calloc(1, sizeof(struct gl_trace));
+	pthread_mutex_init(&trace->lock, 0);
+	trace->origin = gl_trace_now();
+	return trace;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_write_trace(struct gl_trace* trace, FILE* stream) {
+	uint8_t const** lanes = calloc(trace->spans_count + 1, sizeof(uint8_t const*));
+	size_t lanes_count = 0;
+
+	fprintf(stream, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	fprintf(stream, "\t{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"%s\"}}", GLTOOLKIT_NAME);
+
+
+	/* Every span is a complete event on the track of its lane
+	 */
+	size_t i = 0; for (; i < trace->spans_count; ++i) {
+		struct gl_trace_span* span = &trace->spans[i];
+		size_t known = lanes_count;
+		size_t tid = find_lane(lanes, &lanes_count, span->lane);
+
+		if (lanes_count != known) {
+			fprintf(stream, ",\n\t{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %lu, \"args\": {\"name\": ", (unsigned long)tid);
+			write_json_string(stream, span->lane);
+			fprintf(stream, "}}");
+		}
+
+		fprintf(stream, ",\n\t{\"name\": ");
+		write_json_string(stream, span->name);
+		fprintf(stream, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %lu, \"ts\": %llu, \"dur\": %llu",
+			GLTOOLKIT_NAME,
+			(unsigned long)tid,
+			(unsigned long long)(span->start > trace->origin ? span->start - trace->origin : 0),
+			(unsigned long long)span->duration
+		);
+		if (span->detail) {
+			fprintf(stream, ", \"args\": {\"detail\": ");
+			write_json_string(stream, span->detail);
+			fprintf(stream, "}");
+		}
+		fprintf(stream, "}");
+	}
+
+	fprintf(stream, "\n]}\n");
+	free(lanes);
+	return !ferror(stream);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_print_trace_stats(struct gl_trace* trace, FILE* stream) {
+	struct gl_trace_phase* phases = calloc(trace->spans_count + 1, sizeof(struct gl_trace_phase));
+	size_t phases_count = 0;
+
+
+	/* Accumulate spans by phase in order of first appearance
+	 */
+	size_t i = 0; for (; i < trace->spans_count; ++i) {
+		struct gl_trace_span* span = &trace->spans[i];
+
+		size_t j = 0; for (; j < phases_count; ++j) {
+			if (!strcmp(phases[j].name, span->name)) {
+				break;
+			}
+		}
+		if (j == phases_count) {
+			phases[phases_count++].name = span->name;
+		}
+
+		phases[j].count += 1;
+		phases[j].total += span->duration;
+		if (span->duration > phases[j].max) {
+			phases[j].max = span->duration;
+		}
+	}
+
+
+	/* Print table
+	 */
+	fprintf(stream, "%-16s %8s %12s %12s %12s\n", "Phase", "Count", "Total ms", "Mean ms", "Max ms");
+
+	for (i = 0; i < phases_count; ++i) {
+		struct gl_trace_phase* phase = &phases[i];
+
+		fprintf(stream, "%-16s %8lu %12.3f %12.3f %12.3f\n",
+			phase->name,
+			(unsigned long)phase->count,
+			phase->total / 1e3,
+			phase->total / 1e3 / phase->count,
+			phase->max / 1e3
+		);
+	}
+	free(phases);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_trace(struct gl_trace* trace) {
+	size_t i = 0; for (; i < trace->spans_count; ++i) {
+		free(trace->spans[i].lane);
+		free(trace->spans[i].detail);
+	}
+	free(trace->spans);
+	pthread_mutex_destroy(&trace->lock);
+	free(trace);
+}
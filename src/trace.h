@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_TRACE
+#define GLTOOLKIT_TRACE
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+
+
+
+
+/**
+ * @return Monotonic time stamp in microseconds, used for all spans
+ */
+uint64_t gl_trace_now();
+
+/**
+ * Records that phase `name' took from `start' until `end'. Spans of the same
+ * `lane' are shown on the same track, so a lane should be sequential, e.g.
+ * all phases of one download
+ *
+ * @param trace Trace to record into, nothing is recorded if 0
+ * @param name Phase name, has to be a string literal
+ * @param lane Track of the span, e.g. an URL or 0 for the main track. Copied
+ * @param detail Additional information, e.g. a language code or 0. Copied
+ */
+void gl_add_trace_span(	struct gl_trace* trace,
+			uint8_t const* name,
+			uint8_t const* lane,
+			uint8_t const* detail,
+			uint64_t start, uint64_t end
+);
+
+/**
+ * @return Trace attached to the session or 0
+ */
+struct gl_trace* gl_get_session_trace(struct gl_session* session);
+
+
+
+
+
+#endif
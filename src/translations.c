@@ -20,14 +20,25 @@
  *
  *  3. This notice may not be removed or altered from any source distribution.
  */
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <curl/curl.h>
+#include <entities.h>
 #include <xml.h>
 
+#include "arena.h"
+#include "error.h"
+#include "glstrings.h"
 #include "gltoolkit.h"
 #include "http.h"
+#include "intern.h"
+#include "languages.h"
+#include "queue.h"
+#include "tokenizer.h"
+#include "trace.h"
+#include "translations.h"
 
 
 
@@ -44,6 +55,15 @@
 
 
 
+/**
+ * Content of empty fields of zero copy catalogs
+ */
+static uint8_t gl_translations_empty[1] = {0};
+
+
+
+
+
 /**
  * [OPAQUE API]
  *
@@ -54,46 +74,94 @@ struct gl_translation {
 	uint8_t* logical_string;
 	uint8_t* context_info;
 	uint8_t* translation;
+
+	size_t master_string_length;
+	size_t logical_string_length;
+	size_t context_info_length;
+	size_t translation_length;
+
+	/* If set, the string fields hold the distance of every string from the
+	 * translation itself instead of its address (see snapshots)
+	 */
+	bool relative;
 };
 
 
 
 /**
- * [OPAQUE API]
+ * [PRIVATE]
  *
- * Holds all translations in one language
+ * Slot of a translation index, `translation' is the position of the indexed
+ * translation plus one, so 0 marks an empty slot. The hash is kept to avoid
+ * comparing strings of colliding entries
  */
-struct gl_translations {
-	struct gl_translation** translations;
-	size_t translations_count;
+struct gl_translation_slot {
+	uint32_t hash;
+	uint32_t translation;
 };
 
 
 
+/**
+ * [PRIVATE]
+ *
+ * Open addressing hash table with linear probing over one field of all
+ * translations. It is built on first lookup and published by storing `slots'
+ * last, so lookups seeing `slots' also see a complete table
+ */
+struct gl_translation_index {
+	struct gl_translation_slot* slots;
+	size_t mask;
+};
+
 
 
 /**
- * [PUBLIC API]
+ * [OPAQUE API]
+ *
+ * Holds all translations in one language. The structure, all translations and
+ * their strings live inside `arena', unless the strings are views into
+ * `document'
  */
-struct gl_translations* gl_get_translations(uint8_t const* project, uint8_t const* language) {
-	struct gl_http_response* response = 0;
-	struct xml_document* document = 0;
-	struct gl_languages* languages = 0;
+struct gl_translations {
+	struct gl_translation* translations;
+	size_t translations_count;
 
+	/* Arena is freed together with the translations iff it is owned
+	 */
+	struct gl_arena* arena;
+	bool owns_arena;
 
-	/* Initialize cURL
+	/* Downloaded document referenced by zero copy catalogs (optional)
 	 */
-	CURL* curl = curl_easy_init();
-	if (!curl) {
-		fprintf(stderr, "Initializing cURL failed\n");
-		goto exit_failure;
-	}
+	uint8_t* document;
+
+	/* Lookup by master string and logical string, allocated on first use.
+	 * `lock' serializes building them, so concurrent first lookups are safe
+	 */
+	struct gl_translation_index master_index;
+	struct gl_translation_index logical_index;
+	pthread_mutex_t lock;
+};
+
+
+
 
 
+/**
+ * [PRIVATE]
+ *
+ * @return Dynamically allocated REST API URL of `project''s translations in
+ *     `language'
+ */
+static uint8_t* translations_url(	uint8_t const* project,
+					uint8_t const* language
+		) {
+
 	/* Create URL
 	 */
-	uint8_t* project_escaped = curl_easy_escape(curl, project, 0);
-	uint8_t* language_escaped = curl_easy_escape(curl, language, 0);
+	uint8_t* project_escaped = gl_escape(project);
+	uint8_t* language_escaped = gl_escape(language);
 
 	size_t url_length = 1
 		+ strlen(GET_LOCALIZATION_TRANSLATIONS_PATTERN)
@@ -101,7 +169,7 @@ struct gl_translations* gl_get_translations(uint8_t const* project, uint8_t cons
 		+ strlen(language_escaped)
 	;
 
-	uint8_t* url = alloca(url_length * sizeof(uint8_t));
+	uint8_t* url = malloc(url_length * sizeof(uint8_t));
 	snprintf(
 		url, url_length - 1,
 		GET_LOCALIZATION_TRANSLATIONS_PATTERN,
@@ -111,165 +179,1465 @@ struct gl_translations* gl_get_translations(uint8_t const* project, uint8_t cons
 
 	curl_free(project_escaped);
 	curl_free(language_escaped);
-	curl_easy_cleanup(curl);
 
+	return url;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return URLs of all `languages', free using free_translations_urls
+ */
+static uint8_t** translations_urls(	uint8_t const* project,
+					struct gl_languages* languages
+		) {
+	size_t count = gl_get_languages_count(languages);
+	uint8_t** urls = calloc(count + 1, sizeof(uint8_t*));
+
+	size_t i = 0; for (; i < count; ++i) {
+		uint8_t const* language = gl_get_language_code(gl_get_language(languages, i));
+		urls[i] = translations_url(project, language);
+	}
+	return urls;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Frees 0-terminated URL list
+ */
+static void free_translations_urls(uint8_t** urls) {
+	uint8_t** url = urls; for (; *url; ++url) {
+		free(*url);
+	}
+	free(urls);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Entity decoded copy of `string' inside `arena'
+ */
+static uint8_t* copy_xml_string(	struct gl_arena* arena,
+					struct xml_string* string,
+					size_t* decoded_length
+		) {
+	size_t length = xml_string_length(string);
+	uint8_t* copy = gl_arena_allocate_string(arena, length);
+
+	xml_string_copy(string, copy, length);
 
-	/* Download content
+	/* xml.c does not resolve entities
 	 */
-	response = gl_download(url);
-	if (!response) {
-		fprintf(stderr, "Failed downloading %s\n", url);
-		goto exit_failure;
+	*decoded_length = decode_html_entities_utf8(copy, 0);
+	return copy;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Entity decoded `string' stored once in `pool', or a copy inside
+ *     `arena' iff there is no pool. `scratch' is a reusable decoding buffer
+ *     of `scratch_length' bytes
+ */
+static uint8_t* copy_source_string(	struct gl_arena* arena,
+					struct gl_string_pool* pool,
+					uint8_t** scratch, size_t* scratch_length,
+					struct xml_string* string,
+					size_t* decoded_length
+		) {
+	if (!pool) {
+		return copy_xml_string(arena, string, decoded_length);
+	}
+
+	size_t length = xml_string_length(string);
+	if (length + 1 > *scratch_length) {
+		*scratch_length = 2 * (length + 1);
+		*scratch = realloc(*scratch, *scratch_length);
+	}
+	xml_string_copy(string, *scratch, length);
+	(*scratch)[length] = 0;
+
+	*decoded_length = decode_html_entities_utf8(*scratch, 0);
+	return (uint8_t*)gl_intern_string(pool, *scratch, *decoded_length);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Entity decoded copy of `token' inside `arena'
+ */
+static uint8_t* copy_token(	struct gl_arena* arena,
+				struct gl_token const* token,
+				size_t* decoded_length
+		) {
+	uint8_t* copy = gl_arena_copy(arena, token->data, token->length);
+
+	*decoded_length = token->escaped
+		? decode_html_entities_utf8(copy, 0)
+		: token->length
+	;
+	return copy;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Like copy_source_string but for a token. Tokens without entities are
+ * interned straight from the document
+ */
+static uint8_t* copy_source_token(	struct gl_arena* arena,
+					struct gl_string_pool* pool,
+					uint8_t** scratch, size_t* scratch_length,
+					struct gl_token const* token,
+					size_t* decoded_length
+		) {
+	if (!pool) {
+		return copy_token(arena, token, decoded_length);
+	}
+
+	if (!token->escaped) {
+		*decoded_length = token->length;
+		return (uint8_t*)gl_intern_string(pool, token->data, token->length);
+	}
+
+	if (token->length + 1 > *scratch_length) {
+		*scratch_length = 2 * (token->length + 1);
+		*scratch = realloc(*scratch, *scratch_length);
+	}
+	memcpy(*scratch, token->data, token->length);
+	(*scratch)[token->length] = 0;
+
+	*decoded_length = decode_html_entities_utf8(*scratch, 0);
+	return (uint8_t*)gl_intern_string(pool, *scratch, *decoded_length);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Address of `string', a field of `translation'
+ */
+static uint8_t const* resolve_string(	struct gl_translation const* translation,
+					uint8_t const* string
+		) {
+	return translation->relative
+		? (uint8_t const*)translation + (intptr_t)string
+		: string
+	;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Initializes `translation' with the fields of a parsed <GLString>
+ */
+static void set_translation(	struct gl_translation* translation,
+				uint8_t* const* fields,
+				size_t const* lengths
+		) {
+	translation->master_string = fields[GL_GLSTRINGS_MASTER_STRING];
+	translation->logical_string = fields[GL_GLSTRINGS_LOGICAL_STRING];
+	translation->context_info = fields[GL_GLSTRINGS_CONTEXT_INFO];
+	translation->translation = fields[GL_GLSTRINGS_TRANSLATION];
+
+	translation->master_string_length = lengths[GL_GLSTRINGS_MASTER_STRING];
+	translation->logical_string_length = lengths[GL_GLSTRINGS_LOGICAL_STRING];
+	translation->context_info_length = lengths[GL_GLSTRINGS_CONTEXT_INFO];
+	translation->translation_length = lengths[GL_GLSTRINGS_TRANSLATION];
+	translation->relative = false;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Growable list of translations referencing the document
+ */
+struct views_context {
+	struct gl_translation* translations;
+	size_t count;
+	size_t capacity;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Collects a <GLString> parsed in place
+ */
+static bool collect_view(uint8_t* const* fields, size_t const* lengths, void* context) {
+	struct views_context* views = context;
+
+	if (views->count == views->capacity) {
+		views->capacity = views->capacity ? 2 * views->capacity : 256;
+		views->translations = realloc(views->translations,
+			views->capacity * sizeof(struct gl_translation)
+		);
+	}
+
+	set_translation(&views->translations[views->count++], fields, lengths);
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Collects all <GLString> elements of `document' found by the tokenizer.
+ * Fields are terminated and decoded in place, which is safe once the whole
+ * document has been tokenized
+ *
+ * @return false iff the tokenizer does not accept the document, nothing has
+ *     been modified then
+ */
+static bool collect_tokens(	struct views_context* views,
+				uint8_t* document, size_t length
+		) {
+	size_t count = 0;
+	struct gl_token* tokens = gl_tokenize(
+		GL_TOKENIZER_GLSTRINGS, gl_get_tokenizer_kernel(),
+		document, length, &count
+	);
+
+	if (!tokens) {
+		return false;
+	}
+
+	views->capacity = count;
+	views->translations = malloc((count + 1) * sizeof(struct gl_translation));
+
+	size_t i = 0; for (; i < count; ++i) {
+		uint8_t* fields[GL_GLSTRINGS_FIELDS];
+		size_t lengths[GL_GLSTRINGS_FIELDS];
+
+		size_t j = 0; for (; j < GL_GLSTRINGS_FIELDS; ++j) {
+			struct gl_token* token = &tokens[i * GL_TOKENIZER_FIELDS + j];
+
+			if (!token->length) {
+				fields[j] = gl_translations_empty;
+				lengths[j] = 0;
+				continue;
+			}
+
+			/* Overwrites the `<' of the field's closing tag
+			 */
+			fields[j] = (uint8_t*)token->data;
+			fields[j][token->length] = 0;
+			lengths[j] = token->escaped
+				? decode_html_entities_utf8(fields[j], 0)
+				: token->length
+			;
+		}
+		collect_view(fields, lengths, views);
+	}
+
+	free(tokens);
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Builds the translation list as views into the GLStrings response, which is
+ * taken over by the catalog. `response' is freed in any case
+ *
+ * @param arena Arena to allocate the translation list in, if 0 a new arena is
+ *     created and owned by the translations
+ * @param trace Receives the parse and copy phases, may be 0
+ * @param url Used for error reporting and tracing only
+ */
+static struct gl_translations* parse_translations_in_place(
+			struct gl_http_response* response,
+			struct gl_arena* arena,
+			struct gl_trace* trace,
+			uint8_t const* url
+		) {
+	uint64_t parse_start = gl_trace_now();
+	size_t length = gl_get_response_length(response);
+	uint8_t* document = gl_release_response_data(response);
+	gl_free_response(response);
+
+
+	/* Terminate and decode all fields inside the document. Documents the
+	 * tokenizer does not accept go through the incremental parser
+	 */
+	struct views_context views = {0};
+	bool parsed = collect_tokens(&views, document, length);
+
+	if (!parsed) {
+		struct gl_glstrings_parser* parser = gl_create_glstrings_parser(
+			collect_view, &views, true
+		);
+		parsed = gl_feed_glstrings_parser(parser, document, length)
+			&& gl_finish_glstrings_parser(parser)
+		;
+		gl_free_glstrings_parser(parser);
+	}
+
+	if (!parsed) {
+		gl_set_error("Failed parsing response from %s", url);
+		free(views.translations);
+		free(document);
+		return 0;
 	}
 
+	uint64_t copy_start = gl_trace_now();
+	gl_add_trace_span(trace, "parse", url, 0, parse_start, copy_start);
+
 
-	/* Parse contents
+	/* Only the translation list itself is copied into the arena
 	 */
-	document = xml_parse_document(
-		gl_get_response_data(response),
-		gl_get_response_length(response)
+	bool owns_arena = !arena;
+	if (owns_arena) {
+		arena = gl_create_arena(64
+			+ sizeof(struct gl_translations)
+			+ views.count * sizeof(struct gl_translation)
+		);
+	}
+
+	struct gl_translations* translations = gl_arena_allocate(arena, sizeof(struct gl_translations));
+	translations->translations_count = views.count;
+	translations->translations = gl_arena_allocate(arena, (views.count + 1) * sizeof(struct gl_translation));
+	translations->arena = arena;
+	translations->owns_arena = owns_arena;
+	translations->document = document;
+	translations->master_index = (struct gl_translation_index){0};
+	translations->logical_index = (struct gl_translation_index){0};
+	pthread_mutex_init(&translations->lock, 0);
+
+	memcpy(	translations->translations, views.translations,
+		views.count * sizeof(struct gl_translation)
 	);
+	free(views.translations);
+
+	gl_add_trace_span(trace, "copy", url, 0, copy_start, gl_trace_now());
+	return translations;
+}
 
-	if (!document) {
-		size_t length = gl_get_response_length(response);
-		uint8_t* buffer = alloca(length + 1);
-		memcpy(buffer, gl_get_response_data(response), length);
-		buffer[length] = 0;
 
-		fprintf(stderr, "Failed parsing response from %s: %s\n", url, buffer);
-		goto exit_failure;
+
+/**
+ * [PRIVATE]
+ *
+ * Builds the translation list from a GLStrings response. `response' is freed
+ * in any case
+ *
+ * @param arena Arena to allocate the translations in, if 0 a new arena large
+ *     enough for the whole catalog is created and owned by the translations
+ * @param zero_copy Build translations as views into the response
+ * @param pool Stores master strings, logical strings and context info of
+ *     copied translations, may be 0
+ * @param trace Receives the parse and copy phases, may be 0
+ * @param url Used for error reporting and tracing only
+ */
+static struct gl_translations* parse_translations(
+			struct gl_http_response* response,
+			struct gl_arena* arena,
+			bool zero_copy,
+			struct gl_string_pool* pool,
+			struct gl_trace* trace,
+			uint8_t const* url
+		) {
+
+	if (zero_copy) {
+		return parse_translations_in_place(response, arena, trace, url);
 	}
 
 
-	/* Build language list ... the hard way :D
+	/* Locate all fields with the tokenizer, documents of any other shape
+	 * are parsed by xml.c
 	 */
-	struct xml_node* root = xml_document_root(document);
+	uint64_t parse_start = gl_trace_now();
+	uint8_t* data = gl_get_response_data(response);
+	size_t length = gl_get_response_length(response);
+
+	size_t count = 0;
+	struct xml_document* document = 0;
+	struct xml_node* root = 0;
+	struct gl_token* tokens = gl_tokenize(
+		GL_TOKENIZER_GLSTRINGS, gl_get_tokenizer_kernel(),
+		data, length, &count
+	);
+
+	if (!tokens) {
+		document = xml_parse_document(data, length);
 
-	struct gl_translations* translations = malloc(sizeof(struct gl_translations));
-	translations->translations_count = xml_node_children(root) - 1;
-	translations->translations = calloc(translations->translations_count + 1, sizeof(struct gl_translation*));
+		if (!document) {
+			gl_set_error("Failed parsing response from %s: %.*s", url,
+				(int)(length < GL_ERROR_EXCERPT_LENGTH ? length : GL_ERROR_EXCERPT_LENGTH), data
+			);
+			gl_free_response(response);
+			return 0;
+		}
 
+		root = xml_document_root(document);
+		count = xml_node_children(root) - 1;
+	}
+
+	uint64_t copy_start = gl_trace_now();
+	gl_add_trace_span(trace, "parse", url, 0, parse_start, copy_start);
 
-	/* Skip first child, since it contains the project name
+
+	/* Strings cannot be longer than the document, so an arena of this size
+	 * holds the whole catalog in a single block. With a pool only the
+	 * translated strings are copied, which the tokens know the size of
 	 */
-	size_t i = 0; for (; i < translations->translations_count; ++i) {
-		struct xml_node* node = xml_node_child(root, i + 1);
+	bool owns_arena = !arena;
 
-		struct xml_string* xml_master = xml_node_content(xml_node_child(node, 0));
-		struct xml_string* xml_logical = xml_node_content(xml_node_child(node, 1));
-		struct xml_string* xml_context = xml_node_content(xml_node_child(node, 2));
-		struct xml_string* xml_translation = xml_node_content(xml_node_child(node, 3));
+	if (owns_arena) {
+		size_t strings = length;
 
-		struct gl_translation* translation = malloc(sizeof(struct gl_translation));
-		translation->master_string = calloc(xml_string_length(xml_master) + 1, sizeof(uint8_t));
-		translation->logical_string = calloc(xml_string_length(xml_logical) + 1, sizeof(uint8_t));
-		translation->context_info = calloc(xml_string_length(xml_context) + 1, sizeof(uint8_t));
-		translation->translation = calloc(xml_string_length(xml_translation) + 1, sizeof(uint8_t));
+		if (pool) {
+			strings = tokens ? count : 0;
 
-		xml_string_copy(xml_master, translation->master_string, xml_string_length(xml_master));
-		xml_string_copy(xml_logical, translation->logical_string, xml_string_length(xml_logical));
-		xml_string_copy(xml_context, translation->context_info, xml_string_length(xml_context));
-		xml_string_copy(xml_translation, translation->translation, xml_string_length(xml_translation));
+			size_t i = 0; for (; tokens && i < count; ++i) {
+				strings += tokens[i * GL_TOKENIZER_FIELDS + GL_GLSTRINGS_TRANSLATION].length;
+			}
+		}
 
-		translations->translations[i] = translation;
+		arena = gl_create_arena(64
+			+ sizeof(struct gl_translations)
+			+ count * sizeof(struct gl_translation)
+			+ strings
+		);
 	}
 
 
-	/* Return translations after freeing the document and the http response
+	/* Build language list ... the hard way :D
 	 */
-	xml_document_free(document, false);
-	gl_free_response(response);
-	return translations;	
+	struct gl_translations* translations = gl_arena_allocate(arena, sizeof(struct gl_translations));
+	translations->translations_count = count;
+	translations->translations = gl_arena_allocate(arena, (count + 1) * sizeof(struct gl_translation));
+	translations->arena = arena;
+	translations->owns_arena = owns_arena;
+	translations->document = 0;
+	translations->master_index = (struct gl_translation_index){0};
+	translations->logical_index = (struct gl_translation_index){0};
+	pthread_mutex_init(&translations->lock, 0);
+
+
+	/* Only the translated string differs between languages, all other
+	 * strings are shared through the pool if available
+	 */
+	uint8_t* scratch = 0;
+	size_t scratch_length = 0;
+
+	size_t i = 0; for (; tokens && i < count; ++i) {
+		struct gl_token const* fields = &tokens[i * GL_TOKENIZER_FIELDS];
+		struct gl_translation* translation = &translations->translations[i];
+
+		translation->master_string = copy_source_token(arena, pool, &scratch, &scratch_length, &fields[GL_GLSTRINGS_MASTER_STRING], &translation->master_string_length);
+		translation->logical_string = copy_source_token(arena, pool, &scratch, &scratch_length, &fields[GL_GLSTRINGS_LOGICAL_STRING], &translation->logical_string_length);
+		translation->context_info = copy_source_token(arena, pool, &scratch, &scratch_length, &fields[GL_GLSTRINGS_CONTEXT_INFO], &translation->context_info_length);
+		translation->translation = copy_token(arena, &fields[GL_GLSTRINGS_TRANSLATION], &translation->translation_length);
+		translation->relative = false;
+	}
+
+
+	/* Skip first child of the xml.c document, since it contains the
+	 * project name
+	 */
+	for (; document && i < count; ++i) {
+		struct xml_node* node = xml_node_child(root, i + 1);
+		struct gl_translation* translation = &translations->translations[i];
+
+		translation->master_string = copy_source_string(arena, pool, &scratch, &scratch_length, xml_node_content(xml_node_child(node, 0)), &translation->master_string_length);
+		translation->logical_string = copy_source_string(arena, pool, &scratch, &scratch_length, xml_node_content(xml_node_child(node, 1)), &translation->logical_string_length);
+		translation->context_info = copy_source_string(arena, pool, &scratch, &scratch_length, xml_node_content(xml_node_child(node, 2)), &translation->context_info_length);
+		translation->translation = copy_xml_string(arena, xml_node_content(xml_node_child(node, 3)), &translation->translation_length);
+		translation->relative = false;
+	}
+	free(scratch);
 
 
-	/* Free resources and return with failure
+	/* Return translations after freeing the tokens respectively the
+	 * document and the http response
 	 */
-exit_failure:
+	free(tokens);
 	if (document) {
 		xml_document_free(document, false);
 	}
-	if (response) {
-		gl_free_response(response);
-	}
-	return 0;
+	gl_free_response(response);
+
+	gl_add_trace_span(trace, "copy", url, 0, copy_start, gl_trace_now());
+	return translations;
 }
 
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * Request of gl_async_get_translations
  */
-size_t gl_get_translations_count(struct gl_translations* translations) {
-	return translations->translations_count;
-}
+struct async_translations {
+	gl_async_translations_callback callback;
+	void* context;
+
+	bool zero_copy;
+	struct gl_string_pool* pool;
+	struct gl_trace* trace;
+	uint8_t* url;
+};
 
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * Builds the catalog as soon as its download finished
  */
-struct gl_translation* gl_get_translation(struct gl_translations* translations, size_t n) {
-	if (n >= translations->translations_count) {
-		return 0;
+static void async_translations_downloaded(struct gl_http_response* response, void* context) {
+	struct async_translations* request = context;
+	struct gl_translations* translations = 0;
+
+	if (response) {
+		translations = parse_translations(
+			response, 0, request->zero_copy, request->pool, request->trace, request->url
+		);
 	}
 
-	return translations->translations[n];
+	request->callback(translations, request->context);
+	free(request->url);
+	free(request);
 }
 
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * State shared by all downloads of gl_fetch_translations
  */
-uint8_t const* gl_get_translation_master_string(struct gl_translation* translation) {
-	return translation->master_string;
-}
+struct fetch_context {
+	struct gl_languages* languages;
+	uint8_t** urls;
+	bool zero_copy;
+	struct gl_string_pool* pool;
+	struct gl_trace* trace;
+
+	gl_translations_callback callback;
+	void* context;
+};
 
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * Builds the catalog of the n-th language and records its size and how long
+ * downloading and parsing took, so later fetches can start the most
+ * expensive languages first
+ *
+ * @return Catalog or 0 iff parsing failed
  */
-uint8_t const* gl_get_translation_logical_string(struct gl_translation* translation) {
-	return translation->logical_string;
+static struct gl_translations* build_fetched_translations(
+			struct fetch_context* fetch,
+			size_t n,
+			struct gl_http_response* response
+		) {
+	size_t bytes = gl_get_response_length(response);
+	double transfer = gl_get_response_transfer_seconds(response);
+	uint64_t start = gl_trace_now();
+
+	struct gl_translations* translations = parse_translations(
+		response, 0, fetch->zero_copy, fetch->pool, fetch->trace, fetch->urls[n]
+	);
+
+	gl_set_language_measurement(fetch->languages, n, bytes,
+		transfer + (gl_trace_now() - start) / 1e6
+	);
+	return translations;
 }
 
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * Parses the n-th language's response as soon as it is available and passes
+ * the result to the user's callback
  */
-uint8_t const* gl_get_translation_context_info(struct gl_translation* translation) {
-	return translation->context_info;
+static void fetch_translations_finished(
+			size_t n,
+			struct gl_http_response* response,
+			void* context
+		) {
+	struct fetch_context* fetch = context;
+	struct gl_translations* translations = 0;
+
+	if (response) {
+		translations = build_fetched_translations(fetch, n, response);
+	}
+
+	fetch->callback(
+		gl_get_language(fetch->languages, n),
+		translations,
+		fetch->context
+	);
 }
 
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * Language passing through the stages of gl_fetch_translations_pipelined
  */
-uint8_t const* gl_get_translation_string(struct gl_translation* translation) {
-	return translation->translation;
-}
+struct pipeline_item {
+	size_t n;
+	struct gl_http_response* response;
+	struct gl_translations* translations;
+
+	/* Failure message of the stage the language failed on, the writer
+	 * restores it on its own thread for the callback (optional)
+	 */
+	uint8_t* error;
+};
 
 
 
 /**
- * [PUBLIC API]
+ * [PRIVATE]
+ *
+ * State shared by all stages of gl_fetch_translations_pipelined
  */
-void gl_free_translations(struct gl_translations* translations) {
+struct pipeline_context {
+	struct fetch_context fetch;
+
+	/* Downloaded responses respectively built catalogs
+	 */
+	struct gl_queue* responses;
+	struct gl_queue* catalogs;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Network stage, hands the n-th language's response to the parsers. Blocks
+ * while all of them are busy, which pauses the transfers
+ */
+static void pipeline_downloaded(	size_t n,
+					struct gl_http_response* response,
+					void* context
+		) {
+	struct pipeline_context* pipeline = context;
+	struct pipeline_item* item = malloc(sizeof(struct pipeline_item));
+
+	item->n = n;
+	item->response = response;
+	item->translations = 0;
+	item->error = response ? 0 : (uint8_t*)strdup(gl_get_error());
+	gl_push_queue(pipeline->responses, item);
+}
+
 
-	size_t i = 0; for (; i < translations->translations_count; ++i) {
-		struct gl_translation* translation = translations->translations[i];
 
-		free(translation->master_string);
-		free(translation->logical_string);
-		free(translation->context_info);
-		free(translation->translation);
-		free(translation);
+/**
+ * [PRIVATE]
+ *
+ * Parser thread, builds catalogs until the network stage is done
+ */
+static void* pipeline_parse(void* context) {
+	struct pipeline_context* pipeline = context;
+	struct fetch_context* fetch = &pipeline->fetch;
+	struct pipeline_item* item;
+
+	while ((item = gl_pop_queue(pipeline->responses))) {
+		if (item->response) {
+			item->translations = build_fetched_translations(fetch, item->n, item->response);
+
+			if (!item->translations) {
+				item->error = (uint8_t*)strdup(gl_get_error());
+			}
+		}
+		gl_push_queue(pipeline->catalogs, item);
 	}
+	return 0;
+}
+
 
-	free(translations->translations);
-	free(translations);
+
+/**
+ * [PRIVATE]
+ *
+ * Writer thread, passes catalogs to the user's callback until all parsers
+ * are done
+ */
+static void* pipeline_write(void* context) {
+	struct pipeline_context* pipeline = context;
+	struct fetch_context* fetch = &pipeline->fetch;
+	struct pipeline_item* item;
+
+	while ((item = gl_pop_queue(pipeline->catalogs))) {
+		if (item->error) {
+			gl_set_error("%s", item->error);
+			free(item->error);
+		}
+
+		fetch->callback(
+			gl_get_language(fetch->languages, item->n),
+			item->translations,
+			fetch->context
+		);
+		free(item);
+	}
+	return 0;
 }
 
+
+
+/**
+ * [PRIVATE]
+ *
+ * Streaming state of one language
+ */
+struct stream_language {
+	struct stream_context* stream;
+	struct gl_glstrings_parser* parser;
+
+	/* Value returned by the begin callback
+	 */
+	void* context;
+	bool begun;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * State shared by all downloads of gl_stream_translations
+ */
+struct stream_context {
+	struct gl_languages* languages;
+	uint8_t** urls;
+	struct stream_language* states;
+
+	struct gl_stream_callbacks const* callbacks;
+	void* context;
+};
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Passes a parsed <GLString> to the user's callback without copying it
+ */
+static bool stream_translation(	uint8_t* const* fields,
+				size_t const* lengths,
+				void* context
+		) {
+	struct stream_language* state = context;
+	struct gl_translation translation;
+
+	set_translation(&translation, fields, lengths);
+	return state->stream->callbacks->translation(&translation, state->context);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Starts streaming the n-th language on its first chunk
+ */
+static struct stream_language* stream_begin(struct stream_context* stream, size_t n) {
+	struct stream_language* state = &stream->states[n];
+
+	if (!state->begun) {
+		state->begun = true;
+		state->stream = stream;
+		state->parser = gl_create_glstrings_parser(stream_translation, state, false);
+		state->context = stream->callbacks->begin(
+			gl_get_language(stream->languages, n),
+			stream->context
+		);
+	}
+	return state;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Parses every chunk of the n-th language as soon as it arrives
+ */
+static bool stream_translations_data(	size_t n,
+					uint8_t const* data, size_t length,
+					void* context
+		) {
+	struct stream_language* state = stream_begin(context, n);
+
+	/* The copying parser does not modify the chunk
+	 */
+	return gl_feed_glstrings_parser(state->parser, (uint8_t*)data, length);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Completes streaming of the n-th language
+ */
+static void stream_translations_finished(
+			size_t n,
+			struct gl_http_response* response,
+			void* context
+		) {
+	struct stream_context* stream = context;
+	struct stream_language* state = stream_begin(stream, n);
+	bool success = response && gl_finish_glstrings_parser(state->parser);
+
+	/* Chunks are parsed while they arrive, so the transfer includes
+	 * parsing
+	 */
+	if (response) {
+		gl_set_language_measurement(stream->languages, n,
+			gl_get_response_length(response),
+			gl_get_response_transfer_seconds(response)
+		);
+	}
+
+	if (!response) {
+		gl_set_error("Failed downloading %s", stream->urls[n]);
+	} else if (!success) {
+		gl_set_error("Failed parsing response from %s", stream->urls[n]);
+	}
+
+	stream->callbacks->end(
+		gl_get_language(stream->languages, n),
+		success, state->context
+	);
+
+	gl_free_glstrings_parser(state->parser);
+	state->parser = 0;
+	if (response) {
+		gl_free_response(response);
+	}
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * FNV-1a hash of `length' bytes of `string'
+ */
+static uint32_t hash_string(uint8_t const* string, size_t length) {
+	uint32_t hash = 2166136261u;
+
+	size_t i = 0; for (; i < length; ++i) {
+		hash = (hash ^ string[i]) * 16777619u;
+	}
+	return hash;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Indexed field of `translation', i.e. its logical string iff
+ *     `logical' is true, otherwise its master string
+ */
+static uint8_t const* index_field(	struct gl_translation const* translation,
+					bool logical,
+					size_t* length
+		) {
+	if (logical) {
+		*length = translation->logical_string_length;
+		return resolve_string(translation, translation->logical_string);
+	}
+	*length = translation->master_string_length;
+	return resolve_string(translation, translation->master_string);
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Builds the index of the master strings or logical strings of all
+ * translations. The table is kept at most half full, so probe sequences stay
+ * short. Empty logical strings are not indexed, since they do not identify a
+ * translation. If several translations share a key, the first one is found
+ *
+ * The table is not allocated inside the arena, since the arena may be shared
+ * with catalogs looked up by other threads
+ *
+ * @return Slots of the new table, which are not published yet
+ */
+static struct gl_translation_slot* build_index(	struct gl_translations* translations,
+						bool logical,
+						size_t* mask
+		) {
+	size_t capacity = 16;
+	while (capacity < 2 * translations->translations_count) {
+		capacity *= 2;
+	}
+
+	struct gl_translation_slot* slots = calloc(capacity, sizeof(struct gl_translation_slot));
+	*mask = capacity - 1;
+
+	size_t i = 0; for (; i < translations->translations_count; ++i) {
+		size_t length = 0;
+		uint8_t const* key = index_field(&translations->translations[i], logical, &length);
+
+		if (logical && !length) {
+			continue;
+		}
+		uint32_t hash = hash_string(key, length);
+
+
+		/* Insert unless the key is already indexed
+		 */
+		size_t slot = hash & *mask;
+		for (; slots[slot].translation; slot = (slot + 1) & *mask) {
+			size_t other_length = 0;
+			uint8_t const* other = index_field(&translations->translations[slots[slot].translation - 1], logical, &other_length);
+
+			if (hash == slots[slot].hash && length == other_length && !memcmp(key, other, length)) {
+				break;
+			}
+		}
+
+		if (!slots[slot].translation) {
+			slots[slot].hash = hash;
+			slots[slot].translation = i + 1;
+		}
+	}
+	return slots;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return First translation whose master string (or logical string iff
+ *     `logical' is true) equals `key' or 0
+ */
+static struct gl_translation* find_translation(	struct gl_translations* translations,
+						bool logical,
+						uint8_t const* key
+		) {
+	struct gl_translation_index* index = logical
+		? &translations->logical_index
+		: &translations->master_index
+	;
+
+	/* Built once under the catalog's lock, afterwards lookups take no lock
+	 */
+	if (!__atomic_load_n(&index->slots, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&translations->lock);
+
+		if (!index->slots) {
+			size_t mask = 0;
+			struct gl_translation_slot* slots = build_index(translations, logical, &mask);
+
+			index->mask = mask;
+			__atomic_store_n(&index->slots, slots, __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&translations->lock);
+	}
+
+	size_t length = strlen(key);
+	uint32_t hash = hash_string(key, length);
+
+	size_t slot = hash & index->mask;
+	for (; index->slots[slot].translation; slot = (slot + 1) & index->mask) {
+		if (hash != index->slots[slot].hash) {
+			continue;
+		}
+
+		struct gl_translation* translation = &translations->translations[index->slots[slot].translation - 1];
+		size_t other_length = 0;
+		uint8_t const* other = index_field(translation, logical, &other_length);
+
+		if (length == other_length && !memcmp(key, other, length)) {
+			return translation;
+		}
+	}
+	return 0;
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_translation_record_size() {
+	return sizeof(struct gl_translation);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_set_relative_translation(	struct gl_translation* record,
+					struct gl_translation* translation,
+					int64_t const* offsets
+		) {
+	memset(record, 0, sizeof(struct gl_translation));
+
+	record->master_string = (uint8_t*)(intptr_t)offsets[GL_GLSTRINGS_MASTER_STRING];
+	record->logical_string = (uint8_t*)(intptr_t)offsets[GL_GLSTRINGS_LOGICAL_STRING];
+	record->context_info = (uint8_t*)(intptr_t)offsets[GL_GLSTRINGS_CONTEXT_INFO];
+	record->translation = (uint8_t*)(intptr_t)offsets[GL_GLSTRINGS_TRANSLATION];
+
+	record->master_string_length = translation->master_string_length;
+	record->logical_string_length = translation->logical_string_length;
+	record->context_info_length = translation->context_info_length;
+	record->translation_length = translation->translation_length;
+	record->relative = true;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_get_relative_translation(	struct gl_translation const* record,
+					int64_t* offsets,
+					size_t* lengths
+		) {
+	offsets[GL_GLSTRINGS_MASTER_STRING] = (intptr_t)record->master_string;
+	offsets[GL_GLSTRINGS_LOGICAL_STRING] = (intptr_t)record->logical_string;
+	offsets[GL_GLSTRINGS_CONTEXT_INFO] = (intptr_t)record->context_info;
+	offsets[GL_GLSTRINGS_TRANSLATION] = (intptr_t)record->translation;
+
+	lengths[GL_GLSTRINGS_MASTER_STRING] = record->master_string_length;
+	lengths[GL_GLSTRINGS_LOGICAL_STRING] = record->logical_string_length;
+	lengths[GL_GLSTRINGS_CONTEXT_INFO] = record->context_info_length;
+	lengths[GL_GLSTRINGS_TRANSLATION] = record->translation_length;
+	return record->relative;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_translations* gl_create_translations_view(
+			struct gl_arena* arena,
+			struct gl_translation* records,
+			size_t count
+		) {
+	struct gl_translations* translations = gl_arena_allocate(arena, sizeof(struct gl_translations));
+
+	translations->translations = records;
+	translations->translations_count = count;
+	translations->arena = arena;
+	translations->owns_arena = false;
+	translations->document = 0;
+	translations->master_index = (struct gl_translation_index){0};
+	translations->logical_index = (struct gl_translation_index){0};
+	pthread_mutex_init(&translations->lock, 0);
+
+	return translations;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_translations* gl_get_translations(
+			struct gl_session* session,
+			uint8_t const* project,
+			uint8_t const* language
+		) {
+	return gl_get_translations_in_arena(session, project, language, 0);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_translations* gl_get_translations_in_arena(
+			struct gl_session* session,
+			uint8_t const* project,
+			uint8_t const* language,
+			struct gl_arena* arena
+		) {
+
+	/* Create URL, download and parse content
+	 */
+	uint8_t* url = translations_url(project, language);
+	struct gl_translations* translations = 0;
+	struct gl_http_response* response = gl_download(session, url);
+
+	if (response) {
+		translations = parse_translations(
+			response, arena,
+			gl_get_session_zero_copy(session),
+			gl_get_session_string_pool(session),
+			gl_get_session_trace(session),
+			url
+		);
+	}
+
+	free(url);
+	return translations;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_async_request* gl_async_get_translations(
+			struct gl_async* async,
+			uint8_t const* project,
+			uint8_t const* language,
+			gl_async_translations_callback callback,
+			void* context
+		) {
+	struct gl_session* session = gl_get_async_session(async);
+
+	struct async_translations* request = malloc(sizeof(struct async_translations));
+	request->callback = callback;
+	request->context = context;
+	request->zero_copy = gl_get_session_zero_copy(session);
+	request->pool = gl_get_session_string_pool(session);
+	request->trace = gl_get_session_trace(session);
+	request->url = translations_url(project, language);
+
+	struct gl_async_request* download = gl_async_download(
+		async, request->url, async_translations_downloaded, request
+	);
+
+	if (!download) {
+		free(request->url);
+		free(request);
+	}
+	return download;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_fetch_translations(	struct gl_session* session,
+				uint8_t const* project,
+				struct gl_languages* languages,
+				size_t jobs,
+				gl_translations_callback callback,
+				void* context
+		) {
+
+	/* Download all languages concurrently
+	 */
+	struct fetch_context fetch = {
+		.languages = languages,
+		.urls = translations_urls(project, languages),
+		.zero_copy = gl_get_session_zero_copy(session),
+		.pool = gl_get_session_string_pool(session),
+		.trace = gl_get_session_trace(session),
+		.callback = callback,
+		.context = context
+	};
+	size_t* order = gl_schedule_languages(languages);
+
+	bool success = gl_download_all(
+		session, (uint8_t const* const*)fetch.urls,
+		gl_get_languages_count(languages), jobs, order,
+		0, fetch_translations_finished, &fetch
+	);
+
+	free(order);
+	free_translations_urls(fetch.urls);
+	return success;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_fetch_translations_pipelined(	struct gl_session* session,
+					uint8_t const* project,
+					struct gl_languages* languages,
+					size_t jobs,
+					size_t parsers, size_t writers,
+					gl_translations_callback callback,
+					void* context
+		) {
+	struct pipeline_context pipeline = {
+		.fetch = {
+			.languages = languages,
+			.urls = translations_urls(project, languages),
+			.zero_copy = gl_get_session_zero_copy(session),
+			.pool = gl_get_session_string_pool(session),
+			.trace = gl_get_session_trace(session),
+			.callback = callback,
+			.context = context
+		},
+		.responses = gl_create_queue(parsers),
+		.catalogs = gl_create_queue(writers)
+	};
+
+
+	/* Start parsers and writers, the pipeline works with fewer threads
+	 * than requested but not without any
+	 */
+	pthread_t* threads = calloc(parsers + writers + 1, sizeof(pthread_t));
+	size_t parsers_started = 0;
+	size_t writers_started = 0;
+
+	while (parsers_started < parsers && !pthread_create(&threads[parsers_started], 0, pipeline_parse, &pipeline)) {
+		++parsers_started;
+	}
+	while (writers_started < writers && !pthread_create(&threads[parsers + writers_started], 0, pipeline_write, &pipeline)) {
+		++writers_started;
+	}
+
+	bool success = parsers_started && writers_started;
+	if (success) {
+		size_t* order = gl_schedule_languages(languages);
+
+		success = gl_download_all(
+			session, (uint8_t const* const*)pipeline.fetch.urls,
+			gl_get_languages_count(languages), jobs, order,
+			0, pipeline_downloaded, &pipeline
+		);
+		free(order);
+	} else {
+		gl_set_error("Cannot start pipeline threads");
+	}
+
+
+	/* Every stage drains its queue before the next one is closed
+	 */
+	gl_close_queue(pipeline.responses);
+	size_t i = 0; for (; i < parsers_started; ++i) {
+		pthread_join(threads[i], 0);
+	}
+
+	gl_close_queue(pipeline.catalogs);
+	for (i = 0; i < writers_started; ++i) {
+		pthread_join(threads[parsers + i], 0);
+	}
+
+	free(threads);
+	gl_free_queue(pipeline.responses);
+	gl_free_queue(pipeline.catalogs);
+	free_translations_urls(pipeline.fetch.urls);
+	return success;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+bool gl_stream_translations(	struct gl_session* session,
+				uint8_t const* project,
+				struct gl_languages* languages,
+				size_t jobs,
+				struct gl_stream_callbacks const* callbacks,
+				void* context
+		) {
+
+	/* Stream all languages concurrently, parsing every chunk on arrival
+	 */
+	size_t count = gl_get_languages_count(languages);
+	struct stream_context stream = {
+		.languages = languages,
+		.urls = translations_urls(project, languages),
+		.states = calloc(count + 1, sizeof(struct stream_language)),
+		.callbacks = callbacks,
+		.context = context
+	};
+	size_t* order = gl_schedule_languages(languages);
+
+	bool success = gl_download_all(
+		session, (uint8_t const* const*)stream.urls, count, jobs, order,
+		stream_translations_data, stream_translations_finished, &stream
+	);
+	free(order);
+
+
+	/* Free parsers of aborted languages
+	 */
+	size_t i = 0; for (; i < count; ++i) {
+		if (stream.states[i].parser) {
+			gl_free_glstrings_parser(stream.states[i].parser);
+		}
+	}
+
+	free(stream.states);
+	free_translations_urls(stream.urls);
+	return success;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_translations_count(struct gl_translations* translations) {
+	return translations->translations_count;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_translation* gl_get_translation(struct gl_translations* translations, size_t n) {
+	if (n >= translations->translations_count) {
+		return 0;
+	}
+
+	return &translations->translations[n];
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_translation* gl_find_translation_by_master(
+			struct gl_translations* translations,
+			uint8_t const* master_string
+		) {
+	return find_translation(translations, false, master_string);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct gl_translation* gl_find_translation_by_logical(
+			struct gl_translations* translations,
+			uint8_t const* logical_string
+		) {
+	if (!*logical_string) {
+		return 0;
+	}
+	return find_translation(translations, true, logical_string);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_get_translation_master_string(struct gl_translation* translation) {
+	return resolve_string(translation, translation->master_string);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_get_translation_logical_string(struct gl_translation* translation) {
+	return resolve_string(translation, translation->logical_string);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_get_translation_context_info(struct gl_translation* translation) {
+	return resolve_string(translation, translation->context_info);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+uint8_t const* gl_get_translation_string(struct gl_translation* translation) {
+	return resolve_string(translation, translation->translation);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_translation_master_string_length(struct gl_translation* translation) {
+	return translation->master_string_length;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_translation_logical_string_length(struct gl_translation* translation) {
+	return translation->logical_string_length;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_translation_context_info_length(struct gl_translation* translation) {
+	return translation->context_info_length;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t gl_get_translation_string_length(struct gl_translation* translation) {
+	return translation->translation_length;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void gl_free_translations(struct gl_translations* translations) {
+	uint8_t* document = translations->document;
+
+	free(translations->master_index.slots);
+	free(translations->logical_index.slots);
+	pthread_mutex_destroy(&translations->lock);
+
+	if (translations->owns_arena) {
+		gl_free_arena(translations->arena);
+	}
+	free(document);
+}
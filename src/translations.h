@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_TRANSLATIONS
+#define GLTOOLKIT_TRANSLATIONS
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+
+
+
+
+
+/**
+ * @return Size of a translation record in bytes
+ */
+size_t gl_get_translation_record_size();
+
+/**
+ * Stores `translation' in relative form inside `record'. Its strings are not
+ * referenced by address but by their distance from the record, so records
+ * and strings can be mapped from a file at any address
+ *
+ * @param record Room for gl_get_translation_record_size() bytes
+ * @param offsets Distance of every field's string (in order of
+ *     enum gl_glstrings_field) from `record' in bytes
+ */
+void gl_set_relative_translation(	struct gl_translation* record,
+					struct gl_translation* translation,
+					int64_t const* offsets
+);
+
+/**
+ * Reads a record written by gl_set_relative_translation, e.g. to check it
+ * before use
+ *
+ * @param offsets Receives the distance of every field's string
+ * @param lengths Receives the length of every field's string
+ * @return false iff `record' is not in relative form
+ */
+bool gl_get_relative_translation(	struct gl_translation const* record,
+					int64_t* offsets,
+					size_t* lengths
+);
+
+/**
+ * Wraps `count' consecutive translation records as catalog without copying
+ * them. The records have to outlive the catalog, which has to be freed with
+ * gl_free_translations before `arena'
+ *
+ * @param arena Receives the catalog structure, is not freed together with
+ *     the catalog
+ */
+struct gl_translations* gl_create_translations_view(
+			struct gl_arena* arena,
+			struct gl_translation* records,
+			size_t count
+);
+
+
+
+
+
+#endif
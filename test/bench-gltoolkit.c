@@ -0,0 +1,1441 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <libintl.h>
+#include <locale.h>
+#include <stdio.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <xml.h>
+
+#include "glstrings.h"
+#include "gltoolkit.h"
+#include "gltoolkit-phf.h"
+#include "http.h"
+#include "mo.h"
+#include "phf.h"
+#include "po.h"
+#include "test-server.h"
+#include "tokenizer.h"
+
+
+
+
+
+/**
+ * Number of entries in the catalog of the po suite
+ */
+#define BENCH_PO_ENTRIES 100000
+
+/**
+ * Repetitions of every po measurement, the fastest one is reported
+ */
+#define BENCH_PO_RUNS 5
+
+/**
+ * Entries of the documents of the tokenizer suite
+ */
+#define BENCH_TOKENIZER_ENTRIES 100000
+
+/**
+ * Repetitions of every tokenizer measurement, the fastest one is reported
+ */
+#define BENCH_TOKENIZER_RUNS 5
+
+/**
+ * Size of the synthetic project of the pipeline suite
+ */
+#define BENCH_PIPELINE_STRINGS 10000
+#define BENCH_PIPELINE_LANGUAGES 100
+
+/**
+ * Skewed synthetic project of the schedule suite: many small languages
+ * followed by a single large one, which is transferred over a slow link
+ */
+#define BENCH_SCHEDULE_SMALL_LANGUAGES 12
+#define BENCH_SCHEDULE_SMALL_STRINGS 500
+#define BENCH_SCHEDULE_LARGE_STRINGS 6000
+#define BENCH_SCHEDULE_BANDWIDTH (1024 * 1024)
+#define BENCH_SCHEDULE_JOBS 4
+
+/**
+ * Entries of the catalog of the phf suite
+ */
+#define BENCH_PHF_ENTRIES 100000
+
+/**
+ * Repetitions of every load measurement of the phf suite, the fastest one
+ * is reported. Every repetition loads its own copy of the catalog, since
+ * gettext never loads a domain twice
+ */
+#define BENCH_PHF_RUNS 5
+
+/**
+ * Bounds of the synthetic suite, as accepted on the command line
+ */
+#define BENCH_SYNTHETIC_MIN_STRINGS 100
+#define BENCH_SYNTHETIC_MAX_STRINGS 1000000
+#define BENCH_SYNTHETIC_MIN_LANGUAGES 1
+#define BENCH_SYNTHETIC_MAX_LANGUAGES 100
+
+/**
+ * Upper bound of a single generated <GLString> element in bytes
+ */
+#define BENCH_SYNTHETIC_ENTRY_LENGTH 1024
+
+/**
+ * Maximum number of values of --strings and --languages
+ */
+#define BENCH_SYNTHETIC_SIZES 16
+
+
+
+
+
+/**
+ * @return Monotonic time in seconds
+ */
+static double bench_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+
+/**
+ * Downloads `path' once and reports how often the response buffer had to
+ * grow and how many bytes were copied doing so
+ */
+static void bench_response_download(
+			struct gl_session* session,
+			uint8_t const* path,
+			size_t length,
+			bool chunked
+		) {
+	uint8_t url[256];
+	snprintf(url, sizeof(url), "http://127.0.0.1:%u%s", (unsigned)GLTOOLKIT_BENCH_PORT, path);
+
+	double start = bench_now();
+	struct gl_http_response* response = gl_download(session, url);
+	double duration = bench_now() - start;
+
+	if (!response || length != gl_get_response_length(response)) {
+		fprintf(stderr, "Downloading %s failed\n", url);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stdout, "{\"suite\": \"response\", \"bytes\": %lu, \"content_length\": %s, \"chunks\": %lu, \"reallocations\": %lu, \"copied_bytes\": %lu, \"seconds\": %f}\n",
+		(unsigned long)length,
+		chunked ? "false" : "true",
+		(unsigned long)gl_get_response_chunks(response),
+		(unsigned long)gl_get_response_reallocations(response),
+		(unsigned long)gl_get_response_copied_bytes(response),
+		duration
+	);
+	gl_free_response(response);
+}
+
+
+
+/**
+ * Response buffer growth for multi-megabyte payloads, with and without a
+ * Content-Length announced by the server
+ */
+static void bench_response(struct test_server* server, struct gl_session* session) {
+	size_t megabytes[] = {1, 4, 16, 64};
+
+	size_t i = 0; for (; i < sizeof(megabytes) / sizeof(megabytes[0]); ++i) {
+		size_t length = megabytes[i] << 20;
+		uint8_t* body = malloc(length);
+		memset(body, 'x', length);
+
+		uint8_t path[64];
+		uint8_t path_chunked[64];
+		snprintf(path, sizeof(path), "/response/%lu", (unsigned long)length);
+		snprintf(path_chunked, sizeof(path_chunked), "/response/%lu/chunked", (unsigned long)length);
+
+		test_server_add(server, path, body, length);
+		test_server_add_chunked(server, path_chunked, body, length);
+		free(body);
+
+		bench_response_download(session, path, length, false);
+		bench_response_download(session, path_chunked, length, true);
+	}
+}
+
+
+
+
+
+/**
+ * Serializes `translations' like gltoolkit did before the po writer, i.e.
+ * with one fprintf call per line and without escaping
+ *
+ * @return Number of bytes written
+ */
+static size_t bench_po_fprintf(FILE* po, struct gl_translations* translations) {
+	size_t bytes = 0;
+
+	size_t i = 0; for (; i < gl_get_translations_count(translations); ++i) {
+		struct gl_translation* translation = gl_get_translation(translations, i);
+
+		bytes += fprintf(po, "# %s\n", gl_get_translation_context_info(translation));
+		bytes += fprintf(po, "msgid \"%s\"\n", gl_get_translation_master_string(translation));
+		bytes += fprintf(po, "msgstr \"%s\"\n", gl_get_translation_string(translation));
+		bytes += fprintf(po, "\n");
+	}
+	return bytes;
+}
+
+
+
+/**
+ * Serializes `translations' using the po writer with `kernel'
+ *
+ * @return Number of bytes written or 0 iff `kernel' is not supported
+ */
+static size_t bench_po_writer(	FILE* po,
+				struct gl_translations* translations,
+				enum gl_po_kernel kernel
+		) {
+	struct gl_po_writer* writer = gl_create_po_writer(po);
+	if (!gl_set_po_writer_kernel(writer, kernel)) {
+		gl_free_po_writer(writer);
+		return 0;
+	}
+
+	size_t i = 0; for (; i < gl_get_translations_count(translations); ++i) {
+		gl_write_po_translation(writer, gl_get_translation(translations, i));
+	}
+
+	size_t bytes = gl_get_po_writer_bytes(writer);
+	gl_free_po_writer(writer);
+	return bytes;
+}
+
+
+
+/**
+ * Reports the fastest of BENCH_PO_RUNS serializations of `translations' with
+ * `kernel', GL_PO_KERNELS selects the fprintf path
+ */
+static void bench_po_kernel(	FILE* po,
+				struct gl_translations* translations,
+				enum gl_po_kernel kernel
+		) {
+	double fastest = 0;
+	size_t bytes = 0;
+
+	size_t run = 0; for (; run < BENCH_PO_RUNS; ++run) {
+		double start = bench_now();
+		bytes = GL_PO_KERNELS == kernel
+			? bench_po_fprintf(po, translations)
+			: bench_po_writer(po, translations, kernel)
+		;
+		double duration = bench_now() - start;
+
+		if (!bytes) {
+			return;
+		}
+		if (!run || duration < fastest) {
+			fastest = duration;
+		}
+	}
+
+	fprintf(stdout, "{\"suite\": \"po\", \"kernel\": \"%s\", \"entries\": %lu, \"bytes\": %lu, \"seconds\": %f, \"mb_per_second\": %f}\n",
+		GL_PO_KERNELS == kernel ? (uint8_t const*)"fprintf" : gl_get_po_kernel_name(kernel),
+		(unsigned long)gl_get_translations_count(translations),
+		(unsigned long)bytes,
+		fastest,
+		bytes / fastest / 1e6
+	);
+}
+
+
+
+/**
+ * Po serialization throughput of the fprintf path and of the po writer with
+ * every escaping kernel the CPU supports
+ */
+static void bench_po(struct test_server* server, struct gl_session* session) {
+	size_t capacity = 512 * BENCH_PO_ENTRIES;
+	uint8_t* body = malloc(capacity);
+	size_t length = snprintf(body, capacity, "<GLStrings>\n\t<product>bench</product>\n");
+
+
+	/* Mostly clean text with a few characters which have to be escaped
+	 */
+	size_t i = 0; for (; i < BENCH_PO_ENTRIES; ++i) {
+		length += snprintf(&body[length], capacity - length,
+			"\t<GLString>\n"
+			"\t\t<MasterString>Weapon %lu fires &quot;%s&quot; bullets at the approaching monsters</MasterString>\n"
+			"\t\t<LogicalString>weapon_%lu</LogicalString>\n"
+			"\t\t<ContextInfo>../src/game/objects/weapons.cpp:%lu ../src/game/GameController.cpp:%lu</ContextInfo>\n"
+			"\t\t<Translation>Waffe %lu feuert &quot;%s&quot; Kugeln auf die herannahenden Monster\\</Translation>\n"
+			"\t</GLString>\n",
+			(unsigned long)i, i % 2 ? "explosive" : "piercing",
+			(unsigned long)i,
+			(unsigned long)i, (unsigned long)(3 * i),
+			(unsigned long)i, i % 2 ? "explosive" : "durchschlagende"
+		);
+	}
+	length += snprintf(&body[length], capacity - length, "</GLStrings>\n");
+
+	test_server_add(server, "/strings/bench/de", body, length);
+	free(body);
+
+	struct gl_translations* translations = gl_get_translations(session, "bench", "de");
+	FILE* po = fopen("/dev/null", "wb");
+
+	if (!translations || !po) {
+		fprintf(stderr, "Cannot prepare po suite\n");
+		exit(EXIT_FAILURE);
+	}
+
+
+	/* fprintf path first, then every kernel
+	 */
+	bench_po_kernel(po, translations, GL_PO_KERNELS);
+
+	enum gl_po_kernel kernel = GL_PO_KERNEL_SCALAR;
+	for (; kernel < GL_PO_KERNELS; ++kernel) {
+		bench_po_kernel(po, translations, kernel);
+	}
+
+	fclose(po);
+	gl_free_translations(translations);
+}
+
+
+
+
+
+/**
+ * Words of generated strings, some of them have to be XML escaped
+ */
+static uint8_t const* bench_words[] = {
+	"the", "monster", "weapon", "fires", "&quot;explosive&quot;", "bullets",
+	"at", "level", "player", "health", "Save", "&amp;", "quit", "game",
+	"options", "controls", "sound", "volume", "difficulty", "&lt;none&gt;",
+	"approaching", "wave", "score", "highscore", "bonus", "time"
+};
+
+
+
+/**
+ * Timing of one phase of the synthetic suite, summed over all languages
+ */
+struct bench_phase {
+	uint8_t const* name;
+	size_t bytes;
+	size_t strings;
+	double seconds;
+};
+
+
+
+/**
+ * Linear congruential generator, so fixtures are identical on every run
+ *
+ * @return Next pseudo random number of `state'
+ */
+static uint32_t bench_random(uint32_t* state) {
+	*state = *state * 1103515245 + 12345;
+	return *state >> 16;
+}
+
+
+
+/**
+ * @return IANA like code of the n-th synthetic language, e.g. `ab'
+ */
+static void bench_language_code(uint8_t* code, size_t n) {
+	code[0] = 'a' + n / 26;
+	code[1] = 'a' + n % 26;
+	code[2] = 0;
+}
+
+
+
+/**
+ * Appends 1 to 12 random words to `buffer'
+ *
+ * @return Number of bytes appended
+ */
+static size_t bench_append_words(uint8_t* buffer, uint32_t* state) {
+	size_t words = 1 + bench_random(state) % 12;
+	size_t length = 0;
+
+	size_t i = 0; for (; i < words; ++i) {
+		length += sprintf(&buffer[length], "%s%s",
+			i ? " " : "",
+			bench_words[bench_random(state) % (sizeof(bench_words) / sizeof(bench_words[0]))]
+		);
+	}
+	return length;
+}
+
+
+
+/**
+ * Generates a GLStrings document of the project `synthetic' containing
+ * `strings' entries in the n-th synthetic language
+ *
+ * @return Document, has to be freed by the caller
+ */
+static uint8_t* bench_generate_glstrings(size_t strings, size_t n, size_t* length) {
+	size_t capacity = 64 + strings * BENCH_SYNTHETIC_ENTRY_LENGTH;
+	uint8_t* body = malloc(capacity);
+
+	/* Source strings are the same in every language, like in a real
+	 * project, only translations depend on the language
+	 */
+	uint32_t source = 1;
+	uint32_t state = 2 + n;
+
+	uint8_t code[3];
+	bench_language_code(code, n);
+
+	*length = sprintf(body, "<GLStrings>\n\t<product>synthetic</product>\n");
+
+	size_t i = 0; for (; i < strings; ++i) {
+		*length += sprintf(&body[*length], "\t<GLString>\n\t\t<MasterString>");
+		*length += bench_append_words(&body[*length], &source);
+
+		*length += i % 3
+			? sprintf(&body[*length], "</MasterString>\n\t\t<LogicalString>key_%lu</LogicalString>\n", (unsigned long)i)
+			: sprintf(&body[*length], "</MasterString>\n\t\t<LogicalString></LogicalString>\n")
+		;
+		*length += sprintf(&body[*length],
+			"\t\t<ContextInfo>../src/module%lu.cpp:%lu</ContextInfo>\n"
+			"\t\t<Translation>[%s] ",
+			(unsigned long)(bench_random(&source) % 100),
+			(unsigned long)(bench_random(&source) % 10000),
+			code
+		);
+		*length += bench_append_words(&body[*length], &state);
+		*length += sprintf(&body[*length], "</Translation>\n\t</GLString>\n");
+	}
+
+	*length += sprintf(&body[*length], "</GLStrings>\n");
+	return body;
+}
+
+
+
+/**
+ * Registers project `synthetic' with `languages' languages of `strings'
+ * entries each
+ *
+ * @return Number of bytes served
+ */
+static size_t bench_serve_synthetic(	struct test_server* server,
+					size_t strings,
+					size_t languages
+		) {
+	size_t capacity = 64 + languages * 128;
+	uint8_t* body = malloc(capacity);
+	size_t length = snprintf(body, capacity, "<Languages>\n");
+	size_t bytes = 0;
+
+	size_t n = 0; for (; n < languages; ++n) {
+		uint8_t code[3];
+		bench_language_code(code, n);
+
+		length += snprintf(&body[length], capacity - length,
+			"\t<Language>\n"
+			"\t\t<Name>Synthetic %s</Name>\n"
+			"\t\t<IanaCode>%s</IanaCode>\n"
+			"\t</Language>\n",
+			code, code
+		);
+
+		uint8_t path[64];
+		snprintf(path, sizeof(path), "/strings/synthetic/%s", code);
+
+		size_t glstrings_length = 0;
+		uint8_t* glstrings = bench_generate_glstrings(strings, n, &glstrings_length);
+		test_server_add(server, path, glstrings, glstrings_length);
+		free(glstrings);
+
+		bytes += glstrings_length;
+	}
+	length += snprintf(&body[length], capacity - length, "</Languages>\n");
+
+	test_server_add(server, "/languages/synthetic", body, length);
+	free(body);
+	return bytes + length;
+}
+
+
+
+/**
+ * Accepts every element, the GLStrings parser counts them itself
+ */
+static bool bench_count_glstring(	__attribute__((unused)) uint8_t* const* fields,
+					__attribute__((unused)) size_t const* lengths,
+					__attribute__((unused)) void* context
+		) {
+	return true;
+}
+
+
+
+/**
+ * Resets the peak resident set size of the process, iff supported by the
+ * kernel. Otherwise bench_peak_rss reports the peak since process start
+ */
+static void bench_reset_peak_rss() {
+	FILE* clear_refs = fopen("/proc/self/clear_refs", "w");
+
+	if (clear_refs) {
+		fputs("5", clear_refs);
+		fclose(clear_refs);
+	}
+}
+
+
+
+/**
+ * @return Value of the field of /proc/self/status matched by `format' or -1
+ *     iff not available
+ */
+static long bench_status_kb(char const* format) {
+	FILE* status = fopen("/proc/self/status", "r");
+	long value = -1;
+
+	if (status) {
+		char line[256];
+		while (value < 0 && fgets(line, sizeof(line), status)) {
+			sscanf(line, format, &value);
+		}
+		fclose(status);
+	}
+	return value;
+}
+
+
+
+/**
+ * @return Peak resident set size in KiB since the last call of
+ *     bench_reset_peak_rss
+ */
+static long bench_peak_rss() {
+	long peak = bench_status_kb("VmHWM: %ld kB");
+
+	if (peak < 0) {
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		peak = usage.ru_maxrss;
+	}
+	return peak;
+}
+
+
+
+/**
+ * Reports the throughput of one phase
+ */
+static void bench_report_phase(	struct bench_phase const* phase,
+				size_t strings,
+				size_t languages
+		) {
+	double seconds = phase->seconds > 0 ? phase->seconds : 1e-9;
+
+	fprintf(stdout, "{\"suite\": \"synthetic\", \"phase\": \"%s\", \"strings\": %lu, \"languages\": %lu, \"bytes\": %lu, \"seconds\": %f, \"mb_per_second\": %f, \"strings_per_second\": %f}\n",
+		phase->name,
+		(unsigned long)strings,
+		(unsigned long)languages,
+		(unsigned long)phase->bytes,
+		phase->seconds,
+		phase->bytes / seconds / 1e6,
+		phase->strings / seconds
+	);
+}
+
+
+
+/**
+ * Catalogs of all languages kept by the intern measurement
+ */
+struct bench_catalogs {
+	struct gl_languages* languages;
+	struct gl_translations** catalogs;
+};
+
+
+
+/**
+ * Keeps the catalog of `language' until all languages are fetched
+ */
+static void bench_keep_catalog(	struct gl_language* language,
+				struct gl_translations* translations,
+				void* context
+		) {
+	struct bench_catalogs* kept = context;
+
+	size_t i = 0; for (; i < gl_get_languages_count(kept->languages); ++i) {
+		if (language == gl_get_language(kept->languages, i)) {
+			kept->catalogs[i] = translations;
+		}
+	}
+}
+
+
+
+/**
+ * Keeps the catalogs of all languages in memory at once, with every catalog
+ * holding its own source strings and with all catalogs sharing them through
+ * a string pool, and reports the peak memory of both
+ */
+static void bench_synthetic_intern(	struct gl_session* session,
+					struct gl_languages* list,
+					size_t strings,
+					size_t languages
+		) {
+	size_t pooled = 0; for (; pooled < 2; ++pooled) {
+		struct gl_string_pool* pool = pooled ? gl_create_string_pool() : 0;
+		struct bench_catalogs kept = {
+			.languages = list,
+			.catalogs = calloc(languages, sizeof(struct gl_translations*))
+		};
+		gl_set_session_string_pool(session, pool);
+		bench_reset_peak_rss();
+
+		if (!gl_fetch_translations(session, "synthetic", list, 4, bench_keep_catalog, &kept)) {
+			fprintf(stderr, "Fetching synthetic catalogs failed\n");
+			exit(EXIT_FAILURE);
+		}
+		long peak_rss = bench_peak_rss();
+		long rss = bench_status_kb("VmRSS: %ld kB");
+
+		fprintf(stdout, "{\"suite\": \"synthetic\", \"phase\": \"intern\", \"strings\": %lu, \"languages\": %lu, \"pool\": %s, \"rss_kb\": %ld, \"peak_rss_kb\": %ld, \"pool_bytes\": %lu, \"saved_bytes\": %lu}\n",
+			(unsigned long)strings,
+			(unsigned long)languages,
+			pool ? "true" : "false",
+			rss, peak_rss,
+			(unsigned long)(pool ? gl_get_string_pool_bytes(pool) : 0),
+			(unsigned long)(pool ? gl_get_string_pool_saved_bytes(pool) : 0)
+		);
+
+		size_t i = 0; for (; i < languages; ++i) {
+			if (!kept.catalogs[i]) {
+				fprintf(stderr, "Missing synthetic catalog\n");
+				exit(EXIT_FAILURE);
+			}
+			gl_free_translations(kept.catalogs[i]);
+		}
+		free(kept.catalogs);
+
+		gl_set_session_string_pool(session, 0);
+		if (pool) {
+			gl_free_string_pool(pool);
+		}
+	}
+}
+
+
+
+/**
+ * Fetches every language of project `synthetic' phase by phase: the raw
+ * download, a pass of the GLStrings parser, building the catalog (the time
+ * gl_get_translations_in_arena spends beyond its transfer), looking up every
+ * master string and writing the catalog as po file. Finally the memory of
+ * all catalogs with and without a shared string pool is compared
+ */
+static void bench_synthetic_run(	struct test_server* server,
+					struct gl_session* session,
+					size_t strings,
+					size_t languages
+		) {
+	size_t fixture_bytes = bench_serve_synthetic(server, strings, languages);
+	bench_reset_peak_rss();
+
+	struct bench_phase download = {"download", 0, 0, 0};
+	struct bench_phase parse = {"parse", 0, 0, 0};
+	struct bench_phase catalog = {"catalog", 0, 0, 0};
+	struct bench_phase lookup = {"lookup", 0, 0, 0};
+	struct bench_phase po = {"po", 0, 0, 0};
+
+	struct gl_languages* list = gl_get_languages(session, "synthetic");
+	struct gl_arena* arena = gl_create_arena(0);
+	FILE* null = fopen("/dev/null", "wb");
+
+	if (!list || languages != gl_get_languages_count(list) || !null) {
+		fprintf(stderr, "Cannot prepare synthetic suite\n");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t n = 0; for (; n < languages; ++n) {
+		uint8_t const* code = gl_get_language_code(gl_get_language(list, n));
+
+		uint8_t url[256];
+		snprintf(url, sizeof(url), GET_LOCALIZATION_TRANSLATIONS_PATTERN, "synthetic", code);
+
+
+		/* Raw download
+		 */
+		double start = bench_now();
+		struct gl_http_response* response = gl_download(session, url);
+		download.seconds += bench_now() - start;
+
+		if (!response) {
+			fprintf(stderr, "Downloading %s failed\n", url);
+			exit(EXIT_FAILURE);
+		}
+		download.bytes += gl_get_response_length(response);
+		download.strings += strings;
+
+
+		/* Tokenizing and entity decoding without building a catalog
+		 */
+		start = bench_now();
+		struct gl_glstrings_parser* parser = gl_create_glstrings_parser(bench_count_glstring, 0, false);
+		bool parsed = gl_feed_glstrings_parser(parser, gl_get_response_data(response), gl_get_response_length(response))
+			&& gl_finish_glstrings_parser(parser)
+		;
+		size_t count = gl_get_glstrings_parser_count(parser);
+		gl_free_glstrings_parser(parser);
+		parse.seconds += bench_now() - start;
+
+		if (!parsed || strings != count) {
+			fprintf(stderr, "Parsing %s failed\n", url);
+			exit(EXIT_FAILURE);
+		}
+		size_t document_length = gl_get_response_length(response);
+		parse.bytes += document_length;
+		parse.strings += strings;
+		gl_free_response(response);
+
+
+		/* Catalog build, the transfer itself is not accounted for
+		 */
+		double transfer = gl_get_session_transfer_seconds(session);
+		start = bench_now();
+		struct gl_translations* translations = gl_get_translations_in_arena(session, "synthetic", code, arena);
+		catalog.seconds += bench_now() - start - (gl_get_session_transfer_seconds(session) - transfer);
+
+		if (!translations || strings != gl_get_translations_count(translations)) {
+			fprintf(stderr, "Building catalog of %s failed\n", code);
+			exit(EXIT_FAILURE);
+		}
+		catalog.bytes += document_length;
+		catalog.strings += strings;
+
+
+		/* Lookup of every master string, including building the index
+		 */
+		start = bench_now();
+		size_t i = 0; for (; i < strings; ++i) {
+			struct gl_translation* translation = gl_get_translation(translations, i);
+
+			if (!gl_find_translation_by_master(translations, gl_get_translation_master_string(translation))) {
+				fprintf(stderr, "Lookup in catalog of %s failed\n", code);
+				exit(EXIT_FAILURE);
+			}
+		}
+		lookup.seconds += bench_now() - start;
+		lookup.bytes += document_length;
+		lookup.strings += strings;
+
+
+		/* Po serialization with the best kernel available
+		 */
+		start = bench_now();
+		struct gl_po_writer* writer = gl_create_po_writer(null);
+
+		for (i = 0; i < strings; ++i) {
+			gl_write_po_translation(writer, gl_get_translation(translations, i));
+		}
+		po.bytes += gl_get_po_writer_bytes(writer);
+		gl_free_po_writer(writer);
+		po.seconds += bench_now() - start;
+		po.strings += strings;
+
+		gl_free_translations(translations);
+		gl_reset_arena(arena);
+	}
+
+	bench_report_phase(&download, strings, languages);
+	bench_report_phase(&parse, strings, languages);
+	bench_report_phase(&catalog, strings, languages);
+	bench_report_phase(&lookup, strings, languages);
+	bench_report_phase(&po, strings, languages);
+
+	fprintf(stdout, "{\"suite\": \"synthetic\", \"phase\": \"memory\", \"strings\": %lu, \"languages\": %lu, \"fixture_bytes\": %lu, \"peak_rss_kb\": %ld}\n",
+		(unsigned long)strings,
+		(unsigned long)languages,
+		(unsigned long)fixture_bytes,
+		bench_peak_rss()
+	);
+	bench_synthetic_intern(session, list, strings, languages);
+
+	fclose(null);
+	gl_free_arena(arena);
+	gl_free_languages(list);
+	test_server_clear(server);
+}
+
+
+
+/**
+ * Runs the synthetic suite for every combination of `strings' and
+ * `languages'
+ */
+static void bench_synthetic(	struct test_server* server,
+				struct gl_session* session,
+				size_t const* strings, size_t strings_count,
+				size_t const* languages, size_t languages_count
+		) {
+	size_t i = 0; for (; i < strings_count; ++i) {
+		size_t j = 0; for (; j < languages_count; ++j) {
+			bench_synthetic_run(server, session, strings[i], languages[j]);
+		}
+	}
+}
+
+
+
+
+
+/**
+ * Walks every field of `document' with xml.c like the fallback paths of
+ * translations.c and languages.c, skipping the first `skip' children of the
+ * root element
+ *
+ * @return Number of entries or 0 iff parsing failed
+ */
+static size_t bench_tokenizer_xml(	uint8_t* document, size_t length,
+					size_t skip, size_t fields
+		) {
+	struct xml_document* xml = xml_parse_document(document, length);
+	if (!xml) {
+		return 0;
+	}
+
+	struct xml_node* root = xml_document_root(xml);
+	size_t count = xml_node_children(root) - skip;
+	size_t bytes = 0;
+
+	size_t i = 0; for (; i < count; ++i) {
+		struct xml_node* node = xml_node_child(root, i + skip);
+
+		size_t j = 0; for (; j < fields; ++j) {
+			bytes += xml_string_length(xml_node_content(xml_node_child(node, j)));
+		}
+	}
+
+	xml_document_free(xml, false);
+	return bytes ? count : 0;
+}
+
+
+
+/**
+ * Reports the fastest of BENCH_TOKENIZER_RUNS passes over `document' with
+ * the tokenizer `kernel', GL_TOKENIZER_KERNELS selects xml.c
+ */
+static void bench_tokenizer_kernel(	uint8_t const* name,
+					enum gl_tokenizer_schema schema,
+					uint8_t* document, size_t length,
+					enum gl_tokenizer_kernel kernel
+		) {
+	double fastest = 0;
+	size_t count = 0;
+
+	size_t run = 0; for (; run < BENCH_TOKENIZER_RUNS; ++run) {
+		double start = bench_now();
+
+		if (GL_TOKENIZER_KERNELS == kernel) {
+			count = GL_TOKENIZER_GLSTRINGS == schema
+				? bench_tokenizer_xml(document, length, 1, GL_TOKENIZER_FIELDS)
+				: bench_tokenizer_xml(document, length, 0, 2)
+			;
+		} else {
+			free(gl_tokenize(schema, kernel, document, length, &count));
+		}
+		double duration = bench_now() - start;
+
+		if (!run || duration < fastest) {
+			fastest = duration;
+		}
+	}
+
+	if (BENCH_TOKENIZER_ENTRIES != count) {
+		fprintf(stderr, "Tokenizing %s document failed\n", name);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stdout, "{\"suite\": \"tokenizer\", \"schema\": \"%s\", \"kernel\": \"%s\", \"entries\": %lu, \"bytes\": %lu, \"seconds\": %f, \"mb_per_second\": %f}\n",
+		name,
+		GL_TOKENIZER_KERNELS == kernel ? (uint8_t const*)"xml.c" : gl_get_tokenizer_kernel_name(kernel),
+		(unsigned long)count,
+		(unsigned long)length,
+		fastest,
+		length / fastest / 1e6
+	);
+}
+
+
+
+/**
+ * Locating all fields of large GLStrings and Languages documents with xml.c
+ * and with every tokenizer kernel the CPU supports
+ */
+static void bench_tokenizer() {
+	size_t glstrings_length = 0;
+	uint8_t* glstrings = bench_generate_glstrings(BENCH_TOKENIZER_ENTRIES, 0, &glstrings_length);
+
+	size_t capacity = 64 + 128 * BENCH_TOKENIZER_ENTRIES;
+	uint8_t* languages = malloc(capacity);
+	size_t languages_length = sprintf(languages, "<Languages>\n");
+
+	size_t i = 0; for (; i < BENCH_TOKENIZER_ENTRIES; ++i) {
+		languages_length += sprintf(&languages[languages_length],
+			"\t<Language>\n"
+			"\t\t<Name>Synthetic language %lu</Name>\n"
+			"\t\t<IanaCode>x-%lu</IanaCode>\n"
+			"\t</Language>\n",
+			(unsigned long)i, (unsigned long)i
+		);
+	}
+	languages_length += sprintf(&languages[languages_length], "</Languages>\n");
+
+
+	/* xml.c first, then every kernel
+	 */
+	bench_tokenizer_kernel("glstrings", GL_TOKENIZER_GLSTRINGS, glstrings, glstrings_length, GL_TOKENIZER_KERNELS);
+	bench_tokenizer_kernel("languages", GL_TOKENIZER_LANGUAGES, languages, languages_length, GL_TOKENIZER_KERNELS);
+
+	enum gl_tokenizer_kernel kernel = GL_TOKENIZER_KERNEL_SCALAR;
+	for (; kernel < GL_TOKENIZER_KERNELS; ++kernel) {
+		if (gl_is_tokenizer_kernel_supported(kernel)) {
+			bench_tokenizer_kernel("glstrings", GL_TOKENIZER_GLSTRINGS, glstrings, glstrings_length, kernel);
+			bench_tokenizer_kernel("languages", GL_TOKENIZER_LANGUAGES, languages, languages_length, kernel);
+		}
+	}
+	free(glstrings);
+	free(languages);
+}
+
+
+
+
+/**
+ * Writes the catalog of one language as po file and discards it, like the
+ * writer stage of gltoolkit does
+ */
+static void bench_pipeline_write(	struct gl_language* language,
+					struct gl_translations* translations,
+					void* context
+		) {
+	size_t* written = context;
+	FILE* null = fopen("/dev/null", "wb");
+
+	if (!translations || !null) {
+		fprintf(stderr, "Pipelined fetch of %s failed\n", gl_get_language_code(language));
+		exit(EXIT_FAILURE);
+	}
+
+	struct gl_po_writer* writer = gl_create_po_writer(null);
+	size_t i = 0; for (; i < gl_get_translations_count(translations); ++i) {
+		gl_write_po_translation(writer, gl_get_translation(translations, i));
+	}
+	gl_free_po_writer(writer);
+	fclose(null);
+
+	__sync_fetch_and_add(written, gl_get_translations_count(translations));
+	gl_free_translations(translations);
+}
+
+
+
+/**
+ * Fetches, parses and writes all languages of a synthetic project through
+ * the pipeline with an increasing number of parser and writer threads
+ */
+static void bench_pipeline(struct test_server* server, struct gl_session* session) {
+	bench_serve_synthetic(server, BENCH_PIPELINE_STRINGS, BENCH_PIPELINE_LANGUAGES);
+
+	struct gl_languages* list = gl_get_languages(session, "synthetic");
+	if (!list || BENCH_PIPELINE_LANGUAGES != gl_get_languages_count(list)) {
+		fprintf(stderr, "Cannot prepare pipeline suite\n");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t const threads[] = {1, 2, 4};
+	size_t i = 0; for (; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+		size_t written = 0;
+
+		double start = bench_now();
+		bool fetched = gl_fetch_translations_pipelined(session, "synthetic", list, 4, threads[i], threads[i], bench_pipeline_write, &written);
+		double seconds = bench_now() - start;
+
+		if (!fetched || BENCH_PIPELINE_STRINGS * BENCH_PIPELINE_LANGUAGES != written) {
+			fprintf(stderr, "Pipelined fetch of synthetic project failed\n");
+			exit(EXIT_FAILURE);
+		}
+
+		fprintf(stdout, "{\"suite\": \"pipeline\", \"strings\": %lu, \"languages\": %lu, \"parsers\": %lu, \"writers\": %lu, \"cpus\": %ld, \"seconds\": %.6f, \"strings_per_second\": %.0f}\n",
+			(unsigned long)BENCH_PIPELINE_STRINGS,
+			(unsigned long)BENCH_PIPELINE_LANGUAGES,
+			(unsigned long)threads[i],
+			(unsigned long)threads[i],
+			sysconf(_SC_NPROCESSORS_ONLN),
+			seconds,
+			written / seconds
+		);
+	}
+
+	gl_free_languages(list);
+	test_server_clear(server);
+}
+
+
+
+
+
+/**
+ * Discards a fetched catalog
+ */
+static void bench_schedule_discard(	struct gl_language* language,
+					struct gl_translations* translations,
+					__attribute__((unused)) void* context
+		) {
+	if (!translations) {
+		fprintf(stderr, "Fetch of %s failed\n", gl_get_language_code(language));
+		exit(EXIT_FAILURE);
+	}
+	gl_free_translations(translations);
+}
+
+
+
+/**
+ * Fetches a skewed project once in list order, which starts the large
+ * language last, and once largest first using the durations measured by the
+ * first run as costs
+ */
+static void bench_schedule(struct test_server* server, struct gl_session* session) {
+	size_t const count = BENCH_SCHEDULE_SMALL_LANGUAGES + 1;
+	size_t capacity = 64 + count * 128;
+	uint8_t* body = malloc(capacity);
+	size_t length = snprintf(body, capacity, "<Languages>\n");
+
+	size_t n = 0; for (; n < count; ++n) {
+		uint8_t code[3];
+		bench_language_code(code, n);
+
+		length += snprintf(&body[length], capacity - length,
+			"\t<Language>\n"
+			"\t\t<Name>Synthetic %s</Name>\n"
+			"\t\t<IanaCode>%s</IanaCode>\n"
+			"\t</Language>\n",
+			code, code
+		);
+
+		uint8_t path[64];
+		snprintf(path, sizeof(path), "/strings/synthetic/%s", code);
+
+		size_t glstrings_length = 0;
+		uint8_t* glstrings = bench_generate_glstrings(n < BENCH_SCHEDULE_SMALL_LANGUAGES
+			? BENCH_SCHEDULE_SMALL_STRINGS
+			: BENCH_SCHEDULE_LARGE_STRINGS,
+			n, &glstrings_length
+		);
+		test_server_add(server, path, glstrings, glstrings_length);
+		free(glstrings);
+	}
+	length += snprintf(&body[length], capacity - length, "</Languages>\n");
+	test_server_add(server, "/languages/synthetic", body, length);
+	free(body);
+
+	struct gl_languages* list = gl_get_languages(session, "synthetic");
+	if (!list || count != gl_get_languages_count(list)) {
+		fprintf(stderr, "Cannot prepare schedule suite\n");
+		exit(EXIT_FAILURE);
+	}
+	test_server_limit_bandwidth(server, BENCH_SCHEDULE_BANDWIDTH);
+
+	uint8_t const* const orders[] = {"list", "largest_first"};
+	size_t i = 0; for (; i < sizeof(orders) / sizeof(orders[0]); ++i) {
+		double start = bench_now();
+		bool fetched = gl_fetch_translations(session, "synthetic", list, BENCH_SCHEDULE_JOBS, bench_schedule_discard, 0);
+		double seconds = bench_now() - start;
+
+		if (!fetched) {
+			fprintf(stderr, "Fetch of skewed project failed\n");
+			exit(EXIT_FAILURE);
+		}
+
+		size_t bytes = 0;
+		for (n = 0; n < count; ++n) {
+			bytes += gl_get_language_bytes(list, n);
+			gl_set_language_cost(list, n, gl_get_language_seconds(list, n));
+		}
+
+		fprintf(stdout, "{\"suite\": \"schedule\", \"order\": \"%s\", \"languages\": %lu, \"jobs\": %lu, \"bytes\": %lu, \"bandwidth\": %lu, \"seconds\": %.6f}\n",
+			orders[i],
+			(unsigned long)count,
+			(unsigned long)BENCH_SCHEDULE_JOBS,
+			(unsigned long)bytes,
+			(unsigned long)BENCH_SCHEDULE_BANDWIDTH,
+			seconds
+		);
+	}
+
+	test_server_limit_bandwidth(server, 0);
+	gl_free_languages(list);
+	test_server_clear(server);
+}
+
+
+
+
+
+/**
+ * Reports load time and lookup latency of one catalog format
+ */
+static void bench_phf_report(	uint8_t const* format,
+				size_t bytes,
+				double load_seconds,
+				double lookup_seconds
+		) {
+	fprintf(stdout, "{\"suite\": \"phf\", \"format\": \"%s\", \"entries\": %lu, \"bytes\": %lu, \"load_us\": %.1f, \"lookup_ns\": %.1f}\n",
+		format,
+		(unsigned long)BENCH_PHF_ENTRIES,
+		(unsigned long)bytes,
+		load_seconds * 1e6,
+		lookup_seconds / BENCH_PHF_ENTRIES * 1e9
+	);
+}
+
+
+
+/**
+ * Writes `translations' as mo catalog respectively compiled catalog
+ *
+ * @return Size of the catalog in bytes
+ */
+static size_t bench_phf_write(uint8_t const* path, bool mo, struct gl_translations* translations) {
+	FILE* file = fopen(path, "wb");
+	bool written = file && (mo
+		? gl_write_mo(file, "Content-Type: text/plain; charset=UTF-8\n", translations)
+		: gl_write_phf(file, GL_PHF_MASTER_STRING, translations)
+	);
+
+	if (!written) {
+		fprintf(stderr, "Cannot write %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+	size_t bytes = ftell(file);
+	fclose(file);
+	return bytes;
+}
+
+
+
+/**
+ * Load time and lookup latency of compiled catalogs compared to mo catalogs
+ * loaded by glibc's gettext. Keys are looked up in random order
+ */
+static void bench_phf(struct test_server* server, struct gl_session* session) {
+	size_t capacity = 256 * BENCH_PHF_ENTRIES;
+	uint8_t* body = malloc(capacity);
+	size_t length = snprintf(body, capacity, "<GLStrings>\n\t<product>phf</product>\n");
+
+	size_t i = 0; for (; i < BENCH_PHF_ENTRIES; ++i) {
+		length += snprintf(&body[length], capacity - length,
+			"\t<GLString>\n"
+			"\t\t<MasterString>Monster %lu approaches</MasterString>\n"
+			"\t\t<LogicalString>monster_%lu</LogicalString>\n"
+			"\t\t<ContextInfo></ContextInfo>\n"
+			"\t\t<Translation>Monster %lu kommt n&#228;her</Translation>\n"
+			"\t</GLString>\n",
+			(unsigned long)i, (unsigned long)i, (unsigned long)i
+		);
+	}
+	length += snprintf(&body[length], capacity - length, "</GLStrings>\n");
+
+	test_server_add(server, "/strings/phf/de", body, length);
+	free(body);
+
+	struct gl_translations* translations = gl_get_translations(session, "phf", "de");
+	uint8_t directory[] = "/tmp/gltoolkit-bench-XXXXXX";
+
+	if (!translations || !mkdtemp(directory)) {
+		fprintf(stderr, "Cannot prepare phf suite\n");
+		exit(EXIT_FAILURE);
+	}
+
+
+	/* One copy of every catalog per run, gettext expects mo catalogs at
+	 * <directory>/<language>/LC_MESSAGES/<domain>.mo
+	 */
+	uint8_t path[4096];
+	snprintf(path, sizeof(path), "%s/de", directory);
+	mkdir(path, 0700);
+	snprintf(path, sizeof(path), "%s/de/LC_MESSAGES", directory);
+	mkdir(path, 0700);
+
+	size_t mo_bytes = 0;
+	size_t phf_bytes = 0;
+	for (i = 0; i < BENCH_PHF_RUNS; ++i) {
+		snprintf(path, sizeof(path), "%s/de/LC_MESSAGES/bench%lu.mo", directory, (unsigned long)i);
+		mo_bytes = bench_phf_write(path, true, translations);
+		snprintf(path, sizeof(path), "%s/bench%lu.phf", directory, (unsigned long)i);
+		phf_bytes = bench_phf_write(path, false, translations);
+	}
+
+
+	/* Keys in random order
+	 */
+	uint8_t const** keys = malloc(BENCH_PHF_ENTRIES * sizeof(uint8_t const*));
+	uint32_t state = 1;
+
+	for (i = 0; i < BENCH_PHF_ENTRIES; ++i) {
+		keys[i] = gl_get_translation_master_string(gl_get_translation(translations, i));
+	}
+	for (i = BENCH_PHF_ENTRIES - 1; i > 0; --i) {
+		size_t j = ((bench_random(&state) << 16) | bench_random(&state)) % (i + 1);
+		uint8_t const* key = keys[i];
+		keys[i] = keys[j];
+		keys[j] = key;
+	}
+
+
+	/* Compiled catalogs, loading includes the first lookup since mapped
+	 * pages are only read on demand
+	 */
+	struct gl_phf phf;
+	double fastest = 0;
+
+	for (i = 0; i < BENCH_PHF_RUNS; ++i) {
+		snprintf(path, sizeof(path), "%s/bench%lu.phf", directory, (unsigned long)i);
+
+		double start = bench_now();
+		bool loaded = gl_phf_open(&phf, path) && gl_phf_get(&phf, keys[0]);
+		double seconds = bench_now() - start;
+
+		if (!loaded) {
+			fprintf(stderr, "Cannot load %s\n", path);
+			exit(EXIT_FAILURE);
+		}
+		fastest = i && fastest < seconds ? fastest : seconds;
+
+		if (i + 1 < BENCH_PHF_RUNS) {
+			gl_phf_close(&phf);
+		}
+	}
+
+	size_t found = 0;
+	double start = bench_now();
+	for (i = 0; i < BENCH_PHF_ENTRIES; ++i) {
+		found += 0 != gl_phf_get(&phf, keys[i]);
+	}
+	double lookup = bench_now() - start;
+	gl_phf_close(&phf);
+
+	if (BENCH_PHF_ENTRIES != found) {
+		fprintf(stderr, "Compiled catalog misses %lu keys\n", (unsigned long)(BENCH_PHF_ENTRIES - found));
+		exit(EXIT_FAILURE);
+	}
+	bench_phf_report("phf", phf_bytes, fastest, lookup);
+
+
+	/* gettext only translates iff the locale is not `C', the language is
+	 * taken from $LANGUAGE
+	 */
+	setenv("LANGUAGE", "de", 1);
+	if (!setlocale(LC_ALL, "C.UTF-8")) {
+		fprintf(stderr, "C.UTF-8 locale not available, skipping gettext measurements\n");
+		goto exit;
+	}
+
+	uint8_t domain[32];
+	for (i = 0; i < BENCH_PHF_RUNS; ++i) {
+		snprintf(domain, sizeof(domain), "bench%lu", (unsigned long)i);
+		bindtextdomain(domain, directory);
+
+		double start = bench_now();
+		bool loaded = keys[0] != (uint8_t const*)dgettext(domain, keys[0]);
+		double seconds = bench_now() - start;
+
+		if (!loaded) {
+			fprintf(stderr, "gettext cannot load %s, skipping gettext measurements\n", domain);
+			goto exit;
+		}
+		fastest = i && fastest < seconds ? fastest : seconds;
+	}
+
+	found = 0;
+	start = bench_now();
+	for (i = 0; i < BENCH_PHF_ENTRIES; ++i) {
+		found += keys[i] != (uint8_t const*)dgettext(domain, keys[i]);
+	}
+	lookup = bench_now() - start;
+
+	if (BENCH_PHF_ENTRIES != found) {
+		fprintf(stderr, "gettext misses %lu keys\n", (unsigned long)(BENCH_PHF_ENTRIES - found));
+		exit(EXIT_FAILURE);
+	}
+	bench_phf_report("mo", mo_bytes, fastest, lookup);
+
+
+	/* Free allocated resources
+	 */
+exit:
+	setlocale(LC_ALL, "C");
+	unsetenv("LANGUAGE");
+
+	for (i = 0; i < BENCH_PHF_RUNS; ++i) {
+		snprintf(path, sizeof(path), "%s/de/LC_MESSAGES/bench%lu.mo", directory, (unsigned long)i);
+		unlink(path);
+		snprintf(path, sizeof(path), "%s/bench%lu.phf", directory, (unsigned long)i);
+		unlink(path);
+	}
+	snprintf(path, sizeof(path), "%s/de/LC_MESSAGES", directory);
+	rmdir(path);
+	snprintf(path, sizeof(path), "%s/de", directory);
+	rmdir(path);
+	rmdir(directory);
+
+	free(keys);
+	gl_free_translations(translations);
+	test_server_clear(server);
+}
+
+
+
+
+
+/**
+ * Parses a comma separated list of sizes within [`minimum', `maximum']
+ *
+ * @return Number of sizes or 0 iff `list' is malformed
+ */
+static size_t bench_parse_sizes(	uint8_t const* list,
+					size_t* sizes,
+					size_t minimum,
+					size_t maximum
+		) {
+	size_t count = 0;
+
+	while (count < BENCH_SYNTHETIC_SIZES) {
+		char* end = 0;
+		unsigned long size = strtoul(list, &end, 10);
+
+		if (end == (char*)list || size < minimum || size > maximum) {
+			return 0;
+		}
+		sizes[count++] = size;
+
+		if (!*end) {
+			return count;
+		}
+		if (',' != *end) {
+			return 0;
+		}
+		list = end + 1;
+	}
+	return 0;
+}
+
+
+
+
+
+/**
+ * Benchmarks gltoolkit against a local stand-in of GetLocalization.com and
+ * reports every measurement as one JSON object per line
+ *
+ * Usage: bench-gltoolkit [--strings <n>[,<n>...]] [--languages <n>[,<n>...]]
+ */
+int main(int argc, char** argv) {
+	size_t strings[BENCH_SYNTHETIC_SIZES] = {100, 10000, 100000};
+	size_t strings_count = 3;
+	size_t languages[BENCH_SYNTHETIC_SIZES] = {1, 10};
+	size_t languages_count = 2;
+
+
+	/* Synthetic suite sizes
+	 */
+	int i = 1; for (; i < argc; ++i) {
+		bool has_value = i + 1 < argc;
+
+		if (!strcmp("--strings", argv[i]) && has_value) {
+			strings_count = bench_parse_sizes(argv[++i], strings,
+				BENCH_SYNTHETIC_MIN_STRINGS, BENCH_SYNTHETIC_MAX_STRINGS
+			);
+		} else if (!strcmp("--languages", argv[i]) && has_value) {
+			languages_count = bench_parse_sizes(argv[++i], languages,
+				BENCH_SYNTHETIC_MIN_LANGUAGES, BENCH_SYNTHETIC_MAX_LANGUAGES
+			);
+		} else {
+			strings_count = 0;
+		}
+
+		if (!strings_count || !languages_count) {
+			fprintf(stderr, "Usage: %s [--strings <n>[,<n>...]] [--languages <n>[,<n>...]]\n", argv[0]);
+			fprintf(stderr, "\tBetween %u and %u strings and between %u and %u languages\n",
+				(unsigned)BENCH_SYNTHETIC_MIN_STRINGS, (unsigned)BENCH_SYNTHETIC_MAX_STRINGS,
+				(unsigned)BENCH_SYNTHETIC_MIN_LANGUAGES, (unsigned)BENCH_SYNTHETIC_MAX_LANGUAGES
+			);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* Large blocks are always mapped, so freed documents are returned to
+	 * the system immediately and resident memory reflects live data only
+	 */
+	mallopt(M_MMAP_THRESHOLD, 1024 * 1024);
+
+	struct test_server* server = test_server_start(GLTOOLKIT_BENCH_PORT);
+	if (!server) {
+		exit(EXIT_FAILURE);
+	}
+
+	struct gl_session* session = gl_init() ? gl_create_session() : 0;
+	if (!session) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		exit(EXIT_FAILURE);
+	}
+
+	bench_response(server, session);
+	bench_po(server, session);
+	bench_tokenizer();
+	bench_pipeline(server, session);
+	bench_schedule(server, session);
+	bench_phf(server, session);
+	bench_synthetic(server, session, strings, strings_count, languages, languages_count);
+
+	gl_free_session(session);
+	gl_cleanup();
+	test_server_stop(server);
+	exit(EXIT_SUCCESS);
+}
+
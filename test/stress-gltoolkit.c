@@ -0,0 +1,461 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gltoolkit.h"
+#include "test-server.h"
+
+
+
+
+
+/**
+ * Size of the project served to all threads
+ */
+#define STRESS_LANGUAGES 8
+#define STRESS_STRINGS 50
+
+/**
+ * Defaults of the command line
+ */
+#define STRESS_THREADS 8
+#define STRESS_ITERATIONS 25
+
+/**
+ * Operations every thread cycles through
+ */
+#define STRESS_OPERATIONS 6
+
+
+
+
+
+/**
+ * Resources shared by all threads
+ */
+struct stress_context {
+	struct gl_session* session;
+	struct gl_string_pool* pool;
+	struct gl_trace* trace;
+	size_t iterations;
+
+	/* Catalog looked up by all threads at once, so its indices are built
+	 * by concurrent first lookups
+	 */
+	struct gl_translations* catalog;
+	pthread_barrier_t lookup;
+
+	/* Number of failed checks, updated atomically
+	 */
+	size_t failures;
+};
+
+
+
+/**
+ * State of one thread
+ */
+struct stress_thread {
+	struct stress_context* context;
+	pthread_t thread;
+	size_t n;
+};
+
+
+
+
+
+/**
+ * Records a failed check
+ */
+static void stress_fail(struct stress_thread* thread, uint8_t const* message) {
+	fprintf(stderr, "Thread %lu: %s (last error: %s)\n",
+		(unsigned long)thread->n, message, gl_get_error()
+	);
+	__sync_fetch_and_add(&thread->context->failures, 1);
+}
+
+
+
+/**
+ * Writes the IANA code of the n-th language of project `stress'
+ */
+static void stress_language_code(uint8_t* code, size_t n) {
+	code[0] = 'a' + n % 26;
+	code[1] = 'a' + n / 26 % 26;
+	code[2] = 0;
+}
+
+
+
+/**
+ * Registers project `stress' with the stand-in server
+ */
+static void stress_serve(struct test_server* server) {
+	size_t capacity = 64 + STRESS_LANGUAGES * 128 + STRESS_STRINGS * 256;
+	uint8_t* body = malloc(capacity);
+	size_t length = snprintf(body, capacity, "<Languages>\n");
+
+	size_t n = 0; for (; n < STRESS_LANGUAGES; ++n) {
+		uint8_t code[3];
+		stress_language_code(code, n);
+
+		length += snprintf(&body[length], capacity - length,
+			"\t<Language><Name>Stress %s</Name><IanaCode>%s</IanaCode></Language>\n",
+			code, code
+		);
+	}
+	length += snprintf(&body[length], capacity - length, "</Languages>\n");
+	test_server_add(server, "/languages/stress", body, length);
+
+	for (n = 0; n < STRESS_LANGUAGES; ++n) {
+		uint8_t code[3];
+		stress_language_code(code, n);
+		length = snprintf(body, capacity, "<GLStrings>\n\t<product>stress</product>\n");
+
+		size_t i = 0; for (; i < STRESS_STRINGS; ++i) {
+			length += snprintf(&body[length], capacity - length,
+				"\t<GLString>"
+				"<MasterString>Message %lu &amp; more</MasterString>"
+				"<LogicalString>message.%lu</LogicalString>"
+				"<ContextInfo>stress.c:%lu</ContextInfo>"
+				"<Translation>Message %lu (%s)</Translation>"
+				"</GLString>\n",
+				(unsigned long)i, (unsigned long)i, (unsigned long)i, (unsigned long)i, code
+			);
+		}
+		length += snprintf(&body[length], capacity - length, "</GLStrings>\n");
+
+		uint8_t path[64];
+		snprintf(path, sizeof(path), "/strings/stress/%s", code);
+		test_server_add(server, path, body, length);
+	}
+	free(body);
+}
+
+
+
+/**
+ * Checks one catalog, including lookups which build its index
+ */
+static void stress_check_translations(	struct stress_thread* thread,
+					struct gl_translations* translations
+		) {
+	if (!translations) {
+		stress_fail(thread, "Missing catalog");
+		return;
+	}
+	if (STRESS_STRINGS != gl_get_translations_count(translations)) {
+		stress_fail(thread, "Incomplete catalog");
+	}
+
+	size_t i = 0; for (; i < gl_get_translations_count(translations); ++i) {
+		struct gl_translation* translation = gl_get_translation(translations, i);
+
+		if (translation != gl_find_translation_by_master(translations, gl_get_translation_master_string(translation))) {
+			stress_fail(thread, "Lookup failed");
+			break;
+		}
+	}
+	gl_free_translations(translations);
+}
+
+
+
+/**
+ * Looks up every translation of the shared catalog by both of its keys
+ */
+static void stress_lookup_shared(struct stress_thread* thread) {
+	struct gl_translations* catalog = thread->context->catalog;
+
+	size_t i = 0; for (; i < gl_get_translations_count(catalog); ++i) {
+		struct gl_translation* translation = gl_get_translation(catalog, i);
+
+		if (translation != gl_find_translation_by_master(catalog, gl_get_translation_master_string(translation))
+				|| translation != gl_find_translation_by_logical(catalog, gl_get_translation_logical_string(translation))) {
+			stress_fail(thread, "Shared lookup failed");
+			break;
+		}
+	}
+}
+
+
+
+/**
+ * Checks every catalog of gl_fetch_translations, which may be called on
+ * several threads at once
+ */
+static void stress_translations_fetched(	__attribute__((unused)) struct gl_language* language,
+						struct gl_translations* translations,
+						void* context
+		) {
+	stress_check_translations(context, translations);
+}
+
+
+
+/**
+ * Counts streamed translations of the thread
+ */
+static void* stress_stream_begin(__attribute__((unused)) struct gl_language* language, void* context) {
+	return context;
+}
+
+static bool stress_stream_translation(__attribute__((unused)) struct gl_translation* translation, void* stream) {
+	size_t* streamed = stream;
+	*streamed += 1;
+	return true;
+}
+
+static void stress_stream_end(	__attribute__((unused)) struct gl_language* language,
+				__attribute__((unused)) bool success,
+				__attribute__((unused)) void* stream
+		) {
+}
+
+
+
+/**
+ * Runs the thread's share of operations on its own session and on the
+ * session shared by all threads
+ */
+static void* stress_run(void* context) {
+	struct stress_thread* thread = context;
+	struct stress_context* shared = thread->context;
+
+	/* All threads start by looking up the shared catalog at the same time
+	 */
+	pthread_barrier_wait(&shared->lookup);
+	stress_lookup_shared(thread);
+
+	/* Every thread balances its own gl_init
+	 */
+	if (!gl_init()) {
+		stress_fail(thread, "Cannot initialize gltoolkit");
+		return 0;
+	}
+
+	struct gl_session* session = gl_create_session();
+	if (!session) {
+		stress_fail(thread, "Cannot create session");
+		gl_cleanup();
+		return 0;
+	}
+	gl_set_session_zero_copy(session, thread->n % 2);
+	gl_set_session_string_pool(session, shared->pool);
+	gl_set_session_trace(session, shared->trace);
+
+	struct gl_languages* languages = gl_get_languages(session, "stress");
+	if (!languages || STRESS_LANGUAGES != gl_get_languages_count(languages)) {
+		stress_fail(thread, "Cannot fetch language list");
+		goto exit;
+	}
+
+	size_t i = 0; for (; i < shared->iterations; ++i) {
+		uint8_t code[3];
+		stress_language_code(code, (thread->n + i) % STRESS_LANGUAGES);
+
+		switch ((thread->n + i) % STRESS_OPERATIONS) {
+		case 0: {
+			struct gl_languages* list = gl_get_languages(shared->session, "stress");
+
+			if (!list || STRESS_LANGUAGES != gl_get_languages_count(list)) {
+				stress_fail(thread, "Cannot fetch shared language list");
+			}
+			if (list) {
+				gl_free_languages(list);
+			}
+			break;
+		}
+		case 1:
+			stress_check_translations(thread, gl_get_translations(shared->session, "stress", code));
+			break;
+
+		case 2:
+			if (!gl_fetch_translations(session, "stress", languages, 2, stress_translations_fetched, thread)) {
+				stress_fail(thread, "Concurrent fetch failed");
+			}
+			break;
+
+		case 3:
+			if (!gl_fetch_translations_pipelined(session, "stress", languages, 2, 2, 2, stress_translations_fetched, thread)) {
+				stress_fail(thread, "Pipelined fetch failed");
+			}
+			break;
+
+		case 4: {
+			struct gl_stream_callbacks callbacks = {
+				.begin = stress_stream_begin,
+				.translation = stress_stream_translation,
+				.end = stress_stream_end
+			};
+			size_t streamed = 0;
+
+			if (!gl_stream_translations(session, "stress", languages, 2, &callbacks, &streamed)
+					|| STRESS_LANGUAGES * STRESS_STRINGS != streamed) {
+				stress_fail(thread, "Streaming failed");
+			}
+			break;
+		}
+		default: {
+
+			/* A failure has to be reported to the failing thread only
+			 */
+			uint8_t missing[64];
+			snprintf(missing, sizeof(missing), "missing-%lu", (unsigned long)thread->n);
+
+			if (gl_get_translations(shared->session, "stress", missing)) {
+				stress_fail(thread, "Missing language was found");
+			} else if (!strstr(gl_get_error(), missing)) {
+				stress_fail(thread, "Failure reported to the wrong thread");
+			}
+			gl_get_session_requests(shared->session);
+			gl_get_session_concurrency(shared->session);
+			break;
+		}
+		}
+	}
+	gl_free_languages(languages);
+
+exit:
+	gl_free_session(session);
+	gl_cleanup();
+	return 0;
+}
+
+
+
+
+
+/**
+ * Hammers the library from many threads at once against a local stand-in
+ * of GetLocalization.com. Meant to be run under ThreadSanitizer, configure
+ * with -DGLTOOLKIT_SANITIZE=thread
+ *
+ * Usage: stress-gltoolkit [--threads <n>] [--iterations <n>]
+ */
+int main(int argc, char** argv) {
+	size_t threads_count = STRESS_THREADS;
+	size_t iterations = STRESS_ITERATIONS;
+
+	int i = 1; for (; i < argc; ++i) {
+		bool has_value = i + 1 < argc;
+
+		if (!strcmp("--threads", argv[i]) && has_value) {
+			threads_count = strtoul(argv[++i], 0, 10);
+		} else if (!strcmp("--iterations", argv[i]) && has_value) {
+			iterations = strtoul(argv[++i], 0, 10);
+		} else {
+			threads_count = 0;
+		}
+
+		if (!threads_count || !iterations) {
+			fprintf(stderr, "Usage: %s [--threads <n>] [--iterations <n>]\n", argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (!gl_init()) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		exit(EXIT_FAILURE);
+	}
+
+	struct test_server* server = test_server_start(GLTOOLKIT_STRESS_PORT);
+	if (!server) {
+		exit(EXIT_FAILURE);
+	}
+	stress_serve(server);
+
+
+	/* One session, pool and trace used by all threads at once
+	 */
+	struct stress_context context = {
+		.session = gl_create_session(),
+		.pool = gl_create_string_pool(),
+		.trace = gl_create_trace(),
+		.iterations = iterations,
+		.catalog = 0,
+		.failures = 0
+	};
+	if (!context.session) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		exit(EXIT_FAILURE);
+	}
+	gl_set_session_string_pool(context.session, context.pool);
+	gl_set_session_trace(context.session, context.trace);
+
+	uint8_t code[3];
+	stress_language_code(code, 0);
+
+	context.catalog = gl_get_translations(context.session, "stress", code);
+	if (!context.catalog) {
+		fprintf(stderr, "%s\n", gl_get_error());
+		exit(EXIT_FAILURE);
+	}
+
+	struct stress_thread* threads = calloc(threads_count, sizeof(struct stress_thread));
+	size_t started = 0;
+
+	pthread_barrier_init(&context.lookup, 0, threads_count);
+
+	for (; started < threads_count; ++started) {
+		threads[started].context = &context;
+		threads[started].n = started;
+
+		if (pthread_create(&threads[started].thread, 0, stress_run, &threads[started])) {
+			/* Threads already started wait for this one at the barrier
+			 */
+			fprintf(stderr, "Cannot start thread %lu\n", (unsigned long)started);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	size_t n = 0; for (; n < started; ++n) {
+		pthread_join(threads[n].thread, 0);
+	}
+	pthread_barrier_destroy(&context.lookup);
+	free(threads);
+
+	fprintf(stdout, "%lu threads made %lu requests on the shared session, %lu strings interned\n",
+		(unsigned long)started,
+		(unsigned long)gl_get_session_requests(context.session),
+		(unsigned long)gl_get_string_pool_count(context.pool)
+	);
+
+	gl_free_translations(context.catalog);
+	gl_free_session(context.session);
+	gl_free_string_pool(context.pool);
+	gl_free_trace(context.trace);
+	test_server_stop(server);
+	gl_cleanup();
+
+	if (context.failures) {
+		fprintf(stderr, "%lu checks failed\n", (unsigned long)context.failures);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(stdout, "Stress test passed :-)\n");
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,2408 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <entities.h>
+
+#include "arena.h"
+#include "codegen.h"
+#include "glstrings.h"
+#include "gltoolkit.h"
+#include "gltoolkit-phf.h"
+#include "mo.h"
+#include "output.h"
+#include "phf.h"
+#include "po.h"
+#include "test-server.h"
+#include "tokenizer.h"
+#include "trace.h"
+
+
+
+
+
+/**
+ * Languages served by the stand-in server
+ */
+static uint8_t const* test_languages[] = {"de", "ru", "fr", 0};
+
+
+
+/**
+ * Fails the test run with a message
+ */
+static void gl_test_fail(uint8_t const* message) {
+	fprintf(stderr, "%s (last error: %s)\n", message, gl_get_error());
+	exit(EXIT_FAILURE);
+}
+
+
+
+/**
+ * Registers the project `demo' with the stand-in server
+ */
+static void gl_test_serve_project(struct test_server* server) {
+	uint8_t body[4096];
+	size_t length = 0;
+
+
+	/* Language list
+	 */
+	length += snprintf(&body[length], sizeof(body) - length, "<Languages>\n");
+
+	uint8_t const** language = test_languages; for (; *language; ++language) {
+		length += snprintf(&body[length], sizeof(body) - length,
+			"\t<Language>\n"
+			"\t\t<Name>Language %s</Name>\n"
+			"\t\t<IanaCode>%s</IanaCode>\n"
+			"\t</Language>\n",
+			*language, *language
+		);
+	}
+	length += snprintf(&body[length], sizeof(body) - length, "</Languages>\n");
+	test_server_add(server, "/languages/demo", body, length);
+
+
+	/* Translations of every language
+	 */
+	for (language = test_languages; *language; ++language) {
+		uint8_t path[64];
+		snprintf(path, sizeof(path), "/strings/demo/%s", *language);
+
+		length = snprintf(body, sizeof(body),
+			"<GLStrings>\n"
+			"\t<product>demo</product>\n"
+			"\t<GLString>\n"
+			"\t\t<MasterString>Please wait...</MasterString>\n"
+			"\t\t<LogicalString>wait</LogicalString>\n"
+			"\t\t<ContextInfo>../src/program.cpp:183</ContextInfo>\n"
+			"\t\t<Translation>Please wait (%s)</Translation>\n"
+			"\t</GLString>\n"
+			"\t<GLString>\n"
+			"\t\t<MasterString>Game over</MasterString>\n"
+			"\t\t<LogicalString></LogicalString>\n"
+			"\t\t<ContextInfo>../src/game.cpp:42</ContextInfo>\n"
+			"\t\t<Translation>Game over (%s)</Translation>\n"
+			"\t</GLString>\n"
+			"</GLStrings>\n",
+			*language, *language
+		);
+		test_server_add(server, path, body, length);
+	}
+}
+
+
+
+/**
+ * Sessions can only be created between gl_init and its matching gl_cleanup,
+ * nested calls must keep the library initialized
+ */
+static void gl_test_init() {
+	if (gl_create_session() || !strstr(gl_get_error(), "gl_init")) {
+		gl_test_fail("Session created without gl_init");
+	}
+
+	if (!gl_init() || !gl_init()) {
+		gl_test_fail("Cannot initialize gltoolkit");
+	}
+	gl_cleanup();
+
+	struct gl_session* session = gl_create_session();
+	if (!session) {
+		gl_test_fail("Nested gl_cleanup released the library");
+	}
+	gl_free_session(session);
+}
+
+
+
+/**
+ * Fetches a missing language and remembers the failure seen by the thread
+ */
+static void* gl_test_fail_fetch(void* context) {
+	uint8_t const* language = context;
+
+	struct gl_session* session = gl_create_session();
+	struct gl_translations* translations = gl_get_translations(session, "demo", language);
+	gl_free_session(session);
+
+	return translations ? 0 : strdup(gl_get_error());
+}
+
+
+
+/**
+ * Failures are reported per thread and name the failed request
+ */
+static void gl_test_errors(struct test_server* server) {
+	uint8_t const* missing[] = {"xa", "xb"};
+	pthread_t threads[2];
+
+	size_t i = 0; for (; i < 2; ++i) {
+		if (pthread_create(&threads[i], 0, gl_test_fail_fetch, (void*)missing[i])) {
+			gl_test_fail("Cannot start thread");
+		}
+	}
+
+	for (i = 0; i < 2; ++i) {
+		uint8_t* error = 0;
+		pthread_join(threads[i], (void**)&error);
+
+		uint8_t path[64];
+		snprintf(path, sizeof(path), "/strings/demo/%s", missing[i]);
+
+		if (!error || !strstr(error, path) || !strstr(error, "404")) {
+			gl_test_fail("Failure of a thread not reported to that thread");
+		}
+		free(error);
+	}
+
+	if (strstr(gl_get_error(), "/strings/demo/x")) {
+		gl_test_fail("Failure of a thread reported to another thread");
+	}
+
+
+	/* Empty bodies are no documents, neither copied nor in place
+	 */
+	test_server_add(server, "/languages/empty", "", 0);
+	test_server_add(server, "/strings/demo/empty", "", 0);
+
+	struct gl_session* session = gl_create_session();
+	if (gl_get_languages(session, "empty") || !strstr(gl_get_error(), "/languages/empty")) {
+		gl_test_fail("Empty language list was accepted");
+	}
+
+	size_t mode = 0; for (; mode < 2; ++mode) {
+		gl_set_session_zero_copy(session, mode);
+
+		if (gl_get_translations(session, "demo", "empty") || !strstr(gl_get_error(), "/strings/demo/empty")) {
+			gl_test_fail("Empty catalog was accepted");
+		}
+	}
+
+
+	/* Errors quote only the beginning of malformed responses, which may
+	 * be larger than any thread's stack
+	 */
+	size_t length = 16 * 1024 * 1024;
+	uint8_t* malformed = malloc(length);
+	memset(malformed, 'x', length);
+	memcpy(malformed, "<GLStrings>", strlen("<GLStrings>"));
+
+	test_server_add(server, "/languages/malformed", malformed, length);
+	test_server_add(server, "/strings/demo/malformed", malformed, length);
+	free(malformed);
+	gl_set_session_zero_copy(session, false);
+
+	if (gl_get_languages(session, "malformed") || !strstr(gl_get_error(), "/languages/malformed: <GLStrings>xxx")) {
+		gl_test_fail("Malformed language list was accepted");
+	}
+	if (gl_get_translations(session, "demo", "malformed") || !strstr(gl_get_error(), "/strings/demo/malformed: <GLStrings>xxx")) {
+		gl_test_fail("Malformed catalog was accepted");
+	}
+	gl_free_session(session);
+}
+
+
+
+/**
+ * Sequential requests made through one session have to reuse a single
+ * keep-alive connection
+ */
+static void gl_test_session_reuse(struct test_server* server) {
+	size_t connections = test_server_connections(server);
+	size_t requests = test_server_requests(server);
+
+	struct gl_session* session = gl_create_session();
+	if (!session) {
+		gl_test_fail("Cannot create session");
+	}
+
+
+	/* Fetch languages and every language's translations
+	 */
+	struct gl_languages* languages = gl_get_languages(session, "demo");
+	if (!languages || 3 != gl_get_languages_count(languages)) {
+		gl_test_fail("Unexpected language list");
+	}
+
+	size_t i = 0; for (; i < gl_get_languages_count(languages); ++i) {
+		struct gl_translations* translations = gl_get_translations(
+			session, "demo",
+			gl_get_language_code(gl_get_language(languages, i))
+		);
+		if (!translations || 2 != gl_get_translations_count(translations)) {
+			gl_test_fail("Unexpected translation list");
+		}
+		gl_free_translations(translations);
+	}
+
+
+	/* All four requests have to share one connection
+	 */
+	size_t session_connects = gl_get_session_connects(session);
+	size_t session_requests = gl_get_session_requests(session);
+	size_t server_connections = test_server_connections(server) - connections;
+	size_t server_requests = test_server_requests(server) - requests;
+
+	fprintf(stdout, "Sequential session made %lu requests using %lu connections (server saw %lu requests on %lu connections)\n",
+		(unsigned long)session_requests, (unsigned long)session_connects,
+		(unsigned long)server_requests, (unsigned long)server_connections
+	);
+
+	if (4 != session_requests || 4 != server_requests) {
+		gl_test_fail("Unexpected number of requests");
+	}
+	if (1 != session_connects || 1 != server_connections) {
+		gl_test_fail("Session did not reuse its connection");
+	}
+
+	gl_free_languages(languages);
+	gl_free_session(session);
+}
+
+
+
+/**
+ * Counts translations received by gl_fetch_translations
+ */
+static void gl_test_count_translations(
+			__attribute__((unused)) struct gl_language* language,
+			struct gl_translations* translations,
+			void* context
+		) {
+	size_t* received = context;
+
+	if (!translations || 2 != gl_get_translations_count(translations)) {
+		gl_test_fail("Unexpected concurrent translation list");
+	}
+	*received += 1;
+	gl_free_translations(translations);
+}
+
+
+
+/**
+ * Concurrent fetches must not open more connections than parallel jobs and
+ * reuse the connection of the language list
+ */
+static void gl_test_session_concurrent(struct test_server* server, size_t jobs) {
+	size_t connections = test_server_connections(server);
+
+	struct gl_session* session = gl_create_session();
+	if (!session) {
+		gl_test_fail("Cannot create session");
+	}
+
+	struct gl_languages* languages = gl_get_languages(session, "demo");
+	if (!languages) {
+		gl_test_fail("Cannot fetch language list");
+	}
+
+
+	/* Fetch twice, the second run has to reuse all connections
+	 */
+	size_t received = 0;
+	size_t run = 0; for (; run < 2; ++run) {
+		if (!gl_fetch_translations(session, "demo", languages, jobs, gl_test_count_translations, &received)) {
+			gl_test_fail("Concurrent fetch failed");
+		}
+	}
+
+	size_t session_connects = gl_get_session_connects(session);
+	size_t server_connections = test_server_connections(server) - connections;
+
+	fprintf(stdout, "Concurrent session with %lu jobs made %lu requests using %lu connections\n",
+		(unsigned long)jobs,
+		(unsigned long)gl_get_session_requests(session),
+		(unsigned long)session_connects
+	);
+
+	if (2 * 3 != received) {
+		gl_test_fail("Not all languages were fetched");
+	}
+	if (session_connects > jobs || server_connections > jobs) {
+		gl_test_fail("Concurrent session opened too many connections");
+	}
+
+	gl_free_languages(languages);
+	gl_free_session(session);
+}
+
+
+
+
+
+/**
+ * Rate limited servers have to be served at the concurrency they tolerate,
+ * throttled downloads are retried until they succeed or run out of attempts
+ */
+static void gl_test_throttle(struct test_server* server) {
+	struct gl_session* session = gl_create_session();
+	struct gl_languages* languages = gl_get_languages(session, "demo");
+	if (!languages) {
+		gl_test_fail("Cannot fetch language list");
+	}
+	size_t count = gl_get_languages_count(languages);
+
+
+	/* The server processes one request at a time and asks to retry
+	 * immediately, all downloads have to succeed nonetheless
+	 */
+	size_t requests = test_server_requests(server);
+	size_t throttled = test_server_throttled(server);
+	test_server_throttle(server, 1, 20, 0);
+
+	size_t received = 0;
+	size_t run = 0; for (; run < 6; ++run) {
+		if (!gl_fetch_translations(session, "demo", languages, 8, gl_test_count_translations, &received)) {
+			gl_test_fail("Throttled fetch failed");
+		}
+	}
+	throttled = test_server_throttled(server) - throttled;
+
+	if (6 * count != received || throttled != gl_get_session_throttled(session)) {
+		gl_test_fail("Unexpected results of throttled fetch");
+	}
+	if (!throttled || throttled >= 6 * count) {
+		gl_test_fail("Concurrency did not adapt to rate limit");
+	}
+	if (throttled + 6 * count != test_server_requests(server) - requests) {
+		gl_test_fail("Unexpected number of throttled requests");
+	}
+	fprintf(stdout, "Fetched %lu catalogs from throttled server with %lu retries, concurrency %lu\n",
+		(unsigned long)received, (unsigned long)throttled,
+		(unsigned long)gl_get_session_concurrency(session)
+	);
+
+
+	/* 503 Service Unavailable without Retry-After is retried with
+	 * exponential backoff
+	 */
+	test_server_throttle(server, 1, 50, -1);
+	received = 0;
+
+	if (!gl_fetch_translations(session, "demo", languages, 2, gl_test_count_translations, &received) || count != received) {
+		gl_test_fail("Fetch from unavailable server failed");
+	}
+
+
+	/* Retry-After beyond the maximum backoff is capped to at least 3/4 of
+	 * the maximum, parallel and single downloads are retried soon
+	 */
+	struct gl_session* patient = gl_create_session();
+	test_server_throttle(server, 1, 100, 3600);
+	throttled = test_server_throttled(server);
+	received = 0;
+	uint64_t start = gl_trace_now();
+
+	if (!gl_fetch_translations(patient, "demo", languages, 4, gl_test_count_translations, &received) || count != received) {
+		gl_test_fail("Fetch from server requesting a long retry delay failed");
+	}
+	uint64_t elapsed = gl_trace_now() - start;
+
+	if (throttled == test_server_throttled(server) || elapsed < 3 * GL_HTTP_MAX_BACKOFF / 4 || elapsed > 10000000) {
+		gl_test_fail("Long Retry-After was not capped");
+	}
+
+	test_server_throttle(server, 0, 0, 3600);
+	start = gl_trace_now();
+
+	if (gl_get_translations(patient, "demo", "de") || gl_trace_now() - start > 10000000) {
+		gl_test_fail("Long Retry-After of single download was not capped");
+	}
+	gl_free_session(patient);
+
+
+	/* Downloads which are always throttled fail after a bounded number of
+	 * attempts
+	 */
+	test_server_throttle(server, 0, 0, 0);
+	requests = test_server_requests(server);
+
+	if (gl_get_translations(session, "demo", "de")) {
+		gl_test_fail("Fetched translations from server rejecting all requests");
+	}
+	size_t attempts = test_server_requests(server) - requests;
+	if (attempts < 2 || attempts > 10) {
+		gl_test_fail("Unexpected number of attempts");
+	}
+
+	test_server_unthrottle(server);
+	gl_free_languages(languages);
+	gl_free_session(session);
+}
+
+
+
+/**
+ * One arena reused for all languages must not need additional blocks after
+ * the first language
+ */
+static void gl_test_arena(__attribute__((unused)) struct test_server* server) {
+	struct gl_session* session = gl_create_session();
+	struct gl_arena* arena = gl_create_arena(256);
+	size_t blocks = 0;
+
+	size_t run = 0; for (; run < 2; ++run) {
+		uint8_t const** language = test_languages; for (; *language; ++language) {
+			struct gl_translations* translations = gl_get_translations_in_arena(
+				session, "demo", *language, arena
+			);
+			if (!translations || 2 != gl_get_translations_count(translations)) {
+				gl_test_fail("Unexpected translation list in arena");
+			}
+			uint8_t expected[64];
+			snprintf(expected, sizeof(expected), "Game over (%s)", *language);
+
+			if (strcmp(gl_get_translation_string(gl_get_translation(translations, 1)), expected)) {
+				gl_test_fail("Unexpected translation in arena");
+			}
+
+			gl_free_translations(translations);
+			gl_reset_arena(arena);
+		}
+
+		if (!run) {
+			blocks = gl_get_arena_blocks(arena);
+		} else if (blocks != gl_get_arena_blocks(arena)) {
+			gl_test_fail("Reset arena requested new blocks");
+		}
+	}
+	fprintf(stdout, "Reused arena of %lu blocks for %lu catalogs\n",
+		(unsigned long)blocks, (unsigned long)(2 * 3)
+	);
+
+	gl_free_arena(arena);
+	gl_free_session(session);
+}
+
+
+
+/**
+ * Maximum number of sockets watched by the test event loop
+ */
+#define GL_TEST_LOOP_SOCKETS 64
+
+
+
+/**
+ * Minimal poll based event loop driving an asynchronous context
+ */
+struct gl_test_loop {
+	struct pollfd fds[GL_TEST_LOOP_SOCKETS];
+	size_t count;
+	long timeout;
+
+	/* Completed requests and catalogs
+	 */
+	struct gl_async* async;
+	size_t languages;
+	size_t translations;
+	size_t failures;
+};
+
+
+
+/**
+ * Watches, changes or forgets `fd' as requested by the asynchronous context
+ */
+static void gl_test_loop_socket(int fd, int events, void* context) {
+	struct gl_test_loop* loop = context;
+
+	size_t i = 0; for (; i < loop->count && loop->fds[i].fd != fd; ++i);
+
+	if (GL_ASYNC_REMOVE & events) {
+		if (i < loop->count) {
+			loop->fds[i] = loop->fds[--loop->count];
+		}
+		return;
+	}
+
+	if (i == loop->count) {
+		if (GL_TEST_LOOP_SOCKETS == loop->count) {
+			gl_test_fail("Too many sockets");
+		}
+		loop->fds[loop->count++].fd = fd;
+	}
+	loop->fds[i].events = ((GL_ASYNC_IN & events) ? POLLIN : 0) | ((GL_ASYNC_OUT & events) ? POLLOUT : 0);
+}
+
+
+
+/**
+ * Arms the single timer of the loop
+ */
+static void gl_test_loop_timer(long timeout, void* context) {
+	struct gl_test_loop* loop = context;
+	loop->timeout = timeout;
+}
+
+
+
+/**
+ * Runs the loop until all requests completed
+ */
+static void gl_test_loop_run(struct gl_test_loop* loop) {
+	while (gl_get_async_running(loop->async)) {
+		long timeout = loop->timeout < 0 || loop->timeout > 1000 ? 1000 : loop->timeout;
+		int ready = poll(loop->fds, loop->count, timeout);
+
+		if (ready < 0) {
+			gl_test_fail("poll() failed");
+		}
+		if (!ready) {
+			loop->timeout = -1;
+			gl_async_perform(loop->async, GL_ASYNC_TIMEOUT, 0);
+			continue;
+		}
+
+
+		/* Callbacks change the watched sockets, so dispatch a snapshot
+		 */
+		struct pollfd fds[GL_TEST_LOOP_SOCKETS];
+		size_t count = loop->count;
+		memcpy(fds, loop->fds, count * sizeof(struct pollfd));
+
+		size_t i = 0; for (; i < count; ++i) {
+			int events = 0;
+			events |= (POLLIN & fds[i].revents) ? GL_ASYNC_IN : 0;
+			events |= (POLLOUT & fds[i].revents) ? GL_ASYNC_OUT : 0;
+			events |= ((POLLERR | POLLHUP) & fds[i].revents) ? GL_ASYNC_ERROR : 0;
+
+			if (events) {
+				gl_async_perform(loop->async, fds[i].fd, events);
+			}
+		}
+	}
+}
+
+
+
+/**
+ * Counts a completed catalog of the asynchronous test
+ */
+static void gl_test_async_translations(struct gl_translations* translations, void* context) {
+	struct gl_test_loop* loop = context;
+
+	if (!translations || 2 != gl_get_translations_count(translations)) {
+		loop->failures += 1;
+	} else {
+		loop->translations += 1;
+		gl_free_translations(translations);
+	}
+}
+
+
+
+/**
+ * Requests the catalog of every language as soon as the language list is
+ * available
+ */
+static void gl_test_async_languages(struct gl_languages* languages, void* context) {
+	struct gl_test_loop* loop = context;
+
+	if (!languages) {
+		loop->failures += 1;
+		return;
+	}
+	loop->languages += 1;
+
+	size_t i = 0; for (; i < gl_get_languages_count(languages); ++i) {
+		uint8_t const* code = gl_get_language_code(gl_get_language(languages, i));
+
+		if (!gl_async_get_translations(loop->async, "demo", code, gl_test_async_translations, loop)) {
+			loop->failures += 1;
+		}
+	}
+	gl_free_languages(languages);
+}
+
+
+
+/**
+ * Two syncs progressing on one thread, driven by an external event loop.
+ * Cancelled requests have to report their failure exactly once
+ */
+static void gl_test_async(struct test_server* server) {
+	struct gl_session* session = gl_create_session();
+	struct gl_test_loop loop = {.timeout = -1};
+	loop.async = gl_create_async(session, gl_test_loop_socket, gl_test_loop_timer, &loop);
+
+
+	/* Complete sync of `demo' next to a single catalog
+	 */
+	size_t requests = test_server_requests(server);
+	if (!gl_async_get_languages(loop.async, "demo", gl_test_async_languages, &loop)
+			|| !gl_async_get_translations(loop.async, "demo", "de", gl_test_async_translations, &loop)) {
+		gl_test_fail("Cannot start asynchronous requests");
+	}
+	gl_test_loop_run(&loop);
+
+	if (loop.failures || 1 != loop.languages || 4 != loop.translations) {
+		gl_test_fail("Unexpected results of asynchronous requests");
+	}
+	if (5 != test_server_requests(server) - requests) {
+		gl_test_fail("Unexpected number of asynchronous requests");
+	}
+
+
+	/* Cancelled requests and requests pending when the context is freed
+	 * fail immediately
+	 */
+	struct gl_async_request* cancelled = gl_async_get_translations(
+		loop.async, "demo", "ru", gl_test_async_translations, &loop
+	);
+	gl_async_get_translations(loop.async, "demo", "fr", gl_test_async_translations, &loop);
+	gl_cancel_async_request(cancelled);
+
+	if (1 != loop.failures || 1 != gl_get_async_running(loop.async)) {
+		gl_test_fail("Cancelled request did not fail");
+	}
+	gl_free_async(loop.async);
+
+	if (2 != loop.failures || loop.count) {
+		gl_test_fail("Pending request did not fail");
+	}
+	gl_free_session(session);
+
+	fprintf(stdout, "Completed %lu asynchronous requests on one thread\n", (unsigned long)(loop.languages + loop.translations));
+}
+
+
+
+/**
+ * Keeps every catalog received by gl_fetch_translations in the slot of its
+ * language
+ */
+static void gl_test_keep_translations(
+			struct gl_language* language,
+			struct gl_translations* translations,
+			void* context
+		) {
+	struct gl_translations** catalogs = context;
+
+	size_t i = 0; for (; test_languages[i]; ++i) {
+		if (!strcmp(test_languages[i], gl_get_language_code(language))) {
+			catalogs[i] = translations;
+		}
+	}
+}
+
+
+
+/**
+ * Catalogs of all languages built through one pool have to share their
+ * source strings, but not their translations
+ */
+static void gl_test_intern(__attribute__((unused)) struct test_server* server) {
+	struct gl_string_pool* pool = gl_create_string_pool();
+
+	size_t mode = 0; for (; mode < 2; ++mode) {
+		struct gl_session* session = gl_create_session();
+		gl_set_session_zero_copy(session, mode);
+		gl_set_session_string_pool(session, pool);
+
+		struct gl_languages* languages = gl_get_languages(session, "demo");
+		struct gl_translations* catalogs[sizeof(test_languages) / sizeof(test_languages[0])] = {0};
+
+		if (!languages || !gl_fetch_translations(session, "demo", languages, 2, gl_test_keep_translations, catalogs)) {
+			gl_test_fail("Cannot fetch demo translations");
+		}
+
+
+		/* Master strings, logical strings and context info are the same
+		 * strings in every copied catalog
+		 */
+		size_t i = 1; for (; test_languages[i]; ++i) {
+			if (!catalogs[0] || !catalogs[i]) {
+				gl_test_fail("Missing demo catalog");
+			}
+
+			size_t j = 0; for (; j < gl_get_translations_count(catalogs[0]); ++j) {
+				struct gl_translation* a = gl_get_translation(catalogs[0], j);
+				struct gl_translation* b = gl_get_translation(catalogs[i], j);
+				bool shared = gl_get_translation_master_string(a) == gl_get_translation_master_string(b)
+					&& gl_get_translation_logical_string(a) == gl_get_translation_logical_string(b)
+					&& gl_get_translation_context_info(a) == gl_get_translation_context_info(b)
+				;
+
+				if (shared != !mode || !strcmp(gl_get_translation_string(a), gl_get_translation_string(b))) {
+					gl_test_fail("Unexpected sharing of strings");
+				}
+			}
+		}
+
+		for (i = 0; test_languages[i]; ++i) {
+			gl_free_translations(catalogs[i]);
+		}
+		gl_free_languages(languages);
+		gl_free_session(session);
+	}
+
+
+	/* Two master strings, two logical strings and two context infos,
+	 * zero copy catalogs do not use the pool
+	 */
+	if (6 != gl_get_string_pool_count(pool) || !gl_get_string_pool_saved_bytes(pool)) {
+		gl_test_fail("Unexpected string pool statistics");
+	}
+	fprintf(stdout, "Interned %lu strings of %lu bytes, saving %lu bytes\n",
+		(unsigned long)gl_get_string_pool_count(pool),
+		(unsigned long)gl_get_string_pool_bytes(pool),
+		(unsigned long)gl_get_string_pool_saved_bytes(pool)
+	);
+	gl_free_string_pool(pool);
+}
+
+
+
+/**
+ * The pipelined fetch has to deliver every language exactly once, with
+ * several parsers building catalogs through one shared pool at a time
+ */
+static void gl_test_pipeline(size_t parsers, size_t writers) {
+	struct gl_string_pool* pool = gl_create_string_pool();
+	struct gl_session* session = gl_create_session();
+	gl_set_session_string_pool(session, pool);
+
+	struct gl_languages* languages = gl_get_languages(session, "demo");
+	struct gl_translations* catalogs[sizeof(test_languages) / sizeof(test_languages[0])] = {0};
+
+	if (!languages || !gl_fetch_translations_pipelined(session, "demo", languages, 2, parsers, writers, gl_test_keep_translations, catalogs)) {
+		gl_test_fail("Pipelined fetch failed");
+	}
+
+	size_t i = 0; for (; test_languages[i]; ++i) {
+		if (!catalogs[i] || 2 != gl_get_translations_count(catalogs[i])) {
+			gl_test_fail("Missing pipelined catalog");
+		}
+		if (gl_get_translation_master_string(gl_get_translation(catalogs[0], 0)) != gl_get_translation_master_string(gl_get_translation(catalogs[i], 0))) {
+			gl_test_fail("Pipelined catalogs do not share their pool");
+		}
+	}
+
+	if (6 != gl_get_string_pool_count(pool)) {
+		gl_test_fail("Unexpected string pool statistics after pipelined fetch");
+	}
+
+	for (i = 0; test_languages[i]; ++i) {
+		gl_free_translations(catalogs[i]);
+	}
+	gl_free_languages(languages);
+	gl_free_session(session);
+	gl_free_string_pool(pool);
+}
+
+
+
+/**
+ * Appends the code of every fetched language to the order string
+ */
+static void gl_test_record_order(
+			struct gl_language* language,
+			struct gl_translations* translations,
+			void* context
+		) {
+	uint8_t* order = context;
+
+	strcat(order, gl_get_language_code(language));
+	strcat(order, " ");
+	gl_free_translations(translations);
+}
+
+
+
+/**
+ * The most expensive languages have to be fetched first, languages without
+ * cost last in list order, and every fetched language has to be measured
+ */
+static void gl_test_schedule(__attribute__((unused)) struct test_server* server) {
+	struct gl_session* session = gl_create_session();
+	struct gl_languages* languages = gl_get_languages(session, "demo");
+
+	if (!languages) {
+		gl_test_fail("Cannot fetch language list");
+	}
+	gl_set_language_cost(languages, 0, 1.0);
+	gl_set_language_cost(languages, 2, 5.0);
+
+	uint8_t order[64] = {0};
+	if (!gl_fetch_translations(session, "demo", languages, 1, gl_test_record_order, order)) {
+		gl_test_fail("Cannot fetch demo translations");
+	}
+	if (strcmp("fr de ru ", order)) {
+		gl_test_fail("Languages were not fetched most expensive first");
+	}
+
+	size_t i = 0; for (; i < gl_get_languages_count(languages); ++i) {
+		if (!gl_get_language_bytes(languages, i) || gl_get_language_seconds(languages, i) <= 0) {
+			gl_test_fail("Fetched language was not measured");
+		}
+	}
+
+	gl_free_languages(languages);
+	gl_free_session(session);
+}
+
+
+
+/**
+ * Number of messages in the index fixture
+ */
+#define GL_TEST_INDEX_MESSAGES 1000
+
+
+
+/**
+ * Every translation has to be found by its master string and by its logical
+ * string, in copied as well as in zero copy catalogs
+ */
+static void gl_test_index(struct test_server* server) {
+	size_t capacity = 256 * (GL_TEST_INDEX_MESSAGES + 2);
+	uint8_t* body = malloc(capacity);
+	size_t length = snprintf(body, capacity, "<GLStrings>\n\t<product>index</product>\n");
+
+
+	/* Only even messages have a logical string, the last two messages
+	 * duplicate the first one's keys
+	 */
+	size_t n = 0; for (; n < GL_TEST_INDEX_MESSAGES + 2; ++n) {
+		size_t key = n < GL_TEST_INDEX_MESSAGES ? n : 0;
+		uint8_t logical[32] = "";
+
+		if (n == GL_TEST_INDEX_MESSAGES || (n < GL_TEST_INDEX_MESSAGES && !(n % 2))) {
+			snprintf(logical, sizeof(logical), "key_%lu", (unsigned long)key);
+		}
+
+		length += snprintf(&body[length], capacity - length,
+			"\t<GLString>\n"
+			"\t\t<MasterString>Message &quot;%lu&quot;</MasterString>\n"
+			"\t\t<LogicalString>%s</LogicalString>\n"
+			"\t\t<ContextInfo>index.c:%lu</ContextInfo>\n"
+			"\t\t<Translation>Nachricht %lu</Translation>\n"
+			"\t</GLString>\n",
+			(unsigned long)key, logical, (unsigned long)n, (unsigned long)n
+		);
+	}
+	length += snprintf(&body[length], capacity - length, "</GLStrings>\n");
+	test_server_add(server, "/strings/index/de", body, length);
+	free(body);
+
+
+	/* Look up every message twice, so the second round uses the index
+	 * built by the first one
+	 */
+	size_t mode = 0; for (; mode < 2; ++mode) {
+		struct gl_session* session = gl_create_session();
+		gl_set_session_zero_copy(session, mode);
+
+		struct gl_translations* translations = gl_get_translations(session, "index", "de");
+		if (!translations) {
+			gl_test_fail("Cannot fetch index fixture");
+		}
+
+		size_t round = 0; for (; round < 2; ++round) {
+			for (n = 0; n < GL_TEST_INDEX_MESSAGES; ++n) {
+				struct gl_translation* expected = gl_get_translation(translations, n);
+
+				uint8_t key[32];
+				snprintf(key, sizeof(key), "Message \"%lu\"", (unsigned long)n);
+				if (expected != gl_find_translation_by_master(translations, key)) {
+					gl_test_fail("Translation not found by master string");
+				}
+
+				snprintf(key, sizeof(key), "key_%lu", (unsigned long)n);
+				if ((n % 2 ? 0 : expected) != gl_find_translation_by_logical(translations, key)) {
+					gl_test_fail("Translation not found by logical string");
+				}
+			}
+		}
+
+		if (gl_find_translation_by_master(translations, "Message")
+				|| gl_find_translation_by_logical(translations, "")
+				|| gl_find_translation_by_logical(translations, "key_1")) {
+			gl_test_fail("Found translation which does not exist");
+		}
+
+		gl_free_translations(translations);
+		gl_free_session(session);
+	}
+	fprintf(stdout, "Found %lu translations by master and logical string\n", (unsigned long)GL_TEST_INDEX_MESSAGES);
+}
+
+
+
+/**
+ * A traced session has to record every phase of its requests and catalogs,
+ * and export them as Chrome trace events as well as a summary table
+ */
+static void gl_test_trace(__attribute__((unused)) struct test_server* server) {
+	struct gl_trace* trace = gl_create_trace();
+	struct gl_session* session = gl_create_session();
+	gl_set_session_trace(session, trace);
+
+	struct gl_languages* languages = gl_get_languages(session, "demo");
+	struct gl_translations* translations = gl_get_translations(session, "demo", "de");
+	if (!languages || !translations) {
+		gl_test_fail("Cannot fetch traced project");
+	}
+	gl_free_translations(translations);
+	gl_free_languages(languages);
+	gl_free_session(session);
+
+
+	/* Trace events of both requests, the first one had to connect
+	 */
+	char* events = 0;
+	size_t events_length = 0;
+	FILE* stream = open_memstream(&events, &events_length);
+
+	if (!gl_write_trace(trace, stream)) {
+		gl_test_fail("Cannot write trace");
+	}
+	fclose(stream);
+
+	uint8_t const* expected_events[] = {
+		"\"traceEvents\"",
+		"\"name\": \"download\"",
+		"\"name\": \"connect\"",
+		"\"name\": \"transfer\"",
+		"\"name\": \"parse\"",
+		"\"name\": \"copy\"",
+		"/languages/demo\"}}",
+		"/strings/demo/de\"}}",
+		0
+	};
+	uint8_t const** expected = expected_events; for (; *expected; ++expected) {
+		if (!strstr(events, *expected)) {
+			fprintf(stderr, "Trace lacks %s:\n%s", *expected, events);
+			gl_test_fail("Incomplete trace");
+		}
+	}
+	free(events);
+
+
+	/* Summary of every phase
+	 */
+	char* stats = 0;
+	size_t stats_length = 0;
+	stream = open_memstream(&stats, &stats_length);
+	gl_print_trace_stats(trace, stream);
+	fclose(stream);
+
+	if (!strstr(stats, "Phase") || !strstr(stats, "\ndownload ") || !strstr(stats, "\ncopy ")) {
+		fprintf(stderr, "%s", stats);
+		gl_test_fail("Incomplete trace summary");
+	}
+	fprintf(stdout, "%s", stats);
+
+	free(stats);
+	gl_free_trace(trace);
+}
+
+
+
+/**
+ * Catalogs built as views into the response have to equal copied catalogs,
+ * also when they are allocated inside a shared arena
+ */
+static void gl_test_zero_copy(__attribute__((unused)) struct test_server* server) {
+	struct gl_session* copying = gl_create_session();
+	struct gl_session* zero_copy = gl_create_session();
+	struct gl_arena* arena = gl_create_arena(256);
+
+	gl_set_session_zero_copy(zero_copy, true);
+	if (gl_get_session_zero_copy(copying) || !gl_get_session_zero_copy(zero_copy)) {
+		gl_test_fail("Unexpected zero copy setting");
+	}
+
+	uint8_t const** language = test_languages; for (; *language; ++language) {
+		struct gl_translations* expected = gl_get_translations(copying, "demo", *language);
+		struct gl_translations* views = gl_get_translations(zero_copy, "demo", *language);
+		struct gl_translations* arena_views = gl_get_translations_in_arena(zero_copy, "demo", *language, arena);
+
+		if (!expected || !views || !arena_views
+		 || gl_get_translations_count(expected) != gl_get_translations_count(views)
+		 || gl_get_translations_count(expected) != gl_get_translations_count(arena_views)) {
+			gl_test_fail("Unexpected zero copy translation list");
+		}
+
+		size_t i = 0; for (; i < gl_get_translations_count(expected); ++i) {
+			struct gl_translation* a = gl_get_translation(expected, i);
+			struct gl_translation* b = gl_get_translation(views, i);
+			struct gl_translation* c = gl_get_translation(arena_views, i);
+
+			if (strcmp(gl_get_translation_master_string(a), gl_get_translation_master_string(b))
+			 || strcmp(gl_get_translation_logical_string(a), gl_get_translation_logical_string(b))
+			 || strcmp(gl_get_translation_context_info(a), gl_get_translation_context_info(b))
+			 || strcmp(gl_get_translation_string(a), gl_get_translation_string(b))
+			 || strcmp(gl_get_translation_string(a), gl_get_translation_string(c))) {
+				gl_test_fail("Zero copy translation differs");
+			}
+			if (gl_get_translation_master_string_length(a) != gl_get_translation_master_string_length(b)
+			 || gl_get_translation_logical_string_length(a) != gl_get_translation_logical_string_length(b)
+			 || gl_get_translation_context_info_length(a) != gl_get_translation_context_info_length(b)
+			 || gl_get_translation_string_length(a) != gl_get_translation_string_length(b)
+			 || strlen(gl_get_translation_string(b)) != gl_get_translation_string_length(b)) {
+				gl_test_fail("Zero copy translation length differs");
+			}
+		}
+
+		gl_free_translations(expected);
+		gl_free_translations(views);
+		gl_free_translations(arena_views);
+		gl_reset_arena(arena);
+	}
+	fprintf(stdout, "Zero copy catalogs equal copied catalogs\n");
+
+	gl_free_arena(arena);
+	gl_free_session(zero_copy);
+	gl_free_session(copying);
+}
+
+
+
+/**
+ * Counts streamed translations of one language
+ */
+static void* gl_test_stream_begin(struct gl_language* language, void* context) {
+	size_t* counts = context;
+	size_t i = 0; for (; test_languages[i]; ++i) {
+		if (!strcmp(test_languages[i], gl_get_language_code(language))) {
+			return &counts[i];
+		}
+	}
+	gl_test_fail("Streamed unknown language");
+	return 0;
+}
+
+static bool gl_test_stream_translation(struct gl_translation* translation, void* stream) {
+	size_t* count = stream;
+
+	if (!*count && strcmp(gl_get_translation_master_string(translation), "Please wait...")) {
+		gl_test_fail("Unexpected streamed master string");
+	}
+	*count += 1;
+	return true;
+}
+
+static void gl_test_stream_end(	__attribute__((unused)) struct gl_language* language,
+				bool success,
+				__attribute__((unused)) void* stream
+		) {
+	if (!success) {
+		gl_test_fail("Streaming failed");
+	}
+}
+
+
+
+/**
+ * Streaming has to report the same translations as building catalogs
+ */
+static void gl_test_stream(__attribute__((unused)) struct test_server* server) {
+	struct gl_session* session = gl_create_session();
+	struct gl_languages* languages = gl_get_languages(session, "demo");
+	if (!languages) {
+		gl_test_fail("Cannot fetch language list");
+	}
+
+	struct gl_stream_callbacks callbacks = {
+		.begin = gl_test_stream_begin,
+		.translation = gl_test_stream_translation,
+		.end = gl_test_stream_end
+	};
+	size_t counts[3] = {0, 0, 0};
+
+	if (!gl_stream_translations(session, "demo", languages, 2, &callbacks, counts)) {
+		gl_test_fail("Streaming could not be set up");
+	}
+
+	size_t i = 0; for (; i < 3; ++i) {
+		if (2 != counts[i]) {
+			gl_test_fail("Not all translations were streamed");
+		}
+	}
+	fprintf(stdout, "Streamed %lu languages\n", (unsigned long)gl_get_languages_count(languages));
+
+	gl_free_languages(languages);
+	gl_free_session(session);
+}
+
+
+
+/**
+ * Checks the fields of the entries parsed by gl_test_glstrings_parser
+ */
+static bool gl_test_glstrings_entry(uint8_t* const* fields, size_t const* lengths, void* context) {
+	size_t* count = context;
+
+	uint8_t const* expected[2][GL_GLSTRINGS_FIELDS] = {
+		{"Say \"hi\" & <go>", "", "a.c:1", "Sag \"hallo\""},
+		{"Bye", "bye", "", ""}
+	};
+	if (*count >= 2) {
+		gl_test_fail("Too many GLString elements");
+	}
+
+	size_t i = 0; for (; i < GL_GLSTRINGS_FIELDS; ++i) {
+		if (strcmp(fields[i], expected[*count][i]) || strlen(fields[i]) != lengths[i]) {
+			fprintf(stderr, "Field %lu is `%s'\n", (unsigned long)i, fields[i]);
+			gl_test_fail("Unexpected GLString field");
+		}
+	}
+	*count += 1;
+	return true;
+}
+
+
+
+/**
+ * The streaming parser has to produce identical results no matter how the
+ * document is split into chunks
+ */
+static void gl_test_glstrings_parser() {
+	uint8_t const* document =
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<!-- generated -> by <GetLocalization> -->\n"
+		"<GLStrings>\n"
+		"\t<product>demo</product>\n"
+		"\t<GLString>\n"
+		"\t\t<MasterString>Say &quot;hi&quot; &amp; &lt;go&gt;</MasterString>\n"
+		"\t\t<LogicalString/>\n"
+		"\t\t<ContextInfo>a.c:1</ContextInfo>\n"
+		"\t\t<Translation lang=\"de\">Sag &quot;hallo&quot;</Translation>\n"
+		"\t</GLString>\n"
+		"\t<GLString>\n"
+		"\t\t<MasterString>Bye</MasterString>\n"
+		"\t\t<LogicalString>bye</LogicalString>\n"
+		"\t\t<ContextInfo></ContextInfo>\n"
+		"\t\t<Translation></Translation>\n"
+		"\t</GLString>\n"
+		"</GLStrings>\n"
+	;
+	size_t length = strlen(document);
+	uint8_t* buffer = malloc(length);
+
+	size_t in_place = 0; for (; in_place < 2; ++in_place) {
+		size_t chunk = 1; for (; chunk <= length; chunk *= 2) {
+			size_t count = 0;
+			struct gl_glstrings_parser* parser = gl_create_glstrings_parser(
+				gl_test_glstrings_entry, &count, in_place
+			);
+
+			/* In place parsing modifies the buffer
+			 */
+			memcpy(buffer, document, length);
+
+			size_t offset = 0; for (; offset < length; offset += chunk) {
+				size_t remaining = length - offset;
+				if (!gl_feed_glstrings_parser(parser, &buffer[offset], remaining < chunk ? remaining : chunk)) {
+					gl_test_fail("Parsing GLStrings chunk failed");
+				}
+			}
+			if (!gl_finish_glstrings_parser(parser) || 2 != count) {
+				gl_test_fail("GLStrings document incomplete");
+			}
+			gl_free_glstrings_parser(parser);
+		}
+	}
+	free(buffer);
+	fprintf(stdout, "Streaming parser is independent of chunk boundaries\n");
+}
+
+
+
+/**
+ * @return true iff `token' equals `expected' after decoding entities
+ */
+static bool gl_test_token_equals(struct gl_token const* token, uint8_t const* expected) {
+	uint8_t* decoded = malloc(token->length + 1);
+	memcpy(decoded, token->data, token->length);
+	decoded[token->length] = 0;
+
+	if (token->escaped) {
+		decode_html_entities_utf8(decoded, 0);
+	}
+	bool equals = !strcmp(decoded, expected)
+		&& token->escaped == (0 != memchr(token->data, '&', token->length))
+	;
+	free(decoded);
+	return equals;
+}
+
+
+
+/**
+ * Every kernel has to locate the same fields and reject everything but the
+ * exact schema, so callers can fall back to xml.c
+ */
+static void gl_test_tokenizer() {
+	uint8_t const* glstrings =
+		"\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<GLStrings>\n"
+		"\t<product>demo</product>\n"
+		"\t<GLString>\n"
+		"\t\t<MasterString>Say &quot;hi&quot; &amp; &lt;go&gt;</MasterString>\n"
+		"\t\t<LogicalString/>\n"
+		"\t\t<ContextInfo>a.c:1</ContextInfo>\n"
+		"\t\t<Translation lang=\"a>b\">Sag &quot;hallo&quot;</Translation>\n"
+		"\t</GLString>\n"
+		"\t<GLString>\n"
+		"\t\t<Translation>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod</Translation>\n"
+		"\t\t<MasterString>Bye</MasterString>\n"
+		"\t</GLString>\n"
+		"</GLStrings>\n"
+	;
+	uint8_t const* expected[2][GL_TOKENIZER_FIELDS] = {
+		{"Say \"hi\" & <go>", "", "a.c:1", "Sag \"hallo\""},
+		{"Bye", "", "", "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod"}
+	};
+	uint8_t const* languages =
+		"<Languages>\n"
+		"\t<Language><Name>German</Name><IanaCode>de</IanaCode></Language>\n"
+		"\t<Language>\n"
+		"\t\t<Name>Russian</Name>\n"
+		"\t\t<IanaCode >ru</IanaCode >\n"
+		"\t</Language>\n"
+		"</Languages>"
+	;
+	uint8_t const* rejected[] = {
+		"<!-- comment --><Languages></Languages>",
+		"<Languages><Language><Name><![CDATA[German]]></Name></Language></Languages>",
+		"<Languages><Language><Name>German<!-- comment --></Name></Language></Languages>",
+		"<Languages><Language><Code>de</Code></Language></Languages>",
+		"<Languages><Language><Name>German</Name></Language>",
+		"<Languages></Languages>trailing",
+		"<Languages><Language><Name lang='a>b'>German</Name></Language></Languages>",
+		"<GLStrings></GLStrings>",
+		0
+	};
+
+	enum gl_tokenizer_kernel kernel = GL_TOKENIZER_KERNEL_SCALAR; for (; kernel < GL_TOKENIZER_KERNELS; ++kernel) {
+		if (!gl_is_tokenizer_kernel_supported(kernel)) {
+			fprintf(stdout, "Skipping unsupported tokenizer kernel %s\n", gl_get_tokenizer_kernel_name(kernel));
+			continue;
+		}
+
+		size_t count = 0;
+		struct gl_token* tokens = gl_tokenize(GL_TOKENIZER_GLSTRINGS, kernel, glstrings, strlen(glstrings), &count);
+		if (!tokens || 2 != count) {
+			gl_test_fail("GLStrings document was not tokenized");
+		}
+
+		size_t i = 0; for (; i < 2 * GL_TOKENIZER_FIELDS; ++i) {
+			if (!gl_test_token_equals(&tokens[i], expected[i / GL_TOKENIZER_FIELDS][i % GL_TOKENIZER_FIELDS])) {
+				fprintf(stderr, "Token %lu is `%.*s'\n", (unsigned long)i, (int)tokens[i].length, tokens[i].data);
+				gl_test_fail("Unexpected GLStrings token");
+			}
+		}
+		free(tokens);
+
+		tokens = gl_tokenize(GL_TOKENIZER_LANGUAGES, kernel, languages, strlen(languages), &count);
+		if (	!tokens || 2 != count
+		||	!gl_test_token_equals(&tokens[0], "German")
+		||	!gl_test_token_equals(&tokens[1], "de")
+		||	!gl_test_token_equals(&tokens[GL_TOKENIZER_FIELDS], "Russian")
+		||	!gl_test_token_equals(&tokens[GL_TOKENIZER_FIELDS + 1], "ru")) {
+			gl_test_fail("Unexpected Languages tokens");
+		}
+		free(tokens);
+
+		uint8_t const** document = rejected; for (; *document; ++document) {
+			if (gl_tokenize(GL_TOKENIZER_LANGUAGES, kernel, *document, strlen(*document), &count)) {
+				fprintf(stderr, "Accepted `%s'\n", *document);
+				gl_test_fail("Tokenizer accepted unexpected document");
+			}
+		}
+		fprintf(stdout, "Tokenizer kernel %s locates all fields\n", gl_get_tokenizer_kernel_name(kernel));
+	}
+}
+
+
+
+
+
+/**
+ * Removes a flat directory created by a test
+ */
+static void gl_test_remove_directory(uint8_t const* directory) {
+	DIR* entries = opendir(directory);
+	struct dirent* entry = 0;
+
+	while (entries && (entry = readdir(entries))) {
+		if ('.' == entry->d_name[0]) {
+			continue;
+		}
+
+		uint8_t path[4096];
+		snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+		unlink(path);
+	}
+	if (entries) {
+		closedir(entries);
+	}
+	rmdir(directory);
+}
+
+
+
+/**
+ * Generates `file' inside `directory'
+ *
+ * @return Result of closing the output
+ */
+static enum gl_output_result gl_test_write_output(
+			uint8_t const* directory, uint8_t const* file,
+			uint8_t const* stamp, uint8_t const* contents
+		) {
+	struct gl_output* output = gl_open_output(directory, file);
+	if (!output) {
+		gl_test_fail("Cannot open output");
+	}
+
+	gl_set_output_volatile_line(output, "Stamp: ");
+	fprintf(gl_get_output_stream(output), "Header\nStamp: %s\n%s", stamp, contents);
+	return gl_close_output(output);
+}
+
+
+
+/**
+ * Output files have to be replaced iff anything but their volatile line
+ * changed
+ */
+static void gl_test_output() {
+	uint8_t directory[] = "/tmp/gltoolkit-output-XXXXXX";
+	if (!mkdtemp(directory)) {
+		gl_test_fail("Cannot create output directory");
+	}
+
+	uint8_t path[4096];
+	snprintf(path, sizeof(path), "%s/%s", directory, "de.po");
+
+	if (	GL_OUTPUT_WRITTEN != gl_test_write_output(directory, "de.po", "1", "Hallo\n")
+	||	GL_OUTPUT_UNCHANGED != gl_test_write_output(directory, "de.po", "2", "Hallo\n")
+	||	GL_OUTPUT_WRITTEN != gl_test_write_output(directory, "de.po", "3", "Hallo Welt\n")
+	||	GL_OUTPUT_WRITTEN != gl_test_write_output(directory, "de.po", "4", "")) {
+		gl_test_fail("Unexpected output result");
+	}
+
+
+	/* Unchanged runs keep the time stamp of the last change
+	 */
+	uint8_t contents[64] = {0};
+	FILE* file = fopen(path, "rb");
+	fread(contents, 1, sizeof(contents) - 1, file);
+	fclose(file);
+
+	if (strcmp(contents, "Header\nStamp: 4\n")) {
+		gl_test_fail("Unexpected output contents");
+	}
+	if (GL_OUTPUT_UNCHANGED != gl_test_write_output(directory, "de.po", "5", "")) {
+		gl_test_fail("Output rewritten without changes");
+	}
+
+
+	/* Replaced files get the permissions of any other new file
+	 */
+	mode_t mask = umask(027);
+	gl_test_write_output(directory, "de.po", "6", "Hallo\n");
+	umask(mask);
+
+	struct stat status;
+	if (stat(path, &status) || 0640 != (status.st_mode & 0777)) {
+		gl_test_fail("Output ignores the file mode creation mask");
+	}
+	fprintf(stdout, "Output files are only replaced if changed\n");
+
+	gl_test_remove_directory(directory);
+}
+
+
+
+/**
+ * Unchanged resources have to be revalidated with conditional requests and
+ * served from the cache, changed resources have to replace the cached ones.
+ * Catalogs and streams have to see identical data in all cases
+ */
+static void gl_test_cache(struct test_server* server) {
+	uint8_t directory[] = "/tmp/gltoolkit-cache-XXXXXX";
+	if (!mkdtemp(directory)) {
+		gl_test_fail("Cannot create cache directory");
+	}
+
+	/* Runs 0 and 2 download everything, because the cache is empty or all
+	 * resources changed, runs 1 and 3 are answered with 304 only
+	 */
+	size_t run = 0; for (; run < 4; ++run) {
+		size_t not_modified = test_server_not_modified(server);
+
+		if (2 == run) {
+			gl_test_serve_project(server);
+		}
+
+		struct gl_session* session = gl_create_session();
+		if (!gl_set_session_cache(session, directory)) {
+			gl_test_fail("Cannot use cache directory");
+		}
+
+		struct gl_languages* languages = gl_get_languages(session, "demo");
+		if (!languages || 3 != gl_get_languages_count(languages)) {
+			gl_test_fail("Unexpected cached language list");
+		}
+
+
+		/* Cached bodies have to reach both catalogs and sinks
+		 */
+		if (run < 2) {
+			size_t received = 0;
+
+			if (!gl_fetch_translations(session, "demo", languages, 2, gl_test_count_translations, &received) || 3 != received) {
+				gl_test_fail("Cached fetch failed");
+			}
+		} else {
+			struct gl_stream_callbacks callbacks = {
+				.begin = gl_test_stream_begin,
+				.translation = gl_test_stream_translation,
+				.end = gl_test_stream_end
+			};
+			size_t counts[3] = {0, 0, 0};
+
+			if (!gl_stream_translations(session, "demo", languages, 2, &callbacks, counts)) {
+				gl_test_fail("Cached stream failed");
+			}
+			if (2 != counts[0] || 2 != counts[1] || 2 != counts[2]) {
+				gl_test_fail("Not all cached translations were streamed");
+			}
+		}
+
+		size_t expected = (run % 2) ? 4 : 0;
+		size_t revalidated = gl_get_session_revalidated(session);
+
+		fprintf(stdout, "Cached run %lu revalidated %lu of %lu requests\n",
+			(unsigned long)run,
+			(unsigned long)revalidated,
+			(unsigned long)gl_get_session_requests(session)
+		);
+		if (expected != revalidated || expected != test_server_not_modified(server) - not_modified) {
+			gl_test_fail("Unexpected number of revalidated responses");
+		}
+
+		gl_free_languages(languages);
+		gl_free_session(session);
+	}
+
+	gl_test_remove_directory(directory);
+}
+
+
+
+/**
+ * Number of translated messages in the mo fixture
+ */
+#define GL_TEST_MO_MESSAGES 40
+
+/**
+ * Header entry of the mo fixture
+ */
+#define GL_TEST_MO_HEADER \
+	"Project-Id-Version: mo\n" \
+	"MIME-Version: 1.0\n" \
+	"Content-Type: text/plain; charset=UTF-8\n" \
+	"Content-Transfer-Encoding: 8bit\n" \
+	"Language: de\n"
+
+
+
+/**
+ * Registers the project `mo' containing translated, untranslated and
+ * duplicated messages
+ */
+static void gl_test_serve_mo(struct test_server* server) {
+	size_t capacity = 65536;
+	uint8_t* body = malloc(capacity);
+	size_t length = snprintf(body, capacity, "<GLStrings>\n\t<product>mo</product>\n");
+
+	size_t i = 0; for (; i < GL_TEST_MO_MESSAGES + 2; ++i) {
+		uint8_t master_string[32];
+		uint8_t translation[32];
+
+		/* Last two messages are untranslated and a duplicate
+		 */
+		snprintf(master_string, sizeof(master_string), "Message %lu", (unsigned long)(i % GL_TEST_MO_MESSAGES));
+		snprintf(translation, sizeof(translation), i < GL_TEST_MO_MESSAGES ? "Nachricht %lu" : "", (unsigned long)i);
+		if (GL_TEST_MO_MESSAGES == i) {
+			snprintf(master_string, sizeof(master_string), "Untranslated");
+		}
+
+		length += snprintf(&body[length], capacity - length,
+			"\t<GLString>\n"
+			"\t\t<MasterString>%s</MasterString>\n"
+			"\t\t<LogicalString></LogicalString>\n"
+			"\t\t<ContextInfo></ContextInfo>\n"
+			"\t\t<Translation>%s</Translation>\n"
+			"\t</GLString>\n",
+			master_string, translation
+		);
+	}
+	length += snprintf(&body[length], capacity - length, "</GLStrings>\n");
+
+	test_server_add(server, "/strings/mo/de", body, length);
+	free(body);
+}
+
+
+
+/**
+ * Looks up `original' in a mo catalog like gettext does
+ *
+ * @return Translation or 0
+ */
+static uint8_t const* gl_test_mo_lookup(uint8_t const* mo, uint8_t const* original) {
+	uint32_t const* header = (uint32_t const*)mo;
+	uint32_t const* originals = (uint32_t const*)&mo[header[3]];
+	uint32_t const* translations = (uint32_t const*)&mo[header[4]];
+	uint32_t const* hash_table = (uint32_t const*)&mo[header[6]];
+	uint32_t hash_size = header[5];
+
+	uint32_t hash = gl_mo_hash(original);
+	uint32_t slot = hash % hash_size;
+	uint32_t increment = 1 + (hash % (hash_size - 2));
+
+	while (hash_table[slot]) {
+		uint32_t n = hash_table[slot] - 1;
+
+		if (!strcmp(&mo[originals[2 * n + 1]], original)) {
+			return &mo[translations[2 * n + 1]];
+		}
+		slot = slot >= hash_size - increment ? slot - (hash_size - increment) : slot + increment;
+	}
+	return 0;
+}
+
+
+
+/**
+ * Directly written mo catalogs have to be found by gettext's hash lookup and
+ * equal the output of msgfmt, if available
+ */
+static void gl_test_mo(struct test_server* server) {
+	uint8_t directory[] = "/tmp/gltoolkit-mo-XXXXXX";
+	if (!mkdtemp(directory)) {
+		gl_test_fail("Cannot create mo directory");
+	}
+	uint8_t po_path[4096];
+	uint8_t mo_path[4096];
+	uint8_t msgfmt_path[4096];
+	snprintf(po_path, sizeof(po_path), "%s/de.po", directory);
+	snprintf(mo_path, sizeof(mo_path), "%s/de.mo", directory);
+	snprintf(msgfmt_path, sizeof(msgfmt_path), "%s/msgfmt.mo", directory);
+
+	gl_test_serve_mo(server);
+	struct gl_session* session = gl_create_session();
+	struct gl_translations* translations = gl_get_translations(session, "mo", "de");
+	if (!translations) {
+		gl_test_fail("Cannot fetch mo fixture");
+	}
+
+
+	/* Write and read back catalog
+	 */
+	FILE* file = fopen(mo_path, "wb");
+	if (!gl_write_mo(file, GL_TEST_MO_HEADER, translations)) {
+		gl_test_fail("Cannot write mo catalog");
+	}
+	fclose(file);
+
+	uint8_t mo[65536];
+	file = fopen(mo_path, "rb");
+	size_t mo_length = fread(mo, 1, sizeof(mo), file);
+	fclose(file);
+
+	uint32_t const* header = (uint32_t const*)mo;
+	if (0x950412de != header[0] || GL_TEST_MO_MESSAGES + 1 != header[2] || gl_mo_hash_size(header[2]) != header[5]) {
+		gl_test_fail("Unexpected mo header");
+	}
+
+	size_t i = 0; for (; i < GL_TEST_MO_MESSAGES; ++i) {
+		uint8_t original[32];
+		uint8_t expected[32];
+		snprintf(original, sizeof(original), "Message %lu", (unsigned long)i);
+		snprintf(expected, sizeof(expected), "Nachricht %lu", (unsigned long)i);
+
+		uint8_t const* translation = gl_test_mo_lookup(mo, original);
+		if (!translation || strcmp(translation, expected)) {
+			gl_test_fail("Unexpected mo translation");
+		}
+	}
+	if (strcmp(gl_test_mo_lookup(mo, ""), GL_TEST_MO_HEADER) || gl_test_mo_lookup(mo, "Untranslated")) {
+		gl_test_fail("Unexpected mo header or untranslated message");
+	}
+
+
+	/* Compare with msgfmt output of the equivalent po file
+	 */
+	if (system("msgfmt --version >/dev/null 2>&1")) {
+		fprintf(stdout, "msgfmt not found, skipping byte comparison of mo catalogs\n");
+	} else {
+		file = fopen(po_path, "wb");
+		fprintf(file, "msgid \"\"\nmsgstr \"\"\n");
+
+		uint8_t const* line = GL_TEST_MO_HEADER; while (*line) {
+			size_t length = strcspn(line, "\n");
+			fprintf(file, "\"%.*s\\n\"\n", (int)length, line);
+			line += length + 1;
+		}
+		for (i = 0; i < GL_TEST_MO_MESSAGES + 1; ++i) {
+			struct gl_translation* translation = gl_get_translation(translations, i);
+			fprintf(file, "\nmsgid \"%s\"\nmsgstr \"%s\"\n",
+				gl_get_translation_master_string(translation),
+				gl_get_translation_string(translation)
+			);
+		}
+		fclose(file);
+
+		uint8_t command[3 * 4096];
+		snprintf(command, sizeof(command), "msgfmt -o %s %s", msgfmt_path, po_path);
+		if (system(command)) {
+			gl_test_fail("msgfmt failed");
+		}
+
+		uint8_t expected[65536];
+		file = fopen(msgfmt_path, "rb");
+		size_t expected_length = fread(expected, 1, sizeof(expected), file);
+		fclose(file);
+
+		if (expected_length != mo_length || memcmp(expected, mo, mo_length)) {
+			gl_test_fail("mo catalog differs from msgfmt output");
+		}
+		fprintf(stdout, "mo catalog equals msgfmt output\n");
+	}
+	fprintf(stdout, "Wrote mo catalog of %lu bytes with %lu hash slots\n",
+		(unsigned long)mo_length, (unsigned long)header[5]
+	);
+
+	gl_free_translations(translations);
+	gl_free_session(session);
+	gl_test_remove_directory(directory);
+}
+
+
+
+/**
+ * Compiled catalogs have to resolve every translated message, reject all
+ * other keys and refuse truncated files
+ */
+static void gl_test_phf(struct test_server* server) {
+	uint8_t directory[] = "/tmp/gltoolkit-phf-XXXXXX";
+	if (!mkdtemp(directory)) {
+		gl_test_fail("Cannot create phf directory");
+	}
+	uint8_t path[4096];
+	snprintf(path, sizeof(path), "%s/de.phf", directory);
+
+	gl_test_serve_mo(server);
+	struct gl_session* session = gl_create_session();
+	struct gl_translations* translations = gl_get_translations(session, "mo", "de");
+	if (!translations) {
+		gl_test_fail("Cannot fetch mo fixture");
+	}
+
+
+	/* Keyed by master string
+	 */
+	FILE* file = fopen(path, "wb");
+	if (!gl_write_phf(file, GL_PHF_MASTER_STRING, translations)) {
+		gl_test_fail("Cannot write compiled catalog");
+	}
+	fclose(file);
+
+	struct gl_phf phf;
+	if (!gl_phf_open(&phf, path) || GL_TEST_MO_MESSAGES != phf.count) {
+		gl_test_fail("Cannot open compiled catalog");
+	}
+
+	size_t i = 0; for (; i < GL_TEST_MO_MESSAGES; ++i) {
+		uint8_t original[32];
+		uint8_t expected[32];
+		snprintf(original, sizeof(original), "Message %lu", (unsigned long)i);
+		snprintf(expected, sizeof(expected), "Nachricht %lu", (unsigned long)i);
+
+		char const* translation = gl_phf_get(&phf, original);
+		if (!translation || strcmp(translation, expected)) {
+			gl_test_fail("Unexpected compiled translation");
+		}
+	}
+	if (gl_phf_get(&phf, "Untranslated") || gl_phf_get(&phf, "Message") || gl_phf_get(&phf, "")) {
+		gl_test_fail("Compiled catalog resolved unknown key");
+	}
+
+	size_t length = phf.length;
+	gl_phf_close(&phf);
+
+	if (truncate(path, length - 1) || gl_phf_open(&phf, path)) {
+		gl_test_fail("Truncated compiled catalog was accepted");
+	}
+
+
+	/* Slots pointing at strings without terminator are rejected
+	 */
+	char* buffer = 0;
+	size_t buffer_length = 0;
+
+	size_t corruption = 0; for (; corruption < 2; ++corruption) {
+		file = open_memstream(&buffer, &buffer_length);
+		if (!gl_write_phf(file, GL_PHF_MASTER_STRING, translations)) {
+			gl_test_fail("Cannot write compiled catalog");
+		}
+		fclose(file);
+
+		struct gl_phf_header const* header = (struct gl_phf_header const*)buffer;
+		struct gl_phf_slot* slots = (struct gl_phf_slot*)&buffer[header->slots_offset];
+
+		for (i = 0; i < header->count; ++i) {
+			if (corruption) {
+				slots[i].translation_length += 1;
+			} else {
+				buffer[slots[i].key_offset + slots[i].key_length] = 'x';
+			}
+		}
+
+		if (!gl_phf_map(&phf, buffer, buffer_length) || gl_phf_get(&phf, "Message 0") || gl_phf_get(&phf, "Message 1")) {
+			gl_test_fail("Compiled catalog resolved unterminated string");
+		}
+		gl_phf_close(&phf);
+		free(buffer);
+	}
+
+
+	/* Keyed by the logical strings, which are all empty
+	 */
+	file = open_memstream(&buffer, &buffer_length);
+	if (!gl_write_phf(file, GL_PHF_LOGICAL_STRING, translations)) {
+		gl_test_fail("Cannot write empty compiled catalog");
+	}
+	fclose(file);
+
+	if (!gl_phf_map(&phf, buffer, buffer_length) || phf.count || gl_phf_get(&phf, "Message 0")) {
+		gl_test_fail("Unexpected empty compiled catalog");
+	}
+	gl_phf_close(&phf);
+	free(buffer);
+
+	gl_free_translations(translations);
+	gl_free_session(session);
+	gl_test_remove_directory(directory);
+}
+
+
+
+/**
+ * Generated C and C++ sources of languages with different ids have to compile
+ * together and resolve every string, the C++ lookups at compile time. Both are
+ * skipped iff no compiler is available
+ */
+static void gl_test_codegen(struct test_server* server) {
+	uint8_t directory[] = "/tmp/gltoolkit-codegen-XXXXXX";
+	if (!mkdtemp(directory)) {
+		gl_test_fail("Cannot create codegen directory");
+	}
+
+	uint8_t const* body =
+		"<GLStrings>\n\t<product>codegen</product>\n"
+		"\t<GLString>\n\t\t<MasterString>Please wait...</MasterString>\n\t\t<LogicalString>menu.wait</LogicalString>\n"
+		"\t\t<ContextInfo></ContextInfo>\n\t\t<Translation>Bitte warten...</Translation>\n\t</GLString>\n"
+		"\t<GLString>\n\t\t<MasterString>Quote &quot; ?" "?=</MasterString>\n\t\t<LogicalString>1st-level</LogicalString>\n"
+		"\t\t<ContextInfo></ContextInfo>\n\t\t<Translation>Zitat &quot;\\ ?" "?= &#252;</Translation>\n\t</GLString>\n"
+		"\t<GLString>\n\t\t<MasterString>Untranslated</MasterString>\n\t\t<LogicalString>menu.untranslated</LogicalString>\n"
+		"\t\t<ContextInfo></ContextInfo>\n\t\t<Translation></Translation>\n\t</GLString>\n"
+		"\t<GLString>\n\t\t<MasterString>No id</MasterString>\n\t\t<LogicalString></LogicalString>\n"
+		"\t\t<ContextInfo></ContextInfo>\n\t\t<Translation>Keine ID</Translation>\n\t</GLString>\n"
+		"</GLStrings>\n"
+	;
+	test_server_add(server, "/strings/codegen/or", body, strlen(body));
+
+	/* `menu.start' and `menu_start' collide
+	 */
+	uint8_t const* other =
+		"<GLStrings>\n\t<product>codegen</product>\n"
+		"\t<GLString>\n\t\t<MasterString>Please wait...</MasterString>\n\t\t<LogicalString>menu.wait</LogicalString>\n"
+		"\t\t<ContextInfo></ContextInfo>\n\t\t<Translation>Moment...</Translation>\n\t</GLString>\n"
+		"\t<GLString>\n\t\t<MasterString>Start</MasterString>\n\t\t<LogicalString>menu_start</LogicalString>\n"
+		"\t\t<ContextInfo></ContextInfo>\n\t\t<Translation>Los</Translation>\n\t</GLString>\n"
+		"\t<GLString>\n\t\t<MasterString>Begin</MasterString>\n\t\t<LogicalString>menu.start</LogicalString>\n"
+		"\t\t<ContextInfo></ContextInfo>\n\t\t<Translation>Beginnen</Translation>\n\t</GLString>\n"
+		"</GLStrings>\n"
+	;
+	test_server_add(server, "/strings/codegen/de", other, strlen(other));
+
+	struct gl_session* session = gl_create_session();
+	struct gl_translations* translations = gl_get_translations(session, "codegen", "or");
+	struct gl_translations* other_translations = gl_get_translations(session, "codegen", "de");
+	if (!translations || !other_translations) {
+		gl_test_fail("Cannot fetch codegen fixture");
+	}
+
+
+	/* Language `or' is a C++ keyword
+	 */
+	uint8_t path[4096];
+	snprintf(path, sizeof(path), "%s/codegen_ids.h", directory);
+	FILE* file = fopen(path, "wb");
+	struct gl_translations* catalogs[] = {translations, 0, other_translations};
+	size_t collisions = 0;
+	bool written = gl_write_ids_header(file, "codegen", catalogs, 3, &collisions);
+	fclose(file);
+
+	if (1 != collisions || !strstr(gl_get_error(), "`menu.start' and `menu_start'")) {
+		gl_test_fail("Expected one id collision");
+	}
+
+	snprintf(path, sizeof(path), "%s/codegen_or.h", directory);
+	file = fopen(path, "wb");
+	written = gl_write_c_header(file, "codegen", "or", translations) && written;
+	fclose(file);
+
+	snprintf(path, sizeof(path), "%s/codegen_or.c", directory);
+	file = fopen(path, "wb");
+	written = gl_write_c_source(file, "codegen_or.h", "codegen", "or", translations) && written;
+	fclose(file);
+
+	snprintf(path, sizeof(path), "%s/codegen_or.hpp", directory);
+	file = fopen(path, "wb");
+	written = gl_write_cpp_header(file, "codegen", "or", translations) && written;
+	fclose(file);
+
+	snprintf(path, sizeof(path), "%s/codegen_de.h", directory);
+	file = fopen(path, "wb");
+	written = gl_write_c_header(file, "codegen", "de", other_translations) && written;
+	fclose(file);
+
+	snprintf(path, sizeof(path), "%s/codegen_de.c", directory);
+	file = fopen(path, "wb");
+	written = gl_write_c_source(file, "codegen_de.h", "codegen", "de", other_translations) && written;
+	fclose(file);
+
+	snprintf(path, sizeof(path), "%s/codegen_de.hpp", directory);
+	file = fopen(path, "wb");
+	written = gl_write_cpp_header(file, "codegen", "de", other_translations) && written;
+	fclose(file);
+
+	if (!written) {
+		gl_test_fail("Cannot write generated sources");
+	}
+
+
+	/* C sources
+	 */
+	uint8_t command[3 * 4096];
+
+	if (system("cc --version >/dev/null 2>&1")) {
+		fprintf(stdout, "cc not found, skipping compilation of generated C sources\n");
+	} else {
+		snprintf(path, sizeof(path), "%s/test.c", directory);
+		file = fopen(path, "wb");
+		fprintf(file,
+			"#include <string.h>\n"
+			"#include \"codegen_or.h\"\n"
+			"#include \"codegen_de.h\"\n"
+			"int main(void) {\n"
+			"\treturn 4 != CODEGEN_STRING_COUNT || 0 != CODEGEN_1ST_LEVEL\n"
+			"\t\t|| codegen_or_get(CODEGEN_MENU_START) || codegen_de_get(CODEGEN_1ST_LEVEL)\n"
+			"\t\t|| strcmp(codegen_de_get(CODEGEN_MENU_START), \"Beginnen\")\n"
+			"\t\t|| strcmp(codegen_de_get(CODEGEN_MENU_WAIT), \"Moment...\")\n"
+			"\t\t|| strcmp(codegen_or_get(CODEGEN_MENU_WAIT), \"Bitte warten...\")\n"
+			"\t\t|| strcmp(codegen_or_get(CODEGEN_MENU_UNTRANSLATED), \"Untranslated\")\n"
+			"\t\t|| strcmp(codegen_or_get(CODEGEN_1ST_LEVEL), \"Zitat \\\"\\\\ ?\\?= \\303\\274\")\n"
+			"\t\t|| strcmp(codegen_or_gettext(\"Quote \\\" ?\\?=\"), \"Zitat \\\"\\\\ ?\\?= \\303\\274\")\n"
+			"\t\t|| strcmp(codegen_or_gettext(\"No id\"), \"Keine ID\")\n"
+			"\t\t|| strcmp(codegen_or_gettext(\"Unknown\"), \"Unknown\");\n"
+			"}\n"
+		);
+		fclose(file);
+
+		snprintf(command, sizeof(command),
+			"cc -std=c99 -pedantic -Wall -Werror -o %s/test %s/test.c %s/codegen_or.c %s/codegen_de.c && %s/test",
+			directory, directory, directory, directory, directory
+		);
+		if (system(command)) {
+			gl_test_fail("Generated C sources do not work");
+		}
+	}
+
+
+	/* C++ header, together with the C header
+	 */
+	if (system("c++ --version >/dev/null 2>&1")) {
+		fprintf(stdout, "c++ not found, skipping compilation of generated C++ header\n");
+	} else {
+		snprintf(path, sizeof(path), "%s/test.cpp", directory);
+		file = fopen(path, "wb");
+		fprintf(file,
+			"#include \"codegen_or.h\"\n"
+			"#include \"codegen_or.hpp\"\n"
+			"#include \"codegen_de.hpp\"\n"
+			"static_assert(!codegen::de::get(CODEGEN_1ST_LEVEL), \"missing\");\n"
+			"static_assert(!codegen::de::compare(codegen::de::get(CODEGEN_MENU_START), \"Beginnen\"), \"collision\");\n"
+			"using namespace codegen::or_;\n"
+			"static_assert(!compare(get(CODEGEN_MENU_WAIT), \"Bitte warten...\"), \"get\");\n"
+			"static_assert(!compare(gettext(\"Please wait...\"), \"Bitte warten...\"), \"gettext\");\n"
+			"static_assert(!compare(gettext(\"Untranslated\"), \"Untranslated\"), \"untranslated\");\n"
+			"static_assert(!compare(gettext(\"Unknown\"), \"Unknown\"), \"unknown\");\n"
+			"int main() {\n"
+			"}\n"
+		);
+		fclose(file);
+
+		snprintf(command, sizeof(command),
+			"c++ -std=c++14 -pedantic -Wall -Werror -c -o %s/test.o %s/test.cpp",
+			directory, directory
+		);
+		if (system(command)) {
+			gl_test_fail("Generated C++ header does not work");
+		}
+	}
+
+	gl_free_translations(other_translations);
+	gl_free_translations(translations);
+	gl_free_session(session);
+	gl_test_remove_directory(directory);
+}
+
+
+
+/**
+ * Number of messages in the compressed fixture
+ */
+#define GL_TEST_GZIP_MESSAGES 500
+
+
+
+/**
+ * Compressed catalogs have to be decoded transparently, while the session
+ * counts compressed bytes on the wire
+ */
+static void gl_test_compression(struct test_server* server) {
+	size_t capacity = 256 * (GL_TEST_GZIP_MESSAGES + 1);
+	uint8_t* body = malloc(capacity);
+	size_t length = snprintf(body, capacity, "<GLStrings>\n\t<product>gzip</product>\n");
+
+	size_t i = 0; for (; i < GL_TEST_GZIP_MESSAGES; ++i) {
+		length += snprintf(&body[length], capacity - length,
+			"\t<GLString>\n"
+			"\t\t<MasterString>Message %lu</MasterString>\n"
+			"\t\t<LogicalString></LogicalString>\n"
+			"\t\t<ContextInfo>../src/game/objects/weapons.cpp:%lu ../src/game/objects/weapons.cpp:%lu</ContextInfo>\n"
+			"\t\t<Translation>Nachricht %lu</Translation>\n"
+			"\t</GLString>\n",
+			(unsigned long)i, (unsigned long)i, (unsigned long)(2 * i), (unsigned long)i
+		);
+	}
+	length += snprintf(&body[length], capacity - length, "</GLStrings>\n");
+	test_server_add_gzip(server, "/strings/gzip/de", body, length);
+
+
+	/* Fetch catalog
+	 */
+	struct gl_session* session = gl_create_session();
+	struct gl_translations* translations = gl_get_translations(session, "gzip", "de");
+
+	if (!translations || GL_TEST_GZIP_MESSAGES != gl_get_translations_count(translations)) {
+		gl_test_fail("Unexpected compressed translation list");
+	}
+	if (strcmp(gl_get_translation_string(gl_get_translation(translations, GL_TEST_GZIP_MESSAGES - 1)), "Nachricht 499")) {
+		gl_test_fail("Unexpected compressed translation");
+	}
+
+	size_t wire_bytes = gl_get_session_wire_bytes(session);
+	size_t decoded_bytes = gl_get_session_decoded_bytes(session);
+
+	fprintf(stdout, "Compressed catalog of %lu bytes took %lu bytes on the wire\n",
+		(unsigned long)decoded_bytes, (unsigned long)wire_bytes
+	);
+	if (length != decoded_bytes || 4 * wire_bytes > decoded_bytes) {
+		gl_test_fail("Catalog was not transferred compressed");
+	}
+
+	gl_free_translations(translations);
+	gl_free_session(session);
+	free(body);
+}
+
+
+
+/**
+ * Number of messages in the po writer fixture, message n is n bytes long
+ */
+#define GL_TEST_PO_MESSAGES 80
+
+
+
+/**
+ * @return k-th byte of the po writer fixture message of `length' bytes, every
+ *     fifth byte has to be escaped
+ */
+static uint8_t gl_test_po_byte(size_t length, size_t k) {
+	uint8_t const* special = "\"\\\n\t";
+
+	if (k % 5 == length % 5) {
+		return special[(k + length) % 4];
+	}
+	return 'a' + k % 26;
+}
+
+
+
+/**
+ * Serializes `translations' with `kernel'
+ *
+ * @return Contents of the po file, has to be freed by the caller
+ */
+static char* gl_test_po_serialize(struct gl_translations* translations, enum gl_po_kernel kernel) {
+	char* data = 0;
+	size_t length = 0;
+	FILE* stream = open_memstream(&data, &length);
+
+	struct gl_po_writer* writer = gl_create_po_writer(stream);
+	gl_set_po_writer_kernel(writer, kernel);
+
+	size_t i = 0; for (; i < gl_get_translations_count(translations); ++i) {
+		gl_write_po_translation(writer, gl_get_translation(translations, i));
+	}
+	if (!gl_free_po_writer(writer)) {
+		gl_test_fail("Cannot write po entries");
+	}
+
+	fclose(stream);
+	return data;
+}
+
+
+
+/**
+ * Every escaping kernel has to produce valid po strings, no matter where
+ * special characters are located relative to its block size
+ */
+static void gl_test_po_writer(struct test_server* server) {
+	size_t capacity = 512 * GL_TEST_PO_MESSAGES;
+	uint8_t* body = malloc(capacity);
+	uint8_t* expected = malloc(4 * capacity);
+	size_t length = snprintf(body, capacity, "<GLStrings>\n\t<product>po</product>\n");
+	size_t expected_length = 0;
+
+
+	/* Messages of every length with XML escaped special characters, the
+	 * translation is the same message reversed
+	 */
+	size_t n = 0; for (; n < GL_TEST_PO_MESSAGES; ++n) {
+		uint8_t xml[2][512];
+		uint8_t po[2][512];
+		size_t xml_length[2] = {0, 0};
+		size_t po_length[2] = {0, 0};
+
+		size_t k = 0; for (; k < n; ++k) {
+			size_t direction = 0; for (; direction < 2; ++direction) {
+				uint8_t byte = gl_test_po_byte(n, direction ? n - 1 - k : k);
+				uint8_t const* entity = '"' == byte ? "&quot;" : '\n' == byte ? "&#10;" : '\t' == byte ? "&#9;" : 0;
+				uint8_t const* escape = '"' == byte ? "\\\"" : '\\' == byte ? "\\\\" : '\n' == byte ? "\\n" : '\t' == byte ? "\\t" : 0;
+
+				if (entity) {
+					xml_length[direction] += sprintf(&xml[direction][xml_length[direction]], "%s", entity);
+				} else {
+					xml[direction][xml_length[direction]++] = byte;
+				}
+				if (escape) {
+					po_length[direction] += sprintf(&po[direction][po_length[direction]], "%s", escape);
+				} else {
+					po[direction][po_length[direction]++] = byte;
+				}
+			}
+		}
+
+		length += snprintf(&body[length], capacity - length,
+			"\t<GLString>\n"
+			"\t\t<MasterString>%.*s</MasterString>\n"
+			"\t\t<LogicalString></LogicalString>\n"
+			"\t\t<ContextInfo>a.c:%lu&#10;b.c:%lu</ContextInfo>\n"
+			"\t\t<Translation>%.*s</Translation>\n"
+			"\t</GLString>\n",
+			(int)xml_length[0], xml[0],
+			(unsigned long)n, (unsigned long)n,
+			(int)xml_length[1], xml[1]
+		);
+		expected_length += sprintf(&expected[expected_length],
+			"# a.c:%lu\n# b.c:%lu\nmsgid \"%.*s\"\nmsgstr \"%.*s\"\n\n",
+			(unsigned long)n, (unsigned long)n,
+			(int)po_length[0], po[0],
+			(int)po_length[1], po[1]
+		);
+	}
+	length += snprintf(&body[length], capacity - length, "</GLStrings>\n");
+	test_server_add(server, "/strings/po/de", body, length);
+
+
+	/* Compare all kernels supported by the CPU
+	 */
+	struct gl_session* session = gl_create_session();
+	struct gl_translations* translations = gl_get_translations(session, "po", "de");
+	if (!translations || GL_TEST_PO_MESSAGES != gl_get_translations_count(translations)) {
+		gl_test_fail("Unexpected po writer fixture");
+	}
+
+	enum gl_po_kernel kernel = GL_PO_KERNEL_SCALAR; for (; kernel < GL_PO_KERNELS; ++kernel) {
+		struct gl_po_writer* writer = gl_create_po_writer(stdout);
+		bool supported = gl_set_po_writer_kernel(writer, kernel);
+		gl_free_po_writer(writer);
+
+		if (!supported) {
+			fprintf(stdout, "Skipping unsupported po kernel %s\n", gl_get_po_kernel_name(kernel));
+			continue;
+		}
+
+		char* po = gl_test_po_serialize(translations, kernel);
+		if (strlen(po) != expected_length || memcmp(po, expected, expected_length)) {
+			fprintf(stderr, "Po kernel %s failed\n", gl_get_po_kernel_name(kernel));
+			gl_test_fail("Unexpected po entries");
+		}
+		free(po);
+		fprintf(stdout, "Po kernel %s escapes correctly\n", gl_get_po_kernel_name(kernel));
+	}
+
+	gl_free_translations(translations);
+	gl_free_session(session);
+	free(expected);
+	free(body);
+}
+
+
+
+/**
+ * @return true iff both translations contain the same strings
+ */
+static bool gl_test_same_translation(struct gl_translation* a, struct gl_translation* b) {
+	return !strcmp(gl_get_translation_master_string(a), gl_get_translation_master_string(b))
+		&& !strcmp(gl_get_translation_logical_string(a), gl_get_translation_logical_string(b))
+		&& !strcmp(gl_get_translation_context_info(a), gl_get_translation_context_info(b))
+		&& !strcmp(gl_get_translation_string(a), gl_get_translation_string(b))
+		&& gl_get_translation_string_length(a) == gl_get_translation_string_length(b)
+	;
+}
+
+
+
+/**
+ * Snapshots of copied and zero copy catalogs have to contain the same
+ * strings after being mapped, missing catalogs stay empty and damaged files
+ * must not be opened
+ */
+static void gl_test_snapshot(__attribute__((unused)) struct test_server* server) {
+	uint8_t directory[] = "/tmp/gltoolkit-snapshot-XXXXXX";
+	if (!mkdtemp(directory)) {
+		gl_test_fail("Cannot create snapshot directory");
+	}
+	uint8_t path[4096];
+	snprintf(path, sizeof(path), "%s/demo.snapshot", directory);
+
+	size_t mode = 0; for (; mode < 2; ++mode) {
+		struct gl_session* session = gl_create_session();
+		gl_set_session_zero_copy(session, mode);
+
+		struct gl_languages* languages = gl_get_languages(session, "demo");
+		if (!languages) {
+			gl_test_fail("Cannot fetch languages of demo");
+		}
+		size_t count = gl_get_languages_count(languages);
+		struct gl_translations** translations = calloc(count, sizeof(struct gl_translations*));
+
+
+		/* The first language is left out of the snapshot
+		 */
+		size_t i = 1; for (; i < count; ++i) {
+			uint8_t const* code = gl_get_language_code(gl_get_language(languages, i));
+			translations[i] = gl_get_translations(session, "demo", code);
+
+			if (!translations[i]) {
+				gl_test_fail("Cannot fetch demo translations");
+			}
+		}
+
+		if (!gl_save_snapshot(path, languages, translations)) {
+			gl_test_fail("Cannot save snapshot");
+		}
+		struct gl_snapshot* snapshot = gl_open_snapshot(path);
+		if (!snapshot) {
+			gl_test_fail("Cannot open snapshot");
+		}
+
+
+		/* Compare every language and every string
+		 */
+		struct gl_languages* mapped = gl_get_snapshot_languages(snapshot);
+		if (count != gl_get_languages_count(mapped)
+				|| gl_get_snapshot_translations(snapshot, count)
+				|| gl_get_translations_count(gl_get_snapshot_translations(snapshot, 0))) {
+			gl_test_fail("Unexpected snapshot languages");
+		}
+
+		for (i = 0; i < count; ++i) {
+			struct gl_language* expected = gl_get_language(languages, i);
+			struct gl_language* actual = gl_get_language(mapped, i);
+
+			if (strcmp(gl_get_language_name(expected), gl_get_language_name(actual))
+					|| strcmp(gl_get_language_code(expected), gl_get_language_code(actual))) {
+				gl_test_fail("Unexpected snapshot language");
+			}
+			if (!translations[i]) {
+				continue;
+			}
+
+			struct gl_translations* catalog = gl_get_snapshot_translations(snapshot, i);
+			if (gl_get_translations_count(translations[i]) != gl_get_translations_count(catalog)) {
+				gl_test_fail("Unexpected snapshot catalog");
+			}
+
+			size_t j = 0; for (; j < gl_get_translations_count(catalog); ++j) {
+				struct gl_translation* translation = gl_get_translation(catalog, j);
+
+				if (!gl_test_same_translation(gl_get_translation(translations[i], j), translation)
+						|| translation != gl_find_translation_by_master(catalog, gl_get_translation_master_string(translation))) {
+					gl_test_fail("Unexpected snapshot translation");
+				}
+			}
+			gl_free_translations(translations[i]);
+		}
+
+		gl_close_snapshot(snapshot);
+		free(translations);
+		gl_free_languages(languages);
+		gl_free_session(session);
+	}
+
+
+	/* Records referencing strings outside the pool and strings lacking
+	 * their terminator are rejected, even though the length is right. The
+	 * language records start at the offset stored at byte 48 of the header,
+	 * each with the offset of its name
+	 */
+	struct stat status;
+	if (stat(path, &status)) {
+		gl_test_fail("Cannot stat snapshot");
+	}
+	uint8_t* original = malloc(status.st_size);
+	FILE* file = fopen(path, "r+b");
+	if ((size_t)status.st_size != fread(original, 1, status.st_size, file)) {
+		gl_test_fail("Cannot read snapshot");
+	}
+
+	uint64_t languages_offset = 0;
+	memcpy(&languages_offset, &original[48], sizeof(languages_offset));
+	int64_t outside = status.st_size;
+
+	fseek(file, languages_offset, SEEK_SET);
+	fwrite(&outside, sizeof(outside), 1, file);
+	fflush(file);
+	if (gl_open_snapshot(path) || !strstr(gl_get_error(), "corrupted")) {
+		gl_test_fail("Opened snapshot referencing strings outside the pool");
+	}
+
+	fseek(file, 0, SEEK_SET);
+	fwrite(original, 1, status.st_size, file);
+	fseek(file, status.st_size - 1, SEEK_SET);
+	fputc('x', file);
+	fclose(file);
+	free(original);
+	if (gl_open_snapshot(path) || !strstr(gl_get_error(), "corrupted")) {
+		gl_test_fail("Opened snapshot with unterminated string");
+	}
+
+
+	/* Truncated snapshots and other files are rejected
+	 */
+	if (truncate(path, status.st_size - 1) || gl_open_snapshot(path)) {
+		gl_test_fail("Opened truncated snapshot");
+	}
+
+	file = fopen(path, "wb");
+	fprintf(file, "<GLStrings></GLStrings>\n");
+	fclose(file);
+	if (gl_open_snapshot(path)) {
+		gl_test_fail("Opened file which is not a snapshot");
+	}
+
+	gl_test_remove_directory(directory);
+	fprintf(stdout, "Mapped snapshots of copied and zero copy catalogs\n");
+}
+
+
+
+/**
+ * Runs all tests against a local stand-in of GetLocalization.com
+ */
+int main() {
+	gl_test_init();
+
+	struct test_server* server = test_server_start(GLTOOLKIT_TEST_PORT);
+	if (!server) {
+		gl_test_fail("Cannot start stand-in server");
+	}
+	gl_test_serve_project(server);
+
+	gl_test_errors(server);
+	gl_test_session_reuse(server);
+	gl_test_session_concurrent(server, 1);
+	gl_test_session_concurrent(server, 2);
+	gl_test_throttle(server);
+	gl_test_arena(server);
+	gl_test_zero_copy(server);
+	gl_test_glstrings_parser();
+	gl_test_tokenizer();
+	gl_test_stream(server);
+	gl_test_cache(server);
+	gl_test_output();
+	gl_test_mo(server);
+	gl_test_phf(server);
+	gl_test_codegen(server);
+	gl_test_compression(server);
+	gl_test_po_writer(server);
+	gl_test_trace(server);
+	gl_test_index(server);
+	gl_test_intern(server);
+	gl_test_pipeline(1, 1);
+	gl_test_pipeline(3, 2);
+	gl_test_schedule(server);
+	gl_test_async(server);
+	gl_test_snapshot(server);
+
+	test_server_stop(server);
+	gl_cleanup();
+	fprintf(stdout, "All local tests passed :-)\n");
+	exit(EXIT_SUCCESS);
+}
+
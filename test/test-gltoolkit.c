@@ -31,11 +31,11 @@
 /**
  * Tests gl_language features
  */
-static void gl_test_languages(uint8_t const* project) {
+static void gl_test_languages(struct gl_session* session, uint8_t const* project) {
 
 	/* Load languages
 	 */
-	struct gl_languages* languages = gl_get_languages(project);
+	struct gl_languages* languages = gl_get_languages(session, project);
 
 	if (!languages) {
 		fprintf(stderr, "Cannot download languages of project %s\n", project);
@@ -64,7 +64,6 @@ static void gl_test_languages(uint8_t const* project) {
 	/* Free resources
 	 */
 	gl_free_languages(languages);
-	curl_global_cleanup();
 }
 
 
@@ -72,12 +71,12 @@ static void gl_test_languages(uint8_t const* project) {
 /**
  * Tests gl_translation features
  */
-static gl_test_translations(uint8_t const* project, uint8_t const* language) {
+static gl_test_translations(struct gl_session* session, uint8_t const* project, uint8_t const* language) {
 
 	/* Load translations of project in language
 	 */
 	struct gl_translations* translations = gl_get_translations(
-		project, language
+		session, project, language
 	);
 
 	if (!translations) {
@@ -119,7 +118,6 @@ static gl_test_translations(uint8_t const* project, uint8_t const* language) {
 	 */
 exit_success:
 	gl_free_translations(translations);
-	curl_global_cleanup();
 }
 
 
@@ -132,9 +130,23 @@ exit_success:
 int main(int argc, char** argv) {
 	uint8_t const* project = "violetland";
 
-	gl_test_languages(project);
-	gl_test_translations(project, "ru");
-	gl_test_translations(project, "de");
+	if (!gl_init()) {
+		fprintf(stderr, "Cannot initialize gltoolkit: %s\n", gl_get_error());
+		exit(EXIT_FAILURE);
+	}
+
+	struct gl_session* session = gl_create_session();
+	if (!session) {
+		fprintf(stderr, "Cannot create session: %s\n", gl_get_error());
+		exit(EXIT_FAILURE);
+	}
+
+	gl_test_languages(session, project);
+	gl_test_translations(session, project, "ru");
+	gl_test_translations(session, project, "de");
+
+	gl_free_session(session);
+	gl_cleanup();
 
 	fprintf(stdout, "All testes passed :-)\n");
 	exit(EXIT_SUCCESS);
@@ -0,0 +1,898 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "test-server.h"
+
+
+
+
+
+/**
+ * Maximum size of a request header
+ */
+#define TEST_SERVER_REQUEST_LENGTH 16384
+
+/**
+ * Size of chunks if a resource is sent using chunked transfer encoding
+ */
+#define TEST_SERVER_CHUNK_LENGTH 16384
+
+/**
+ * Interval in which blocked threads check whether the server is stopping
+ */
+#define TEST_SERVER_POLL_INTERVAL 50
+
+/**
+ * Last-Modified date of the first resource revision, every further revision
+ * is one second younger
+ */
+#define TEST_SERVER_EPOCH 1350000000
+
+
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * Static resource
+ */
+struct test_resource {
+	uint8_t* path;
+	uint8_t* body;
+	size_t length;
+
+	/* Send without Content-Length
+	 */
+	bool chunked;
+
+	/* gzip encoded body, sent to clients accepting it (optional)
+	 */
+	uint8_t* gzip;
+	size_t gzip_length;
+
+	/* Validators, changed whenever the resource is replaced
+	 */
+	uint8_t etag[32];
+	uint8_t last_modified[64];
+};
+
+
+
+/**
+ * [OPAQUE API]
+ *
+ * One connection handled by its own thread
+ */
+struct test_connection {
+	struct test_server* server;
+	int socket;
+	pthread_t thread;
+};
+
+
+
+/**
+ * [OPAQUE API]
+ */
+struct test_server {
+	int socket;
+	pthread_t thread;
+	bool stopping;
+
+	pthread_mutex_t lock;
+
+	struct test_resource* resources;
+	size_t resources_count;
+
+	struct test_connection** connections;
+	size_t connections_count;
+
+	size_t revision;
+	size_t requests;
+	size_t not_modified;
+
+	/* Simulated rate limit, at most `concurrency' requests are answered
+	 * at once and each takes `latency' milliseconds
+	 */
+	bool throttling;
+	size_t concurrency;
+	unsigned latency;
+	long retry_after;
+	size_t active;
+	size_t throttled;
+
+	/* Simulated link speed of every connection in bytes per second, 0 iff
+	 * unlimited
+	 */
+	size_t bandwidth;
+};
+
+
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return Resource registered for `path' or 0
+ */
+static struct test_resource* find_resource(
+			struct test_server* server,
+			uint8_t const* path
+		) {
+	size_t i = 0; for (; i < server->resources_count; ++i) {
+		if (!strcmp(server->resources[i].path, path)) {
+			return &server->resources[i];
+		}
+	}
+	return 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Copies the value of header `name' inside `request' into `value'
+ *
+ * @return true iff `request' contains header `name'
+ */
+static bool find_header(	uint8_t const* request,
+				uint8_t const* name,
+				uint8_t* value, size_t capacity
+		) {
+	uint8_t const* line = strstr(request, "\r\n");
+
+	for (; line; line = strstr(line + 2, "\r\n")) {
+		size_t name_length = strlen(name);
+
+		if (strncasecmp(line + 2, name, name_length) || ':' != line[2 + name_length]) {
+			continue;
+		}
+
+		uint8_t const* begin = &line[2 + name_length + 1];
+		while (' ' == *begin) {
+			++begin;
+		}
+		size_t length = strcspn(begin, "\r\n");
+		if (length >= capacity) {
+			return false;
+		}
+
+		memcpy(value, begin, length);
+		value[length] = 0;
+		return true;
+	}
+	return false;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return true iff the client's cached copy of `resource' is still valid
+ */
+static bool not_modified(struct test_resource* resource, uint8_t const* request) {
+	uint8_t value[TEST_SERVER_REQUEST_LENGTH];
+
+	/* If-Modified-Since is ignored if If-None-Match is present
+	 */
+	if (find_header(request, "If-None-Match", value, sizeof(value))) {
+		return !strcmp(value, resource->etag);
+	}
+	if (find_header(request, "If-Modified-Since", value, sizeof(value))) {
+		return !strcmp(value, resource->last_modified);
+	}
+	return false;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes the whole buffer into `socket'
+ *
+ * @return false iff the peer closed the connection
+ */
+static bool send_all(int socket, void const* buffer, size_t length) {
+	uint8_t const* data = buffer;
+
+	while (length) {
+		ssize_t sent = send(socket, data, length, MSG_NOSIGNAL);
+		if (sent <= 0) {
+			return false;
+		}
+		data += sent;
+		length -= sent;
+	}
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Writes the whole buffer into `socket' at no more than `bandwidth' bytes
+ * per second, 0 iff unlimited
+ *
+ * @return false iff the peer closed the connection
+ */
+static bool send_limited(	int socket,
+				void const* buffer, size_t length,
+				size_t bandwidth
+		) {
+	if (!bandwidth) {
+		return send_all(socket, buffer, length);
+	}
+	uint8_t const* data = buffer;
+
+	while (length) {
+		size_t slice = length < TEST_SERVER_CHUNK_LENGTH ? length : TEST_SERVER_CHUNK_LENGTH;
+		long nanoseconds = (long)(1000000000.0 * slice / bandwidth);
+		struct timespec duration = {
+			.tv_sec = nanoseconds / 1000000000L,
+			.tv_nsec = nanoseconds % 1000000000L
+		};
+		nanosleep(&duration, 0);
+
+		if (!send_all(socket, data, slice)) {
+			return false;
+		}
+		data += slice;
+		length -= slice;
+	}
+	return true;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Waits until `socket' is readable or the server is stopping
+ *
+ * @return true iff `socket' is readable
+ */
+static bool wait_readable(struct test_server* server, int socket) {
+	struct pollfd descriptor = {
+		.fd = socket,
+		.events = POLLIN
+	};
+
+	while (!__atomic_load_n(&server->stopping, __ATOMIC_ACQUIRE)) {
+		int ready = poll(&descriptor, 1, TEST_SERVER_POLL_INTERVAL);
+
+		if (ready > 0) {
+			return true;
+		}
+		if (ready < 0 && EINTR != errno) {
+			return false;
+		}
+	}
+	return false;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Reads one request header into `request'
+ *
+ * @return Length of request header or 0 iff the connection was closed
+ */
+static size_t read_request(	struct test_server* server,
+				int socket,
+				uint8_t* request,
+				size_t* buffered
+		) {
+
+	for (;;) {
+		uint8_t* end = 0;
+
+		if (*buffered) {
+			request[*buffered] = 0;
+			end = strstr(request, "\r\n\r\n");
+		}
+		if (end) {
+			return end - request + 4;
+		}
+		if (*buffered >= TEST_SERVER_REQUEST_LENGTH - 1) {
+			return 0;
+		}
+		if (!wait_readable(server, socket)) {
+			return 0;
+		}
+
+		ssize_t received = recv(
+			socket, &request[*buffered],
+			TEST_SERVER_REQUEST_LENGTH - 1 - *buffered, 0
+		);
+		if (received <= 0) {
+			return 0;
+		}
+		*buffered += received;
+	}
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Answers one request
+ *
+ * @return false iff the connection should be closed
+ */
+static bool answer_request(	struct test_server* server,
+				int socket,
+				uint8_t* request
+		) {
+
+	/* Request line `GET <path> HTTP/1.1'
+	 */
+	uint8_t path[TEST_SERVER_REQUEST_LENGTH];
+	if (1 != sscanf(request, "GET %16383s HTTP/1.1", path)) {
+		return false;
+	}
+	bool keep_alive = !strcasestr(request, "\r\nConnection: close");
+
+
+	/* Lookup resource
+	 */
+	pthread_mutex_lock(&server->lock);
+	struct test_resource* resource = find_resource(server, path);
+	bool unchanged = resource && not_modified(resource, request);
+	bool throttled = server->throttling && server->active >= server->concurrency;
+	bool throttling = server->throttling && !throttled;
+	long retry_after = server->retry_after;
+	unsigned latency = server->latency;
+	size_t bandwidth = server->bandwidth;
+
+	server->requests += 1;
+	server->not_modified += unchanged && !throttled;
+	server->throttled += throttled;
+	server->active += throttling;
+	pthread_mutex_unlock(&server->lock);
+
+
+	/* Reject requests exceeding the rate limit, accepted requests occupy
+	 * a slot while they are processed
+	 */
+	if (throttled) {
+		uint8_t const* notice = "Too many requests\n";
+		uint8_t header[512];
+		int header_length = retry_after >= 0
+			? snprintf(header, sizeof(header),
+				"HTTP/1.1 429 Too Many Requests\r\n"
+				"Retry-After: %li\r\n"
+				"Content-Length: %lu\r\n"
+				"\r\n",
+				retry_after, (unsigned long)strlen(notice)
+			)
+			: snprintf(header, sizeof(header),
+				"HTTP/1.1 503 Service Unavailable\r\n"
+				"Content-Length: %lu\r\n"
+				"\r\n",
+				(unsigned long)strlen(notice)
+			)
+		;
+		return send_all(socket, header, header_length)
+			&& send_all(socket, notice, strlen(notice))
+			&& keep_alive
+		;
+	}
+
+	if (throttling) {
+		struct timespec duration = {
+			.tv_sec = latency / 1000,
+			.tv_nsec = (latency % 1000) * 1000000L
+		};
+		nanosleep(&duration, 0);
+
+		pthread_mutex_lock(&server->lock);
+		server->active -= 1;
+		pthread_mutex_unlock(&server->lock);
+	}
+
+
+	/* Prefer encoded body iff the client accepts it
+	 */
+	uint8_t const* body = resource ? resource->body : 0;
+	size_t body_length = resource ? resource->length : 0;
+	uint8_t const* content_encoding = "";
+
+	uint8_t accept_encoding[256];
+	if (	resource && resource->gzip
+	&&	find_header(request, "Accept-Encoding", accept_encoding, sizeof(accept_encoding))
+	&&	strstr(accept_encoding, "gzip")) {
+		body = resource->gzip;
+		body_length = resource->gzip_length;
+		content_encoding = "Content-Encoding: gzip\r\n";
+	}
+
+
+	/* Write response
+	 */
+	uint8_t header[512];
+	int header_length = 0;
+
+	if (!resource) {
+		header_length = snprintf(header, sizeof(header),
+			"HTTP/1.1 404 Not Found\r\n"
+			"Content-Length: 0\r\n"
+			"\r\n"
+		);
+	} else if (unchanged) {
+		header_length = snprintf(header, sizeof(header),
+			"HTTP/1.1 304 Not Modified\r\n"
+			"ETag: %s\r\n"
+			"Last-Modified: %s\r\n"
+			"\r\n",
+			resource->etag, resource->last_modified
+		);
+	} else if (resource->chunked) {
+		header_length = snprintf(header, sizeof(header),
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Type: text/xml; charset=UTF-8\r\n"
+			"ETag: %s\r\n"
+			"Last-Modified: %s\r\n"
+			"%s"
+			"Transfer-Encoding: chunked\r\n"
+			"\r\n",
+			resource->etag, resource->last_modified,
+			content_encoding
+		);
+	} else {
+		header_length = snprintf(header, sizeof(header),
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Type: text/xml; charset=UTF-8\r\n"
+			"ETag: %s\r\n"
+			"Last-Modified: %s\r\n"
+			"%s"
+			"Content-Length: %lu\r\n"
+			"\r\n",
+			resource->etag, resource->last_modified,
+			content_encoding,
+			(unsigned long)body_length
+		);
+	}
+
+	if (!send_all(socket, header, header_length)) {
+		return false;
+	}
+	if (!resource || unchanged) {
+		return keep_alive;
+	}
+	if (!resource->chunked) {
+		return send_limited(socket, body, body_length, bandwidth) && keep_alive;
+	}
+
+
+	/* Chunked transfer encoding
+	 */
+	size_t offset = 0; while (offset < body_length) {
+		size_t length = body_length - offset;
+		if (length > TEST_SERVER_CHUNK_LENGTH) {
+			length = TEST_SERVER_CHUNK_LENGTH;
+		}
+
+		header_length = snprintf(header, sizeof(header), "%lx\r\n", (unsigned long)length);
+		if (	!send_all(socket, header, header_length)
+		||	!send_all(socket, &body[offset], length)
+		||	!send_all(socket, "\r\n", 2)) {
+			return false;
+		}
+		offset += length;
+	}
+	return send_all(socket, "0\r\n\r\n", 5) && keep_alive;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Serves requests on one connection until the client closes it
+ */
+static void* serve_connection(void* context) {
+	struct test_connection* connection = context;
+	uint8_t* request = malloc(TEST_SERVER_REQUEST_LENGTH);
+	size_t buffered = 0;
+
+	for (;;) {
+		size_t length = read_request(
+			connection->server, connection->socket,
+			request, &buffered
+		);
+		if (!length) {
+			break;
+		}
+		if (!answer_request(connection->server, connection->socket, request)) {
+			break;
+		}
+
+		/* Keep pipelined data
+		 */
+		memmove(request, &request[length], buffered - length);
+		buffered -= length;
+	}
+
+	free(request);
+	close(connection->socket);
+	return 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Accepts connections until the server is stopped
+ */
+static void* accept_connections(void* context) {
+	struct test_server* server = context;
+
+	while (wait_readable(server, server->socket)) {
+		int socket = accept(server->socket, 0, 0);
+		if (socket < 0) {
+			continue;
+		}
+
+		/* Headers and body are sent separately, without disabling Nagle's
+		 * algorithm small responses would wait for a delayed ACK
+		 */
+		int nodelay = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+		struct test_connection* connection = malloc(sizeof(struct test_connection));
+		connection->server = server;
+		connection->socket = socket;
+
+		pthread_mutex_lock(&server->lock);
+		server->connections = realloc(server->connections,
+			(server->connections_count + 1) * sizeof(struct test_connection*)
+		);
+		server->connections[server->connections_count++] = connection;
+		pthread_mutex_unlock(&server->lock);
+
+		pthread_create(&connection->thread, 0, serve_connection, connection);
+	}
+	return 0;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * @return gzip encoded copy of `body'
+ */
+static uint8_t* gzip_body(uint8_t const* body, size_t length, size_t* gzip_length) {
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+
+	/* Window bits above 15 select the gzip container
+	 */
+	deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+
+	size_t capacity = deflateBound(&stream, length);
+	uint8_t* gzip = malloc(capacity);
+
+	stream.next_in = (Bytef*)body;
+	stream.avail_in = length;
+	stream.next_out = gzip;
+	stream.avail_out = capacity;
+
+	deflate(&stream, Z_FINISH);
+	*gzip_length = stream.total_out;
+	deflateEnd(&stream);
+
+	return gzip;
+}
+
+
+
+/**
+ * [PRIVATE]
+ *
+ * Registers or replaces a resource
+ */
+static void add_resource(	struct test_server* server,
+				uint8_t const* path,
+				uint8_t const* body, size_t length,
+				bool chunked, bool gzip
+		) {
+	pthread_mutex_lock(&server->lock);
+
+	struct test_resource* resource = find_resource(server, path);
+	if (!resource) {
+		server->resources = realloc(server->resources,
+			(server->resources_count + 1) * sizeof(struct test_resource)
+		);
+		resource = &server->resources[server->resources_count++];
+		resource->path = strdup(path);
+	} else {
+		free(resource->body);
+		free(resource->gzip);
+	}
+
+	resource->body = malloc(length + 1);
+	memcpy(resource->body, body, length);
+	resource->length = length;
+	resource->chunked = chunked;
+
+	resource->gzip = 0;
+	resource->gzip_length = 0;
+	if (gzip) {
+		resource->gzip = gzip_body(body, length, &resource->gzip_length);
+	}
+
+
+	/* New validators for every revision
+	 */
+	server->revision += 1;
+	time_t modified = TEST_SERVER_EPOCH + server->revision;
+	struct tm date;
+
+	snprintf(resource->etag, sizeof(resource->etag), "\"r%lu\"", (unsigned long)server->revision);
+	strftime(resource->last_modified, sizeof(resource->last_modified),
+		"%a, %d %b %Y %H:%M:%S GMT", gmtime_r(&modified, &date)
+	);
+
+	pthread_mutex_unlock(&server->lock);
+}
+
+
+
+
+
+/**
+ * [PUBLIC API]
+ */
+struct test_server* test_server_start(uint16_t port) {
+
+	/* Listen on loopback interface
+	 */
+	int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (socket_fd < 0) {
+		fprintf(stderr, "Cannot create server socket\n");
+		return 0;
+	}
+
+	int reuse = 1;
+	setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(socket_fd, (struct sockaddr*)&address, sizeof(address)) || listen(socket_fd, 64)) {
+		fprintf(stderr, "Cannot listen on 127.0.0.1:%u\n", (unsigned)port);
+		close(socket_fd);
+		return 0;
+	}
+
+
+	/* Start accepting connections
+	 */
+	struct test_server* server = calloc(1, sizeof(struct test_server));
+	server->socket = socket_fd;
+	pthread_mutex_init(&server->lock, 0);
+	pthread_create(&server->thread, 0, accept_connections, server);
+
+	return server;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void test_server_add(	struct test_server* server,
+			uint8_t const* path,
+			uint8_t const* body, size_t length
+		) {
+	add_resource(server, path, body, length, false, false);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void test_server_add_chunked(	struct test_server* server,
+				uint8_t const* path,
+				uint8_t const* body, size_t length
+		) {
+	add_resource(server, path, body, length, true, false);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void test_server_add_gzip(	struct test_server* server,
+				uint8_t const* path,
+				uint8_t const* body, size_t length
+		) {
+	add_resource(server, path, body, length, false, true);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void test_server_throttle(	struct test_server* server,
+				size_t concurrency,
+				unsigned latency,
+				long retry_after
+		) {
+	pthread_mutex_lock(&server->lock);
+	server->throttling = true;
+	server->concurrency = concurrency;
+	server->latency = latency;
+	server->retry_after = retry_after;
+	pthread_mutex_unlock(&server->lock);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void test_server_unthrottle(struct test_server* server) {
+	pthread_mutex_lock(&server->lock);
+	server->throttling = false;
+	pthread_mutex_unlock(&server->lock);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void test_server_limit_bandwidth(struct test_server* server, size_t bandwidth) {
+	pthread_mutex_lock(&server->lock);
+	server->bandwidth = bandwidth;
+	pthread_mutex_unlock(&server->lock);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t test_server_throttled(struct test_server* server) {
+	pthread_mutex_lock(&server->lock);
+	size_t throttled = server->throttled;
+	pthread_mutex_unlock(&server->lock);
+
+	return throttled;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t test_server_connections(struct test_server* server) {
+	pthread_mutex_lock(&server->lock);
+	size_t connections = server->connections_count;
+	pthread_mutex_unlock(&server->lock);
+
+	return connections;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t test_server_requests(struct test_server* server) {
+	pthread_mutex_lock(&server->lock);
+	size_t requests = server->requests;
+	pthread_mutex_unlock(&server->lock);
+
+	return requests;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+size_t test_server_not_modified(struct test_server* server) {
+	pthread_mutex_lock(&server->lock);
+	size_t not_modified = server->not_modified;
+	pthread_mutex_unlock(&server->lock);
+
+	return not_modified;
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void test_server_clear(struct test_server* server) {
+	pthread_mutex_lock(&server->lock);
+
+	size_t i = 0; for (; i < server->resources_count; ++i) {
+		free(server->resources[i].path);
+		free(server->resources[i].body);
+		free(server->resources[i].gzip);
+	}
+	free(server->resources);
+
+	server->resources = 0;
+	server->resources_count = 0;
+
+	pthread_mutex_unlock(&server->lock);
+}
+
+
+
+/**
+ * [PUBLIC API]
+ */
+void test_server_stop(struct test_server* server) {
+	__atomic_store_n(&server->stopping, true, __ATOMIC_RELEASE);
+	pthread_join(server->thread, 0);
+	close(server->socket);
+
+	size_t i = 0; for (; i < server->connections_count; ++i) {
+		pthread_join(server->connections[i]->thread, 0);
+		free(server->connections[i]);
+	}
+	free(server->connections);
+
+	test_server_clear(server);
+	pthread_mutex_destroy(&server->lock);
+	free(server);
+}
+
@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2012 ooxi/gltoolkit
+ *     https://github.com/ooxi/gltoolkit
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ * 
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software in a
+ *     product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ * 
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ */
+#ifndef GLTOOLKIT_TEST_SERVER
+#define GLTOOLKIT_TEST_SERVER
+
+
+
+
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Opaque structures
+ */
+struct test_server;
+
+
+
+
+
+/**
+ * Starts a minimal HTTP/1.1 server on 127.0.0.1:`port' which serves static
+ * resources and supports keep-alive connections as well as conditional
+ * requests using ETag and Last-Modified. It is used as a stand-in for
+ * GetLocalization.com, so tests do not depend on the network
+ *
+ * @return Running server or 0 on failure
+ */
+struct test_server* test_server_start(uint16_t port);
+
+/**
+ * Serves `body' for requests of `path'. The body is copied
+ *
+ * @warning Must not be called while requests are in flight
+ */
+void test_server_add(	struct test_server* server,
+			uint8_t const* path,
+			uint8_t const* body, size_t length
+);
+
+/**
+ * Serves `body' for requests of `path' using chunked transfer encoding, so
+ * the client does not know the length in advance. The body is copied
+ *
+ * @warning Must not be called while requests are in flight
+ */
+void test_server_add_chunked(	struct test_server* server,
+				uint8_t const* path,
+				uint8_t const* body, size_t length
+);
+
+/**
+ * Serves `body' for requests of `path' using gzip content encoding, iff the
+ * client accepts it. The body is copied
+ *
+ * @warning Must not be called while requests are in flight
+ */
+void test_server_add_gzip(	struct test_server* server,
+				uint8_t const* path,
+				uint8_t const* body, size_t length
+);
+
+/**
+ * Removes all resources, so large fixtures do not stay in memory
+ *
+ * @warning Must not be called while requests are in flight
+ */
+void test_server_clear(struct test_server* server);
+
+/**
+ * Simulates a rate limited server: at most `concurrency' requests are
+ * processed at once, each taking `latency' milliseconds. Further requests
+ * are rejected with 429 Too Many Requests and `retry_after' seconds as
+ * Retry-After, or with 503 Service Unavailable iff `retry_after' is negative
+ */
+void test_server_throttle(	struct test_server* server,
+				size_t concurrency,
+				unsigned latency,
+				long retry_after
+);
+
+/**
+ * Stops simulating a rate limit
+ */
+void test_server_unthrottle(struct test_server* server);
+
+/**
+ * Simulates a slow link: bodies of responses without chunked transfer
+ * encoding are sent at `bandwidth' bytes per second and connection, 0 for
+ * full speed
+ */
+void test_server_limit_bandwidth(struct test_server* server, size_t bandwidth);
+
+/**
+ * @return Number of requests rejected because of the simulated rate limit
+ */
+size_t test_server_throttled(struct test_server* server);
+
+/**
+ * @return Number of TCP connections accepted so far
+ */
+size_t test_server_connections(struct test_server* server);
+
+/**
+ * @return Number of requests answered so far
+ */
+size_t test_server_requests(struct test_server* server);
+
+/**
+ * @return Number of conditional requests answered with 304 Not Modified
+ */
+size_t test_server_not_modified(struct test_server* server);
+
+/**
+ * Stops the server and frees all resources
+ */
+void test_server_stop(struct test_server* server);
+
+
+
+
+
+#endif
+